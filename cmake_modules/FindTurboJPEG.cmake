@@ -0,0 +1,22 @@
+#
+# Find the libjpeg-turbo TurboJPEG API includes and library
+#
+# This module defines
+# TURBOJPEG_INCLUDE_DIR, where to find turbojpeg.h
+# TURBOJPEG_LIBRARIES, the libraries to link against to use TurboJPEG.
+# TURBOJPEG_FOUND, If false, do not try to use TurboJPEG.
+
+FIND_PATH(TURBOJPEG_INCLUDE_DIR turbojpeg.h)
+
+FIND_LIBRARY(TURBOJPEG_LIBRARY turbojpeg)
+
+SET(TURBOJPEG_LIBRARIES ${TURBOJPEG_LIBRARY})
+
+INCLUDE(FindPackageHandleStandardArgs)
+FIND_PACKAGE_HANDLE_STANDARD_ARGS(TURBOJPEG
+  "Could NOT find the TurboJPEG library"
+  TURBOJPEG_LIBRARY
+  TURBOJPEG_INCLUDE_DIR
+  )
+
+MARK_AS_ADVANCED(TURBOJPEG_INCLUDE_DIR TURBOJPEG_LIBRARY)
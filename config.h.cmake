@@ -6,3 +6,6 @@
 
 /* Set when theora is detected */
 #cmakedefine HAVE_THEORA
+
+/* Set when the TurboJPEG API of libjpeg-turbo is detected */
+#cmakedefine HAVE_TURBOJPEG
@@ -20,8 +20,10 @@
 #include "agent_imager.h"
 #include "indistandardproperty.h"
 
+#include <cerrno>
 #include <cstring>
 #include <algorithm>
+#include <fstream>
 #include <memory>
 
 #include "group.h"
@@ -77,12 +79,23 @@ void ISSnoopDevice(XMLEle *root)
 
 Imager::Imager()
 {
-    setVersion(1, 2);
+    setVersion(1, 3);
     groups.resize(MAX_GROUP_COUNT);
     int i=0;
     std::generate(groups.begin(), groups.end(), [this, &i] { return std::make_shared<Group>(i++, this); });
 }
 
+Imager::~Imager()
+{
+    {
+        std::lock_guard<std::mutex> lock(saveMutex);
+        stopSaving = true;
+    }
+    saveCondition.notify_all();
+    if (saveThread.joinable())
+        saveThread.join();
+}
+
 bool Imager::isRunning()
 {
     return ProgressNP.s == IPS_BUSY;
@@ -139,6 +152,7 @@ void Imager::initiateNextFilter()
         else if (filterSlot != 0 && FilterSlotN[0].value != filterSlot)
         {
             FilterSlotN[0].value = filterSlot;
+            filterMoving         = true;
             sendNewNumber(&FilterSlotNP);
             LOGF_DEBUG("Group %d of %d, image %d of %d, filer %d, filter set initiated on %s",
                    group, maxGroup, image, maxImage, (int)FilterSlotN[0].value, FilterSlotNP.device);
@@ -162,9 +176,21 @@ void Imager::initiateNextCapture()
                 IDSetNumber(&ProgressNP, "CCD is not connected");
                 return;
             }
+            Capture capture;
+            capture.group    = group;
+            capture.image    = image;
+            capture.exposure = currentGroup()->exposure();
+            capture.started  = std::chrono::steady_clock::now();
+            captures.push_back(capture);
+            ccdBusy = true;
+
+            ProgressN[0].value = group;
+            ProgressN[1].value = image;
+            IDSetNumber(&ProgressNP, nullptr);
+
             CCDImageBinN[0].value = CCDImageBinN[1].value = currentGroup()->binning();
             sendNewNumber(&CCDImageBinNP);
-            CCDImageExposureN[0].value = currentGroup()->exposure();
+            CCDImageExposureN[0].value = capture.exposure;
             sendNewNumber(&CCDImageExposureNP);
             IUSaveText(&CCDUploadSettingsT[0], ImageNameT[0].text);
             IUSaveText(&CCDUploadSettingsT[1], "_TMP_");
@@ -173,23 +199,71 @@ void Imager::initiateNextCapture()
             LOGF_DEBUG("Group %d of %d, image %d of %d, duration %.1fs, binning %d, capture initiated on %s", group,
                    maxGroup, image, maxImage, CCDImageExposureN[0].value, (int)CCDImageBinN[0].value,
                    CCDImageExposureNP.device);
+
+            // Move on to the image to take next, group is past maxGroup once all are requested
+            if (image < maxImage)
+                image++;
+            else if (++group <= maxGroup)
+            {
+                image    = 1;
+                maxImage = currentGroup()->count();
+            }
         }
     }
 }
 
+void Imager::captureNext()
+{
+    if (!isRunning() || ccdBusy || filterMoving || !checkSaves())
+        return;
+
+    if (group > maxGroup)
+    {
+        // All exposures are taken, the batch is done once the last images are in and on disk
+        if (captures.empty())
+        {
+            waitForSaves(0);
+            if (checkSaves())
+                batchDone();
+        }
+        return;
+    }
+
+    // A filter change drains the pipeline, so the wheel only moves once the previous group is on disk.
+    // Otherwise up to PIPELINE_DEPTH images are downloaded or saved while the next exposure runs.
+    int filterSlot    = currentGroup()->filterSlot();
+    bool filterChange = isFilterConnected() && filterSlot != 0 && FilterSlotN[0].value != filterSlot;
+    size_t depth      = filterChange ? 0 : static_cast<size_t>(PipelineN[0].value);
+
+    // Called again when the next image arrives
+    if (captures.size() > depth)
+        return;
+
+    waitForSaves(depth - captures.size());
+    if (checkSaves())
+        initiateNextFilter();
+}
+
 void Imager::startBatch()
 {
     LOG_DEBUG("Batch started");
     ProgressN[0].value = group = 1;
     ProgressN[1].value = image = 1;
     maxImage                   = currentGroup()->count();
-    ProgressNP.s               = IPS_BUSY;
+    captures.clear();
+    ccdBusy = filterMoving = false;
+    {
+        std::lock_guard<std::mutex> lock(saveMutex);
+        saveFailed = false;
+    }
+    ProgressNP.s = IPS_BUSY;
     IDSetNumber(&ProgressNP, nullptr);
-    initiateNextFilter();
+    captureNext();
 }
 
 void Imager::abortBatch()
 {
+    captures.clear();
     ProgressNP.s = IPS_ALERT;
     IDSetNumber(&ProgressNP, "Batch aborted");
 }
@@ -242,6 +316,135 @@ void Imager::initiateDownload()
     }
 }
 
+/* Match an arriving image to the oldest awaited exposure. Returns false for images nobody asked for. */
+bool Imager::newFrame(const char *extension, Frame &frame)
+{
+    if (captures.empty())
+    {
+        LOG_DEBUG("Image received without a pending capture, ignored");
+        return false;
+    }
+
+    auto now        = std::chrono::steady_clock::now();
+    Capture capture = captures.front();
+    char name[128]={0};
+
+    captures.pop_front();
+
+    strncpy(format, extension, sizeof(format));
+    snprintf(name, sizeof(name), IMAGE_NAME, ImageNameT[0].text, ImageNameT[1].text, capture.group, capture.image,
+             format);
+    frame.group = capture.group;
+    frame.image = capture.image;
+    frame.name  = name;
+
+    // Without a countdown from the CCD, assume the exposure took exactly the requested duration
+    if (capture.endSeen)
+        frame.exposure = std::chrono::duration<double>(capture.ended - capture.started).count();
+    else
+        frame.exposure = capture.exposure;
+    frame.download = std::max(0.0, std::chrono::duration<double>(now - capture.started).count() - frame.exposure);
+
+    return true;
+}
+
+void Imager::queueFrame(Frame &&frame)
+{
+    {
+        std::lock_guard<std::mutex> lock(saveMutex);
+        if (!saveThread.joinable())
+            saveThread = std::thread(&Imager::saveLoop, this);
+        saveQueue.push_back(std::move(frame));
+        pendingSaves++;
+    }
+    saveCondition.notify_all();
+
+    captureNext();
+}
+
+void Imager::waitForSaves(size_t depth)
+{
+    std::unique_lock<std::mutex> lock(saveMutex);
+    saveCondition.wait(lock, [this, depth] { return pendingSaves <= depth; });
+}
+
+/* Stop the batch once an image could not be saved. Returns false if one failed. */
+bool Imager::checkSaves()
+{
+    std::lock_guard<std::mutex> lock(saveMutex);
+
+    if (!saveFailed)
+        return true;
+
+    if (isRunning())
+    {
+        captures.clear();
+        ProgressNP.s = IPS_ALERT;
+        IDSetNumber(&ProgressNP, "Image could not be saved, batch stopped");
+    }
+    return false;
+}
+
+bool Imager::saveFrame(Frame &frame)
+{
+    auto start = std::chrono::steady_clock::now();
+    bool saved = true;
+
+    if (frame.source.empty())
+    {
+        std::ofstream file;
+        file.open(frame.name, std::ios::out | std::ios::binary | std::ios::trunc);
+        file.write(frame.data.data(), frame.data.size());
+        file.close();
+        saved = !file.fail();
+    }
+    else
+    {
+        saved = (rename(frame.source.c_str(), frame.name.c_str()) == 0);
+    }
+
+    if (!saved)
+    {
+        LOGF_ERROR("Group %d, image %d, failed to save %s: %s", frame.group, frame.image, frame.name.c_str(),
+                   strerror(errno));
+        FrameTimingNP.s = IPS_ALERT;
+        IDSetNumber(&FrameTimingNP, nullptr);
+        return false;
+    }
+
+    double save = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    LOGF_DEBUG("Group %d, image %d, saved to %s (exposure %.3fs, download %.3fs, save %.3fs)", frame.group,
+               frame.image, frame.name.c_str(), frame.exposure, frame.download, save);
+
+    FrameTimingN[0].value = frame.exposure;
+    FrameTimingN[1].value = frame.download;
+    FrameTimingN[2].value = save;
+    FrameTimingNP.s       = IPS_OK;
+    IDSetNumber(&FrameTimingNP, nullptr);
+    return true;
+}
+
+void Imager::saveLoop()
+{
+    std::unique_lock<std::mutex> lock(saveMutex);
+    while (true)
+    {
+        saveCondition.wait(lock, [this] { return stopSaving || !saveQueue.empty(); });
+        if (saveQueue.empty())
+            return;
+
+        Frame frame = std::move(saveQueue.front());
+        saveQueue.pop_front();
+        lock.unlock();
+        bool saved = saveFrame(frame);
+        lock.lock();
+        if (!saved)
+            saveFailed = true;
+        pendingSaves--;
+        saveCondition.notify_all();
+    }
+}
+
 // DefaultDevice ----------------------------------------------------------------------------
 
 const char *Imager::getDefaultName()
@@ -294,9 +497,20 @@ bool Imager::initProperties()
     IUFillBLOB(&FitsB[0], "IMAGE", "Image", "");
     IUFillBLOBVector(&FitsBP, FitsB, 1, getDefaultName(), "IMAGE", "Image Data", DOWNLOAD_TAB, IP_RO, 60, IPS_IDLE);
 
+    IUFillNumber(&PipelineN[0], "PIPELINE_DEPTH", "Frames in flight", "%1.0f", 0, 4, 1, 1);
+    IUFillNumberVector(&PipelineNP, PipelineN, 1, getDefaultName(), "PIPELINE", "Pipeline", OPTIONS_TAB, IP_RW, 60,
+                       IPS_IDLE);
+
+    IUFillNumber(&FrameTimingN[0], "EXPOSURE", "Exposure (s)", "%6.3f", 0, 36000, 0, 0);
+    IUFillNumber(&FrameTimingN[1], "DOWNLOAD", "Download (s)", "%6.3f", 0, 36000, 0, 0);
+    IUFillNumber(&FrameTimingN[2], "SAVE", "Save (s)", "%6.3f", 0, 36000, 0, 0);
+    IUFillNumberVector(&FrameTimingNP, FrameTimingN, 3, getDefaultName(), "FRAME_TIMING", "Last frame timing",
+                       MAIN_CONTROL_TAB, IP_RO, 60, IPS_IDLE);
+
     defineNumber(&GroupCountNP);
     defineText(&ControlledDeviceTP);
     defineText(&ImageNameTP);
+    defineNumber(&PipelineNP);
 
     for (int i = 0; i < GroupCountN[0].value; i++)
     {
@@ -347,6 +561,8 @@ bool Imager::updateProperties()
         defineNumber(&DownloadNP);
         FitsBP.s = IPS_IDLE;
         defineBLOB(&FitsBP);
+        FrameTimingNP.s = IPS_IDLE;
+        defineNumber(&FrameTimingNP);
     }
     else
     {
@@ -355,6 +571,7 @@ bool Imager::updateProperties()
         deleteProperty(BatchSP.name);
         deleteProperty(DownloadNP.name);
         deleteProperty(FitsBP.name);
+        deleteProperty(FrameTimingNP.name);
     }
     return true;
 }
@@ -388,6 +605,13 @@ bool Imager::ISNewNumber(const char *dev, const char *name, double values[], cha
             initiateDownload();
             return true;
         }
+        if (std::string{name} == std::string{PipelineNP.name})
+        {
+            IUUpdateNumber(&PipelineNP, values, names, n);
+            PipelineNP.s = IPS_OK;
+            IDSetNumber(&PipelineNP, nullptr);
+            return true;
+        }
         if (strncmp(name, GROUP_PREFIX, GROUP_PREFIX_LEN) == 0)
         {
             for (int i = 0; i < GroupCountN[0].value; i++)
@@ -554,39 +778,15 @@ void Imager::removeDevice(INDI::BaseDevice *dp)
 
 void Imager::newBLOB(IBLOB *bp)
 {
-    if (ProgressNP.s == IPS_BUSY)
+    Frame frame;
+
+    if (ProgressNP.s == IPS_BUSY && newFrame(bp->format, frame))
     {
-        char name[128]={0};
-        std::ofstream file;
+        char *data = static_cast<char *>(bp->blob);
 
-        strncpy(format, bp->format, 16);
-        sprintf(name, IMAGE_NAME, ImageNameT[0].text, ImageNameT[1].text, group, image, format);
-        file.open(name, std::ios::out | std::ios::binary | std::ios::trunc);
-        file.write(static_cast<char *>(bp->blob), bp->bloblen);
-        file.close();
-        LOGF_DEBUG("Group %d of %d, image %d of %d, saved to %s", group, maxGroup, image, maxImage,
-               name);
-        if (image == maxImage)
-        {
-            if (group == maxGroup)
-            {
-                batchDone();
-            }
-            else
-            {
-                maxImage           = nextGroup()->count();
-                ProgressN[0].value = group = group + 1;
-                ProgressN[1].value = image = 1;
-                IDSetNumber(&ProgressNP, nullptr);
-                initiateNextFilter();
-            }
-        }
-        else
-        {
-            ProgressN[1].value = image = image + 1;
-            IDSetNumber(&ProgressNP, nullptr);
-            initiateNextFilter();
-        }
+        // The client reuses the BLOB buffer for the next image, so the saver gets its own copy
+        frame.data.assign(data, data + bp->bloblen);
+        queueFrame(std::move(frame));
     }
 }
 
@@ -633,6 +833,33 @@ void Imager::newNumber(INumberVectorProperty *nvp)
         {
             ProgressN[2].value = nvp->np[0].value;
             IDSetNumber(&ProgressNP, nullptr);
+
+            // The countdown reaching zero ends the exposure of the newest capture, unless its image is in already
+            if (!captures.empty())
+            {
+                Capture &capture = captures.back();
+                if (nvp->s == IPS_BUSY && nvp->np[0].value > 0)
+                    capture.running = true;
+                else if (capture.running && !capture.endSeen)
+                {
+                    capture.ended   = std::chrono::steady_clock::now();
+                    capture.endSeen = true;
+                }
+            }
+
+            // The CCD accepts the next exposure once it is done with this one, images may still be on the way
+            if (ccdBusy && nvp->s == IPS_ALERT && isRunning())
+            {
+                ccdBusy = false;
+                captures.clear();
+                ProgressNP.s = IPS_ALERT;
+                IDSetNumber(&ProgressNP, "Exposure failed");
+            }
+            else if (ccdBusy && nvp->s == IPS_OK)
+            {
+                ccdBusy = false;
+                captureNext();
+            }
         }
     }
     if (deviceName == controlledFilterWheel)
@@ -640,8 +867,17 @@ void Imager::newNumber(INumberVectorProperty *nvp)
         if (strcmp(nvp->name, "FILTER_SLOT") == 0)
         {
             FilterSlotN[0].value = nvp->np->value;
-            if (nvp->s == IPS_OK)
+            if (filterMoving && nvp->s == IPS_OK)
+            {
+                filterMoving = false;
                 initiateNextCapture();
+            }
+            else if (filterMoving && nvp->s == IPS_ALERT && isRunning())
+            {
+                filterMoving = false;
+                ProgressNP.s = IPS_ALERT;
+                IDSetNumber(&ProgressNP, "Filter change failed");
+            }
         }
     }
 }
@@ -652,35 +888,15 @@ void Imager::newText(ITextVectorProperty *tvp)
 
     if (deviceName == controlledCCD)
     {
-        if (strcmp(tvp->name, "CCD_FILE_PATH") == 0)
+        if (strcmp(tvp->name, "CCD_FILE_PATH") == 0 && ProgressNP.s == IPS_BUSY)
         {
-            char name[128]={0};
-
-            strncpy(format, strrchr(tvp->tp[0].text, '.'), sizeof(format));
-            sprintf(name, IMAGE_NAME, ImageNameT[0].text, ImageNameT[1].text, group, image, format);
-            rename(tvp->tp[0].text, name);
-            LOGF_DEBUG("Group %d of %d, image %d of %d, saved to %s", group, maxGroup, image,
-                   maxImage, name);
-            if (image == maxImage)
-            {
-                if (group == maxGroup)
-                {
-                    batchDone();
-                }
-                else
-                {
-                    maxImage           = nextGroup()->count();
-                    ProgressN[0].value = group = group + 1;
-                    ProgressN[1].value = image = 1;
-                    IDSetNumber(&ProgressNP, nullptr);
-                    initiateNextFilter();
-                }
-            }
-            else
+            const char *extension = strrchr(tvp->tp[0].text, '.');
+            Frame frame;
+
+            if (newFrame(extension ? extension : "", frame))
             {
-                ProgressN[1].value = image = image + 1;
-                IDSetNumber(&ProgressNP, nullptr);
-                initiateNextFilter();
+                frame.source = tvp->tp[0].text;
+                queueFrame(std::move(frame));
             }
         }
     }
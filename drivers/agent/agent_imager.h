@@ -21,6 +21,15 @@
 
 #include "baseclient.h"
 #include "defaultdevice.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
 #define MAX_GROUP_COUNT 16
 
 class Group;
@@ -29,7 +38,7 @@ class Imager : public virtual INDI::DefaultDevice, public virtual INDI::BaseClie
   public:
     static const std::string DEVICE_NAME;
     Imager();
-    virtual ~Imager() = default;
+    virtual ~Imager();
 
     // DefaultDevice
 
@@ -71,11 +80,47 @@ class Imager : public virtual INDI::DefaultDevice, public virtual INDI::BaseClie
     void deleteProperties();
     void initiateNextFilter();
     void initiateNextCapture();
+    void captureNext();
     void startBatch();
     void abortBatch();
     void batchDone();
     void initiateDownload();
 
+    /**
+     * @brief Capture An exposure requested from the CCD whose image has not arrived yet.
+     */
+    struct Capture
+    {
+        int group { 0 };
+        int image { 0 };
+        double exposure { 0 };
+        std::chrono::steady_clock::time_point started;
+        std::chrono::steady_clock::time_point ended;
+        bool running { false };
+        bool endSeen { false };
+    };
+
+    /**
+     * @brief Frame A captured image waiting to be written to the image folder.
+     */
+    struct Frame
+    {
+        int group { 0 };
+        int image { 0 };
+        std::string name;
+        // File saved by the CCD driver in local upload mode, empty if data holds the image
+        std::string source;
+        std::vector<char> data;
+        double exposure { 0 };
+        double download { 0 };
+    };
+    bool newFrame(const char *extension, Frame &frame);
+    void queueFrame(Frame &&frame);
+    void waitForSaves(size_t depth);
+    bool checkSaves();
+    bool saveFrame(Frame &frame);
+    void saveLoop();
+
     char format[16];
     int group { 0 };
     int maxGroup { 0 };
@@ -100,6 +145,10 @@ class Imager : public virtual INDI::DefaultDevice, public virtual INDI::BaseClie
     INumber DownloadN[2];
     IBLOBVectorProperty FitsBP;
     IBLOB FitsB[1];
+    INumberVectorProperty PipelineNP;
+    INumber PipelineN[1];
+    INumberVectorProperty FrameTimingNP;
+    INumber FrameTimingN[3];
 
     INumberVectorProperty CCDImageExposureNP;
     INumber CCDImageExposureN[1];
@@ -117,5 +166,19 @@ class Imager : public virtual INDI::DefaultDevice, public virtual INDI::BaseClie
     std::shared_ptr<Group> currentGroup() const;
     std::shared_ptr<Group> nextGroup() const;
     std::shared_ptr<Group> getGroup(int index) const;
-    
+
+    // Exposures whose images are awaited, oldest first. Images arrive in the order they were taken.
+    std::deque<Capture> captures;
+    // The CCD runs one exposure at a time, a new one is requested once CCD_EXPOSURE left the busy state
+    bool ccdBusy { false };
+    bool filterMoving { false };
+
+    // Frames are saved in the background while the next exposure runs
+    std::deque<Frame> saveQueue;
+    size_t pendingSaves { 0 };
+    bool saveFailed { false };
+    bool stopSaving { false };
+    std::mutex saveMutex;
+    std::condition_variable saveCondition;
+    std::thread saveThread;
 };
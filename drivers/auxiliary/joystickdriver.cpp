@@ -22,16 +22,20 @@
 
 #include "joystickdriver.h"
 
+#include "indidevapi.h"
+
+#include <cerrno>
 #include <cstring>
 
 #define MAX_JOYSTICKS 3
+// Events read per read() call
+#define MAX_EVENTS    32
 
 JoyStickDriver::JoyStickDriver()
 {
-    active      = false;
     pollMS      = 100;
-    joystick_fd = 0;
-    joystick_ev = new js_event();
+    callbackID  = -1;
+    joystick_fd = -1;
     joystick_st = new joystick_state();
 
     strncpy(dev_path, JOYSTICK_DEV, 256);
@@ -45,7 +49,6 @@ JoyStickDriver::~JoyStickDriver()
 {
     Disconnect();
     delete joystick_st;
-    delete joystick_ev;
 }
 
 void JoyStickDriver::setJoystickCallback(joystickFunc JoystickCallback)
@@ -72,17 +75,17 @@ bool JoyStickDriver::Connect()
 {
     joystick_fd = open(dev_path, O_RDONLY | O_NONBLOCK);
 
-    if (joystick_fd > 0)
+    if (joystick_fd >= 0)
     {
         ioctl(joystick_fd, JSIOCGNAME(256), name);
         ioctl(joystick_fd, JSIOCGVERSION, &version);
         ioctl(joystick_fd, JSIOCGAXES, &axes);
         ioctl(joystick_fd, JSIOCGBUTTONS, &buttons);
 
-        joystick_st->axis.reserve(axes);
-        joystick_st->button.reserve(buttons);
-        active = true;
-        pthread_create(&thread, 0, &JoyStickDriver::loop, this);
+        joystick_st->axis.assign(axes, 0);
+        joystick_st->button.assign(buttons, 0);
+        axisChanged.assign(axes, false);
+        callbackID = IEAddCallback(joystick_fd, readCallback, this);
         return true;
     }
 
@@ -91,61 +94,103 @@ bool JoyStickDriver::Connect()
 
 bool JoyStickDriver::Disconnect()
 {
-    if (joystick_fd > 0)
-    {
-        active = false;
-        pthread_join(thread, 0);
+    if (callbackID >= 0)
+        IERmCallback(callbackID);
+
+    if (joystick_fd >= 0)
         close(joystick_fd);
-    }
 
-    joystick_fd = 0;
+    callbackID  = -1;
+    joystick_fd = -1;
 
     return true;
 }
 
-void *JoyStickDriver::loop(void *obj)
+void JoyStickDriver::readCallback(int fd, void *obj)
 {
-    while (reinterpret_cast<JoyStickDriver *>(obj)->active)
-        reinterpret_cast<JoyStickDriver *>(obj)->readEv();
-    return obj;
+    (void)fd;
+    reinterpret_cast<JoyStickDriver *>(obj)->readEv();
 }
 
 void JoyStickDriver::readEv()
 {
-    int bytes = read(joystick_fd, joystick_ev, sizeof(*joystick_ev));
-    if (bytes > 0)
+    js_event events[MAX_EVENTS];
+
+    for (;;)
     {
-        joystick_ev->type &= ~JS_EVENT_INIT;
-        if (joystick_ev->type & JS_EVENT_BUTTON)
-        {
-            joystick_st->button[joystick_ev->number] = joystick_ev->value;
-            buttonCallbackFunc(joystick_ev->number, joystick_ev->value);
-        }
-        if (joystick_ev->type & JS_EVENT_AXIS)
+        ssize_t bytes = read(joystick_fd, events, sizeof(events));
+
+        if (bytes < 0 && errno == EINTR)
+            continue;
+
+        if (bytes <= 0)
         {
-            joystick_st->axis[joystick_ev->number] = joystick_ev->value;
-            int joystick_n                         = joystick_ev->number;
-            if (joystick_n % 2 != 0)
-                joystick_n--;
-            if (joystick_n / 2.0 < MAX_JOYSTICKS)
+            // Unplugged, stop watching until disconnected
+            if (bytes == 0 || errno != EAGAIN)
             {
-                joystick_position pos = joystickPosition(joystick_n);
+                IERmCallback(callbackID);
+                callbackID = -1;
+            }
+            break;
+        }
 
-                // Reject noise
-                if (pos.r < 0.001)
-                {
-                    pos.r = 0;
-                    pos.theta = 0;
-                }
+        for (size_t i = 0; i < bytes / sizeof(js_event); i++)
+            processEvent(events[i]);
 
-                joystickCallbackFunc(joystick_n / 2, pos.r, pos.theta);
-            }
+        // Drained
+        if (bytes < static_cast<ssize_t>(sizeof(events)))
+            break;
+    }
 
-            axisCallbackFunc(joystick_ev->number, joystick_ev->value);
+    flushAxes();
+}
+
+void JoyStickDriver::processEvent(const js_event &event)
+{
+    int type = event.type & ~JS_EVENT_INIT;
+
+    if ((type & JS_EVENT_BUTTON) && event.number < buttons)
+    {
+        // Report the axes first, so that events keep their order
+        flushAxes();
+        joystick_st->button[event.number] = event.value;
+        buttonCallbackFunc(event.number, event.value);
+    }
+
+    if ((type & JS_EVENT_AXIS) && event.number < axes)
+    {
+        joystick_st->axis[event.number] = event.value;
+        axisChanged[event.number]        = true;
+    }
+}
+
+void JoyStickDriver::flushAxes()
+{
+    for (int joystick_n = 0; joystick_n < axes && joystick_n / 2 < MAX_JOYSTICKS; joystick_n += 2)
+    {
+        if (!axisChanged[joystick_n] && !(joystick_n + 1 < axes && axisChanged[joystick_n + 1]))
+            continue;
+
+        joystick_position pos = joystickPosition(joystick_n);
+
+        // Reject noise
+        if (pos.r < 0.001)
+        {
+            pos.r = 0;
+            pos.theta = 0;
         }
+
+        joystickCallbackFunc(joystick_n / 2, pos.r, pos.theta);
+    }
+
+    for (int axis_n = 0; axis_n < axes; axis_n++)
+    {
+        if (!axisChanged[axis_n])
+            continue;
+
+        axisChanged[axis_n] = false;
+        axisCallbackFunc(axis_n, joystick_st->axis[axis_n]);
     }
-    else
-        usleep(pollMS * 1000);
 }
 
 joystick_position JoyStickDriver::joystickPosition(int n)
@@ -155,7 +200,9 @@ joystick_position JoyStickDriver::joystickPosition(int n)
     if (n > -1 && n < axes)
     {
         int i0 = n, i1 = n + 1;
-        float x0 = joystick_st->axis[i0] / 32767.0f, y0 = -joystick_st->axis[i1] / 32767.0f;
+        // The last joystick may only have one axis
+        int y_raw = i1 < axes ? joystick_st->axis[i1] : 0;
+        float x0 = joystick_st->axis[i0] / 32767.0f, y0 = -y_raw / 32767.0f;
         float x = x0 * sqrt(1 - pow(y0, 2) / 2.0f), y = y0 * sqrt(1 - pow(x0, 2) / 2.0f);
 
         pos.x = x0;
@@ -167,7 +214,7 @@ joystick_position JoyStickDriver::joystickPosition(int n)
         // For direction keys and scale/throttle keys
         if (pos.r == 0)
         {
-            pos.r = -joystick_st->axis[i1];
+            pos.r = -y_raw;
 
             if (pos.r < 0)
             {
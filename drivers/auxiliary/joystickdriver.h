@@ -27,7 +27,6 @@
 #include <iostream>
 #include <functional>
 #include <fcntl.h>
-#include <pthread.h>
 #include <cmath>
 #include <linux/joystick.h>
 #include <vector>
@@ -52,8 +51,8 @@ typedef struct
  * A game pad may have one or more joysticks depending on the number of reported axis. You can utilize the class in an event driven fashion by using callbacks.
  * The callbacks have a specific signature and must be set. Alternatively, you may query the status and position of the buttons & axis at any time as well.
  *
- * Since the class runs a non-blocking thread, the thread goes to sleep when there are no events detected in order to reduce CPU utilization. The sleep period is set by
- * default to 100 milliseconds and can be adjusted by the \i setPoll function.
+ * Events are read by the main loop of the driver as soon as they arrive, and the callbacks are called from there. All events pending are read at once, and
+ * axis events in a batch are merged: each axis and joystick that moved is reported once with its latest value. Button events are reported one by one.
  *
  * Each joystick has a normalized magnitude [0 to 1] and an angle. The magnitude is 0 when the stick is not depressed, and 1 when depressed all the way.
  * The angles are measured counter clock wise [0 to 360] with right/east direction being zero.
@@ -77,6 +76,7 @@ class JoyStickDriver
     bool Disconnect();
 
     void setPort(const char *port);
+    /** Not used anymore, events are read as they arrive */
     void setPoll(int ms);
 
     const char *getName();
@@ -97,19 +97,21 @@ class JoyStickDriver
     static void axisEvent(int axis_n, int value);
     static void buttonEvent(int button_n, int value);
 
-    static void *loop(void *obj);
+    static void readCallback(int fd, void *obj);
     void readEv();
+    void processEvent(const js_event &event);
+    void flushAxes();
 
     joystickFunc joystickCallbackFunc;
     buttonFunc buttonCallbackFunc;
     axisFunc axisCallbackFunc;
 
   private:
-    pthread_t thread;
-    bool active;
+    int callbackID;
     int joystick_fd;
-    js_event *joystick_ev;
     joystick_state *joystick_st;
+    // Axes moved since they were last reported
+    std::vector<bool> axisChanged;
     __u32 version;
     __u8 axes;
     __u8 buttons;
@@ -25,7 +25,9 @@
 #include <libnova/julian_day.h>
 #include <libnova/precession.h>
 
+#include <algorithm>
 #include <cmath>
+#include <thread>
 #include <unistd.h>
 
 static pthread_cond_t cv         = PTHREAD_COND_INITIALIZER;
@@ -36,6 +38,80 @@ static std::unique_ptr<CCDSim> ccdsim(new CCDSim());
 
 void ISPoll(void * p);
 
+namespace
+{
+/**
+ * @brief Small xorshift64* generator. Each rendering thread owns one, so noise generation needs
+ * no locking unlike random().
+ */
+class FastRandom
+{
+    public:
+        explicit FastRandom(uint64_t seed)
+        {
+            // Scramble the seed with splitmix64 so nearby seeds give unrelated sequences.
+            seed += 0x9E3779B97F4A7C15ULL;
+            seed = (seed ^ (seed >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            seed = (seed ^ (seed >> 27)) * 0x94D049BB133111EBULL;
+            state = (seed ^ (seed >> 31)) | 1;
+        }
+
+        uint32_t next()
+        {
+            state ^= state >> 12;
+            state ^= state << 25;
+            state ^= state >> 27;
+            return static_cast<uint32_t>((state * 0x2545F4914F6CDD1DULL) >> 32);
+        }
+
+        // Uniform value in [0, range)
+        uint32_t next(uint32_t range)
+        {
+            return static_cast<uint32_t>((static_cast<uint64_t>(next()) * range) >> 32);
+        }
+
+    private:
+        uint64_t state;
+};
+
+/**
+ * @brief Split rows [0, height) into bands and render them in parallel. Small frames are
+ * rendered on the calling thread since spawning threads would cost more than it saves.
+ */
+template <typename Func>
+void ForEachRowBand(int width, int height, Func render)
+{
+    constexpr int minPixelsPerBand = 128 * 1024;
+
+    int bands = static_cast<int>(std::thread::hardware_concurrency());
+    bands = std::min(bands, static_cast<int>((static_cast<int64_t>(width) * height) / minPixelsPerBand));
+    bands = std::min(bands, height);
+
+    if (bands <= 1)
+    {
+        render(0, height, 0);
+        return;
+    }
+
+    std::vector<std::thread> workers;
+    workers.reserve(bands - 1);
+    int rowsPerBand = (height + bands - 1) / bands;
+    for (int band = 1; band < bands; band++)
+    {
+        int startRow = band * rowsPerBand;
+        int endRow   = std::min(height, startRow + rowsPerBand);
+        if (startRow >= endRow)
+            break;
+        workers.emplace_back(render, startRow, endRow, band);
+    }
+
+    render(0, std::min(height, rowsPerBand), 0);
+
+    for (auto &worker : workers)
+        worker.join();
+}
+}
+
 void ISGetProperties(const char * dev)
 {
     ccdsim->ISGetProperties(dev);
@@ -177,6 +253,13 @@ bool CCDSim::initProperties()
     IUFillSwitchVector(&SimulateRgbSP, SimulateRgbS, 2, getDeviceName(), "SIMULATE_RGB", "Simulate RGB",
                        "Simulator Config", IP_RW, ISR_1OFMANY, 60, IPS_IDLE);
 
+    // Star catalog used in place of gsc
+    const char *catalog = getenv("INDI_SIM_CATALOG");
+    IUFillText(&StarCatalogT[0], "SIM_CATALOG_FILE", "File", catalog ? catalog : "");
+    IUFillTextVector(&StarCatalogTP, StarCatalogT, 1, getDeviceName(), "SIM_CATALOG", "Star Catalog",
+                     "Simulator Config", IP_RW, 60, IPS_IDLE);
+    loadStarCatalog();
+
     IUFillSwitch(&TimeFactorS[0], "1X", "Actual Time", ISS_ON);
     IUFillSwitch(&TimeFactorS[1], "10X", "10x", ISS_OFF);
     IUFillSwitch(&TimeFactorS[2], "100X", "100x", ISS_OFF);
@@ -270,6 +353,7 @@ void CCDSim::ISGetProperties(const char * dev)
     defineSwitch(TimeFactorSV);
     defineNumber(&EqPENP);
     defineSwitch(&SimulateRgbSP);
+    defineText(&StarCatalogTP);
 }
 
 bool CCDSim::updateProperties()
@@ -703,101 +787,100 @@ int CCDSim::DrawCcdFrame(INDI::CCDChip * targetChip)
 
         if (ftype == INDI::CCDChip::LIGHT_FRAME)
         {
-            AutoCNumeric locale;
-            char gsccmd[250];
-            FILE * pp;
             int drawn = 0;
 
-            sprintf(gsccmd, "gsc -c %8.6f %+8.6f -r %4.1f -m 0 %4.2f -n 3000",
-                    range360(rad + PEOffset),
-                    rangeDec(cameradec),
-                    radius,
-                    lookuplimit);
+            auto drawStar = [&](float ra, float dec, float mag)
+            {
+                //  Convert the ra/dec to standard co-ordinates
+                double sx;    //  standard co-ords
+                double sy;    //
+                double srar;  //  star ra in radians
+                double sdecr; //  star dec in radians;
+                double ccdx;
+                double ccdy;
+
+                srar  = ra * 0.0174532925;
+                sdecr = dec * 0.0174532925;
+                //  Handbook of astronomical image processing
+                //  page 253
+                //  equations 9.1 and 9.2
+                //  convert ra/dec to standard co-ordinates
+
+                sx = cos(sdecr) * sin(srar - rar) /
+                     (cos(decr) * cos(sdecr) * cos(srar - rar) + sin(decr) * sin(sdecr));
+                sy = (sin(decr) * cos(sdecr) * cos(srar - rar) - cos(decr) * sin(sdecr)) /
+                     (cos(decr) * cos(sdecr) * cos(srar - rar) + sin(decr) * sin(sdecr));
+
+                //  now convert to pixels
+                ccdx = pa * sx + pb * sy + pc;
+                ccdy = pd * sx + pe * sy + pf;
+
+                // Invert horizontally
+                ccdx = ccdW - ccdx;
+
+                drawn += DrawImageStar(targetChip, mag, ccdx, ccdy, ExposureTime);
+            };
+
+            if (starCatalog.isLoaded())
+            {
+                starCatalog.query(range360(rad + PEOffset), rangeDec(cameradec), radius, lookuplimit, 3000,
+                                  [&](const StarCatalog::Star & star)
+                {
+                    drawStar(star.ra, star.dec, star.mag);
+                });
+            }
+            else
+            {
+                AutoCNumeric locale;
+                char gsccmd[250];
+                FILE * pp;
 
-            if (!Streamer->isStreaming())
-                LOGF_DEBUG("GSC Command: %s", gsccmd);
+                sprintf(gsccmd, "gsc -c %8.6f %+8.6f -r %4.1f -m 0 %4.2f -n 3000",
+                        range360(rad + PEOffset),
+                        rangeDec(cameradec),
+                        radius,
+                        lookuplimit);
 
-            pp = popen(gsccmd, "r");
-            if (pp != nullptr)
-            {
-                char line[256];
-                int stars = 0;
-                int lines = 0;
+                if (!Streamer->isStreaming())
+                    LOGF_DEBUG("GSC Command: %s", gsccmd);
 
-                while (fgets(line, 256, pp) != nullptr)
+                pp = popen(gsccmd, "r");
+                if (pp != nullptr)
                 {
-                    //  ok, lets parse this line for specifcs we want
-                    char id[20];
-                    char plate[6];
-                    char ob[6];
-                    float mag;
-                    float mage;
-                    float ra;
-                    float dec;
-                    float pose;
-                    int band;
-                    float dist;
-                    int dir;
-                    int c;
-
-                    int rc = sscanf(line, "%10s %f %f %f %f %f %d %d %4s %2s %f %d", id, &ra, &dec, &pose, &mag, &mage,
-                                    &band, &c, plate, ob, &dist, &dir);
-                    //fprintf(stderr,"Parsed %d items\n",rc);
-                    if (rc == 12)
+                    char line[256];
+
+                    while (fgets(line, 256, pp) != nullptr)
                     {
-                        lines++;
-                        //if(c==0) {
-                        stars++;
-                        //fprintf(stderr,"%s %8.4f %8.4f %5.2f %5.2f %d\n",id,ra,dec,mag,dist,dir);
-
-                        //  Convert the ra/dec to standard co-ordinates
-                        double sx;    //  standard co-ords
-                        double sy;    //
-                        double srar;  //  star ra in radians
-                        double sdecr; //  star dec in radians;
-                        double ccdx;
-                        double ccdy;
-
-                        //fprintf(stderr,"line %s",line);
-                        //fprintf(stderr,"parsed %6.5f %6.5f\n",ra,dec);
-
-                        srar  = ra * 0.0174532925;
-                        sdecr = dec * 0.0174532925;
-                        //  Handbook of astronomical image processing
-                        //  page 253
-                        //  equations 9.1 and 9.2
-                        //  convert ra/dec to standard co-ordinates
-
-                        sx = cos(sdecr) * sin(srar - rar) /
-                             (cos(decr) * cos(sdecr) * cos(srar - rar) + sin(decr) * sin(sdecr));
-                        sy = (sin(decr) * cos(sdecr) * cos(srar - rar) - cos(decr) * sin(sdecr)) /
-                             (cos(decr) * cos(sdecr) * cos(srar - rar) + sin(decr) * sin(sdecr));
-
-                        //  now convert to pixels
-                        ccdx = pa * sx + pb * sy + pc;
-                        ccdy = pd * sx + pe * sy + pf;
-
-                        // Invert horizontally
-                        ccdx = ccdW - ccdx;
-
-                        rc = DrawImageStar(targetChip, mag, ccdx, ccdy, ExposureTime);
-                        drawn += rc;
-                        if (rc == 1)
-                        {
-                            //LOGF_DEBUG("star %s scope %6.4f %6.4f star %6.4f %6.4f ccd %6.2f %6.2f",id,rad,decPE,ra,dec,ccdx,ccdy);
-                            //LOGF_DEBUG("star %s ccd %6.2f %6.2f",id,ccdx,ccdy);
-                        }
+                        //  ok, lets parse this line for specifcs we want
+                        char id[20];
+                        char plate[6];
+                        char ob[6];
+                        float mag;
+                        float mage;
+                        float ra;
+                        float dec;
+                        float pose;
+                        int band;
+                        float dist;
+                        int dir;
+                        int c;
+
+                        int rc = sscanf(line, "%10s %f %f %f %f %f %d %d %4s %2s %f %d", id, &ra, &dec, &pose, &mag, &mage,
+                                        &band, &c, plate, ob, &dist, &dir);
+                        if (rc == 12)
+                            drawStar(ra, dec, mag);
                     }
+                    pclose(pp);
+                }
+                else
+                {
+                    LOG_ERROR("Error looking up stars, is gsc installed with appropriate environment variables set ??");
                 }
-                pclose(pp);
-            }
-            else
-            {
-                LOG_ERROR("Error looking up stars, is gsc installed with appropriate environment variables set ??");
             }
+
             if (drawn == 0)
             {
-                LOG_ERROR("Got no stars, is gsc installed with appropriate environment variables set ??");
+                LOG_ERROR("Got no stars, is gsc installed or a star catalog set ??");
             }
         }
         //fprintf(stderr,"Got %d stars from %d lines drew %d\n",stars,lines,drawn);
@@ -805,10 +888,11 @@ int CCDSim::DrawCcdFrame(INDI::CCDChip * targetChip)
         //  now we need to add background sky glow, with vignetting
         //  this is essentially the same math as drawing a dim star with
         //  fwhm equivalent to the full field of view
+        float skyflux = 0;
+        bool drawSky  = (ftype == INDI::CCDChip::LIGHT_FRAME || ftype == INDI::CCDChip::FLAT_FRAME);
 
-        if (ftype == INDI::CCDChip::LIGHT_FRAME || ftype == INDI::CCDChip::FLAT_FRAME)
+        if (drawSky)
         {
-            float skyflux;
             //  calculate flux from our zero point and gain values
             float glow = skyglow;
 
@@ -828,78 +912,35 @@ int CCDSim::DrawCcdFrame(INDI::CCDChip * targetChip)
             skyflux = skyflux * ExposureTime;
             //IDLog("SkyFlux = %g ExposureRequest %g\n",skyflux,ExposureTime);
 
-            uint16_t * pt = reinterpret_cast<uint16_t *>(targetChip->getFrameBuffer());
-
             nheight = targetChip->getSubH();
             nwidth  = targetChip->getSubW();
 
+            //  The gaussian falloff to the edges is separable in x and y, so we only
+            //  evaluate it once per column and once per row instead of per pixel.
+            float vig = nwidth * ImageScalex;
+
+            VignetteX.resize(nwidth);
+            for (int x = 0; x < nwidth; x++)
+            {
+                float sx = nwidth / 2 - x;
+                VignetteX[x] = exp(-2.0 * 0.7 * (sx * sx * ImageScalex * ImageScalex) / vig / vig);
+            }
+
+            VignetteY.resize(nheight);
             for (int y = 0; y < nheight; y++)
             {
-                for (int x = 0; x < nwidth; x++)
-                {
-                    float dc; //  distance from center
-                    float fp; //  flux this pixel;
-                    float sx, sy;
-                    float vig;
-
-                    sx = nwidth / 2 - x;
-                    sy = nheight / 2 - y;
-
-                    vig = nwidth;
-                    vig = vig * ImageScalex;
-                    //  need to make this account for actual pixel size
-                    dc = std::sqrt(sx * sx * ImageScalex * ImageScalex + sy * sy * ImageScaley * ImageScaley);
-                    //  now we have the distance from center, in arcseconds
-                    //  now lets plot a gaussian falloff to the edges
-                    //
-                    float fa;
-                    fa = exp(-2.0 * 0.7 * (dc * dc) / vig / vig);
-
-                    //  get the current value
-                    fp = pt[0];
-
-                    //  Add the sky glow
-                    fp += skyflux;
-
-                    //  now scale it for the vignetting
-                    fp = fa * fp;
-
-                    //  clamp to limits
-                    if (fp > maxval)
-                        fp = maxval;
-                    if (fp > maxpix)
-                        maxpix = fp;
-                    if (fp < minpix)
-                        minpix = fp;
-                    //  and put it back
-                    pt[0] = fp;
-                    pt++;
-                }
+                float sy = nheight / 2 - y;
+                VignetteY[y] = exp(-2.0 * 0.7 * (sy * sy * ImageScaley * ImageScaley) / vig / vig);
             }
         }
 
-        //  Now we add some bias and read noise
-        int subX = targetChip->getSubX();
-        int subY = targetChip->getSubY();
-        int subW = targetChip->getSubW() + subX;
-        int subH = targetChip->getSubH() + subY;
+        //  Now we add sky glow, bias and read noise, each band of rows on its own thread
+        uint64_t seed = static_cast<uint64_t>(random());
 
-        if (maxnoise > 0)
+        ForEachRowBand(targetChip->getSubW(), targetChip->getSubH(), [&](int startRow, int endRow, int band)
         {
-            for (int x = subX; x < subW; x++)
-            {
-                for (int y = subY; y < subH; y++)
-                {
-                    int noise;
-
-                    noise = random();
-                    noise = noise % maxnoise; //
-
-                    //IDLog("noise is %d\n", noise);
-                    AddToPixel(targetChip, x, y, bias + noise);
-                }
-            }
-        }
+            DrawSkyAndNoise(targetChip, startRow, endRow, drawSky, skyflux, (seed << 8) + band);
+        });
     }
     else
     {
@@ -919,14 +960,74 @@ int CCDSim::DrawCcdFrame(INDI::CCDChip * targetChip)
     return 0;
 }
 
+void CCDSim::DrawSkyAndNoise(INDI::CCDChip * targetChip, int startRow, int endRow, bool drawSky, float skyflux,
+                             uint64_t seed)
+{
+    int nwidth = targetChip->getSubW();
+    FastRandom rng(seed);
+
+    uint16_t * frame = reinterpret_cast<uint16_t *>(targetChip->getFrameBuffer());
+
+    for (int y = startRow; y < endRow; y++)
+    {
+        uint16_t * pt = frame + static_cast<size_t>(y) * nwidth;
+
+        if (drawSky)
+        {
+            const float fy = VignetteY[y];
+            const float * fx = VignetteX.data();
+            const float limit = maxval;
+
+            //  Add the sky glow, scale it for the vignetting and clamp to limits
+            for (int x = 0; x < nwidth; x++)
+            {
+                float fp = (pt[x] + skyflux) * (fx[x] * fy);
+                pt[x] = static_cast<uint16_t>(std::min(fp, limit));
+            }
+        }
+
+        if (maxnoise > 0)
+        {
+            for (int x = 0; x < nwidth; x++)
+            {
+                int newval = pt[x] + bias + static_cast<int>(rng.next(maxnoise));
+                pt[x] = static_cast<uint16_t>(std::min(newval, maxval));
+            }
+        }
+    }
+}
+
+void CCDSim::updatePSFStamp()
+{
+    if (!PSFStamp.empty() && PSFSeeing == seeing && PSFScalex == ImageScalex && PSFScaley == ImageScaley)
+        return;
+
+    //  we need a box size that gives a radius at least 3 times fwhm
+    float qx = seeing / ImageScaley;
+    qx       = qx * 3;
+    PSFBoxSize = static_cast<int>(qx) + 1;
+
+    int side = 2 * PSFBoxSize + 1;
+    PSFStamp.resize(side * side);
+
+    for (int sy = -PSFBoxSize; sy <= PSFBoxSize; sy++)
+    {
+        for (int sx = -PSFBoxSize; sx <= PSFBoxSize; sx++)
+        {
+            //  need to make this account for actual pixel size
+            float dc = std::sqrt(sx * sx * ImageScalex * ImageScalex + sy * sy * ImageScaley * ImageScaley);
+            //  now we have the distance from center, in arcseconds
+            PSFStamp[(sy + PSFBoxSize) * side + (sx + PSFBoxSize)] = exp(-2.0 * 0.7 * (dc * dc) / seeing / seeing);
+        }
+    }
+
+    PSFSeeing = seeing;
+    PSFScalex = ImageScalex;
+    PSFScaley = ImageScaley;
+}
+
 int CCDSim::DrawImageStar(INDI::CCDChip * targetChip, float mag, float x, float y, float ExposureTime)
 {
-    //float d;
-    //float r;
-    int sx, sy;
-    int drew     = 0;
-    //int boxsizex = 5;
-    int boxsizey = 5;
     float flux;
 
     int subX = targetChip->getSubX();
@@ -947,86 +1048,36 @@ int CCDSim::DrawImageStar(INDI::CCDChip * targetChip, float mag, float x, float
     //  scale up linearly for exposure time
     flux = flux * ExposureTime;
 
-    float qx;
-    //  we need a box size that gives a radius at least 3 times fwhm
-    qx       = seeing / ImageScalex;
-    qx       = qx * 3;
-    //boxsizex = (int)qx;
-    //boxsizex++;
-    qx       = seeing / ImageScaley;
-    qx       = qx * 3;
-    boxsizey = static_cast<int>(qx);
-    boxsizey++;
-
-    //IDLog("BoxSize %d %d\n",boxsizex,boxsizey);
-
-    for (sy = -boxsizey; sy <= boxsizey; sy++)
-    {
-        for (sx = -boxsizey; sx <= boxsizey; sx++)
-        {
-            int rc;
-            float dc; //  distance from center
-            float fp; //  flux this pixel;
+    updatePSFStamp();
 
-            //  need to make this account for actual pixel size
-            dc = std::sqrt(sx * sx * ImageScalex * ImageScalex + sy * sy * ImageScaley * ImageScaley);
-            //  now we have the distance from center, in arcseconds
-            //  This should be gaussian, but, for now we'll just go with
-            //  a simple linear function
-            float fa = exp(-2.0 * 0.7 * (dc * dc) / seeing / seeing);
+    //  Clip the stamp against the subframe once, so the inner loop needs no bounds checks
+    int side   = 2 * PSFBoxSize + 1;
+    int left   = static_cast<int>(x) - PSFBoxSize;
+    int top    = static_cast<int>(y) - PSFBoxSize;
+    int x0     = std::max(left, subX);
+    int x1     = std::min(left + side, subW);
+    int y0     = std::max(top, subY);
+    int y1     = std::min(top + side, subH);
 
-            fp = fa * flux;
-
-            if (fp < 0)
-                fp = 0;
-
-            rc = AddToPixel(targetChip, x + sx, y + sy, fp);
-            if (rc != 0)
-                drew = 1;
-        }
-    }
-    return drew;
-}
-
-int CCDSim::AddToPixel(INDI::CCDChip * targetChip, int x, int y, int val)
-{
-    int nwidth  = targetChip->getSubW();
-    int nheight = targetChip->getSubH();
+    if (x0 >= x1 || y0 >= y1)
+        return 0;
 
-    x -= targetChip->getSubX();
-    y -= targetChip->getSubY();
+    int nwidth = targetChip->getSubW();
+    uint16_t * frame = reinterpret_cast<uint16_t *>(targetChip->getFrameBuffer());
 
-    int drew = 0;
-    if (x >= 0)
+    for (int py = y0; py < y1; py++)
     {
-        if (x < nwidth)
+        const float * stamp = PSFStamp.data() + (py - top) * side + (x0 - left);
+        uint16_t * pt = frame + static_cast<size_t>(py - subY) * nwidth + (x0 - subX);
+
+        for (int i = 0; i < x1 - x0; i++)
         {
-            if (y >= 0)
-            {
-                if (y < nheight)
-                {
-                    unsigned short * pt;
-                    int newval;
-                    drew++;
-
-                    pt = reinterpret_cast<uint16_t *>(targetChip->getFrameBuffer());
-
-                    pt += (y * nwidth);
-                    pt += x;
-                    newval = pt[0];
-                    newval += val;
-                    if (newval > maxval)
-                        newval = maxval;
-                    if (newval > maxpix)
-                        maxpix = newval;
-                    if (newval < minpix)
-                        minpix = newval;
-                    pt[0] = newval;
-                }
-            }
+            int newval = pt[i] + static_cast<int>(stamp[i] * flux);
+            pt[i] = static_cast<uint16_t>(std::min(newval, maxval));
         }
     }
-    return drew;
+
+    return 1;
 }
 
 IPState CCDSim::GuideNorth(uint32_t v)
@@ -1074,6 +1125,14 @@ bool CCDSim::ISNewText(const char * dev, const char * name, char * texts[], char
             INDI::FilterInterface::processText(dev, name, texts, names, n);
             return true;
         }
+
+        if (strcmp(name, StarCatalogTP.name) == 0)
+        {
+            IUUpdateText(&StarCatalogTP, texts, names, n);
+            loadStarCatalog();
+            IDSetText(&StarCatalogTP, nullptr);
+            return true;
+        }
     }
 
     return INDI::CCD::ISNewText(dev, name, texts, names, n);
@@ -1295,9 +1354,38 @@ bool CCDSim::saveConfigItems(FILE * fp)
     // RGB
     IUSaveConfigSwitch(fp, &SimulateRgbSP);
 
+    // Star Catalog
+    IUSaveConfigText(fp, &StarCatalogTP);
+
     return true;
 }
 
+void CCDSim::loadStarCatalog()
+{
+    std::unique_lock<std::mutex> guard(ccdBufferLock);
+
+    if (StarCatalogT[0].text == nullptr || StarCatalogT[0].text[0] == '\0')
+    {
+        starCatalog.unload();
+        StarCatalogTP.s = IPS_IDLE;
+        return;
+    }
+
+    if (starCatalog.isLoaded() && starCatalog.path() == StarCatalogT[0].text)
+        return;
+
+    if (starCatalog.load(StarCatalogT[0].text))
+    {
+        StarCatalogTP.s = IPS_OK;
+        LOGF_INFO("Loaded %zu stars from %s.", starCatalog.size(), StarCatalogT[0].text);
+    }
+    else
+    {
+        StarCatalogTP.s = IPS_ALERT;
+        LOGF_ERROR("Failed to load star catalog %s, falling back to gsc.", StarCatalogT[0].text);
+    }
+}
+
 bool CCDSim::SelectFilter(int f)
 {
     CurrentFilter = f;
@@ -20,11 +20,15 @@
 
 #include "indiccd.h"
 #include "indifilterinterface.h"
+#include "starcatalog.h"
+
+#include <vector>
 
 /**
  * @brief The CCDSim class provides an advanced simulator for a CCD that includes a dedicated on-board guide chip.
  *
- * The CCD driver can generate star fields given that General-Star-Catalog (gsc) tool is installed on the same machine the driver is running.
+ * The CCD driver can generate star fields given that General-Star-Catalog (gsc) tool is installed on the same machine the driver is running,
+ * or from a star catalog file built with indi_simulator_catalog which is loaded once and queried in-process.
  *
  * Many simulator parameters can be configured to generate the final star field image. In addition to support guider chip and guiding pulses (ST4),
  * a filter wheel support is provided for 8 filter wheels. Cooler and temperature control is also supported.
@@ -75,7 +79,8 @@ class CCDSim : public INDI::CCD, public INDI::FilterInterface
         int DrawCcdFrame(INDI::CCDChip *targetChip);
 
         int DrawImageStar(INDI::CCDChip *targetChip, float, float, float, float ExposureTime);
-        int AddToPixel(INDI::CCDChip *targetChip, int, int, int);
+        void DrawSkyAndNoise(INDI::CCDChip *targetChip, int startRow, int endRow, bool drawSky, float skyflux,
+                             uint64_t seed);
 
         virtual IPState GuideNorth(uint32_t) override;
         virtual IPState GuideSouth(uint32_t) override;
@@ -104,6 +109,12 @@ class CCDSim : public INDI::CCD, public INDI::FilterInterface
         // Turns on/off Bayer RGB simulation.
         void setRGB(bool onOff);
 
+        // Rebuild the star PSF stamp if seeing or image scale changed.
+        void updatePSFStamp();
+
+        // Load the star catalog file, if set, in place of the gsc tool.
+        void loadStarCatalog();
+
         float TemperatureRequest { 0 };
 
         float ExposureRequest { 0 };
@@ -123,8 +134,6 @@ class CCDSim : public INDI::CCD, public INDI::FilterInterface
         int bias { 1500 };
         int maxnoise { 20 };
         int maxval { 65000 };
-        int maxpix { 0 };
-        int minpix { 65000 };
         float skyglow { 40 };
         float limitingmag { 11.5 };
         float saturationmag { 2 };
@@ -138,6 +147,17 @@ class CCDSim : public INDI::CCD, public INDI::FilterInterface
 
         bool simulateRGB { false };
 
+        // Normalized gaussian profile of a star, (2 * PSFBoxSize + 1)^2 pixels
+        std::vector<float> PSFStamp;
+        int PSFBoxSize { 0 };
+        float PSFSeeing { 0 };
+        float PSFScalex { 0 };
+        float PSFScaley { 0 };
+
+        // Vignetting falloff per column and per row of the current frame
+        std::vector<float> VignetteX;
+        std::vector<float> VignetteY;
+
         //  our zero point calcs used for drawing stars
         float k { 0 };
         float z { 0 };
@@ -175,6 +195,11 @@ class CCDSim : public INDI::CCD, public INDI::FilterInterface
         ISwitchVectorProperty SimulateRgbSP;
         ISwitch SimulateRgbS[2];
 
+        ITextVectorProperty StarCatalogTP;
+        IText StarCatalogT[1] {};
+
+        StarCatalog starCatalog;
+
         ISwitch TimeFactorS[3];
         ISwitchVectorProperty *TimeFactorSV;
 
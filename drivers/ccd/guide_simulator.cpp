@@ -169,6 +169,13 @@ bool GuideSim::initProperties()
     IUFillSwitchVector(TimeFactorSV, TimeFactorS, 3, getDeviceName(), "ON_TIME_FACTOR", "Time Factor",
                        "Simulator Config", IP_RW, ISR_1OFMANY, 60, IPS_IDLE);
 
+    // Star catalog used in place of gsc
+    const char *catalog = getenv("INDI_SIM_CATALOG");
+    IUFillText(&StarCatalogT[0], "SIM_CATALOG_FILE", "File", catalog ? catalog : "");
+    IUFillTextVector(&StarCatalogTP, StarCatalogT, 1, getDeviceName(), "SIM_CATALOG", "Star Catalog",
+                     "Simulator Config", IP_RW, 60, IPS_IDLE);
+    loadStarCatalog();
+
     IUFillNumber(&FWHMN[0], "SIM_FWHM", "FWHM (arcseconds)", "%4.2f", 0, 60, 0, 7.5);
     IUFillNumberVector(&FWHMNP, FWHMN, 1, ActiveDeviceT[1].text, "FWHM", "FWHM", OPTIONS_TAB, IP_RO, 60, IPS_IDLE);
 
@@ -204,6 +211,7 @@ void GuideSim::ISGetProperties(const char *dev)
 
     defineNumber(SimulatorSettingsNV);
     defineSwitch(TimeFactorSV);
+    defineText(&StarCatalogTP);
 }
 
 bool GuideSim::updateProperties()
@@ -494,102 +502,98 @@ int GuideSim::DrawCcdFrame(INDI::CCDChip *targetChip)
 
         if (ftype == INDI::CCDChip::LIGHT_FRAME)
         {
-            AutoCNumeric locale;
-            char gsccmd[250];
-            FILE *pp;
             int drawn = 0;
 
-            //sprintf(gsccmd,"gsc -c %8.6f %+8.6f -r 120 -m 0 9.1",rad+PEOffset,decPE);
-            sprintf(gsccmd, "gsc -c %8.6f %+8.6f -r %4.1f -m 0 %4.2f -n 3000",
-                    range360(rad + PEOffset),
-                    rangeDec(cameradec),
-                    radius,
-                    lookuplimit);
-
-            LOGF_DEBUG("%s", gsccmd);
-            pp = popen(gsccmd, "r");
-            if (pp != nullptr)
+            auto drawStar = [&](float ra, float dec, float mag)
+            {
+                //  Convert the ra/dec to standard co-ordinates
+                double sx;    //  standard co-ords
+                double sy;    //
+                double srar;  //  star ra in radians
+                double sdecr; //  star dec in radians;
+                double ccdx;
+                double ccdy;
+
+                srar  = ra * 0.0174532925;
+                sdecr = dec * 0.0174532925;
+                //  Handbook of astronomical image processing
+                //  page 253
+                //  equations 9.1 and 9.2
+                //  convert ra/dec to standard co-ordinates
+
+                sx = cos(sdecr) * sin(srar - rar) /
+                     (cos(decr) * cos(sdecr) * cos(srar - rar) + sin(decr) * sin(sdecr));
+                sy = (sin(decr) * cos(sdecr) * cos(srar - rar) - cos(decr) * sin(sdecr)) /
+                     (cos(decr) * cos(sdecr) * cos(srar - rar) + sin(decr) * sin(sdecr));
+
+                //  now convert to pixels
+                ccdx = pa * sx + pb * sy + pc;
+                ccdy = pd * sx + pe * sy + pf;
+
+                // Invert horizontally
+                ccdx = ccdW - ccdx;
+
+                drawn += DrawImageStar(targetChip, mag, ccdx, ccdy, ExposureTime);
+            };
+
+            if (starCatalog.isLoaded())
             {
-                char line[256];
-                int stars = 0;
-                int lines = 0;
-                while (fgets(line, 256, pp) != nullptr)
+                starCatalog.query(range360(rad + PEOffset), rangeDec(cameradec), radius, lookuplimit, 3000,
+                                  [&](const StarCatalog::Star & star)
                 {
-                    //fprintf(stderr,"%s",line);
-
-                    //  ok, lets parse this line for specifcs we want
-                    char id[20];
-                    char plate[6];
-                    char ob[6];
-                    float mag;
-                    float mage;
-                    float ra;
-                    float dec;
-                    float pose;
-                    int band;
-                    float dist;
-                    int dir;
-                    int c;
-                    int rc;
-
-                    rc = sscanf(line, "%10s %f %f %f %f %f %d %d %4s %2s %f %d", id, &ra, &dec, &pose, &mag, &mage,
-                                &band, &c, plate, ob, &dist, &dir);
-                    //fprintf(stderr,"Parsed %d items\n",rc);
-                    if (rc == 12)
-                    {
-                        lines++;
-                        //if(c==0) {
-                        stars++;
-                        //fprintf(stderr,"%s %8.4f %8.4f %5.2f %5.2f %d\n",id,ra,dec,mag,dist,dir);
-
-                        //  Convert the ra/dec to standard co-ordinates
-                        double sx;    //  standard co-ords
-                        double sy;    //
-                        double srar;  //  star ra in radians
-                        double sdecr; //  star dec in radians;
-                        double ccdx;
-                        double ccdy;
-
-                        //fprintf(stderr,"line %s",line);
-                        //fprintf(stderr,"parsed %6.5f %6.5f\n",ra,dec);
-
-                        srar  = ra * 0.0174532925;
-                        sdecr = dec * 0.0174532925;
-                        //  Handbook of astronomical image processing
-                        //  page 253
-                        //  equations 9.1 and 9.2
-                        //  convert ra/dec to standard co-ordinates
-
-                        sx = cos(sdecr) * sin(srar - rar) /
-                             (cos(decr) * cos(sdecr) * cos(srar - rar) + sin(decr) * sin(sdecr));
-                        sy = (sin(decr) * cos(sdecr) * cos(srar - rar) - cos(decr) * sin(sdecr)) /
-                             (cos(decr) * cos(sdecr) * cos(srar - rar) + sin(decr) * sin(sdecr));
-
-                        //  now convert to pixels
-                        ccdx = pa * sx + pb * sy + pc;
-                        ccdy = pd * sx + pe * sy + pf;
-
-                        // Invert horizontally
-                        ccdx = ccdW - ccdx;
-
-                        rc = DrawImageStar(targetChip, mag, ccdx, ccdy, ExposureTime);
-                        drawn += rc;
-                        if (rc == 1)
-                        {
-                            //LOGF_DEBUG("star %s scope %6.4f %6.4f star %6.4f %6.4f ccd %6.2f %6.2f",id,rad,decPE,ra,dec,ccdx,ccdy);
-                            //LOGF_DEBUG("star %s ccd %6.2f %6.2f",id,ccdx,ccdy);
-                        }
-                    }
-                }
-                pclose(pp);
+                    drawStar(star.ra, star.dec, star.mag);
+                });
             }
             else
             {
-                LOG_ERROR("Error looking up stars, is gsc installed with appropriate environment variables set ??");
+                AutoCNumeric locale;
+                char gsccmd[250];
+                FILE *pp;
+
+                sprintf(gsccmd, "gsc -c %8.6f %+8.6f -r %4.1f -m 0 %4.2f -n 3000",
+                        range360(rad + PEOffset),
+                        rangeDec(cameradec),
+                        radius,
+                        lookuplimit);
+
+                LOGF_DEBUG("%s", gsccmd);
+                pp = popen(gsccmd, "r");
+                if (pp != nullptr)
+                {
+                    char line[256];
+                    while (fgets(line, 256, pp) != nullptr)
+                    {
+                        //  ok, lets parse this line for specifcs we want
+                        char id[20];
+                        char plate[6];
+                        char ob[6];
+                        float mag;
+                        float mage;
+                        float ra;
+                        float dec;
+                        float pose;
+                        int band;
+                        float dist;
+                        int dir;
+                        int c;
+                        int rc;
+
+                        rc = sscanf(line, "%10s %f %f %f %f %f %d %d %4s %2s %f %d", id, &ra, &dec, &pose, &mag, &mage,
+                                    &band, &c, plate, ob, &dist, &dir);
+                        if (rc == 12)
+                            drawStar(ra, dec, mag);
+                    }
+                    pclose(pp);
+                }
+                else
+                {
+                    LOG_ERROR("Error looking up stars, is gsc installed with appropriate environment variables set ??");
+                }
             }
+
             if (drawn == 0)
             {
-                LOG_ERROR("Got no stars, is gsc installed with appropriate environment variables set ??");
+                LOG_ERROR("Got no stars, is gsc installed or a star catalog set ??");
             }
         }
         //fprintf(stderr,"Got %d stars from %d lines drew %d\n",stars,lines,drawn);
@@ -855,6 +859,22 @@ IPState GuideSim::GuideWest(uint32_t v)
     return IPS_OK;
 }
 
+bool GuideSim::ISNewText(const char *dev, const char *name, char *texts[], char *names[], int n)
+{
+    if (dev != nullptr && strcmp(dev, getDeviceName()) == 0)
+    {
+        if (strcmp(name, StarCatalogTP.name) == 0)
+        {
+            IUUpdateText(&StarCatalogTP, texts, names, n);
+            loadStarCatalog();
+            IDSetText(&StarCatalogTP, nullptr);
+            return true;
+        }
+    }
+
+    return INDI::CCD::ISNewText(dev, name, texts, names, n);
+}
+
 bool GuideSim::ISNewNumber(const char *dev, const char *name, double values[], char *names[], int n)
 {
     //  first check if it's for our device
@@ -976,10 +996,37 @@ bool GuideSim::saveConfigItems(FILE *fp)
     // Save CCD Simulator Config
     IUSaveConfigNumber(fp, SimulatorSettingsNV);
     IUSaveConfigSwitch(fp, TimeFactorSV);
+    IUSaveConfigText(fp, &StarCatalogTP);
 
     return true;
 }
 
+void GuideSim::loadStarCatalog()
+{
+    std::unique_lock<std::mutex> guard(ccdBufferLock);
+
+    if (StarCatalogT[0].text == nullptr || StarCatalogT[0].text[0] == '\0')
+    {
+        starCatalog.unload();
+        StarCatalogTP.s = IPS_IDLE;
+        return;
+    }
+
+    if (starCatalog.isLoaded() && starCatalog.path() == StarCatalogT[0].text)
+        return;
+
+    if (starCatalog.load(StarCatalogT[0].text))
+    {
+        StarCatalogTP.s = IPS_OK;
+        LOGF_INFO("Loaded %zu stars from %s.", starCatalog.size(), StarCatalogT[0].text);
+    }
+    else
+    {
+        StarCatalogTP.s = IPS_ALERT;
+        LOGF_ERROR("Failed to load star catalog %s, falling back to gsc.", StarCatalogT[0].text);
+    }
+}
+
 bool GuideSim::StartStreaming()
 {
     ExposureRequest = 1.0 / Streamer->getTargetFPS();
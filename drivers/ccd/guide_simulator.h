@@ -20,11 +20,13 @@
 #pragma once
 
 #include "indiccd.h"
+#include "starcatalog.h"
 
 /**
  * @brief The GuideSim class provides a simple Guide CCD simulator driver.
  *
- * It can stream video and generate images based on General-Star-Catalog tool (gsc). It simulates guiding pulses.
+ * It can stream video and generate images based on General-Star-Catalog tool (gsc) or a star catalog file built
+ * with indi_simulator_catalog. It simulates guiding pulses.
  */
 class GuideSim : public INDI::CCD
 {
@@ -42,6 +44,7 @@ class GuideSim : public INDI::CCD
 
     virtual bool ISNewNumber(const char *dev, const char *name, double values[], char *names[], int n) override;
     virtual bool ISNewSwitch(const char *dev, const char *name, ISState *states, char *names[], int n) override;
+    virtual bool ISNewText(const char *dev, const char *name, char *texts[], char *names[], int n) override;
     virtual bool ISSnoopDevice(XMLEle *root) override;
 
     static void *streamVideoHelper(void *context);
@@ -81,6 +84,9 @@ protected:
     float CalcTimeLeft(timeval, float);
     bool SetupParms();
 
+    // Load the star catalog file, if set, in place of the gsc tool.
+    void loadStarCatalog();
+
     float ExposureRequest { 0 };
     struct timeval ExpStart { 0, 0 };
 
@@ -137,6 +143,11 @@ protected:
     ISwitch TimeFactorS[3];
     ISwitchVectorProperty *TimeFactorSV;
 
+    ITextVectorProperty StarCatalogTP;
+    IText StarCatalogT[1] {};
+
+    StarCatalog starCatalog;
+
     //  We are going to snoop these from focuser
     INumberVectorProperty FWHMNP;
     INumber FWHMN[1];
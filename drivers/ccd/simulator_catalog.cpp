@@ -0,0 +1,113 @@
+/*******************************************************************************
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+ .
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+ .
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+/*
+ * Generate star catalog files for the CCD and guide simulators.
+ *
+ * Convert the output of the General-Star-Catalog tool:
+ *   gsc -c 0 0 -r 10800 -m 0 14 -n 100000000 | indi_simulator_catalog -o stars.cat
+ *
+ * Or generate a synthetic sky:
+ *   indi_simulator_catalog -s 2000000 -m 14 -o stars.cat
+ */
+
+#include "starcatalog.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <unistd.h>
+
+static void usage(const char *me)
+{
+    fprintf(stderr, "Usage: %s [options] -o <catalog>\n", me);
+    fprintf(stderr, "Purpose: Build a star catalog for the CCD and guide simulators.\n");
+    fprintf(stderr, "Without -s, stars are read from gsc output on stdin.\n");
+    fprintf(stderr, "Options:\n");
+    fprintf(stderr, " -o f  : catalog file to write\n");
+    fprintf(stderr, " -s n  : generate n synthetic stars instead of reading stdin\n");
+    fprintf(stderr, " -m m  : faintest magnitude of synthetic stars, default 14\n");
+    fprintf(stderr, " -r r  : random seed of synthetic stars, default 1\n");
+    fprintf(stderr, " -z z  : number of declination zones, default 1800\n");
+    exit(2);
+}
+
+int main(int argc, char *argv[])
+{
+    const char *output = nullptr;
+    long synthetic     = 0;
+    float maxMag       = 14;
+    unsigned long seed = 1;
+    unsigned long zones = 1800;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "o:s:m:r:z:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'o':
+                output = optarg;
+                break;
+            case 's':
+                synthetic = atol(optarg);
+                break;
+            case 'm':
+                maxMag = atof(optarg);
+                break;
+            case 'r':
+                seed = strtoul(optarg, nullptr, 10);
+                break;
+            case 'z':
+                zones = strtoul(optarg, nullptr, 10);
+                break;
+            default:
+                usage(argv[0]);
+        }
+    }
+
+    if (output == nullptr || zones == 0 || synthetic < 0)
+        usage(argv[0]);
+
+    std::vector<StarCatalog::Star> stars;
+
+    if (synthetic > 0)
+        stars = StarCatalog::synthesize(synthetic, maxMag, seed);
+    else
+    {
+        char line[256];
+        while (fgets(line, sizeof(line), stdin) != nullptr)
+        {
+            char id[20], plate[6], ob[6];
+            float ra, dec, pose, mag, mage, dist;
+            int band, c, dir;
+
+            if (sscanf(line, "%10s %f %f %f %f %f %d %d %4s %2s %f %d", id, &ra, &dec, &pose, &mag, &mage, &band, &c,
+                       plate, ob, &dist, &dir) == 12)
+                stars.push_back({ ra, dec, mag });
+        }
+    }
+
+    if (!StarCatalog::write(output, stars, zones))
+    {
+        fprintf(stderr, "Failed to write %s: %s\n", output, strerror(errno));
+        return 1;
+    }
+
+    fprintf(stderr, "Wrote %zu stars to %s\n", stars.size(), output);
+    return 0;
+}
@@ -0,0 +1,291 @@
+/*******************************************************************************
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+ .
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+ .
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#include "starcatalog.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <random>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char CatalogMagic[8] = { 'I', 'N', 'D', 'I', 'S', 'T', 'A', 'R' };
+static const uint32_t CatalogVersion = 1;
+
+StarCatalog::~StarCatalog()
+{
+    unload();
+}
+
+uint32_t StarCatalog::zoneOf(double dec, uint32_t zones)
+{
+    int zone = static_cast<int>((dec + 90.0) / 180.0 * zones);
+    return static_cast<uint32_t>(std::max(0, std::min(zone, static_cast<int>(zones) - 1)));
+}
+
+bool StarCatalog::load(const std::string &path)
+{
+    unload();
+
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(Header))
+    {
+        close(fd);
+        return false;
+    }
+
+    void *map = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        return false;
+
+    const Header *header = static_cast<const Header *>(map);
+    if (memcmp(header->magic, CatalogMagic, sizeof(CatalogMagic)) != 0 || header->version != CatalogVersion ||
+            !validLayout(header, st.st_size))
+    {
+        munmap(map, st.st_size);
+        return false;
+    }
+
+    m_Map         = map;
+    m_MapSize     = st.st_size;
+    m_Path        = path;
+    m_Zones       = header->zones;
+    m_Count       = header->count;
+    m_ZoneOffsets = reinterpret_cast<const uint32_t *>(static_cast<const char *>(map) + sizeof(Header));
+    m_Stars       = reinterpret_cast<const Star *>(m_ZoneOffsets + m_Zones + 1);
+
+    // The whole catalog is scanned zone by zone, let the kernel read ahead.
+    madvise(map, m_MapSize, MADV_WILLNEED);
+
+    return true;
+}
+
+bool StarCatalog::validLayout(const Header *header, size_t fileSize)
+{
+    // Sizes are checked piecewise so that no product or sum can wrap.
+    size_t zones = header->zones;
+    if (zones == 0 || zones > static_cast<size_t>(std::numeric_limits<int>::max()))
+        return false;
+
+    size_t available = fileSize - sizeof(Header);
+    if (zones + 1 > available / sizeof(uint32_t))
+        return false;
+    available -= (zones + 1) * sizeof(uint32_t);
+
+    if (header->count > std::numeric_limits<size_t>::max() / sizeof(Star) ||
+            available != static_cast<size_t>(header->count) * sizeof(Star))
+        return false;
+
+    // Zone offsets must cover the stars exactly, in order.
+    const uint32_t *offsets = reinterpret_cast<const uint32_t *>(reinterpret_cast<const char *>(header) + sizeof(Header));
+    if (offsets[0] != 0 || offsets[zones] != header->count)
+        return false;
+    for (size_t i = 0; i < zones; i++)
+    {
+        if (offsets[i] > offsets[i + 1])
+            return false;
+    }
+
+    return true;
+}
+
+void StarCatalog::unload()
+{
+    if (m_Map != nullptr)
+        munmap(m_Map, m_MapSize);
+
+    m_Map         = nullptr;
+    m_MapSize     = 0;
+    m_Zones       = 0;
+    m_Count       = 0;
+    m_ZoneOffsets = nullptr;
+    m_Stars       = nullptr;
+    m_Path.clear();
+}
+
+size_t StarCatalog::query(double ra, double dec, double radius, double maxMag, size_t limit,
+                          const std::function<void(const Star &)> &callback) const
+{
+    if (m_Stars == nullptr || limit == 0)
+        return 0;
+
+    const double radiusDeg = radius / 60.0;
+    const double minDec    = std::max(-90.0, dec - radiusDeg);
+    const double maxDec    = std::min(90.0, dec + radiusDeg);
+
+    // Half width of the right ascension window. It grows towards the poles and covers
+    // the full circle once the field contains a pole.
+    double raHalfWidth = 180.0;
+    double edgeDec     = std::max(std::fabs(minDec), std::fabs(maxDec));
+    if (edgeDec < 90.0)
+    {
+        double s = std::sin(radiusDeg * M_PI / 180.0) / std::cos(edgeDec * M_PI / 180.0);
+        if (s < 1.0)
+            raHalfWidth = std::asin(s) * 180.0 / M_PI;
+    }
+
+    // Window as up to two non-wrapping intervals in [0, 360)
+    double windows[2][2];
+    int windowCount = 0;
+    ra = std::fmod(ra, 360.0);
+    if (ra < 0)
+        ra += 360.0;
+
+    if (raHalfWidth >= 180.0)
+    {
+        windows[windowCount][0] = 0;
+        windows[windowCount++][1] = 360.0;
+    }
+    else if (ra - raHalfWidth < 0)
+    {
+        windows[windowCount][0] = 0;
+        windows[windowCount++][1] = ra + raHalfWidth;
+        windows[windowCount][0] = ra - raHalfWidth + 360.0;
+        windows[windowCount++][1] = 360.0;
+    }
+    else if (ra + raHalfWidth >= 360.0)
+    {
+        windows[windowCount][0] = ra - raHalfWidth;
+        windows[windowCount++][1] = 360.0;
+        windows[windowCount][0] = 0;
+        windows[windowCount++][1] = ra + raHalfWidth - 360.0;
+    }
+    else
+    {
+        windows[windowCount][0] = ra - raHalfWidth;
+        windows[windowCount++][1] = ra + raHalfWidth;
+    }
+
+    const double rar       = ra * M_PI / 180.0;
+    const double sinDec    = std::sin(dec * M_PI / 180.0);
+    const double cosDec    = std::cos(dec * M_PI / 180.0);
+    const double cosRadius = std::cos(radiusDeg * M_PI / 180.0);
+
+    auto byRA = [](const Star & star, double value)
+    {
+        return star.ra < value;
+    };
+
+    size_t found = 0;
+    for (uint32_t zone = zoneOf(minDec, m_Zones); zone <= zoneOf(maxDec, m_Zones); zone++)
+    {
+        const Star *zoneBegin = m_Stars + m_ZoneOffsets[zone];
+        const Star *zoneEnd   = m_Stars + m_ZoneOffsets[zone + 1];
+
+        for (int i = 0; i < windowCount; i++)
+        {
+            const Star *star = std::lower_bound(zoneBegin, zoneEnd, windows[i][0], byRA);
+            for (; star != zoneEnd && star->ra <= windows[i][1]; ++star)
+            {
+                if (star->mag > maxMag)
+                    continue;
+
+                double sdecr = star->dec * M_PI / 180.0;
+                double cosSeparation = sinDec * std::sin(sdecr) +
+                                       cosDec * std::cos(sdecr) * std::cos(star->ra * M_PI / 180.0 - rar);
+                if (cosSeparation < cosRadius)
+                    continue;
+
+                callback(*star);
+                if (++found >= limit)
+                    return found;
+            }
+        }
+    }
+
+    return found;
+}
+
+bool StarCatalog::write(const std::string &path, std::vector<Star> stars, uint32_t zones)
+{
+    if (zones == 0)
+        return false;
+
+    for (auto &star : stars)
+    {
+        star.ra = std::fmod(star.ra, 360.0f);
+        if (star.ra < 0)
+            star.ra += 360.0f;
+    }
+
+    std::sort(stars.begin(), stars.end(), [zones](const Star & a, const Star & b)
+    {
+        uint32_t zoneA = zoneOf(a.dec, zones), zoneB = zoneOf(b.dec, zones);
+        return (zoneA != zoneB) ? zoneA < zoneB : a.ra < b.ra;
+    });
+
+    std::vector<uint32_t> offsets(zones + 1, 0);
+    for (const auto &star : stars)
+        offsets[zoneOf(star.dec, zones) + 1]++;
+    for (uint32_t zone = 0; zone < zones; zone++)
+        offsets[zone + 1] += offsets[zone];
+
+    Header header;
+    memcpy(header.magic, CatalogMagic, sizeof(CatalogMagic));
+    header.version = CatalogVersion;
+    header.zones   = zones;
+    header.count   = stars.size();
+
+    FILE *fp = fopen(path.c_str(), "wb");
+    if (fp == nullptr)
+        return false;
+
+    bool rc = fwrite(&header, sizeof(header), 1, fp) == 1 &&
+              fwrite(offsets.data(), sizeof(uint32_t), offsets.size(), fp) == offsets.size() &&
+              fwrite(stars.data(), sizeof(Star), stars.size(), fp) == stars.size();
+
+    if (fclose(fp) != 0)
+        rc = false;
+
+    return rc;
+}
+
+std::vector<StarCatalog::Star> StarCatalog::synthesize(size_t count, float maxMag, uint32_t seed)
+{
+    // Star counts grow by about a factor of 10^0.45 per magnitude. Sample magnitudes from that
+    // distribution by inverting its cumulative density, down to the brightest stars of the real sky.
+    constexpr double slope   = 0.45;
+    constexpr double minMag  = -1.5;
+
+    std::mt19937 generator(seed);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+
+    std::vector<Star> stars;
+    stars.reserve(count);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        Star star;
+        star.ra  = static_cast<float>(uniform(generator) * 360.0);
+        star.dec = static_cast<float>(std::asin(2.0 * uniform(generator) - 1.0) * 180.0 / M_PI);
+        double u = std::max(uniform(generator), 1e-12);
+        star.mag = static_cast<float>(std::max(minMag, maxMag + std::log10(u) / slope));
+        stars.push_back(star);
+    }
+
+    return stars;
+}
@@ -0,0 +1,131 @@
+/*******************************************************************************
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+ .
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+ .
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+/**
+ * @brief The StarCatalog class provides an in-memory star index used by the CCD and guide simulators
+ * to draw star fields without spawning the gsc tool for every frame.
+ *
+ * The catalog is a compact binary file that is memory-mapped once. Stars are bucketed into declination zones
+ * and sorted by right ascension within each zone, so a field of view query only touches the zones that overlap
+ * the field and binary searches the right ascension range inside each of them.
+ *
+ * Catalog files are generated with indi_simulator_catalog, either from the text output of gsc or from a
+ * synthetic star distribution.
+ */
+class StarCatalog
+{
+    public:
+        /** J2000 coordinates in degrees and visual magnitude of a catalog star */
+        struct Star
+        {
+            float ra;
+            float dec;
+            float mag;
+        };
+
+        StarCatalog() = default;
+        ~StarCatalog();
+
+        StarCatalog(const StarCatalog &) = delete;
+        StarCatalog &operator=(const StarCatalog &) = delete;
+
+        /**
+         * @brief load Memory-map a catalog file. Any previously loaded catalog is released first.
+         * @param path Full path of the catalog file.
+         * @return True if the file was mapped and its header is valid, false otherwise.
+         */
+        bool load(const std::string &path);
+
+        /** @brief unload Release the mapped catalog, if any. */
+        void unload();
+
+        bool isLoaded() const
+        {
+            return m_Stars != nullptr;
+        }
+
+        const std::string &path() const
+        {
+            return m_Path;
+        }
+
+        size_t size() const
+        {
+            return m_Count;
+        }
+
+        /**
+         * @brief query Find stars inside a circular field of view.
+         * @param ra Field center J2000 right ascension in degrees.
+         * @param dec Field center J2000 declination in degrees.
+         * @param radius Field radius in arcminutes.
+         * @param maxMag Faintest magnitude to report.
+         * @param limit Maximum number of stars to report.
+         * @param callback Invoked once per matching star.
+         * @return Number of stars reported.
+         */
+        size_t query(double ra, double dec, double radius, double maxMag, size_t limit,
+                     const std::function<void(const Star &)> &callback) const;
+
+        /**
+         * @brief write Build the zone index for a list of stars and save it as a catalog file.
+         * @param path Full path of the catalog file to create.
+         * @param stars Stars to index, in any order.
+         * @param zones Number of declination zones the sky is divided into.
+         * @return True if the file was written successfully, false otherwise.
+         */
+        static bool write(const std::string &path, std::vector<Star> stars, uint32_t zones = 1800);
+
+        /**
+         * @brief synthesize Generate stars uniformly distributed on the sky whose counts grow with magnitude
+         * roughly like the real sky.
+         * @param count Number of stars to generate.
+         * @param maxMag Faintest magnitude generated.
+         * @param seed Random seed, the same seed always generates the same catalog.
+         * @return List of generated stars.
+         */
+        static std::vector<Star> synthesize(size_t count, float maxMag, uint32_t seed);
+
+    private:
+        struct Header
+        {
+            char magic[8];
+            uint32_t version;
+            uint32_t zones;
+            uint64_t count;
+        };
+
+        static uint32_t zoneOf(double dec, uint32_t zones);
+        // True if the zones, offsets and stars announced by header fill a file of fileSize bytes consistently
+        static bool validLayout(const Header *header, size_t fileSize);
+
+        std::string m_Path;
+        void *m_Map { nullptr };
+        size_t m_MapSize { 0 };
+
+        uint32_t m_Zones { 0 };
+        uint64_t m_Count { 0 };
+        const uint32_t *m_ZoneOffsets { nullptr };
+        const Star *m_Stars { nullptr };
+};
@@ -23,11 +23,12 @@
 #include <cmath>
 #include <memory>
 #include <cstring>
+#include <sstream>
 #include <unistd.h>
-#include <sys/wait.h>
 #include <errno.h>
 
-#define MAXARGS 20
+// Motion scripts may only return once the dome stopped
+#define SCRIPT_TIMEOUT 300000
 
 typedef enum
 {
@@ -150,75 +151,79 @@ bool DomeScript::ISNewText(const char *dev, const char *name, char *texts[], cha
     return Dome::ISNewText(dev, name, texts, names, n);
 }
 
-bool DomeScript::RunScript(int script, ...)
+std::vector<std::string> DomeScript::ScriptArgs(int script, const std::vector<std::string> &args)
 {
-    char tmp[256];
-    strncpy(tmp, ScriptsT[script].text, sizeof(tmp));
-
-    char **args = (char **)malloc(MAXARGS * sizeof(char *));
-    int arg     = 1;
-    char *p     = tmp;
-    args[0] = p;
-    while (arg < MAXARGS)
+    std::vector<std::string> argv;
+    std::istringstream words(ScriptsT[script].text);
+    std::string word;
+
+    // The script setting may carry arguments after the name of the script
+    while (std::getline(words, word, ' '))
     {
-        char *pp = strstr(p, " ");
-        if (pp == nullptr)
-            break;
-        *pp++       = 0;
-        args[arg++] = pp;
-        p           = pp;
+        if (!word.empty())
+            argv.push_back(word);
     }
-    va_list ap;
-    va_start(ap, script);
-    while (arg < MAXARGS)
+
+    if (argv.empty())
     {
-        char *pp    = va_arg(ap, char *);
-        args[arg++] = pp;
-        if (pp == nullptr)
-            break;
+        LOGF_ERROR("No script set for %s", ScriptsT[script].label);
+        return argv;
     }
-    va_end(ap);
-    char path[1024];
-    snprintf(path, sizeof(path), "%s/%s", ScriptsT[0].text, tmp);
 
-    if (access(path, F_OK|X_OK) != 0)
+    std::string path = std::string(ScriptsT[0].text) + "/" + argv[0];
+    if (access(path.c_str(), F_OK|X_OK) != 0)
     {
-        LOGF_ERROR("Cannot use script [%s], %s", path, strerror(errno));
-        return false;
+        LOGF_ERROR("Cannot use script [%s], %s", path.c_str(), strerror(errno));
+        argv.clear();
+        return argv;
     }
+
+    argv[0] = path;
+    argv.insert(argv.end(), args.begin(), args.end());
+
     if (isDebug())
     {
-        char dbg[8 * 1024];
-        snprintf(dbg, sizeof(dbg), "execvp('%s'", path);
-        for (int i = 0; args[i]; i++)
-        {
-            strcat(dbg, ", '");
-            strcat(dbg, args[i]);
-            strcat(dbg, "'");
-        }
-        strcat(dbg, ", nullptr)");
-        LOG_DEBUG(dbg);
+        std::string dbg = "Running";
+        for (const std::string &arg : argv)
+            dbg += " '" + arg + "'";
+        LOG_DEBUG(dbg.c_str());
     }
 
-    int pid = fork();
-    if (pid == -1)
-    {
-        LOG_ERROR("Fork failed");
+    return argv;
+}
+
+bool DomeScript::ScriptDone(int script, const INDI::ScriptRunner::Result &result)
+{
+    if (!result.errors.empty())
+        LOGF_DEBUG("Script %s: %s", ScriptsT[script].text, result.errors.c_str());
+    if (!result.ok && !result.error.empty())
+        LOGF_DEBUG("Script %s: %s", ScriptsT[script].text, result.error.c_str());
+
+    LOGF_DEBUG("Script %s returned %d", ScriptsT[script].text, result.status);
+    return result.ok;
+}
+
+bool DomeScript::RunScript(int script, const std::vector<std::string> &args)
+{
+    std::vector<std::string> argv = ScriptArgs(script, args);
+    if (argv.empty())
         return false;
-    }
-    else if (pid == 0)
-    {
-        execvp(path, args);
-        LOG_ERROR("Failed to execute script");
-        exit(1);
-    }
-    else
+
+    return ScriptDone(script, INDI::ScriptRunner::instance().runNow(argv, SCRIPT_TIMEOUT));
+}
+
+bool DomeScript::StartScript(int script, std::function<void(bool)> done, const std::vector<std::string> &args,
+                             bool urgent)
+{
+    std::vector<std::string> argv = ScriptArgs(script, args);
+    if (argv.empty())
+        return false;
+
+    INDI::ScriptRunner::instance().run(argv, [this, script, done](const INDI::ScriptRunner::Result & result)
     {
-        int status;
-        waitpid(pid, &status, 0);
-        LOGF_DEBUG("Script %s returned %d", ScriptsT[script].text, status);
-        return status == 0;
-    }
+        done(ScriptDone(script, result));
+    }, SCRIPT_TIMEOUT, urgent);
+    return true;
 }
 
 bool DomeScript::updateProperties()
@@ -242,7 +247,7 @@ bool DomeScript::updateProperties()
 
 void DomeScript::TimerHit()
 {
-    if (!isConnected())
+    if (!isConnected() || StatusRunning)
         return;
     char tmpfile[] = "/tmp/indi_dome_script_status_XXXXXX";
     int fd = mkstemp(tmpfile);
@@ -253,17 +258,37 @@ void DomeScript::TimerHit()
         return;
     }
     close(fd);
-    bool status = RunScript(SCRIPT_STATUS, tmpfile, nullptr);
-    if (status)
+
+    // The status is read once the script exited, the poll is rearmed from there
+    std::string file = tmpfile;
+    StatusRunning    = StartScript(SCRIPT_STATUS, [this, file](bool ok)
+    {
+        StatusRunning = false;
+        ReadDomeStatus(ok, file);
+    }, { file });
+    if (!StatusRunning)
+        ReadDomeStatus(false, file);
+}
+
+void DomeScript::ReadDomeStatus(bool ok, const std::string &file)
+{
+    if (!isConnected())
+    {
+        unlink(file.c_str());
+        return;
+    }
+    if (ok)
     {
         int parked = 0, shutter = 0;
         float az   = 0;
-        FILE *file = fopen(tmpfile, "r");
-        int ret    = 0;
+        FILE *fp   = fopen(file.c_str(), "r");
 
-        ret = fscanf(file, "%d %d %f", &parked, &shutter, &az);
-        fclose(file);
-        unlink(tmpfile);
+        if (fp != nullptr)
+        {
+            if (fscanf(fp, "%d %d %f", &parked, &shutter, &az) != 3)
+                LOG_DEBUG("Incomplete status");
+            fclose(fp);
+        }
         DomeAbsPosN[0].value = az = round(range360(az) * 10) / 10;
         if (parked != 0)
         {
@@ -319,6 +344,7 @@ void DomeScript::TimerHit()
     {
         LOG_ERROR("Failed to read status");
     }
+    unlink(file.c_str());
     SetTimer(POLLMS);
     if (!isParked() && TimeSinceUpdate++ > 4)
     {
@@ -332,7 +358,7 @@ bool DomeScript::Connect()
     if (isConnected())
         return true;
 
-    bool status = RunScript(SCRIPT_CONNECT, nullptr);
+    bool status = RunScript(SCRIPT_CONNECT);
     if (status)
     {
         LOG_INFO("Successfully connected");
@@ -346,7 +372,7 @@ bool DomeScript::Connect()
 
 bool DomeScript::Disconnect()
 {
-    bool status = RunScript(SCRIPT_DISCONNECT, nullptr);
+    bool status = RunScript(SCRIPT_DISCONNECT);
     if (status)
     {
         LOG_INFO("Successfully disconnected");
@@ -360,7 +386,14 @@ bool DomeScript::Disconnect()
 
 IPState DomeScript::Park()
 {
-    bool status = RunScript(SCRIPT_PARK, nullptr);
+    bool status = StartScript(SCRIPT_PARK, [this](bool ok)
+    {
+        if (!ok)
+        {
+            LOG_ERROR("Failed to park");
+            setDomeState(DOME_ERROR);
+        }
+    });
     if (status)
     {
         return IPS_BUSY;
@@ -371,7 +404,14 @@ IPState DomeScript::Park()
 
 IPState DomeScript::UnPark()
 {
-    bool status = RunScript(SCRIPT_UNPARK, nullptr);
+    bool status = StartScript(SCRIPT_UNPARK, [this](bool ok)
+    {
+        if (!ok)
+        {
+            LOG_ERROR("Failed to unpark");
+            setDomeState(DOME_ERROR);
+        }
+    });
     if (status)
     {
         return IPS_BUSY;
@@ -382,11 +422,21 @@ IPState DomeScript::UnPark()
 
 IPState DomeScript::ControlShutter(ShutterOperation operation)
 {
-    if (RunScript(operation == SHUTTER_OPEN ? SCRIPT_OPEN : SCRIPT_CLOSE, nullptr))
+    const char *action = (operation == SHUTTER_OPEN) ? "open" : "close";
+    bool status = StartScript(operation == SHUTTER_OPEN ? SCRIPT_OPEN : SCRIPT_CLOSE, [this, action](bool ok)
+    {
+        if (!ok)
+        {
+            LOGF_ERROR("Failed to %s shutter", action);
+            DomeShutterSP.s = IPS_ALERT;
+            IDSetSwitch(&DomeShutterSP, nullptr);
+        }
+    });
+    if (status)
     {
         return IPS_BUSY;
     }
-    LOGF_ERROR("Failed to %s shutter", operation == SHUTTER_OPEN ? "open" : "close");
+    LOGF_ERROR("Failed to %s shutter", action);
     return IPS_ALERT;
 }
 
@@ -394,7 +444,11 @@ IPState DomeScript::MoveAbs(double az)
 {
     char _az[16];
     snprintf(_az, 16, "%f", round(az * 10) / 10);
-    bool status = RunScript(SCRIPT_GOTO, _az, nullptr);
+    bool status = StartScript(SCRIPT_GOTO, [this](bool ok)
+    {
+        if (!ok)
+            MotionFailed("Failed to MoveAbs");
+    }, { _az });
     if (status)
     {
         TargetAz = az;
@@ -408,7 +462,12 @@ IPState DomeScript::Move(DomeDirection dir, DomeMotionCommand operation)
 {
     if (operation == MOTION_START)
     {
-        if (RunScript(dir == DOME_CW ? SCRIPT_MOVE_CW : SCRIPT_MOVE_CCW, nullptr))
+        auto moved = [this](bool ok)
+        {
+            if (!ok)
+                MotionFailed("Failed to move");
+        };
+        if (StartScript(dir == DOME_CW ? SCRIPT_MOVE_CW : SCRIPT_MOVE_CCW, moved))
         {
             DomeAbsPosNP.s = IPS_BUSY;
             TargetAz       = -1;
@@ -420,11 +479,13 @@ IPState DomeScript::Move(DomeDirection dir, DomeMotionCommand operation)
     }
     else
     {
-        if (RunScript(SCRIPT_ABORT, nullptr))
+        auto stopped = [this](bool ok)
         {
-            DomeAbsPosNP.s = IPS_IDLE;
-        }
-        else
+            DomeAbsPosNP.s = ok ? IPS_IDLE : IPS_ALERT;
+            IDSetNumber(&DomeAbsPosNP, nullptr);
+        };
+        // Stopping does not wait behind other scripts
+        if (!StartScript(SCRIPT_ABORT, stopped, {}, true))
         {
             DomeAbsPosNP.s = IPS_ALERT;
         }
@@ -433,14 +494,28 @@ IPState DomeScript::Move(DomeDirection dir, DomeMotionCommand operation)
     return ((operation == MOTION_START) ? IPS_BUSY : IPS_OK);
 }
 
+void DomeScript::MotionFailed(const char *message)
+{
+    LOG_ERROR(message);
+    setDomeState(DOME_IDLE);
+    DomeAbsPosNP.s = IPS_ALERT;
+    IDSetNumber(&DomeAbsPosNP, nullptr);
+}
+
 bool DomeScript::Abort()
 {
-    bool status = RunScript(SCRIPT_ABORT, nullptr);
-    if (status)
+    bool status = StartScript(SCRIPT_ABORT, [this](bool ok)
     {
-        LOG_INFO("Successfully aborted");
-    }
-    else
+        if (ok)
+        {
+            LOG_INFO("Successfully aborted");
+        }
+        else
+        {
+            LOG_WARN("Failed to abort");
+        }
+    }, {}, true);
+    if (!status)
     {
         LOG_WARN("Failed to abort");
     }
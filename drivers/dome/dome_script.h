@@ -19,6 +19,11 @@
 #pragma once
 
 #include "indidome.h"
+#include "indiscriptrunner.h"
+
+#include <functional>
+#include <string>
+#include <vector>
 
 class DomeScript : public INDI::Dome
 {
@@ -46,11 +51,17 @@ class DomeScript : public INDI::Dome
     virtual bool Abort();
 
   private:
-    bool ReadDomeStatus();
-    bool RunScript(int script, ...);
+    void ReadDomeStatus(bool ok, const std::string &file);
+    std::vector<std::string> ScriptArgs(int script, const std::vector<std::string> &args);
+    bool ScriptDone(int script, const INDI::ScriptRunner::Result &result);
+    bool RunScript(int script, const std::vector<std::string> &args = {});
+    bool StartScript(int script, std::function<void(bool)> done, const std::vector<std::string> &args = {},
+                     bool urgent = false);
+    void MotionFailed(const char *message);
 
     ITextVectorProperty ScriptsTP;
     IText ScriptsT[15] {};
     double TargetAz { 0 };
     int TimeSinceUpdate { 0 };
+    bool StatusRunning { false };
 };
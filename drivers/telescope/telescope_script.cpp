@@ -20,12 +20,13 @@
 
 #include <cstring>
 #include <memory>
+#include <sstream>
 
 #include <unistd.h>
-#include <sys/wait.h>
 #include <errno.h>
 
-#define MAXARGS 20
+// Motion scripts may only return once the mount stopped
+#define SCRIPT_TIMEOUT 300000
 
 typedef enum
 {
@@ -147,75 +148,79 @@ bool ScopeScript::ISNewText(const char *dev, const char *name, char *texts[], ch
     return Telescope::ISNewText(dev, name, texts, names, n);
 }
 
-bool ScopeScript::RunScript(int script, ...)
+std::vector<std::string> ScopeScript::ScriptArgs(int script, const std::vector<std::string> &args)
 {
-    char tmp[256];
-    strncpy(tmp, ScriptsT[script].text, sizeof(tmp));
-
-    char **args = (char **)malloc(MAXARGS * sizeof(char *));
-    int arg     = 1;
-    char *p     = tmp;
-    args[0] = p;
-    while (arg < MAXARGS)
+    std::vector<std::string> argv;
+    std::istringstream words(ScriptsT[script].text);
+    std::string word;
+
+    // The script setting may carry arguments after the name of the script
+    while (std::getline(words, word, ' '))
     {
-        char *pp = strstr(p, " ");
-        if (pp == nullptr)
-            break;
-        *pp++       = 0;
-        args[arg++] = pp;
-        p           = pp;
+        if (!word.empty())
+            argv.push_back(word);
     }
-    va_list ap;
-    va_start(ap, script);
-    while (arg < MAXARGS)
+
+    if (argv.empty())
     {
-        char *pp    = va_arg(ap, char *);
-        args[arg++] = pp;
-        if (pp == nullptr)
-            break;
+        LOGF_ERROR("No script set for %s", ScriptsT[script].label);
+        return argv;
     }
-    va_end(ap);
-    char path[1024];
-    snprintf(path, sizeof(path), "%s/%s", ScriptsT[0].text, tmp);
 
-    if (access(path, F_OK | X_OK) != 0)
+    std::string path = std::string(ScriptsT[0].text) + "/" + argv[0];
+    if (access(path.c_str(), F_OK | X_OK) != 0)
     {
-        LOGF_ERROR("Cannot use script [%s], %s", path, strerror(errno));
-        return false;
+        LOGF_ERROR("Cannot use script [%s], %s", path.c_str(), strerror(errno));
+        argv.clear();
+        return argv;
     }
+
+    argv[0] = path;
+    argv.insert(argv.end(), args.begin(), args.end());
+
     if (isDebug())
     {
-        char dbg[8 * 1024];
-        snprintf(dbg, sizeof(dbg), "execvp('%s'", path);
-        for (int i = 0; args[i]; i++)
-        {
-            strcat(dbg, ", '");
-            strcat(dbg, args[i]);
-            strcat(dbg, "'");
-        }
-        strcat(dbg, ", nullptr)");
-        LOG_DEBUG(dbg);
+        std::string dbg = "Running";
+        for (const std::string &arg : argv)
+            dbg += " '" + arg + "'";
+        LOG_DEBUG(dbg.c_str());
     }
 
-    int pid = fork();
-    if (pid == -1)
-    {
-        LOG_ERROR("Fork failed");
+    return argv;
+}
+
+bool ScopeScript::ScriptDone(int script, const INDI::ScriptRunner::Result &result)
+{
+    if (!result.errors.empty())
+        LOGF_DEBUG("Script %s: %s", ScriptsT[script].text, result.errors.c_str());
+    if (!result.ok && !result.error.empty())
+        LOGF_DEBUG("Script %s: %s", ScriptsT[script].text, result.error.c_str());
+
+    LOGF_DEBUG("Script %s returned %d", ScriptsT[script].text, result.status);
+    return result.ok;
+}
+
+bool ScopeScript::RunScript(int script, const std::vector<std::string> &args)
+{
+    std::vector<std::string> argv = ScriptArgs(script, args);
+    if (argv.empty())
         return false;
-    }
-    else if (pid == 0)
-    {
-        execvp(path, args);
-        LOG_ERROR("Failed to execute script");
-        exit(1);
-    }
-    else
+
+    return ScriptDone(script, INDI::ScriptRunner::instance().runNow(argv, SCRIPT_TIMEOUT));
+}
+
+bool ScopeScript::StartScript(int script, std::function<void(bool)> done, const std::vector<std::string> &args,
+                              bool urgent)
+{
+    std::vector<std::string> argv = ScriptArgs(script, args);
+    if (argv.empty())
+        return false;
+
+    INDI::ScriptRunner::instance().run(argv, [this, script, done](const INDI::ScriptRunner::Result & result)
     {
-        int status;
-        waitpid(pid, &status, 0);
-        LOGF_DEBUG("Script %s returned %d", ScriptsT[script].text, status);
-        return status == 0;
-    }
+        done(ScriptDone(script, result));
+    }, SCRIPT_TIMEOUT, urgent);
+    return true;
 }
 
 bool ScopeScript::Handshake()
@@ -228,7 +233,7 @@ bool ScopeScript::Connect()
     if (isConnected())
         return true;
 
-    bool status = RunScript(SCRIPT_CONNECT, nullptr);
+    bool status = RunScript(SCRIPT_CONNECT);
     if (status)
     {
         LOG_INFO("Successfully connected");
@@ -244,7 +249,7 @@ bool ScopeScript::Connect()
 
 bool ScopeScript::Disconnect()
 {
-    bool status = RunScript(SCRIPT_DISCONNECT, nullptr);
+    bool status = RunScript(SCRIPT_DISCONNECT);
     if (status)
     {
         LOG_INFO("Successfully disconnected");
@@ -260,6 +265,9 @@ bool ScopeScript::ReadScopeStatus()
 {
     if (!isConnected())
         return false;
+    // The last status stands until the running script reports
+    if (StatusRunning)
+        return true;
     char tmpfile[] = "/tmp/indi_telescope_script_status_XXXXXX";
     int fd = mkstemp(tmpfile);
     if (fd == -1)
@@ -269,17 +277,35 @@ bool ScopeScript::ReadScopeStatus()
         return false;
     }
     close(fd);
-    bool status = RunScript(SCRIPT_STATUS, tmpfile, nullptr);
-    if (status)
+
+    std::string file = tmpfile;
+    StatusRunning    = StartScript(SCRIPT_STATUS, [this, file](bool ok)
+    {
+        StatusRunning = false;
+        ReadStatusFile(ok, file);
+    }, { file });
+    if (!StatusRunning)
+    {
+        unlink(tmpfile);
+        LOG_ERROR("Failed to read status");
+    }
+    return StatusRunning;
+}
+
+void ScopeScript::ReadStatusFile(bool ok, const std::string &file)
+{
+    if (ok && isConnected())
     {
         int parked = 0;
         float ra = 0, dec = 0;
-        FILE *file = fopen(tmpfile, "r");
-        int ret = 0;
+        FILE *fp = fopen(file.c_str(), "r");
 
-        ret = fscanf(file, "%d %f %f", &parked, &ra, &dec);
-        fclose(file);
-        unlink(tmpfile);
+        if (fp != nullptr)
+        {
+            if (fscanf(fp, "%d %f %f", &parked, &ra, &dec) != 3)
+                LOG_DEBUG("Incomplete status");
+            fclose(fp);
+        }
         if (parked != 0)
         {
             if (!isParked())
@@ -298,11 +324,13 @@ bool ScopeScript::ReadScopeStatus()
         }
         NewRaDec(ra, dec);
     }
-    else
+    else if (isConnected())
     {
         LOG_ERROR("Failed to read status");
+        EqNP.s = IPS_ALERT;
+        IDSetNumber(&EqNP, nullptr);
     }
-    return status;
+    unlink(file.c_str());
 }
 
 bool ScopeScript::Goto(double ra, double dec)
@@ -310,10 +338,20 @@ bool ScopeScript::Goto(double ra, double dec)
     char _ra[16], _dec[16];
     snprintf(_ra, 16, "%f", ra);
     snprintf(_dec, 16, "%f", dec);
-    bool status = RunScript(SCRIPT_GOTO, _ra, _dec, nullptr);
+    bool status = StartScript(SCRIPT_GOTO, [this](bool ok)
+    {
+        if (ok)
+        {
+            LOG_INFO("Goto successfully executed");
+            return;
+        }
+        LOG_ERROR("Goto failed");
+        TrackState = SCOPE_IDLE;
+        EqNP.s     = IPS_ALERT;
+        IDSetNumber(&EqNP, nullptr);
+    }, { _ra, _dec });
     if (status)
     {
-        LOG_INFO("Goto successfully executed");
         TrackState = SCOPE_SLEWING;
     }
     else
@@ -328,12 +366,18 @@ bool ScopeScript::Sync(double ra, double dec)
     char _ra[16], _dec[16];
     snprintf(_ra, 16, "%f", ra);
     snprintf(_dec, 16, "%f", dec);
-    bool status = RunScript(SCRIPT_SYNC, _ra, _dec, nullptr);
-    if (status)
+    bool status = StartScript(SCRIPT_SYNC, [this](bool ok)
     {
-        LOG_INFO("Sync successfully executed");
-    }
-    else
+        if (ok)
+        {
+            LOG_INFO("Sync successfully executed");
+            return;
+        }
+        LOG_ERROR("Failed to sync");
+        EqNP.s = IPS_ALERT;
+        IDSetNumber(&EqNP, nullptr);
+    }, { _ra, _dec });
+    if (!status)
     {
         LOG_ERROR("Failed to sync");
     }
@@ -342,7 +386,11 @@ bool ScopeScript::Sync(double ra, double dec)
 
 bool ScopeScript::Park()
 {
-    bool status = RunScript(SCRIPT_PARK, nullptr);
+    bool status = StartScript(SCRIPT_PARK, [this](bool ok)
+    {
+        if (!ok)
+            ParkFailed("Failed to park");
+    });
     if (!status)
     {
         LOG_ERROR("Failed to park");
@@ -352,7 +400,11 @@ bool ScopeScript::Park()
 
 bool ScopeScript::UnPark()
 {
-    bool status = RunScript(SCRIPT_UNPARK, nullptr);
+    bool status = StartScript(SCRIPT_UNPARK, [this](bool ok)
+    {
+        if (!ok)
+            ParkFailed("Failed to unpark");
+    });
     if (!status)
     {
         LOG_ERROR("Failed to unpark");
@@ -360,32 +412,62 @@ bool ScopeScript::UnPark()
     return status;
 }
 
+void ScopeScript::ParkFailed(const char *message)
+{
+    LOG_ERROR(message);
+    ParkSP.s = IPS_ALERT;
+    IDSetSwitch(&ParkSP, nullptr);
+}
+
 bool ScopeScript::MoveNS(INDI_DIR_NS dir, TelescopeMotionCommand command)
 {
-    char _rate[] = { (char)('0' + IUFindOnSwitchIndex(&SlewRateSP)), 0 };
-    bool status  = RunScript(command == MOTION_STOP ? SCRIPT_ABORT :
-                             dir == DIRECTION_NORTH ? SCRIPT_MOVE_NORTH : SCRIPT_MOVE_SOUTH,
-                             _rate, nullptr, nullptr);
-    return status;
+    std::string rate(1, static_cast<char>('0' + IUFindOnSwitchIndex(&SlewRateSP)));
+    auto moved = [this](bool ok)
+    {
+        if (!ok)
+            MoveFailed(&MovementNSSP);
+    };
+    // Stopping does not wait behind other scripts
+    return StartScript(command == MOTION_STOP ? SCRIPT_ABORT :
+                       dir == DIRECTION_NORTH ? SCRIPT_MOVE_NORTH : SCRIPT_MOVE_SOUTH,
+                       moved, { rate }, command == MOTION_STOP);
 }
 
 bool ScopeScript::MoveWE(INDI_DIR_WE dir, TelescopeMotionCommand command)
 {
-    char _rate[] = { (char)('0' + IUFindOnSwitchIndex(&SlewRateSP)), 0 };
-    bool status =
-        RunScript(command == MOTION_STOP ? SCRIPT_ABORT : dir == DIRECTION_WEST ? SCRIPT_MOVE_WEST : SCRIPT_MOVE_EAST,
-                  _rate, nullptr, nullptr);
-    return status;
+    std::string rate(1, static_cast<char>('0' + IUFindOnSwitchIndex(&SlewRateSP)));
+    auto moved = [this](bool ok)
+    {
+        if (!ok)
+            MoveFailed(&MovementWESP);
+    };
+    return StartScript(command == MOTION_STOP ? SCRIPT_ABORT :
+                       dir == DIRECTION_WEST ? SCRIPT_MOVE_WEST : SCRIPT_MOVE_EAST,
+                       moved, { rate }, command == MOTION_STOP);
+}
+
+void ScopeScript::MoveFailed(ISwitchVectorProperty *svp)
+{
+    LOG_ERROR("Failed to move");
+    IUResetSwitch(svp);
+    svp->s = IPS_ALERT;
+    IDSetSwitch(svp, nullptr);
 }
 
 bool ScopeScript::Abort()
 {
-    bool status = RunScript(SCRIPT_ABORT, nullptr);
-    if (status)
+    bool status = StartScript(SCRIPT_ABORT, [this](bool ok)
     {
-        LOG_INFO("Successfully aborted");
-    }
-    else
+        if (ok)
+        {
+            LOG_INFO("Successfully aborted");
+        }
+        else
+        {
+            LOG_ERROR("Failed to abort");
+        }
+    }, {}, true);
+    if (!status)
     {
         LOG_ERROR("Failed to abort");
     }
@@ -19,6 +19,11 @@
 #pragma once
 
 #include "inditelescope.h"
+#include "indiscriptrunner.h"
+
+#include <functional>
+#include <string>
+#include <vector>
 
 class ScopeScript : public INDI::Telescope
 {
@@ -48,8 +53,16 @@ class ScopeScript : public INDI::Telescope
     virtual bool UnPark() override;
 
   private:
-    bool RunScript(int script, ...);
+    void ReadStatusFile(bool ok, const std::string &file);
+    std::vector<std::string> ScriptArgs(int script, const std::vector<std::string> &args);
+    bool ScriptDone(int script, const INDI::ScriptRunner::Result &result);
+    bool RunScript(int script, const std::vector<std::string> &args = {});
+    bool StartScript(int script, std::function<void(bool)> done, const std::vector<std::string> &args = {},
+                     bool urgent = false);
+    void ParkFailed(const char *message);
+    void MoveFailed(ISwitchVectorProperty *svp);
 
     ITextVectorProperty ScriptsTP;
     IText ScriptsT[15] {};
+    bool StatusRunning { false };
 };
@@ -166,6 +166,12 @@ bool V4L2_Driver::initProperties()
     IUFillSwitchVector(&ColorProcessingSP, ColorProcessingS, NARRAY(ColorProcessingS), getDeviceName(),
                        "V4L2_COLOR_PROCESSING", "Color Process", CAPTURE_FORMAT, IP_RW, ISR_NOFMANY, 0, IPS_IDLE);
 
+    /* Demosaic */
+    IUFillSwitch(&DemosaicS[DEMOSAIC_BILINEAR], "BILINEAR", "Bilinear", ISS_ON);
+    IUFillSwitch(&DemosaicS[DEMOSAIC_EDGE_AWARE], "EDGE_AWARE", "Edge aware", ISS_OFF);
+    IUFillSwitchVector(&DemosaicSP, DemosaicS, NARRAY(DemosaicS), getDeviceName(), "V4L2_DEMOSAIC", "Demosaic",
+                       CAPTURE_FORMAT, IP_RW, ISR_1OFMANY, 0, IPS_IDLE);
+
     /* V4L2 Settings */
     IUFillNumberVector(&ImageAdjustNP, nullptr, 0, getDeviceName(), "Image Adjustments", "", IMAGE_GROUP, IP_RW, 60,
                        IPS_IDLE);
@@ -221,6 +227,7 @@ void V4L2_Driver::ISGetProperties(const char * dev)
             defineNumber(&FrameRateNP);
 
         defineSwitch(&StackModeSP);
+        defineSwitch(&DemosaicSP);
 
 #ifdef WITH_V4L2_EXPERIMENTS
         defineSwitch(&ImageDepthSP);
@@ -262,6 +269,7 @@ bool V4L2_Driver::updateProperties()
             defineNumber(&FrameRateNP);
 
         defineSwitch(&StackModeSP);
+        defineSwitch(&DemosaicSP);
 
 #ifdef WITH_V4L2_EXPERIMENTS
         defineSwitch(&ImageDepthSP);
@@ -340,6 +348,7 @@ bool V4L2_Driver::updateProperties()
         v4loptions = 0;
 
         deleteProperty(StackModeSP.name);
+        deleteProperty(DemosaicSP.name);
 
 #ifdef WITH_V4L2_EXPERIMENTS
         deleteProperty(ImageDepthSP.name);
@@ -627,6 +636,16 @@ bool V4L2_Driver::ISNewSwitch(const char * dev, const char * name, ISState * sta
         return true;
     }
 
+    /* Demosaic */
+    if (strcmp(name, DemosaicSP.name) == 0)
+    {
+        IUUpdateSwitch(&DemosaicSP, states, names, n);
+        v4l_base->setEdgeAwareDemosaic(DemosaicS[DEMOSAIC_EDGE_AWARE].s == ISS_ON);
+        DemosaicSP.s = IPS_OK;
+        IDSetSwitch(&DemosaicSP, nullptr);
+        return true;
+    }
+
     /* V4L2 Options/Menus */
     for (iopt = 0; iopt < v4loptions; iopt++)
         if (strcmp(Options[iopt].name, name) == 0)
@@ -1322,8 +1341,25 @@ void V4L2_Driver::newFrame()
         }
         else
         {
-            guard.unlock();
-            Streamer->newFrame(buffer, frameBytes);
+            // Lend the capture buffer to the streamer, it is given back to the device once streamed or recorded.
+            // Frames produced by a decoder are overwritten by the next frame, so the streamer gets a copy of those.
+            int const index = v4l_base->holdFrame(buffer, frameBytes);
+            if (index < 0)
+            {
+                memcpy(PrimaryCCD.getFrameBuffer(), buffer, totalBytes);
+                guard.unlock();
+                Streamer->newFrame(PrimaryCCD.getFrameBuffer(), frameBytes);
+            }
+            else
+            {
+                guard.unlock();
+                Streamer->newFrame(buffer, frameBytes, [this, index]()
+                {
+                    char errmsg[ERRMSGSIZ];
+                    if (v4l_base->releaseFrame(index, errmsg) < 0)
+                        LOGF_DEBUG("Failed to release frame buffer #%d: %s", index, errmsg);
+                });
+            }
         }
         return;
     }
@@ -1754,6 +1790,8 @@ bool V4L2_Driver::saveConfigItems(FILE * fp)
     if (ImageAdjustNP.nnp > 0)
         IUSaveConfigNumber(fp, &ImageAdjustNP);
 
+    IUSaveConfigSwitch(fp, &DemosaicSP);
+
     return Streamer->saveConfigItems(fp);
 }
 
@@ -118,6 +118,12 @@ class V4L2_Driver : public INDI::CCD
     ISwitch ImageDepthS[2];
     ISwitch StackModeS[5];
     ISwitch ColorProcessingS[3];
+    ISwitch DemosaicS[2];
+    enum
+    {
+        DEMOSAIC_BILINEAR,
+        DEMOSAIC_EDGE_AWARE
+    };
 
     /* Texts */
     IText PortT[1] {};
@@ -140,6 +146,7 @@ class V4L2_Driver : public INDI::CCD
     ISwitchVectorProperty FrameRatesSP;     /* Select Frame rate (Discrete) */
     ISwitchVectorProperty *Options;
     ISwitchVectorProperty ColorProcessingSP;
+    ISwitchVectorProperty DemosaicSP;       /* Bayer to RGB interpolation */
 
     unsigned int v4loptions;
     unsigned int v4ladjustments;
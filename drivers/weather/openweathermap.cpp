@@ -29,20 +29,12 @@
 #include "gason.h"
 #include "locale_compat.h"
 
-#include <curl/curl.h>
-
 #include <memory>
 #include <cstring>
 
 // We declare an auto pointer to OpenWeatherMap.
 std::unique_ptr<OpenWeatherMap> openWeatherMap(new OpenWeatherMap());
 
-static size_t WriteCallback(void *contents, size_t size, size_t nmemb, void *userp)
-{
-    ((std::string *)userp)->append((char *)contents, size * nmemb);
-    return size * nmemb;
-}
-
 void ISGetProperties(const char *dev)
 {
     openWeatherMap->ISGetProperties(dev);
@@ -187,8 +179,6 @@ bool OpenWeatherMap::updateLocation(double latitude, double longitude, double el
 
 IPState OpenWeatherMap::updateWeather()
 {
-    CURL *curl;
-    CURLcode res;
     std::string readBuffer;
     char requestURL[MAXRBUF];
 
@@ -201,15 +191,9 @@ IPState OpenWeatherMap::updateWeather()
     snprintf(requestURL, MAXRBUF, "http://api.openweathermap.org/data/2.5/weather?lat=%g&lon=%g&appid=%s&units=metric",
              owmLat, owmLong, owmAPIKeyT[0].text);
 
-    curl = curl_easy_init();
-    if (curl)
-    {
-        curl_easy_setopt(curl, CURLOPT_URL, requestURL);
-        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
-        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &readBuffer);
-        res = curl_easy_perform(curl);
-        curl_easy_cleanup(curl);
-    }
+    IPState state = fetchURL(requestURL, readBuffer);
+    if (state != IPS_OK)
+        return state;
 
     char srcBuffer[readBuffer.size()];
     strncpy(srcBuffer, readBuffer.c_str(), readBuffer.size());
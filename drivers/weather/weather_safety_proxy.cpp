@@ -22,23 +22,16 @@
   file called LICENSE.
 *******************************************************************************/
 
+#include <algorithm>
 #include <memory>
 #include <unistd.h>
-#include <sys/wait.h>
 #include <cstring>
-#include <curl/curl.h>
 
 #include "gason.h"
 #include "weather_safety_proxy.h"
 
 std::unique_ptr<WeatherSafetyProxy> weatherSafetyProxy(new WeatherSafetyProxy());
 
-static size_t WSP_WriteCallback(void *contents, size_t size, size_t nmemb, void *userp)
-{
-    ((std::string *)userp)->append((char *)contents, size * nmemb);
-    return size * nmemb;
-}
-
 void ISGetProperties(const char *dev)
 {
     weatherSafetyProxy->ISGetProperties(dev);
@@ -84,7 +77,10 @@ WeatherSafetyProxy::WeatherSafetyProxy()
     setWeatherConnection(CONNECTION_NONE);
 }
 
-WeatherSafetyProxy::~WeatherSafetyProxy() {}
+WeatherSafetyProxy::~WeatherSafetyProxy()
+{
+    cancelScript();
+}
 
 const char *WeatherSafetyProxy::getDefaultName()
 {
@@ -98,6 +94,7 @@ bool WeatherSafetyProxy::Connect()
 
 bool WeatherSafetyProxy::Disconnect()
 {
+    cancelScript();
     return true;
 }
 
@@ -255,6 +252,9 @@ IPState WeatherSafetyProxy::updateWeather()
     {
         ret = executeCurl();
     }
+    // Still waiting for the script or the url, not an error
+    if (ret == IPS_BUSY)
+        return ret;
     if (ret != IPS_OK)
     {
         if (Safety == WSP_SAFE)
@@ -288,10 +288,31 @@ IPState WeatherSafetyProxy::updateWeather()
     return ret;
 }
 
+// The first call starts the script and returns IPS_BUSY, the call following its exit parses its output
 IPState WeatherSafetyProxy::executeScript()
 {
     char *cmd = ScriptsT[WSP_SCRIPT].text;
 
+    if (scriptDone)
+    {
+        scriptDone = false;
+        if (!scriptResult.errors.empty())
+            LOGF_DEBUG("Script errors [%s]", scriptResult.errors.c_str());
+        if (scriptResult.output.empty())
+        {
+            if (!scriptResult.error.empty())
+                LOGF_ERROR("Failed to run script [%s]", scriptResult.error.c_str());
+            LOGF_ERROR("Got no output from script [%s]", cmd);
+            LastParseSuccess = false;
+            return IPS_ALERT;
+        }
+        LOGF_DEBUG("Read %d bytes output [%s]", scriptResult.output.size(), scriptResult.output.c_str());
+        return parseSafetyJSON(scriptResult.output.c_str(), scriptResult.output.size());
+    }
+
+    if (scriptID >= 0)
+        return IPS_BUSY;
+
     if (access(cmd, F_OK|X_OK) == -1)
     {
         LOGF_ERROR("Cannot use script [%s], check its existence and permissions", cmd);
@@ -300,64 +321,45 @@ IPState WeatherSafetyProxy::executeScript()
     }
 
     LOGF_DEBUG("Run script: %s", cmd);
-    FILE *handle = popen(cmd, "r");
-    if (handle == nullptr)
-    {
-        LOGF_ERROR("Failed to run script [%s]", strerror(errno));
-        LastParseSuccess = false;
-        return IPS_ALERT;
-    }
-    char buf[BUFSIZ];
-    size_t byte_count = fread(buf, 1, BUFSIZ - 1, handle);
-    fclose(handle);
-    buf[byte_count] = 0;
-    if (byte_count == 0)
+    scriptID = INDI::ScriptRunner::instance().run({ cmd }, [this](const INDI::ScriptRunner::Result & result)
     {
-        LOGF_ERROR("Got no output from script [%s]", cmd);
-        LastParseSuccess = false;
-        return IPS_ALERT;
-    }
-    LOGF_DEBUG("Read %d bytes output [%s]", byte_count, buf);
+        scriptID     = -1;
+        scriptDone   = true;
+        scriptResult = result;
+        // Back to updateWeather() with the output
+        TimerHit();
+    });
+    return IPS_BUSY;
+}
 
-    return parseSafetyJSON(buf, byte_count);
+void WeatherSafetyProxy::cancelScript()
+{
+    if (scriptID >= 0)
+        INDI::ScriptRunner::instance().cancel(scriptID);
+
+    scriptID   = -1;
+    scriptDone = false;
 }
 
 IPState WeatherSafetyProxy::executeCurl()
 {
-    CURL *curl_handle;
-    CURLcode res;
     std::string readBuffer;
 
-    curl_handle = curl_easy_init();
-    if (curl_handle)
-    {
-        curl_easy_setopt(curl_handle, CURLOPT_URL, UrlT[WSP_URL].text);
-        curl_easy_setopt(curl_handle, CURLOPT_WRITEFUNCTION, WSP_WriteCallback);
-        curl_easy_setopt(curl_handle, CURLOPT_WRITEDATA, &readBuffer);
-        curl_easy_setopt(curl_handle, CURLOPT_USERAGENT, "libcurl-agent/1.0");
-        LOGF_DEBUG("Call curl %s", UrlT[WSP_URL].text);
-        res = curl_easy_perform(curl_handle);
-        if (res != CURLE_OK)
-        {
-            LOGF_ERROR("curl_easy_perform failed with [%s]", curl_easy_strerror(res));
-            return IPS_ALERT;
-        }
-        curl_easy_cleanup(curl_handle);
-        LOGF_DEBUG("Read %d bytes output [%s]", readBuffer.size(), readBuffer.c_str());
-        return parseSafetyJSON(readBuffer.c_str(), readBuffer.size());
-    }
-    else
-    {
-        LOG_ERROR("curl_easy_init failed");
-        return IPS_ALERT;
-    }
+    IPState state = fetchURL(UrlT[WSP_URL].text, readBuffer);
+    if (state != IPS_OK)
+        return state;
+
+    LOGF_DEBUG("Read %d bytes output [%s]", readBuffer.size(), readBuffer.c_str());
+    return parseSafetyJSON(readBuffer.c_str(), readBuffer.size());
 }
 
 IPState WeatherSafetyProxy::parseSafetyJSON(const char *clean_buf, int byte_count)
 {
     // copy clean_buf to buf which jsonParse can destroy
     char buf[BUFSIZ];
-    strncpy(buf, clean_buf, byte_count);
+    byte_count = std::min(byte_count, BUFSIZ - 1);
+    memcpy(buf, clean_buf, byte_count);
+    buf[byte_count] = 0;
 
     char *source = buf;
     char *endptr;
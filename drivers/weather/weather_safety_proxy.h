@@ -25,6 +25,7 @@
 #pragma once
 
 #include "indiweather.h"
+#include "indiscriptrunner.h"
 
 typedef enum
 {
@@ -83,6 +84,7 @@ class WeatherSafetyProxy : public INDI::Weather
 
   private:
     IPState executeScript();
+    void cancelScript();
     IPState executeCurl();
     IPState parseSafetyJSON(const char *buf, int byte_count);
 
@@ -109,4 +111,9 @@ class WeatherSafetyProxy : public INDI::Weather
     int SofterrorRecoveryCount = 0;
     bool SofterrorRecoveryMode = false;
     bool LastParseSuccess = false;
+
+    // Run of executeScript()
+    int scriptID = -1;
+    bool scriptDone = false;
+    INDI::ScriptRunner::Result scriptResult;
 };
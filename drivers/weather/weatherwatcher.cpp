@@ -25,20 +25,12 @@
 #include "weatherwatcher.h"
 #include "locale_compat.h"
 
-#include <curl/curl.h>
-
 #include <memory>
 #include <cstring>
 
 // We declare an auto pointer to WeatherWatcher.
 static std::unique_ptr<WeatherWatcher> weatherWatcher(new WeatherWatcher());
 
-static size_t write_data(void *contents, size_t size, size_t nmemb, void *userp)
-{
-    ((std::string *)userp)->append((char *)contents, size * nmemb);
-    return size * nmemb;
-}
-
 void ISGetProperties(const char *dev)
 {
     weatherWatcher->ISGetProperties(dev);
@@ -255,9 +247,15 @@ bool WeatherWatcher::ISNewText(const char *dev, const char *name, char *texts[],
 
 IPState WeatherWatcher::updateWeather()
 {
+    std::string readBuffer;
 
-    if (readWatchFile() == false)
-        return IPS_BUSY;
+    IPState state = fetchURL(watchURL(), readBuffer);
+    if (state != IPS_OK)
+        return state;
+
+    AutoCNumeric locale;
+
+    weatherMap = createMap(readBuffer);
 
     for (auto const &x : weatherMap)
     {
@@ -287,38 +285,27 @@ IPState WeatherWatcher::updateWeather()
     return IPS_OK;
 }
 
-bool WeatherWatcher::readWatchFile()
+std::string WeatherWatcher::watchURL()
 {
-    CURL *curl;
-    CURLcode res;
-    bool rc = false;
-    char requestURL[MAXRBUF];
-
-    AutoCNumeric locale;
-
     if (std::string(watchFileT[0].text).find("http") == 0)
-        snprintf(requestURL, MAXRBUF, "%s", watchFileT[0].text);
-    else
-        snprintf(requestURL, MAXRBUF, "file://%s", watchFileT[0].text);
+        return watchFileT[0].text;
 
-    curl = curl_easy_init();
+    return std::string("file://") + watchFileT[0].text;
+}
 
-    if (curl)
-    {
-        curl_easy_setopt(curl, CURLOPT_URL, requestURL);
-        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_data);
-        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &readBuffer);
-        res = curl_easy_perform(curl);
+bool WeatherWatcher::readWatchFile()
+{
+    // The parameters must be known before the properties are defined, so connecting waits for the file
+    INDI::HTTPFetcher::Result result = INDI::HTTPFetcher::instance().fetchNow(watchURL());
 
-        if (res == CURLE_OK)
-        {
-            weatherMap = createMap(readBuffer);
-            rc = true;
-        }
-        curl_easy_cleanup(curl);
+    if (!result.ok)
+    {
+        LOGF_ERROR("Failed to read %s: %s", watchFileT[0].text, result.error.c_str());
+        return false;
     }
 
-    return rc;
+    weatherMap = createMap(result.body);
+    return true;
 }
 
 bool WeatherWatcher::saveConfigItems(FILE *fp)
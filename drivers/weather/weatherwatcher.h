@@ -54,6 +54,7 @@ class WeatherWatcher : public INDI::Weather
 
   private:
     std::map<std::string, std::string> createMap(std::string const& s);
+    std::string watchURL();
     bool readWatchFile();
     bool createPropertiesFromMap();
 
@@ -61,7 +62,6 @@ class WeatherWatcher : public INDI::Weather
     ITextVectorProperty watchFileTP;
 
     bool initialParse { false };
-    std::string readBuffer;
 
     std::map<std::string,std::string> weatherMap;
 };
@@ -27,20 +27,12 @@
 #include "gason.h"
 #include "locale_compat.h"
 
-#include <curl/curl.h>
-
 #include <memory>
 #include <cstring>
 
 // We declare an auto pointer to WunderGround.
 std::unique_ptr<WunderGround> wunderGround(new WunderGround());
 
-static size_t WriteCallback(void *contents, size_t size, size_t nmemb, void *userp)
-{
-    ((std::string *)userp)->append((char *)contents, size * nmemb);
-    return size * nmemb;
-}
-
 void ISGetProperties(const char *dev)
 {
     wunderGround->ISGetProperties(dev);
@@ -175,8 +167,6 @@ bool WunderGround::updateLocation(double latitude, double longitude, double elev
 
 IPState WunderGround::updateWeather()
 {
-    CURL *curl;
-    CURLcode res;
     std::string readBuffer;
     char requestURL[MAXRBUF];
 
@@ -189,15 +179,9 @@ IPState WunderGround::updateWeather()
     snprintf(requestURL, MAXRBUF, "http://api.wunderground.com/api/%s/conditions/q/%g,%g.json", wunderAPIKeyT[0].text,
              wunderLat, wunderLong);
 
-    curl = curl_easy_init();
-    if (curl)
-    {
-        curl_easy_setopt(curl, CURLOPT_URL, requestURL);
-        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
-        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &readBuffer);
-        res = curl_easy_perform(curl);
-        curl_easy_cleanup(curl);
-    }
+    IPState state = fetchURL(requestURL, readBuffer);
+    if (state != IPS_OK)
+        return state;
 
     char srcBuffer[readBuffer.size()];
     strncpy(srcBuffer, readBuffer.c_str(), readBuffer.size());
@@ -331,20 +331,26 @@ static void runWorkProc()
 static void callCallback(fd_set *rfdp)
 {
     CB *cp;
+    int n;
 
     /* skip if list is empty */
     if (!ncbinuse)
         return;
 
-    /* find next */
-    do
+    /* find next. a timer may just have removed the only ready one, so look
+     * at each entry at most once.
+     */
+    for (n = 0; n < ncback; n++)
     {
         lastcb = (lastcb + 1) % ncback;
         cp     = &cback[lastcb];
-    } while (!cp->in_use || !FD_ISSET(cp->fd, rfdp));
-
-    /* run */
-    (*cp->fp)(cp->fd, cp->ud);
+        if (cp->in_use && FD_ISSET(cp->fd, rfdp))
+        {
+            /* run */
+            (*cp->fp)(cp->fd, cp->ud);
+            return;
+        }
+    }
 }
 
 /* run the next timer callback whose time has come, if any. all we have to do
@@ -31,6 +31,7 @@
 #include <errno.h>
 #include <pthread.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <stdarg.h>
 #include <string.h>
 #include <time.h>
@@ -106,32 +107,504 @@ char *escapeXML(const char *s, unsigned int MAX_BUF_SIZE)
     return buf;
 }
 
+/* Outgoing messages are composed in full in a per-thread buffer and handed to
+ * stdout with a single write(), so stdout_mutex is held only while the bytes go
+ * to the kernel and never while formatting.
+ */
+#define DRVBUF_MIN  4096         /* initial capacity of a message buffer */
+#define DRVBUF_KEEP (256 * 1024) /* buffers grown past this are released after use */
+
+typedef struct
+{
+    char *data;
+    size_t len;
+    size_t cap;
+    int err; /* set if the buffer could not grow, message is dropped */
+} DrvBuf;
+
+static pthread_key_t drvbuf_key;
+static pthread_once_t drvbuf_once = PTHREAD_ONCE_INIT;
+static DrvBuf drvbuf_nomem = { NULL, 0, 0, 1 }; /* stand-in when a buffer cannot be allocated */
+
+static void drvBufFree(void *p)
+{
+    DrvBuf *b = (DrvBuf *)p;
+
+    free(b->data);
+    free(b);
+}
+
+static void drvBufInitKey(void)
+{
+    pthread_key_create(&drvbuf_key, drvBufFree);
+}
+
+/* return the calling thread's message buffer, emptied */
+static DrvBuf *drvBufGet(void)
+{
+    DrvBuf *b;
+
+    pthread_once(&drvbuf_once, drvBufInitKey);
+    b = (DrvBuf *)pthread_getspecific(drvbuf_key);
+    if (b == NULL)
+    {
+        b = (DrvBuf *)calloc(1, sizeof(DrvBuf));
+        if (b == NULL || pthread_setspecific(drvbuf_key, b) != 0)
+        {
+            free(b);
+            return &drvbuf_nomem;
+        }
+    }
+    b->len = 0;
+    return b;
+}
+
+/* make room for n more bytes plus a nul, return where they go or NULL */
+static char *drvBufReserve(DrvBuf *b, size_t n)
+{
+    if (b->err)
+        return NULL;
+
+    if (b->len + n + 1 > b->cap)
+    {
+        size_t cap = b->cap ? b->cap : DRVBUF_MIN;
+        char *data;
+
+        while (cap < b->len + n + 1)
+            cap *= 2;
+        data = (char *)realloc(b->data, cap);
+        if (data == NULL)
+        {
+            b->err = 1;
+            return NULL;
+        }
+        b->data = data;
+        b->cap  = cap;
+    }
+
+    return b->data + b->len;
+}
+
+static void drvBufAdd(DrvBuf *b, const char *s, size_t n)
+{
+    char *p = drvBufReserve(b, n);
+
+    if (p == NULL)
+        return;
+    memcpy(p, s, n);
+    b->len += n;
+}
+
+static void drvBufPuts(DrvBuf *b, const char *s)
+{
+    drvBufAdd(b, s, strlen(s));
+}
+
+static void drvBufVPrintf(DrvBuf *b, const char *fmt, va_list ap)
+{
+    va_list aq;
+    char *p = drvBufReserve(b, 128);
+    int n;
+
+    if (p == NULL)
+        return;
+
+    va_copy(aq, ap);
+    n = vsnprintf(p, b->cap - b->len, fmt, aq);
+    va_end(aq);
+    if (n < 0)
+        return;
+
+    if ((size_t)n >= b->cap - b->len)
+    {
+        p = drvBufReserve(b, n);
+        if (p == NULL)
+            return;
+        va_copy(aq, ap);
+        vsnprintf(p, b->cap - b->len, fmt, aq);
+        va_end(aq);
+    }
+
+    b->len += n;
+}
+
+static void drvBufPrintf(DrvBuf *b, const char *fmt, ...)
+{
+    va_list ap;
+
+    va_start(ap, fmt);
+    drvBufVPrintf(b, fmt, ap);
+    va_end(ap);
+}
+
+/* append s expanding the xml special characters into escape sequences */
+static void drvBufEscape(DrvBuf *b, const char *s)
+{
+    const char *ep;
+
+    for (; (ep = strpbrk(s, "&<>'\"")) != NULL; s = ep + 1)
+    {
+        drvBufAdd(b, s, ep - s);
+        switch (*ep)
+        {
+            case '&':
+                drvBufAdd(b, "&amp;", 5);
+                break;
+            case '<':
+                drvBufAdd(b, "&lt;", 4);
+                break;
+            case '>':
+                drvBufAdd(b, "&gt;", 4);
+                break;
+            case '\'':
+                drvBufAdd(b, "&apos;", 6);
+                break;
+            case '"':
+                drvBufAdd(b, "&quot;", 6);
+                break;
+        }
+    }
+    drvBufPuts(b, s);
+}
+
+#ifdef __SIZEOF_INT128__
+/* Print v like printf("%.<prec>g") into out using only integer arithmetic, so the
+ * result is exact, independent of the locale and much cheaper than the stdio path.
+ * Returns the length, or -1 if v is outside the range handled here (infinities,
+ * NaN, subnormals, very large or very small magnitudes) and stdio must be used.
+ */
+static int drvFormatG(char *out, double v, int prec)
+{
+    typedef unsigned __int128 u128;
+    char digits[48];
+    int nd = 0, x, i, k = 0, roundup = 0, decided = 0;
+    uint64_t bits, m, ip;
+    u128 f = 0;
+    int e;
+    char *p = out;
+
+    if (prec <= 0 || prec > 40)
+        return -1;
+
+    memcpy(&bits, &v, sizeof(bits));
+    if (bits >> 63)
+        *p++ = '-';
+    e = (int)((bits >> 52) & 0x7ff);
+    m = bits & 0xfffffffffffffULL;
+
+    if (e == 0 && m == 0)
+    {
+        *p++ = '0';
+        return p - out;
+    }
+    if (e == 0 || e == 0x7ff)
+        return -1;
+
+    /* v = m * 2^e exactly */
+    m |= 1ULL << 52;
+    e -= 1075;
+    if (e >= 0)
+    {
+        if (e > 11)
+            return -1;
+        ip = m << e;
+    }
+    else
+    {
+        k = -e;
+        if (k > 120)
+            return -1;
+        ip = k >= 64 ? 0 : m >> k;
+        f  = (u128)m & (((u128)1 << k) - 1);
+    }
+
+    /* significant digits of the integer part, then of the fraction */
+    if (ip)
+    {
+        char tmp[24];
+        int n = 0;
+        while (ip)
+        {
+            tmp[n++] = '0' + ip % 10;
+            ip /= 10;
+        }
+        x = n - 1;
+        while (n > 0 && nd <= prec)
+            digits[nd++] = tmp[--n];
+        if (nd > prec)
+        {
+            /* digit prec decides, anything after it breaks a tie */
+            int rest = f != 0;
+            while (n > 0)
+                rest |= tmp[--n] != '0';
+            roundup = digits[prec] > '5' || (digits[prec] == '5' && (rest || (digits[prec - 1] - '0') & 1));
+            nd      = prec;
+            decided = 1;
+        }
+    }
+    else
+    {
+        x = -1;
+        while (f && ((f * 10) >> k) == 0)
+        {
+            f *= 10;
+            x--;
+        }
+    }
+
+    if (!decided && f)
+    {
+        u128 mask = ((u128)1 << k) - 1;
+        u128 half = (u128)1 << (k - 1);
+
+        while (nd < prec && f)
+        {
+            f *= 10;
+            digits[nd++] = '0' + (int)(f >> k);
+            f &= mask;
+        }
+        /* whatever fraction is left is measured in units of the last digit */
+        roundup = f > half || (f == half && (digits[nd - 1] - '0') & 1);
+    }
+
+    if (roundup)
+    {
+        for (i = nd - 1; i >= 0 && digits[i] == '9'; i--)
+            digits[i] = '0';
+        if (i >= 0)
+            digits[i]++;
+        else
+        {
+            digits[0] = '1';
+            x++;
+        }
+    }
+
+    /* %g drops trailing zeros */
+    while (nd > 1 && digits[nd - 1] == '0')
+        nd--;
+
+    if (x < -4 || x >= prec)
+    {
+        int ax = x < 0 ? -x : x;
+        *p++   = digits[0];
+        if (nd > 1)
+        {
+            *p++ = '.';
+            memcpy(p, digits + 1, nd - 1);
+            p += nd - 1;
+        }
+        *p++ = 'e';
+        *p++ = x < 0 ? '-' : '+';
+        if (ax >= 100)
+            *p++ = '0' + ax / 100;
+        *p++ = '0' + ax / 10 % 10;
+        *p++ = '0' + ax % 10;
+    }
+    else if (x >= 0)
+    {
+        for (i = 0; i <= x; i++)
+            *p++ = i < nd ? digits[i] : '0';
+        if (nd > x + 1)
+        {
+            *p++ = '.';
+            memcpy(p, digits + x + 1, nd - x - 1);
+            p += nd - x - 1;
+        }
+    }
+    else
+    {
+        *p++ = '0';
+        *p++ = '.';
+        for (i = -1; i > x; i--)
+            *p++ = '0';
+        memcpy(p, digits, nd);
+        p += nd;
+    }
+
+    return p - out;
+}
+#endif
+
+/* append v printed like "%.<prec>g", always with '.' as the decimal separator.
+ * Values drvFormatG() can't take go through stdio, and the radix character of
+ * the current locale is swapped out afterwards rather than switching LC_NUMERIC,
+ * which is process wide and would race with other threads.
+ */
+static void drvBufNumber(DrvBuf *b, double v, int prec)
+{
+    char num[64];
+    const char *dp;
+    int n = -1;
+
+#ifdef __SIZEOF_INT128__
+    n = drvFormatG(num, v, prec);
+#endif
+    if (n < 0)
+    {
+        n = snprintf(num, sizeof(num), "%.*g", prec, v);
+        if (n < 0)
+            return;
+        if (n >= (int)sizeof(num))
+            n = sizeof(num) - 1;
+
+        dp = localeconv()->decimal_point;
+        if (dp[0] != '\0' && (dp[0] != '.' || dp[1] != '\0'))
+        {
+            char *p = strstr(num, dp);
+            if (p)
+            {
+                size_t dl = strlen(dp);
+                *p        = '.';
+                memmove(p + 1, p + dl, n - (p - num) - dl + 1);
+                n -= dl - 1;
+            }
+        }
+    }
+
+    drvBufAdd(b, num, n);
+}
+
+/* append the current time as a timestamp attribute */
+static void drvBufTimestamp(DrvBuf *b)
+{
+    char ts[32];
+    struct tm tm;
+    time_t t = time(NULL);
+
+    gmtime_r(&t, &tm);
+    strftime(ts, sizeof(ts), "%Y-%m-%dT%H:%M:%S", &tm);
+    drvBufPrintf(b, "  timestamp='%s'\n", ts);
+}
+
+/* append the optional message attribute, escaped and clipped to MAXINDIMESSAGE */
+static void drvBufMessage(DrvBuf *b, const char *fmt, va_list ap)
+{
+    char message[MAXINDIMESSAGE];
+
+    vsnprintf(message, MAXINDIMESSAGE, fmt, ap);
+    drvBufPuts(b, "  message='");
+    drvBufEscape(b, message);
+    drvBufPuts(b, "'\n");
+}
+
+/* write n bytes at p to stdout. N.B. caller must hold stdout_mutex */
+static void stdoutWrite(const char *p, size_t left)
+{
+    while (left > 0)
+    {
+        ssize_t nw = write(fileno(stdout), p, left);
+        if (nw < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        p += nw;
+        left -= nw;
+    }
+}
+
+/* Raw BLOB payloads are written with stdout_mutex released, so other threads
+ * are not held up for as long as the pipe takes to drain them. Meanwhile
+ * stdout_raw is set and messages of other threads wait in stdout_held until
+ * the payloads are out.
+ */
+static int stdout_raw;
+static DrvBuf stdout_held;
+static pthread_cond_t stdout_raw_done = PTHREAD_COND_INITIALIZER;
+
+/* write the composed message to stdout, or hold it while raw BLOB payloads
+ * are being written. N.B. caller must hold stdout_mutex
+ */
+static void drvBufWrite(DrvBuf *b)
+{
+    if (b->err)
+    {
+        fprintf(stderr, "Out of memory composing INDI message, dropped.\n");
+        return;
+    }
+
+    if (stdout_raw)
+    {
+        drvBufAdd(&stdout_held, b->data, b->len);
+        if (stdout_held.err)
+        {
+            fprintf(stderr, "Out of memory holding INDI message, dropped.\n");
+            stdout_held.err = 0;
+        }
+        return;
+    }
+
+    /* anything still buffered by stdio must go out first */
+    fflush(stdout);
+
+    stdoutWrite(b->data, b->len);
+}
+
+/* give back a large buffer after an unusually big message, e.g. a BLOB */
+static void drvBufRelease(DrvBuf *b)
+{
+    if (b == &drvbuf_nomem)
+        return;
+    if (b->cap > DRVBUF_KEEP)
+    {
+        free(b->data);
+        b->data = NULL;
+        b->cap  = 0;
+    }
+    b->len = 0;
+    b->err = 0;
+}
+
+static void drvBufSend(DrvBuf *b)
+{
+    pthread_mutex_lock(&stdout_mutex);
+    drvBufWrite(b);
+    pthread_mutex_unlock(&stdout_mutex);
+    drvBufRelease(b);
+}
+
+/* Add a newly defined property to the cache used to sanity check client updates.
+ * N.B. caller must hold stdout_mutex
+ */
+static void cacheProperty(const char *dev, const char *name, IPerm perm, const void *ptr, int type)
+{
+    ROSC *SC;
+
+    if (isPropDefined(name, dev) >= 0)
+        return;
+
+    propCache = propCache ? (ROSC *)realloc(propCache, sizeof(ROSC) * (nPropCache + 1)) : (ROSC *)malloc(sizeof(ROSC));
+    SC = &propCache[nPropCache++];
+
+    strcpy(SC->propName, name);
+    strcpy(SC->devName, dev);
+    SC->perm = perm;
+    SC->ptr  = ptr;
+    SC->type = type;
+}
+
 /* tell Client to delete the property with given name on given device, or
  * entire device if !name
  */
 void IDDelete(const char *dev, const char *name, const char *fmt, ...)
 {
-    pthread_mutex_lock(&stdout_mutex);
+    DrvBuf *b = drvBufGet();
 
-    xmlv1();
-    printf("<delProperty\n  device='%s'\n", dev);
+    drvBufPrintf(b, "<?xml version='1.0'?>\n<delProperty\n  device='%s'\n", dev);
     if (name)
-        printf(" name='%s'\n", name);
-    printf("  timestamp='%s'\n", timestamp());
+        drvBufPrintf(b, " name='%s'\n", name);
+    drvBufTimestamp(b);
     if (fmt)
     {
         va_list ap;
         va_start(ap, fmt);
-        char message[MAXINDIMESSAGE];
-        printf("  message='");
-        vsnprintf(message, MAXINDIMESSAGE, fmt, ap);
-        printf("%s'\n", entityXML(message));
+        drvBufMessage(b, fmt, ap);
         va_end(ap);
     }
-    printf("/>\n");
-    fflush(stdout);
-
-    pthread_mutex_unlock(&stdout_mutex);
+    drvBufPuts(b, "/>\n");
+    drvBufSend(b);
 }
 
 /* tell indiserver we want to snoop on the given device/property.
@@ -139,14 +612,15 @@ void IDDelete(const char *dev, const char *name, const char *fmt, ...)
  */
 void IDSnoopDevice(const char *snooped_device, const char *snooped_property)
 {
-    pthread_mutex_lock(&stdout_mutex);
-    xmlv1();
+    DrvBuf *b = drvBufGet();
+
+    drvBufPuts(b, "<?xml version='1.0'?>\n<getProperties version='");
+    drvBufNumber(b, INDIV, 6);
     if (snooped_property && snooped_property[0])
-        printf("<getProperties version='%g' device='%s' name='%s'/>\n", INDIV, snooped_device, snooped_property);
+        drvBufPrintf(b, "' device='%s' name='%s'/>\n", snooped_device, snooped_property);
     else
-        printf("<getProperties version='%g' device='%s'/>\n", INDIV, snooped_device);
-    fflush(stdout);
-    pthread_mutex_unlock(&stdout_mutex);
+        drvBufPrintf(b, "' device='%s'/>\n", snooped_device);
+    drvBufSend(b);
 }
 
 /* tell indiserver whether we want BLOBs from the given snooped device.
@@ -155,6 +629,7 @@ void IDSnoopDevice(const char *snooped_device, const char *snooped_property)
 void IDSnoopBLOBs(const char *snooped_device, const char *snooped_property, BLOBHandling bh)
 {
     const char *how;
+    DrvBuf *b;
 
     switch (bh)
     {
@@ -171,14 +646,13 @@ void IDSnoopBLOBs(const char *snooped_device, const char *snooped_property, BLOB
             return;
     }
 
-    pthread_mutex_lock(&stdout_mutex);
-    xmlv1();
+    b = drvBufGet();
+    drvBufPuts(b, "<?xml version='1.0'?>\n");
     if (snooped_property && snooped_property[0])
-        printf("<enableBLOB device='%s' name='%s'>%s</enableBLOB>\n", snooped_device, snooped_property, how);
+        drvBufPrintf(b, "<enableBLOB device='%s' name='%s'>%s</enableBLOB>\n", snooped_device, snooped_property, how);
     else
-        printf("<enableBLOB device='%s'>%s</enableBLOB>\n", snooped_device, how);
-    fflush(stdout);
-    pthread_mutex_unlock(&stdout_mutex);
+        drvBufPrintf(b, "<enableBLOB device='%s'>%s</enableBLOB>\n", snooped_device, how);
+    drvBufSend(b);
 }
 
 /* "INDI" wrappers to the more generic eventloop facility. */
@@ -857,8 +1331,9 @@ int IUSnoopBLOB(XMLEle *root, IBLOBVectorProperty *bvp)
 void clientMsgCB(int fd, void *arg)
 {
     (void)arg;
-    char buf[MAXRBUF], msg[MAXRBUF], *bp;
-    int nr;
+    char buf[MAXRBUF], msg[MAXRBUF];
+    XMLEle **nodes;
+    int nr, i;
 
     /* one read */
     nr = read(fd, buf, sizeof(buf));
@@ -874,18 +1349,17 @@ void clientMsgCB(int fd, void *arg)
     }
 
     /* crack and dispatch when complete */
-    for (bp = buf; nr-- > 0; bp++)
+    nodes = parseXMLChunk(clixml, buf, nr, msg);
+    if (msg[0])
+        fprintf(stderr, "%s XML error: %s\n", me, msg);
+
+    for (i = 0; nodes[i]; i++)
     {
-        XMLEle *root = readXMLEle(clixml, *bp, msg);
-        if (root)
-        {
-            if (dispatch(root, msg) < 0)
-                fprintf(stderr, "%s dispatch error: %s\n", me, msg);
-            delXMLEle(root);
-        }
-        else if (msg[0])
-            fprintf(stderr, "%s XML error: %s\n", me, msg);
+        if (dispatch(nodes[i], msg) < 0)
+            fprintf(stderr, "%s dispatch error: %s\n", me, msg);
+        delXMLEle(nodes[i]);
     }
+    free(nodes);
 }
 
 /* crack the given INDI XML element and call driver's IS* entry points as they
@@ -1499,29 +1973,21 @@ int IUGetConfigText(const char *dev, const char *property, const char *member, c
 /* send client a message for a specific device or at large if !dev */
 void IDMessage(const char *dev, const char *fmt, ...)
 {
-    pthread_mutex_lock(&stdout_mutex);
+    DrvBuf *b = drvBufGet();
 
-    xmlv1();
-    printf("<message\n");
+    drvBufPuts(b, "<?xml version='1.0'?>\n<message\n");
     if (dev)
-        printf(" device='%s'\n", dev);
-    printf("  timestamp='%s'\n", timestamp());
+        drvBufPrintf(b, " device='%s'\n", dev);
+    drvBufTimestamp(b);
     if (fmt)
     {
         va_list ap;
         va_start(ap, fmt);
-        char message[MAXINDIMESSAGE];
-        printf("  message='");
-        vsnprintf(message, MAXINDIMESSAGE, fmt, ap);
-        char *escapedMessage = escapeXML(message, MAXINDIMESSAGE);
-        printf("%s'\n", escapedMessage);
-        free(escapedMessage);
+        drvBufMessage(b, fmt, ap);
         va_end(ap);
     }
-    printf("/>\n");
-    fflush(stdout);
-
-    pthread_mutex_unlock(&stdout_mutex);
+    drvBufPuts(b, "/>\n");
+    drvBufSend(b);
 }
 
 int IUPurgeConfig(const char *filename, const char *dev, char errmsg[])
@@ -1713,137 +2179,96 @@ void IUSaveConfigBLOB(FILE *fp, const IBLOBVectorProperty *bvp)
 void IDDefText(const ITextVectorProperty *tvp, const char *fmt, ...)
 {
     int i;
-    ROSC *SC;
-
-    pthread_mutex_lock(&stdout_mutex);
-
-    xmlv1();
-    locale_char_t *orig = indi_locale_C_numeric_push();
-    printf("<defTextVector\n");
-    printf("  device='%s'\n", tvp->device);
-    printf("  name='%s'\n", tvp->name);
-    printf("  label='%s'\n", tvp->label);
-    printf("  group='%s'\n", tvp->group);
-    printf("  state='%s'\n", pstateStr(tvp->s));
-    printf("  perm='%s'\n", permStr(tvp->p));
-    printf("  timeout='%g'\n", tvp->timeout);
-    printf("  timestamp='%s'\n", timestamp());
+    DrvBuf *b = drvBufGet();
+
+    drvBufPuts(b, "<?xml version='1.0'?>\n<defTextVector\n");
+    drvBufPrintf(b, "  device='%s'\n", tvp->device);
+    drvBufPrintf(b, "  name='%s'\n", tvp->name);
+    drvBufPrintf(b, "  label='%s'\n", tvp->label);
+    drvBufPrintf(b, "  group='%s'\n", tvp->group);
+    drvBufPrintf(b, "  state='%s'\n", pstateStr(tvp->s));
+    drvBufPrintf(b, "  perm='%s'\n", permStr(tvp->p));
+    drvBufPuts(b, "  timeout='");
+    drvBufNumber(b, tvp->timeout, 6);
+    drvBufPuts(b, "'\n");
+    drvBufTimestamp(b);
     if (fmt)
     {
         va_list ap;
         va_start(ap, fmt);
-        char message[MAXINDIMESSAGE];
-        printf("  message='");
-        vsnprintf(message, MAXINDIMESSAGE, fmt, ap);
-        char *escapedMessage = escapeXML(message, MAXINDIMESSAGE);
-        printf("%s'\n", escapedMessage);
-        free(escapedMessage);
+        drvBufMessage(b, fmt, ap);
         va_end(ap);
     }
-    printf(">\n");
+    drvBufPuts(b, ">\n");
 
     for (i = 0; i < tvp->ntp; i++)
     {
         IText *tp = &tvp->tp[i];
-        printf("  <defText\n");
-        printf("    name='%s'\n", tp->name);
-        printf("    label='%s'>\n", tp->label);
-        printf("      %s\n", tp->text ? tp->text : "");
-        printf("  </defText>\n");
+        drvBufPrintf(b, "  <defText\n    name='%s'\n    label='%s'>\n", tp->name, tp->label);
+        drvBufPrintf(b, "      %s\n", tp->text ? tp->text : "");
+        drvBufPuts(b, "  </defText>\n");
     }
 
-    printf("</defTextVector>\n");
-
-    if (isPropDefined(tvp->name, tvp->device) < 0)
-    {
-        /* Add this property to insure proper sanity check */
-        propCache =
-            propCache ? (ROSC *)realloc(propCache, sizeof(ROSC) * (nPropCache + 1)) : (ROSC *)malloc(sizeof(ROSC));
-        SC = &propCache[nPropCache++];
-
-        strcpy(SC->propName, tvp->name);
-        strcpy(SC->devName, tvp->device);
-        SC->perm = tvp->p;
-        SC->ptr  = tvp;
-        SC->type = INDI_TEXT;
-    }
-
-    indi_locale_C_numeric_pop(orig);
-    fflush(stdout);
+    drvBufPuts(b, "</defTextVector>\n");
 
+    pthread_mutex_lock(&stdout_mutex);
+    cacheProperty(tvp->device, tvp->name, tvp->p, tvp, INDI_TEXT);
+    drvBufWrite(b);
     pthread_mutex_unlock(&stdout_mutex);
+    drvBufRelease(b);
 }
 
 /* tell client to create a new numeric vector property */
 void IDDefNumber(const INumberVectorProperty *n, const char *fmt, ...)
 {
     int i;
-    ROSC *SC;
-
-    pthread_mutex_lock(&stdout_mutex);
-
-    xmlv1();
-    locale_char_t *orig = indi_locale_C_numeric_push();
-    printf("<defNumberVector\n");
-    printf("  device='%s'\n", n->device);
-    printf("  name='%s'\n", n->name);
-    printf("  label='%s'\n", n->label);
-    printf("  group='%s'\n", n->group);
-    printf("  state='%s'\n", pstateStr(n->s));
-    printf("  perm='%s'\n", permStr(n->p));
-    printf("  timeout='%g'\n", n->timeout);
-    printf("  timestamp='%s'\n", timestamp());
+    DrvBuf *b = drvBufGet();
+
+    drvBufPuts(b, "<?xml version='1.0'?>\n<defNumberVector\n");
+    drvBufPrintf(b, "  device='%s'\n", n->device);
+    drvBufPrintf(b, "  name='%s'\n", n->name);
+    drvBufPrintf(b, "  label='%s'\n", n->label);
+    drvBufPrintf(b, "  group='%s'\n", n->group);
+    drvBufPrintf(b, "  state='%s'\n", pstateStr(n->s));
+    drvBufPrintf(b, "  perm='%s'\n", permStr(n->p));
+    drvBufPuts(b, "  timeout='");
+    drvBufNumber(b, n->timeout, 6);
+    drvBufPuts(b, "'\n");
+    drvBufTimestamp(b);
 
     if (fmt)
     {
         va_list ap;
         va_start(ap, fmt);
-        char message[MAXINDIMESSAGE];
-        printf("  message='");
-        vsnprintf(message, MAXINDIMESSAGE, fmt, ap);
-        char *escapedMessage = escapeXML(message, MAXINDIMESSAGE);
-        printf("%s'\n", escapedMessage);
-        free(escapedMessage);
+        drvBufMessage(b, fmt, ap);
         va_end(ap);
     }
-    printf(">\n");
+    drvBufPuts(b, ">\n");
 
     for (i = 0; i < n->nnp; i++)
     {
         INumber *np = &n->np[i];
 
-        printf("  <defNumber\n");
-        printf("    name='%s'\n", np->name);
-        printf("    label='%s'\n", np->label);
-        printf("    format='%s'\n", np->format);
-        printf("    min='%.20g'\n", np->min);
-        printf("    max='%.20g'\n", np->max);
-        printf("    step='%.20g'>\n", np->step);
-        printf("      %.20g\n", np->value);
-
-        printf("  </defNumber>\n");
+        drvBufPrintf(b, "  <defNumber\n    name='%s'\n    label='%s'\n    format='%s'\n", np->name, np->label,
+                     np->format);
+        drvBufPuts(b, "    min='");
+        drvBufNumber(b, np->min, 20);
+        drvBufPuts(b, "'\n    max='");
+        drvBufNumber(b, np->max, 20);
+        drvBufPuts(b, "'\n    step='");
+        drvBufNumber(b, np->step, 20);
+        drvBufPuts(b, "'>\n      ");
+        drvBufNumber(b, np->value, 20);
+        drvBufPuts(b, "\n  </defNumber>\n");
     }
 
-    printf("</defNumberVector>\n");
-
-    if (isPropDefined(n->name, n->device) < 0)
-    {
-        /* Add this property to insure proper sanity check */
-        propCache =
-            propCache ? (ROSC *)realloc(propCache, sizeof(ROSC) * (nPropCache + 1)) : (ROSC *)malloc(sizeof(ROSC));
-        SC = &propCache[nPropCache++];
-
-        strcpy(SC->propName, n->name);
-        strcpy(SC->devName, n->device);
-        SC->perm = n->p;
-        SC->ptr  = n;
-        SC->type = INDI_NUMBER;
-    }
-
-    indi_locale_C_numeric_pop(orig);
-    fflush(stdout);
+    drvBufPuts(b, "</defNumberVector>\n");
 
+    pthread_mutex_lock(&stdout_mutex);
+    cacheProperty(n->device, n->name, n->p, n, INDI_NUMBER);
+    drvBufWrite(b);
     pthread_mutex_unlock(&stdout_mutex);
+    drvBufRelease(b);
 }
 
 /* tell client to create a new switch vector property */
@@ -1851,451 +2276,417 @@ void IDDefSwitch(const ISwitchVectorProperty *s, const char *fmt, ...)
 
 {
     int i;
-    ROSC *SC;
-
-    pthread_mutex_lock(&stdout_mutex);
-
-    xmlv1();
-    locale_char_t *orig = indi_locale_C_numeric_push();
-    printf("<defSwitchVector\n");
-    printf("  device='%s'\n", s->device);
-    printf("  name='%s'\n", s->name);
-    printf("  label='%s'\n", s->label);
-    printf("  group='%s'\n", s->group);
-    printf("  state='%s'\n", pstateStr(s->s));
-    printf("  perm='%s'\n", permStr(s->p));
-    printf("  rule='%s'\n", ruleStr(s->r));
-    printf("  timeout='%g'\n", s->timeout);
-    printf("  timestamp='%s'\n", timestamp());
+    DrvBuf *b = drvBufGet();
+
+    drvBufPuts(b, "<?xml version='1.0'?>\n<defSwitchVector\n");
+    drvBufPrintf(b, "  device='%s'\n", s->device);
+    drvBufPrintf(b, "  name='%s'\n", s->name);
+    drvBufPrintf(b, "  label='%s'\n", s->label);
+    drvBufPrintf(b, "  group='%s'\n", s->group);
+    drvBufPrintf(b, "  state='%s'\n", pstateStr(s->s));
+    drvBufPrintf(b, "  perm='%s'\n", permStr(s->p));
+    drvBufPrintf(b, "  rule='%s'\n", ruleStr(s->r));
+    drvBufPuts(b, "  timeout='");
+    drvBufNumber(b, s->timeout, 6);
+    drvBufPuts(b, "'\n");
+    drvBufTimestamp(b);
     if (fmt)
     {
         va_list ap;
         va_start(ap, fmt);
-        char message[MAXINDIMESSAGE];
-        printf("  message='");
-        vsnprintf(message, MAXINDIMESSAGE, fmt, ap);
-        char *escapedMessage = escapeXML(message, MAXINDIMESSAGE);
-        printf("%s'\n", escapedMessage);
-        free(escapedMessage);
+        drvBufMessage(b, fmt, ap);
         va_end(ap);
     }
-    printf(">\n");
+    drvBufPuts(b, ">\n");
 
     for (i = 0; i < s->nsp; i++)
     {
         ISwitch *sp = &s->sp[i];
-        printf("  <defSwitch\n");
-        printf("    name='%s'\n", sp->name);
-        printf("    label='%s'>\n", sp->label);
-        printf("      %s\n", sstateStr(sp->s));
-        printf("  </defSwitch>\n");
+        drvBufPrintf(b, "  <defSwitch\n    name='%s'\n    label='%s'>\n", sp->name, sp->label);
+        drvBufPrintf(b, "      %s\n", sstateStr(sp->s));
+        drvBufPuts(b, "  </defSwitch>\n");
     }
 
-    printf("</defSwitchVector>\n");
-
-    if (isPropDefined(s->name, s->device) < 0)
-    {
-        /* Add this property to insure proper sanity check */
-        propCache =
-            propCache ? (ROSC *)realloc(propCache, sizeof(ROSC) * (nPropCache + 1)) : (ROSC *)malloc(sizeof(ROSC));
-        SC = &propCache[nPropCache++];
-
-        strcpy(SC->propName, s->name);
-        strcpy(SC->devName, s->device);
-        SC->perm = s->p;
-        SC->ptr  = s;
-        SC->type = INDI_SWITCH;
-    }
-
-    indi_locale_C_numeric_pop(orig);
-    fflush(stdout);
+    drvBufPuts(b, "</defSwitchVector>\n");
 
+    pthread_mutex_lock(&stdout_mutex);
+    cacheProperty(s->device, s->name, s->p, s, INDI_SWITCH);
+    drvBufWrite(b);
     pthread_mutex_unlock(&stdout_mutex);
+    drvBufRelease(b);
 }
 
 /* tell client to create a new lights vector property */
 void IDDefLight(const ILightVectorProperty *lvp, const char *fmt, ...)
 {
     int i;
-
-    pthread_mutex_lock(&stdout_mutex);
-
-    xmlv1();
-    printf("<defLightVector\n");
-    printf("  device='%s'\n", lvp->device);
-    printf("  name='%s'\n", lvp->name);
-    printf("  label='%s'\n", lvp->label);
-    printf("  group='%s'\n", lvp->group);
-    printf("  state='%s'\n", pstateStr(lvp->s));
-    printf("  timestamp='%s'\n", timestamp());
+    DrvBuf *b = drvBufGet();
+
+    drvBufPuts(b, "<?xml version='1.0'?>\n<defLightVector\n");
+    drvBufPrintf(b, "  device='%s'\n", lvp->device);
+    drvBufPrintf(b, "  name='%s'\n", lvp->name);
+    drvBufPrintf(b, "  label='%s'\n", lvp->label);
+    drvBufPrintf(b, "  group='%s'\n", lvp->group);
+    drvBufPrintf(b, "  state='%s'\n", pstateStr(lvp->s));
+    drvBufTimestamp(b);
     if (fmt)
     {
         va_list ap;
         va_start(ap, fmt);
-        char message[MAXINDIMESSAGE];
-        printf("  message='");
-        vsnprintf(message, MAXINDIMESSAGE, fmt, ap);
-        char *escapedMessage = escapeXML(message, MAXINDIMESSAGE);
-        printf("%s'\n", escapedMessage);
-        free(escapedMessage);
+        drvBufMessage(b, fmt, ap);
         va_end(ap);
     }
-    printf(">\n");
+    drvBufPuts(b, ">\n");
 
     for (i = 0; i < lvp->nlp; i++)
     {
         ILight *lp = &lvp->lp[i];
-        printf("  <defLight\n");
-        printf("    name='%s'\n", lp->name);
-        printf("    label='%s'>\n", lp->label);
-        printf("      %s\n", pstateStr(lp->s));
-        printf("  </defLight>\n");
+        drvBufPrintf(b, "  <defLight\n    name='%s'\n    label='%s'>\n", lp->name, lp->label);
+        drvBufPrintf(b, "      %s\n", pstateStr(lp->s));
+        drvBufPuts(b, "  </defLight>\n");
     }
 
-    printf("</defLightVector>\n");
-    fflush(stdout);
-
-    pthread_mutex_unlock(&stdout_mutex);
+    drvBufPuts(b, "</defLightVector>\n");
+    drvBufSend(b);
 }
 
 /* tell client to create a new BLOB vector property */
 void IDDefBLOB(const IBLOBVectorProperty *b, const char *fmt, ...)
 {
     int i;
-    ROSC *SC;
-
-    pthread_mutex_lock(&stdout_mutex);
-
-    xmlv1();
-    locale_char_t *orig = indi_locale_C_numeric_push();
-    printf("<defBLOBVector\n");
-    printf("  device='%s'\n", b->device);
-    printf("  name='%s'\n", b->name);
-    printf("  label='%s'\n", b->label);
-    printf("  group='%s'\n", b->group);
-    printf("  state='%s'\n", pstateStr(b->s));
-    printf("  perm='%s'\n", permStr(b->p));
-    printf("  timeout='%g'\n", b->timeout);
-    printf("  timestamp='%s'\n", timestamp());
+    DrvBuf *db = drvBufGet();
+
+    drvBufPuts(db, "<?xml version='1.0'?>\n<defBLOBVector\n");
+    drvBufPrintf(db, "  device='%s'\n", b->device);
+    drvBufPrintf(db, "  name='%s'\n", b->name);
+    drvBufPrintf(db, "  label='%s'\n", b->label);
+    drvBufPrintf(db, "  group='%s'\n", b->group);
+    drvBufPrintf(db, "  state='%s'\n", pstateStr(b->s));
+    drvBufPrintf(db, "  perm='%s'\n", permStr(b->p));
+    drvBufPuts(db, "  timeout='");
+    drvBufNumber(db, b->timeout, 6);
+    drvBufPuts(db, "'\n");
+    drvBufTimestamp(db);
     if (fmt)
     {
         va_list ap;
         va_start(ap, fmt);
-        char message[MAXINDIMESSAGE];
-        printf("  message='");
-        vsnprintf(message, MAXINDIMESSAGE, fmt, ap);
-        char *escapedMessage = escapeXML(message, MAXINDIMESSAGE);
-        printf("%s'\n", escapedMessage);
-        free(escapedMessage);
+        drvBufMessage(db, fmt, ap);
         va_end(ap);
     }
-    printf(">\n");
+    drvBufPuts(db, ">\n");
 
     for (i = 0; i < b->nbp; i++)
     {
         IBLOB *bp = &b->bp[i];
-        printf("  <defBLOB\n");
-        printf("    name='%s'\n", bp->name);
-        printf("    label='%s'\n", bp->label);
-        printf("  />\n");
-    }
-
-    printf("</defBLOBVector>\n");
-
-    if (isPropDefined(b->name, b->device) < 0)
-    {
-        /* Add this property to insure proper sanity check */
-        propCache =
-            propCache ? (ROSC *)realloc(propCache, sizeof(ROSC) * (nPropCache + 1)) : (ROSC *)malloc(sizeof(ROSC));
-        SC = &propCache[nPropCache++];
-
-        strcpy(SC->propName, b->name);
-        strcpy(SC->devName, b->device);
-        SC->perm = b->p;
-        SC->ptr  = b;
-        SC->type = INDI_BLOB;
+        drvBufPrintf(db, "  <defBLOB\n    name='%s'\n    label='%s'\n  />\n", bp->name, bp->label);
     }
 
-    indi_locale_C_numeric_pop(orig);
-    fflush(stdout);
+    drvBufPuts(db, "</defBLOBVector>\n");
 
+    pthread_mutex_lock(&stdout_mutex);
+    cacheProperty(b->device, b->name, b->p, b, INDI_BLOB);
+    drvBufWrite(db);
     pthread_mutex_unlock(&stdout_mutex);
+    drvBufRelease(db);
 }
 
 /* tell client to update an existing text vector property */
 void IDSetText(const ITextVectorProperty *tvp, const char *fmt, ...)
 {
     int i;
-
-    pthread_mutex_lock(&stdout_mutex);
-
-    xmlv1();
-    locale_char_t *orig = indi_locale_C_numeric_push();
-    printf("<setTextVector\n");
-    printf("  device='%s'\n", tvp->device);
-    printf("  name='%s'\n", tvp->name);
-    printf("  state='%s'\n", pstateStr(tvp->s));
-    printf("  timeout='%g'\n", tvp->timeout);
-    printf("  timestamp='%s'\n", timestamp());
+    DrvBuf *b = drvBufGet();
+
+    drvBufPuts(b, "<?xml version='1.0'?>\n<setTextVector\n");
+    drvBufPrintf(b, "  device='%s'\n", tvp->device);
+    drvBufPrintf(b, "  name='%s'\n", tvp->name);
+    drvBufPrintf(b, "  state='%s'\n", pstateStr(tvp->s));
+    drvBufPuts(b, "  timeout='");
+    drvBufNumber(b, tvp->timeout, 6);
+    drvBufPuts(b, "'\n");
+    drvBufTimestamp(b);
     if (fmt)
     {
         va_list ap;
         va_start(ap, fmt);
-        char message[MAXINDIMESSAGE];
-        printf("  message='");
-        vsnprintf(message, MAXINDIMESSAGE, fmt, ap);
-        printf("%s'\n", entityXML(message));
+        drvBufMessage(b, fmt, ap);
         va_end(ap);
     }
-    printf(">\n");
+    drvBufPuts(b, ">\n");
 
     for (i = 0; i < tvp->ntp; i++)
     {
         IText *tp = &tvp->tp[i];
-        printf("  <oneText name='%s'>\n", tp->name);
-        printf("      %s\n", tp->text ? entityXML(tp->text) : "");
-        printf("  </oneText>\n");
+        drvBufPrintf(b, "  <oneText name='%s'>\n      ", tp->name);
+        if (tp->text)
+            drvBufEscape(b, tp->text);
+        drvBufPuts(b, "\n  </oneText>\n");
     }
 
-    printf("</setTextVector>\n");
-    indi_locale_C_numeric_pop(orig);
-    fflush(stdout);
-
-    pthread_mutex_unlock(&stdout_mutex);
+    drvBufPuts(b, "</setTextVector>\n");
+    drvBufSend(b);
 }
 
 /* tell client to update an existing numeric vector property */
 void IDSetNumber(const INumberVectorProperty *nvp, const char *fmt, ...)
 {
     int i;
-
-    pthread_mutex_lock(&stdout_mutex);
-
-    xmlv1();
-    locale_char_t *orig = indi_locale_C_numeric_push();
-    printf("<setNumberVector\n");
-    printf("  device='%s'\n", nvp->device);
-    printf("  name='%s'\n", nvp->name);
-    printf("  state='%s'\n", pstateStr(nvp->s));
-    printf("  timeout='%g'\n", nvp->timeout);
-    printf("  timestamp='%s'\n", timestamp());
+    DrvBuf *b = drvBufGet();
+
+    drvBufPuts(b, "<?xml version='1.0'?>\n<setNumberVector\n");
+    drvBufPrintf(b, "  device='%s'\n", nvp->device);
+    drvBufPrintf(b, "  name='%s'\n", nvp->name);
+    drvBufPrintf(b, "  state='%s'\n", pstateStr(nvp->s));
+    drvBufPuts(b, "  timeout='");
+    drvBufNumber(b, nvp->timeout, 6);
+    drvBufPuts(b, "'\n");
+    drvBufTimestamp(b);
     if (fmt)
     {
         va_list ap;
         va_start(ap, fmt);
-        char message[MAXINDIMESSAGE];
-        printf("  message='");
-        vsnprintf(message, MAXINDIMESSAGE, fmt, ap);
-        printf("%s'\n", entityXML(message));
+        drvBufMessage(b, fmt, ap);
         va_end(ap);
     }
-    printf(">\n");
+    drvBufPuts(b, ">\n");
 
     for (i = 0; i < nvp->nnp; i++)
     {
         INumber *np = &nvp->np[i];
-        printf("  <oneNumber name='%s'>\n", np->name);
-        printf("      %.20g\n", np->value);
-        printf("  </oneNumber>\n");
+        drvBufPrintf(b, "  <oneNumber name='%s'>\n      ", np->name);
+        drvBufNumber(b, np->value, 20);
+        drvBufPuts(b, "\n  </oneNumber>\n");
     }
 
-    printf("</setNumberVector>\n");
-    indi_locale_C_numeric_pop(orig);
-    fflush(stdout);
-
-    pthread_mutex_unlock(&stdout_mutex);
+    drvBufPuts(b, "</setNumberVector>\n");
+    drvBufSend(b);
 }
 
 /* tell client to update an existing switch vector property */
 void IDSetSwitch(const ISwitchVectorProperty *svp, const char *fmt, ...)
 {
     int i;
-
-    pthread_mutex_lock(&stdout_mutex);
-
-    xmlv1();
-    locale_char_t *orig = indi_locale_C_numeric_push();
-    printf("<setSwitchVector\n");
-    printf("  device='%s'\n", svp->device);
-    printf("  name='%s'\n", svp->name);
-    printf("  state='%s'\n", pstateStr(svp->s));
-    printf("  timeout='%g'\n", svp->timeout);
-    printf("  timestamp='%s'\n", timestamp());
+    DrvBuf *b = drvBufGet();
+
+    drvBufPuts(b, "<?xml version='1.0'?>\n<setSwitchVector\n");
+    drvBufPrintf(b, "  device='%s'\n", svp->device);
+    drvBufPrintf(b, "  name='%s'\n", svp->name);
+    drvBufPrintf(b, "  state='%s'\n", pstateStr(svp->s));
+    drvBufPuts(b, "  timeout='");
+    drvBufNumber(b, svp->timeout, 6);
+    drvBufPuts(b, "'\n");
+    drvBufTimestamp(b);
     if (fmt)
     {
         va_list ap;
         va_start(ap, fmt);
-        char message[MAXINDIMESSAGE];
-        printf("  message='");
-        vsnprintf(message, MAXINDIMESSAGE, fmt, ap);
-        printf("%s'\n", entityXML(message));
+        drvBufMessage(b, fmt, ap);
         va_end(ap);
     }
-    printf(">\n");
+    drvBufPuts(b, ">\n");
 
     for (i = 0; i < svp->nsp; i++)
     {
         ISwitch *sp = &svp->sp[i];
-        printf("  <oneSwitch name='%s'>\n", sp->name);
-        printf("      %s\n", sstateStr(sp->s));
-        printf("  </oneSwitch>\n");
+        drvBufPrintf(b, "  <oneSwitch name='%s'>\n      %s\n  </oneSwitch>\n", sp->name, sstateStr(sp->s));
     }
 
-    printf("</setSwitchVector>\n");
-    indi_locale_C_numeric_pop(orig);
-    fflush(stdout);
-
-    pthread_mutex_unlock(&stdout_mutex);
+    drvBufPuts(b, "</setSwitchVector>\n");
+    drvBufSend(b);
 }
 
 /* tell client to update an existing lights vector property */
 void IDSetLight(const ILightVectorProperty *lvp, const char *fmt, ...)
 {
     int i;
+    DrvBuf *b = drvBufGet();
 
-    pthread_mutex_lock(&stdout_mutex);
-
-    xmlv1();
-    printf("<setLightVector\n");
-    printf("  device='%s'\n", lvp->device);
-    printf("  name='%s'\n", lvp->name);
-    printf("  state='%s'\n", pstateStr(lvp->s));
-    printf("  timestamp='%s'\n", timestamp());
+    drvBufPuts(b, "<?xml version='1.0'?>\n<setLightVector\n");
+    drvBufPrintf(b, "  device='%s'\n", lvp->device);
+    drvBufPrintf(b, "  name='%s'\n", lvp->name);
+    drvBufPrintf(b, "  state='%s'\n", pstateStr(lvp->s));
+    drvBufTimestamp(b);
     if (fmt)
     {
         va_list ap;
         va_start(ap, fmt);
-        char message[MAXINDIMESSAGE];
-        printf("  message='");
-        vsnprintf(message, MAXINDIMESSAGE, fmt, ap);
-        printf("%s'\n", entityXML(message));
+        drvBufMessage(b, fmt, ap);
         va_end(ap);
     }
-    printf(">\n");
+    drvBufPuts(b, ">\n");
 
     for (i = 0; i < lvp->nlp; i++)
     {
         ILight *lp = &lvp->lp[i];
-        printf("  <oneLight name='%s'>\n", lp->name);
-        printf("      %s\n", pstateStr(lp->s));
-        printf("  </oneLight>\n");
+        drvBufPrintf(b, "  <oneLight name='%s'>\n      %s\n  </oneLight>\n", lp->name, pstateStr(lp->s));
     }
 
-    printf("</setLightVector>\n");
-    fflush(stdout);
+    drvBufPuts(b, "</setLightVector>\n");
+    drvBufSend(b);
+}
 
-    pthread_mutex_unlock(&stdout_mutex);
+/* BLOBs go out raw if indiserver offers to take them so */
+static int rawBLOBs;
+static pthread_once_t rawblobs_once = PTHREAD_ONCE_INIT;
+
+static void rawBLOBsInit(void)
+{
+    const char *blobs = getenv("INDIBLOBS");
+
+    rawBLOBs = blobs && !strcmp(blobs, "raw");
+
+    /* the offer is for this driver only, not for processes it starts */
+    unsetenv("INDIBLOBS");
+}
+
+void initRawBLOBs(void)
+{
+    pthread_once(&rawblobs_once, rawBLOBsInit);
 }
 
 /* tell client to update an existing BLOB vector property */
 void IDSetBLOB(const IBLOBVectorProperty *bvp, const char *fmt, ...)
 {
     int i;
-
-    pthread_mutex_lock(&stdout_mutex);
-
-    xmlv1();
-    locale_char_t *orig = indi_locale_C_numeric_push();
-    printf("<setBLOBVector\n");
-    printf("  device='%s'\n", bvp->device);
-    printf("  name='%s'\n", bvp->name);
-    printf("  state='%s'\n", pstateStr(bvp->s));
-    printf("  timeout='%g'\n", bvp->timeout);
-    printf("  timestamp='%s'\n", timestamp());
+    DrvBuf *b = drvBufGet();
+
+    initRawBLOBs();
+
+    drvBufPuts(b, "<?xml version='1.0'?>\n<setBLOBVector\n");
+    drvBufPrintf(b, "  device='%s'\n", bvp->device);
+    drvBufPrintf(b, "  name='%s'\n", bvp->name);
+    drvBufPrintf(b, "  state='%s'\n", pstateStr(bvp->s));
+    drvBufPuts(b, "  timeout='");
+    drvBufNumber(b, bvp->timeout, 6);
+    drvBufPuts(b, "'\n");
+    drvBufTimestamp(b);
     if (fmt)
     {
         va_list ap;
         va_start(ap, fmt);
-        printf("  message='");
-        vprintf(fmt, ap);
-        printf("'\n");
+        drvBufPuts(b, "  message='");
+        drvBufVPrintf(b, fmt, ap);
+        drvBufPuts(b, "'\n");
         va_end(ap);
     }
-    printf(">\n");
+    drvBufPuts(b, ">\n");
 
     for (i = 0; i < bvp->nbp; i++)
     {
         IBLOB *bp = &bvp->bp[i];
-        unsigned char *encblob;
-        int l;
 
-        printf("  <oneBLOB\n");
-        printf("    name='%s'\n", bp->name);
-        printf("    size='%d'\n", bp->size);
+        drvBufPrintf(b, "  <oneBLOB\n    name='%s'\n    size='%d'\n", bp->name, bp->size);
 
         // If size is zero, we are only sending a state-change
         if (bp->size == 0)
         {
-            printf("    enclen='0'\n");
-            printf("    format='%s'>\n", bp->format);
+            drvBufPrintf(b, "    enclen='0'\n    format='%s'>\n", bp->format);
+        }
+        else if (rawBLOBs)
+        {
+            /* the payload follows the message */
+            drvBufPrintf(b, "    enclen='%d'\n    format='%s'\n    encoding='raw'/>\n", bp->bloblen, bp->format);
+            continue;
         }
         else
         {
-            encblob = malloc(4 * bp->bloblen / 3 + 4);
-            l       = to64frombits(encblob, bp->blob, bp->bloblen);
-            printf("    enclen='%d'\n", l);
-            printf("    format='%s'>\n", bp->format);
-            size_t written = 0;
+            /* encode straight into the message, 54 raw bytes make one 72 column line */
+            const unsigned char *src = (const unsigned char *)bp->blob;
+            int left                 = bp->bloblen;
+            int enclen               = 4 * ((bp->bloblen + 2) / 3);
+            char *p;
 
-            while ((int)written < l)
-            {
-                size_t towrite = ((l - written) > 72) ? 72 : l - written;
-                size_t wr      = fwrite(encblob + written, 1, towrite, stdout);
+            drvBufPrintf(b, "    enclen='%d'\n    format='%s'>\n", enclen, bp->format);
 
-                if (wr > 0)
-                    written += wr;
-                if ((written % 72) == 0)
-                    fputc('\n', stdout);
+            p = drvBufReserve(b, enclen + enclen / 72 + 1);
+            if (p != NULL)
+            {
+                while (left > 0)
+                {
+                    int chunk = left > 54 ? 54 : left;
+                    p += to64frombits((unsigned char *)p, src, chunk);
+                    *p++ = '\n';
+                    src += chunk;
+                    left -= chunk;
+                }
+                b->len = p - b->data;
             }
+        }
 
-            if ((written % 72) != 0)
-                fputc('\n', stdout);
+        drvBufPuts(b, "  </oneBLOB>\n");
+    }
 
-            free(encblob);
-        }
+    if (!rawBLOBs)
+    {
+        drvBufPuts(b, "</setBLOBVector>\n");
+        drvBufSend(b);
+        return;
+    }
 
-        printf("  </oneBLOB>\n");
+    /* raw BLOB payloads, in order, right after the closing '>' */
+    drvBufPuts(b, "</setBLOBVector>");
+    pthread_mutex_lock(&stdout_mutex);
+    while (stdout_raw)
+        pthread_cond_wait(&stdout_raw_done, &stdout_mutex);
+    drvBufWrite(b);
+    if (b->err)
+    {
+        pthread_mutex_unlock(&stdout_mutex);
+        drvBufRelease(b);
+        return;
     }
+    stdout_raw = 1;
+    pthread_mutex_unlock(&stdout_mutex);
 
-    printf("</setBLOBVector>\n");
-    indi_locale_C_numeric_pop(orig);
-    fflush(stdout);
+    for (i = 0; i < bvp->nbp; i++)
+    {
+        IBLOB *bp = &bvp->bp[i];
+        if (bp->size != 0)
+            stdoutWrite((const char *)bp->blob, bp->bloblen);
+    }
 
+    /* then what other threads sent meanwhile */
+    pthread_mutex_lock(&stdout_mutex);
+    stdout_raw = 0;
+    stdoutWrite(stdout_held.data, stdout_held.len);
+    drvBufRelease(&stdout_held);
+    pthread_cond_broadcast(&stdout_raw_done);
     pthread_mutex_unlock(&stdout_mutex);
+    drvBufRelease(b);
 }
 
 /* tell client to update min/max elements of an existing number vector property */
 void IUUpdateMinMax(const INumberVectorProperty *nvp)
 {
     int i;
-
-    pthread_mutex_lock(&stdout_mutex);
-    xmlv1();
-    locale_char_t *orig = indi_locale_C_numeric_push();
-    printf("<setNumberVector\n");
-    printf("  device='%s'\n", nvp->device);
-    printf("  name='%s'\n", nvp->name);
-    printf("  state='%s'\n", pstateStr(nvp->s));
-    printf("  timeout='%g'\n", nvp->timeout);
-    printf("  timestamp='%s'\n", timestamp());
-    printf(">\n");
+    DrvBuf *b = drvBufGet();
+
+    drvBufPuts(b, "<?xml version='1.0'?>\n<setNumberVector\n");
+    drvBufPrintf(b, "  device='%s'\n", nvp->device);
+    drvBufPrintf(b, "  name='%s'\n", nvp->name);
+    drvBufPrintf(b, "  state='%s'\n", pstateStr(nvp->s));
+    drvBufPuts(b, "  timeout='");
+    drvBufNumber(b, nvp->timeout, 6);
+    drvBufPuts(b, "'\n");
+    drvBufTimestamp(b);
+    drvBufPuts(b, ">\n");
 
     for (i = 0; i < nvp->nnp; i++)
     {
         INumber *np = &nvp->np[i];
-        printf("  <oneNumber name='%s'\n", np->name);
-        printf("    min='%g'\n", np->min);
-        printf("    max='%g'\n", np->max);
-        printf("    step='%g'\n", np->step);
-        printf(">\n");
-        printf("      %g\n", np->value);
-        printf("  </oneNumber>\n");
-    }
-
-    printf("</setNumberVector>\n");
-    indi_locale_C_numeric_pop(orig);
-    fflush(stdout);
-    pthread_mutex_unlock(&stdout_mutex);
+        drvBufPrintf(b, "  <oneNumber name='%s'\n    min='", np->name);
+        drvBufNumber(b, np->min, 6);
+        drvBufPuts(b, "'\n    max='");
+        drvBufNumber(b, np->max, 6);
+        drvBufPuts(b, "'\n    step='");
+        drvBufNumber(b, np->step, 6);
+        drvBufPuts(b, "'\n>\n      ");
+        drvBufNumber(b, np->value, 6);
+        drvBufPuts(b, "\n  </oneNumber>\n");
+    }
+
+    drvBufPuts(b, "</setNumberVector>\n");
+    drvBufSend(b);
 }
 
 int IUFindIndex(const char *needle, char **hay, unsigned int n)
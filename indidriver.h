@@ -54,6 +54,11 @@ extern LilXML *clixml; /* XML parser context */
 extern int dispatch(XMLEle *root, char msg[]);
 extern void clientMsgCB(int fd, void *arg);
 
+/* Take the BLOB encoding indiserver offers from INDIBLOBS, once, and remove
+ * it from the environment so processes started by the driver do not inherit it.
+ */
+extern void initRawBLOBs(void);
+
 /**
  * \defgroup configFunctions Configuration Functions: Functions drivers call to save and load configuraion options.
 
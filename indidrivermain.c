@@ -91,6 +91,7 @@ int main(int ac, char *av[])
         usage();
 
     /* init */
+    initRawBLOBs();
     clixml = newLilXML();
     addCallback(0, clientMsgCB, NULL);
 
@@ -26,8 +26,24 @@
  * Outbound messages are limited to Devices and Properties seen inbound.
  *   Messages to Devices on sockets always include Device so the chained
  *   indiserver will only pass back info from that Device.
+ * All Devices chained from one indiserver host:port share one socket to it,
+ *   which is reconnected with backoff if it fails.
  * All newXXX() received from one Client are echoed to all other Clients who
  *   have shown an interest in the same Device and property.
+ * Local Drivers are offered raw BLOBs with INDIBLOBS=raw in their
+ *   environment. A setBLOBVector may then carry oneBLOBs with encoding='raw'
+ *   and no content, their enclen payload bytes follow right after the closing
+ *   '>' of the setBLOBVector, in order. Clients opt in with encoding='raw' in
+ *   enableBLOB and get such BLOBs as they came, the others get them in
+ *   base64, encoded once when first needed.
+ * Clients connected on the optional Unix-domain socket may instead ask for
+ *   encoding='shm'. While any does, raw BLOB messages are read into a memfd
+ *   segment, and such clients get the header with encoding='shm' and an
+ *   offset on each oneBLOB, the segment itself passed along with SCM_RIGHTS.
+ *   Segments are sealed against writes before they are passed, so no client
+ *   can change what the others read.
+ *   We drop the segment once the last queued copy is sent, the kernel frees
+ *   it once every client unmapped it too.
  *
  * 2017-01-29 JM: Added option to drop stream blobs if client blob queue is
  * higher than maxstreamsiz bytes
@@ -48,11 +64,13 @@
 
 #include "config.h"
 
+#include "base64.h"
 #include "fq.h"
 #include "indiapi.h"
 #include "indidevapi.h"
 #include "lilxml.h"
 
+#include <ctype.h>
 #include <errno.h>
 #include <fcntl.h>
 #include <libgen.h>
@@ -71,6 +89,8 @@
 #include <sys/wait.h>
 #include <sys/stat.h>
 #include <sys/socket.h>
+#include <sys/mman.h>
+#include <sys/un.h>
 
 #define INDIPORT      7624    /* default TCP/IP port to listen */
 #define REMOTEDVR     (-1234) /* invalid PID to flag remote drivers */
@@ -81,6 +101,10 @@
 #define DEFMAXQSIZ    128   /* default max q behind, MB */
 #define DEFMAXSSIZ    5     /* default max stream behind, MB */
 #define DEFMAXRESTART 10    /* default max restarts */
+#define MINLINKWAIT   1     /* secs before reconnecting a chained server link */
+#define MAXLINKWAIT   60    /* max secs between reconnect attempts */
+#define BLOBSNDBUF    (4 * 1024 * 1024) /* socket send buffer wanted for clients taking BLOBs */
+#define MAXRAWBLOB    ((size_t)1024 * 1024 * 1024) /* max raw BLOB bytes in one message, base64 fits an int */
 
 #ifdef OSX_EMBEDED_MODE
 #define LOGNAME  "/Users/%s/Library/Logs/indiserver.log"
@@ -94,8 +118,21 @@ typedef struct
     unsigned long cl;  /* content length */
     char *cp;          /* content: buf or malloced */
     char buf[SHORTMSGSIZ];    /* local buf for most messages */
+    XMLEle *ep;        /* raw BLOB message header until cp is made from it */
+    unsigned long rl;  /* raw content length */
+    char *rp;          /* raw content: header then BLOB payloads, malloced */
+    int fd;            /* shared memory segment mapped at rp instead, else -1 */
+    unsigned long sl;  /* shared content length */
+    char *sp;          /* shared content: header pointing into fd, malloced */
 } Msg;
 
+/* a raw BLOB message whose payloads are still being read */
+typedef struct
+{
+    Msg *mp;           /* message being filled, NULL if none */
+    unsigned long got; /* bytes of mp->rp filled so far */
+} RawIn;
+
 /* device + property name */
 typedef struct
 {
@@ -130,6 +167,10 @@ typedef struct
     LilXML *lp;         /* XML parsing context */
     FQ *msgq;           /* Msg queue */
     unsigned int nsent; /* bytes of current Msg sent so far */
+    int local;          /* 1 if connected on the Unix-domain socket */
+    int rawblobs;       /* 1 if client takes raw BLOBs, 2 in shared memory */
+    int sendraw;        /* form of current Msg, as rawblobs */
+    int blobbuf;        /* 1 once socket buffer is sized for BLOBs */
 } ClInfo;
 static ClInfo *clinfo; /*  malloced pool of clients */
 static int nclinfo;    /* n total (not active) */
@@ -155,17 +196,73 @@ typedef struct
     int wfd;            /* write pipe fd */
     int efd;            /* stderr from driver, if local */
     int restarts;       /* times process has been restarted */
-    LilXML *lp;         /* XML parsing context */
-    FQ *msgq;           /* Msg queue */
+    int link;           /* linkinfo[] index if remote */
+    LilXML *lp;         /* XML parsing context, NULL if remote */
+    FQ *msgq;           /* Msg queue, that of the link if remote */
     unsigned int nsent; /* bytes of current Msg sent so far */
+    RawIn raw;          /* raw BLOB message being read, if local */
 } DvrInfo;
 static DvrInfo *dvrinfo; /* malloced array of drivers */
 static int ndvrinfo;     /* n total */
 
+/* info for each chained server host:port, one connection shared by all the
+ * remote drivers there.
+ */
+typedef struct
+{
+    char host[MAXSBUF];
+    int port;
+    int active;         /* 1 when this record is in use */
+    int nusers;         /* remote drivers using this link */
+    int s;              /* socket, -1 while waiting to reconnect */
+    int connecting;     /* 1 until the non-blocking connect completes */
+    int allprops;       /* sent getProperties w/o device */
+    int wait;           /* secs to wait after the next failure */
+    time_t retry;       /* when to reconnect if s is -1 */
+    struct sockaddr_storage addr; /* address of host, looked up once */
+    socklen_t addrlen;  /* size of addr, 0 to look it up again */
+    LilXML *lp;         /* XML parsing context */
+    FQ *msgq;           /* Msg queue */
+    unsigned int nsent; /* bytes of current Msg sent so far */
+    RawIn raw;          /* raw BLOB message being read */
+} LinkInfo;
+static LinkInfo *linkinfo; /* malloced array of links */
+static int nlinkinfo;      /* n total */
+
+/* growable list of clinfo[] or dvrinfo[] indices */
+typedef struct
+{
+    int *ids;
+    int n;
+    int max;
+} IdList;
+
+/* subscribers of one device/property. name is empty for the whole device.
+ * routes let us find the recipients of a message without scanning every
+ * client and driver, they mirror the props[], sprops[] and dev[] lists.
+ */
+typedef struct Route
+{
+    char dev[MAXINDIDEVICE];
+    char name[MAXINDINAME];
+    IdList clients;     /* clients with a props[] entry for dev/name */
+    IdList snoopers;    /* drivers with a sprops[] entry for dev/name */
+    IdList drivers;     /* drivers serving dev, whole device routes only */
+    struct Route *next; /* hash chain */
+} Route;
+
+#define NROUTES 1024                /* hash buckets, power of 2 */
+static Route *routes[NROUTES];     /* device/property -> subscribers */
+static int nroutes;                /* routes in use */
+static IdList allClients;          /* clients that asked for all devices */
+
 static char *me;                                       /* our name */
 static int port = INDIPORT;                            /* public INDI port */
 static int verbose;                                    /* chattiness */
 static int lsocket;                                    /* listen socket */
+static char *usockpath;                                /* Unix-domain socket path, if any */
+static int usocket = -1;                               /* Unix-domain listen socket */
+static struct stat usockstat;                          /* usockpath as we bound it */
 static char *ldir;                                     /* where to log driver messages */
 static int maxqsiz       = (DEFMAXQSIZ * 1024 * 1024); /* kill if these bytes behind */
 static int maxstreamsiz  = (DEFMAXSSIZ * 1024 * 1024); /* drop blobs if these bytes behind while streaming*/
@@ -180,16 +277,27 @@ static void noSIGPIPE(void);
 static void indiFIFO(void);
 static void indiRun(void);
 static void indiListen(void);
+static void indiUnixListen(void);
 static void newFIFO(void);
-static void newClient(void);
-static int newClSocket(void);
+static void newClient(int lfd);
+static int newClSocket(int lfd);
 static void shutdownClient(ClInfo *cp);
 static int readFromClient(ClInfo *cp);
 static void startDvr(DvrInfo *dp);
 static void startLocalDvr(DvrInfo *dp);
 static void startRemoteDvr(DvrInfo *dp);
-static int openINDIServer(char host[], int indi_port);
+static void getPropsDvr(DvrInfo *dp);
 static void shutdownDvr(DvrInfo *dp, int restart);
+static void delDvrDevices(DvrInfo *dp);
+static LinkInfo *findLink(const char *host, int indi_port);
+static void connectLink(LinkInfo *lk);
+static int connectedLink(LinkInfo *lk);
+static void closeLink(LinkInfo *lk);
+static void releaseLink(LinkInfo *lk);
+static DvrInfo *linkDvr(LinkInfo *lk, const char *dev);
+static int readFromLink(LinkInfo *lk);
+static int sendLinkMsg(LinkInfo *lk);
+static int q2Dvr(DvrInfo *dp, Msg *mp);
 static int isDeviceInDriver(const char *dev, DvrInfo *dp);
 static void q2RDrivers(const char *dev, Msg *mp, XMLEle *root);
 static void q2SDrivers(DvrInfo *me, int isblob, const char *dev, const char *name, Msg *mp, XMLEle *root);
@@ -199,17 +307,39 @@ static void addSDevice(DvrInfo *dp, const char *dev, const char *name);
 static Property *findSDevice(DvrInfo *dp, const char *dev, const char *name);
 static void addClDevice(ClInfo *cp, const char *dev, const char *name, int isblob);
 static int findClDevice(ClInfo *cp, const char *dev, const char *name);
+static unsigned int routeHash(const char *dev, const char *name);
+static Route *findRoute(const char *dev, const char *name, int create);
+static void dropRoute(Route *rp);
+static void addId(IdList *lp, int id);
+static void rmId(IdList *lp, int id);
+static void mergeIds(IdList *out, IdList *a, IdList *b, IdList *c);
+static void addDvrRoute(DvrInfo *dp, const char *dev);
+static void rmClRoutes(ClInfo *cp);
+static void rmDvrRoutes(DvrInfo *dp);
 static int readFromDriver(DvrInfo *dp);
+static int handleDvrMsg(DvrInfo *dp, XMLEle *root, Msg *mp);
+static XMLEle *nextMsg(LilXML *lp, RawIn *rp, char **bufp, ssize_t *np, Msg **mpp, char err[]);
+static int rawBLOBLen(XMLEle *root, size_t *plp);
+static int rawBLOBEnclen(XMLEle *ep, size_t *np);
+static void dropRaw(RawIn *rp);
 static int stderrFromDriver(DvrInfo *dp);
 static int msgQSize(FQ *q);
 static void setMsgXMLEle(Msg *mp, XMLEle *root);
 static void setMsgStr(Msg *mp, char *str);
+static void setMsgBase64(Msg *mp);
+static void setMsgShared(Msg *mp, unsigned long hl);
+static int anyShmClient(void);
+static char *newSegment(unsigned long size, int *fdp);
+static void sealSegment(Msg *mp);
+static const char *msgContent(Msg *mp, int form, unsigned long *lenp);
 static void freeMsg(Msg *mp);
 static Msg *newMsg(void);
 static int sendClientMsg(ClInfo *cp);
+static ssize_t sendFd(int s, const char *buf, size_t len, int fd);
 static int sendDriverMsg(DvrInfo *cp);
 static void crackBLOB(const char *enableBLOB, BLOBHandling *bp);
 static void crackBLOBHandling(const char *dev, const char *name, const char *enableBLOB, ClInfo *cp);
+static void setBLOBSndBuf(ClInfo *cp);
 static void traceMsg(XMLEle *root);
 static char *indi_tstamp(char *s);
 static void logDMsg(XMLEle *root, const char *dev);
@@ -299,6 +429,15 @@ int main(int ac, char *av[])
                         maxrestarts = 0;
                     ac--;
                     break;
+                case 'u':
+                    if (ac < 2)
+                    {
+                        fprintf(stderr, "-u requires socket path\n");
+                        usage();
+                    }
+                    usockpath = *++av;
+                    ac--;
+                    break;
                 case 'v':
                     verbose++;
                     break;
@@ -334,6 +473,8 @@ int main(int ac, char *av[])
 
     /* announce we are online */
     indiListen();
+    if (usockpath)
+        indiUnixListen();
 
     /* Load up FIFO, if available */
     indiFIFO();
@@ -373,6 +514,7 @@ static void usage(void)
     fprintf(stderr, " -p p     : alternate IP port, default %d\n", INDIPORT);
     fprintf(stderr, " -r r     : maximum driver restarts on error, default %d\n", DEFMAXRESTART);
     fprintf(stderr, " -f path  : Path to fifo for dynamic startup and shutdown of drivers.\n");
+    fprintf(stderr, " -u path  : also listen on this Unix-domain socket, local clients there may take BLOBs in shared memory\n");
     fprintf(stderr, " -v       : show key events, no traffic\n");
     fprintf(stderr, " -vv      : -v + key message content\n");
     fprintf(stderr, " -vvv     : -vv + complete xml\n");
@@ -537,6 +679,8 @@ static void startLocalDvr(DvrInfo *dp)
             setenv("INDISKEL", dp->envSkel, 1);
         else if (fifo.fd > 0)
             unsetenv("INDISKEL");
+        /* we take BLOBs raw */
+        setenv("INDIBLOBS", "raw", 1);
         char executable[MAXSBUF];
         if (*dp->envPrefix)
         {
@@ -593,6 +737,7 @@ static void startLocalDvr(DvrInfo *dp)
     dp->sprops  = (Property *)malloc(1); /* seed for realloc */
     dp->nsprops = 0;
     dp->nsent   = 0;
+    dp->raw.mp  = NULL;
     dp->active  = 1;
     dp->ndev    = 0;
     dp->dev     = (char **)malloc(sizeof(char *));
@@ -611,16 +756,15 @@ static void startLocalDvr(DvrInfo *dp)
                 dp->wfd, dp->efd);
 }
 
-/* start the given remote INDI driver connection.
+/* start the given remote INDI driver on the link to its chained server.
  * exit if trouble.
  */
 static void startRemoteDvr(DvrInfo *dp)
 {
-    Msg *mp;
+    LinkInfo *lk;
     char dev[MAXINDIDEVICE];
     char host[MAXSBUF];
-    char buf[MAXSBUF];
-    int indi_port, sockfd;
+    int indi_port;
 
     /* extract host and port */
     indi_port = INDIPORT;
@@ -630,17 +774,20 @@ static void startRemoteDvr(DvrInfo *dp)
         Bye();
     }
 
-    /* connect */
-    sockfd = openINDIServer(host, indi_port);
+    /* share the link of other devices on the same server, else connect */
+    lk = findLink(host, indi_port);
+    lk->nusers++;
 
-    /* record flag pid, io channels, init lp and snoop list */
+    /* record flag pid, link, init snoop list */
     dp->pid = REMOTEDVR;
     strncpy(dp->host, host, MAXSBUF);
     dp->port    = indi_port;
-    dp->rfd     = sockfd;
-    dp->wfd     = sockfd;
-    dp->lp      = newLilXML();
-    dp->msgq    = newFQ(1);
+    dp->link    = lk - linkinfo;
+    dp->rfd     = -1;
+    dp->wfd     = -1;
+    dp->efd     = -1;
+    dp->lp      = NULL;
+    dp->msgq    = lk->msgq;
     dp->sprops  = (Property *)malloc(1); /* seed for realloc */
     dp->nsprops = 0;
     dp->nsent   = 0;
@@ -654,57 +801,258 @@ static void startRemoteDvr(DvrInfo *dp)
     dp->dev[0] = (char *)malloc(MAXINDIDEVICE * sizeof(char));
     strncpy(dp->dev[0], dev, MAXINDIDEVICE - 1);
     dp->dev[0][MAXINDIDEVICE - 1] = '\0';
+    addDvrRoute(dp, dp->dev[0]);
+
+    /* a link still waiting to reconnect asks for dev once it does */
+    if (lk->s >= 0)
+        getPropsDvr(dp);
+
+    if (verbose > 0)
+        fprintf(stderr, "%s: Driver %s: link %s:%d socket=%d\n", indi_tstamp(NULL), dp->name, lk->host, lk->port,
+                lk->s);
+}
+
+/* queue getProperties for the device of remote driver dp on its link.
+ * Sending getProperties with device lets remote server limit its
+ * outbound (and our inbound) traffic on the link to the devices chained here.
+ */
+static void getPropsDvr(DvrInfo *dp)
+{
+    Msg *mp;
+    char buf[MAXSBUF];
 
-    /* Sending getProperties with device lets remote server limit its
-     * outbound (and our inbound) traffic on this socket to this device.
-     */
     mp = newMsg();
     pushFQ(dp->msgq, mp);
     sprintf(buf, "<getProperties device='%s' version='%g'/>\n", dp->dev[0], INDIV);
     setMsgStr(mp, buf);
     mp->count++;
+}
 
-    if (verbose > 0)
-        fprintf(stderr, "%s: Driver %s: socket=%d\n", indi_tstamp(NULL), dp->name, sockfd);
+/* return the link to the given chained server, starting one if new.
+ * exit if trouble.
+ */
+static LinkInfo *findLink(const char *host, int indi_port)
+{
+    LinkInfo *lk;
+    int i;
+
+    for (i = 0; i < nlinkinfo; i++)
+    {
+        lk = &linkinfo[i];
+        if (lk->active && lk->port == indi_port && !strcmp(lk->host, host))
+            return (lk);
+    }
+
+    /* try to reuse a link slot, else add one */
+    for (i = 0; i < nlinkinfo; i++)
+        if (!linkinfo[i].active)
+            break;
+    if (i == nlinkinfo)
+    {
+        linkinfo = (LinkInfo *)realloc(linkinfo, (nlinkinfo + 1) * sizeof(LinkInfo));
+        if (!linkinfo)
+        {
+            fprintf(stderr, "no memory for new links\n");
+            Bye();
+        }
+        nlinkinfo++;
+    }
+
+    /* rig up new linkinfo entry */
+    lk = &linkinfo[i];
+    memset(lk, 0, sizeof(*lk));
+    strncpy(lk->host, host, MAXSBUF - 1);
+    lk->port   = indi_port;
+    lk->active = 1;
+    lk->s      = -1;
+    lk->wait   = MINLINKWAIT;
+    lk->lp     = newLilXML();
+    lk->msgq   = newFQ(1);
+
+    connectLink(lk);
+
+    return (lk);
 }
 
-/* open a connection to the given host and port or die.
- * return socket fd.
+/* start a non-blocking connection of lk to its chained server, indiRun()
+ * finishes it. if it fails right away, try again later.
  */
-static int openINDIServer(char host[], int indi_port)
+static void connectLink(LinkInfo *lk)
 {
-    struct sockaddr_in serv_addr;
-    struct hostent *hp;
-    int sockfd;
+    int sockfd, i;
 
-    /* lookup host address */
-    hp = gethostbyname(host);
-    if (!hp)
+    /* lookup the IPv4 address of host once, the lookup blocks every client and driver */
+    if (!lk->addrlen)
     {
-        fprintf(stderr, "gethostbyname(%s): %s\n", host, strerror(errno));
-        Bye();
+        struct addrinfo hints, *res;
+        char port[16];
+        int err;
+
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_family   = AF_INET;
+        hints.ai_socktype = SOCK_STREAM;
+        snprintf(port, sizeof(port), "%d", lk->port);
+        if ((err = getaddrinfo(lk->host, port, &hints, &res)) != 0)
+        {
+            fprintf(stderr, "%s: Link %s:%d: getaddrinfo: %s\n", indi_tstamp(NULL), lk->host, lk->port,
+                    gai_strerror(err));
+            closeLink(lk);
+            return;
+        }
+        memcpy(&lk->addr, res->ai_addr, res->ai_addrlen);
+        lk->addrlen = res->ai_addrlen;
+        freeaddrinfo(res);
     }
 
     /* create a socket to the INDI server */
-    (void)memset((char *)&serv_addr, 0, sizeof(serv_addr));
-    serv_addr.sin_family      = AF_INET;
-    serv_addr.sin_addr.s_addr = ((struct in_addr *)(hp->h_addr_list[0]))->s_addr;
-    serv_addr.sin_port        = htons(indi_port);
-    if ((sockfd = socket(AF_INET, SOCK_STREAM, 0)) < 0)
+    if ((sockfd = socket(lk->addr.ss_family, SOCK_STREAM, 0)) < 0)
     {
-        fprintf(stderr, "socket(%s,%d): %s\n", host, indi_port, strerror(errno));
-        Bye();
+        fprintf(stderr, "%s: Link %s:%d: socket: %s\n", indi_tstamp(NULL), lk->host, lk->port, strerror(errno));
+        closeLink(lk);
+        return;
     }
 
-    /* connect */
-    if (connect(sockfd, (struct sockaddr *)&serv_addr, sizeof(serv_addr)) < 0)
+    /* connect without waiting for the server */
+    fcntl(sockfd, F_SETFL, fcntl(sockfd, F_GETFL, 0) | O_NONBLOCK);
+    if (connect(sockfd, (struct sockaddr *)&lk->addr, lk->addrlen) < 0 && errno != EINPROGRESS)
     {
-        fprintf(stderr, "connect(%s,%d): %s\n", host, indi_port, strerror(errno));
-        Bye();
+        fprintf(stderr, "%s: Link %s:%d: connect: %s\n", indi_tstamp(NULL), lk->host, lk->port, strerror(errno));
+        close(sockfd);
+        closeLink(lk);
+        return;
     }
+    lk->s          = sockfd;
+    lk->connecting = 1;
+    lk->nsent      = 0;
 
-    /* ok */
-    return (sockfd);
+    /* ask again for the devices of all remote drivers on this link, or for
+     * everything if a client did, they go out as soon as the connection is up.
+     */
+    if (!lk->allprops)
+    {
+        for (i = 0; i < ndvrinfo; i++)
+        {
+            DvrInfo *dp = &dvrinfo[i];
+            if (dp->active && dp->pid == REMOTEDVR && &linkinfo[dp->link] == lk)
+                getPropsDvr(dp);
+        }
+    }
+    else
+    {
+        Msg *mp = newMsg();
+        char buf[MAXSBUF];
+
+        pushFQ(lk->msgq, mp);
+        sprintf(buf, "<getProperties version='%g'/>\n", INDIV);
+        setMsgStr(mp, buf);
+        mp->count++;
+    }
+
+    if (verbose > 0)
+        fprintf(stderr, "%s: Link %s:%d: connecting socket=%d\n", indi_tstamp(NULL), lk->host, lk->port, sockfd);
+}
+
+/* finish the non-blocking connect of lk once its socket is writable.
+ * return 0 if ok else -1 if it failed.
+ */
+static int connectedLink(LinkInfo *lk)
+{
+    socklen_t len = sizeof(int);
+    int err       = 0;
+
+    if (getsockopt(lk->s, SOL_SOCKET, SO_ERROR, &err, &len) < 0)
+        err = errno;
+    if (err)
+    {
+        fprintf(stderr, "%s: Link %s:%d: connect: %s\n", indi_tstamp(NULL), lk->host, lk->port, strerror(err));
+        closeLink(lk);
+        return (-1);
+    }
+
+    /* blocking io from now on, like every other socket here */
+    fcntl(lk->s, F_SETFL, fcntl(lk->s, F_GETFL, 0) & ~O_NONBLOCK);
+    lk->connecting = 0;
+    lk->wait       = MINLINKWAIT;
+
+    if (verbose > 0)
+        fprintf(stderr, "%s: Link %s:%d: connected socket=%d\n", indi_tstamp(NULL), lk->host, lk->port, lk->s);
+
+    return (0);
+}
+
+/* drop the connection of lk and try again later, waiting twice as long after
+ * each failure in a row. the remote drivers stay, their devices are gone for
+ * the clients until the chained server sends them again.
+ */
+static void closeLink(LinkInfo *lk)
+{
+    Msg *mp;
+    int i;
+
+    if (lk->s >= 0)
+    {
+        if (!lk->connecting)
+        {
+            for (i = 0; i < ndvrinfo; i++)
+            {
+                DvrInfo *dp = &dvrinfo[i];
+                if (dp->active && dp->pid == REMOTEDVR && &linkinfo[dp->link] == lk)
+                    delDvrDevices(dp);
+            }
+        }
+        shutdown(lk->s, SHUT_RDWR);
+        close(lk->s);
+        lk->s = -1;
+    }
+
+    /* decrement and possibly free any unsent messages for this link */
+    while ((mp = (Msg *)popFQ(lk->msgq)) != NULL)
+        if (--mp->count == 0)
+            freeMsg(mp);
+    lk->nsent      = 0;
+    lk->connecting = 0;
+
+    /* a fresh parser for the next connection */
+    delLilXML(lk->lp);
+    lk->lp = newLilXML();
+    dropRaw(&lk->raw);
+
+    /* down for long, the host may have moved meanwhile */
+    if (lk->wait == MAXLINKWAIT)
+        lk->addrlen = 0;
+
+    lk->retry = time(NULL) + lk->wait;
+    fprintf(stderr, "%s: Link %s:%d: reconnecting in %d s\n", indi_tstamp(NULL), lk->host, lk->port, lk->wait);
+    lk->wait *= 2;
+    if (lk->wait > MAXLINKWAIT)
+        lk->wait = MAXLINKWAIT;
+}
+
+/* one remote driver less uses lk, close it for good once none does */
+static void releaseLink(LinkInfo *lk)
+{
+    Msg *mp;
+
+    if (--lk->nusers > 0)
+        return;
+
+    if (lk->s >= 0)
+    {
+        shutdown(lk->s, SHUT_RDWR);
+        close(lk->s);
+    }
+    while ((mp = (Msg *)popFQ(lk->msgq)) != NULL)
+        if (--mp->count == 0)
+            freeMsg(mp);
+    delFQ(lk->msgq);
+    delLilXML(lk->lp);
+    dropRaw(&lk->raw);
+
+    if (verbose > 0)
+        fprintf(stderr, "%s: Link %s:%d: closed\n", indi_tstamp(NULL), lk->host, lk->port);
+
+    /* ok now to recycle */
+    lk->active = 0;
 }
 
 /* create the public INDI Driver endpoint lsocket on port.
@@ -756,6 +1104,81 @@ static void indiListen()
         fprintf(stderr, "%s: listening to port %d on fd %d\n", indi_tstamp(NULL), port, sfd);
 }
 
+/* create the local INDI endpoint usocket on usockpath, replacing a stale
+ * socket left there by a server that is gone, never anything else.
+ * exit if trouble.
+ */
+static void indiUnixListen()
+{
+    struct sockaddr_un serv_socket;
+    struct stat st;
+    int sfd;
+
+    if (strlen(usockpath) >= sizeof(serv_socket.sun_path))
+    {
+        fprintf(stderr, "%s: socket path too long: %s\n", indi_tstamp(NULL), usockpath);
+        Bye();
+    }
+
+    /* make socket endpoint */
+    if ((sfd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0)
+    {
+        fprintf(stderr, "%s: socket: %s\n", indi_tstamp(NULL), strerror(errno));
+        Bye();
+    }
+
+    memset(&serv_socket, 0, sizeof(serv_socket));
+    serv_socket.sun_family = AF_UNIX;
+    strcpy(serv_socket.sun_path, usockpath);
+
+    /* a socket nobody listens to any more refuses connections */
+    if (lstat(usockpath, &st) == 0)
+    {
+        int probe;
+
+        if (!S_ISSOCK(st.st_mode))
+        {
+            fprintf(stderr, "%s: %s exists and is not a socket\n", indi_tstamp(NULL), usockpath);
+            Bye();
+        }
+        if ((probe = socket(AF_UNIX, SOCK_STREAM, 0)) < 0)
+        {
+            fprintf(stderr, "%s: socket: %s\n", indi_tstamp(NULL), strerror(errno));
+            Bye();
+        }
+        if (connect(probe, (struct sockaddr *)&serv_socket, sizeof(serv_socket)) == 0)
+        {
+            fprintf(stderr, "%s: %s is in use\n", indi_tstamp(NULL), usockpath);
+            Bye();
+        }
+        if (errno != ECONNREFUSED)
+        {
+            fprintf(stderr, "%s: connect %s: %s\n", indi_tstamp(NULL), usockpath, strerror(errno));
+            Bye();
+        }
+        close(probe);
+        unlink(usockpath);
+    }
+
+    if (bind(sfd, (struct sockaddr *)&serv_socket, sizeof(serv_socket)) < 0)
+    {
+        fprintf(stderr, "%s: bind %s: %s\n", indi_tstamp(NULL), usockpath, strerror(errno));
+        Bye();
+    }
+    lstat(usockpath, &usockstat);
+
+    if (listen(sfd, 5) < 0)
+    {
+        fprintf(stderr, "%s: listen: %s\n", indi_tstamp(NULL), strerror(errno));
+        Bye();
+    }
+
+    /* ok */
+    usocket = sfd;
+    if (verbose > 0)
+        fprintf(stderr, "%s: listening to %s on fd %d\n", indi_tstamp(NULL), usockpath, sfd);
+}
+
 /* Attempt to open up FIFO */
 static void indiFIFO(void)
 {
@@ -779,9 +1202,19 @@ static void indiFIFO(void)
 static void indiRun(void)
 {
     fd_set rs, ws;
+    struct timeval tv, *tvp = NULL;
+    time_t now = time(NULL);
     int maxfd = 0;
     int i, s;
 
+    /* reconnect chained server links whose wait is over */
+    for (i = 0; i < nlinkinfo; i++)
+    {
+        LinkInfo *lk = &linkinfo[i];
+        if (lk->active && lk->s < 0 && lk->retry <= now)
+            connectLink(lk);
+    }
+
     /* init with no writers or readers */
     FD_ZERO(&ws);
     FD_ZERO(&rs);
@@ -796,6 +1229,12 @@ static void indiRun(void)
     FD_SET(lsocket, &rs);
     if (lsocket > maxfd)
         maxfd = lsocket;
+    if (usocket >= 0)
+    {
+        FD_SET(usocket, &rs);
+        if (usocket > maxfd)
+            maxfd = usocket;
+    }
 
     /* add all client readers and client writers with work to send */
     for (i = 0; i < nclinfo; i++)
@@ -815,17 +1254,14 @@ static void indiRun(void)
     for (i = 0; i < ndvrinfo; i++)
     {
         DvrInfo *dp = &dvrinfo[i];
-        if (dp->active)
+        if (dp->active && dp->pid != REMOTEDVR)
         {
             FD_SET(dp->rfd, &rs);
             if (dp->rfd > maxfd)
                 maxfd = dp->rfd;
-            if (dp->pid != REMOTEDVR)
-            {
-                FD_SET(dp->efd, &rs);
-                if (dp->efd > maxfd)
-                    maxfd = dp->efd;
-            }
+            FD_SET(dp->efd, &rs);
+            if (dp->efd > maxfd)
+                maxfd = dp->efd;
             if (nFQ(dp->msgq) > 0)
             {
                 FD_SET(dp->wfd, &ws);
@@ -835,8 +1271,34 @@ static void indiRun(void)
         }
     }
 
+    /* add all connected links, pending connects wait for writable, and wake
+     * up in time for the next reconnect
+     */
+    for (i = 0; i < nlinkinfo; i++)
+    {
+        LinkInfo *lk = &linkinfo[i];
+        if (!lk->active)
+            continue;
+        if (lk->s < 0)
+        {
+            if (!tvp || lk->retry - now < tv.tv_sec)
+            {
+                tv.tv_sec  = lk->retry - now;
+                tv.tv_usec = 0;
+                tvp        = &tv;
+            }
+            continue;
+        }
+        if (!lk->connecting)
+            FD_SET(lk->s, &rs);
+        if (lk->connecting || nFQ(lk->msgq) > 0)
+            FD_SET(lk->s, &ws);
+        if (lk->s > maxfd)
+            maxfd = lk->s;
+    }
+
     /* wait for action */
-    s = select(maxfd + 1, &rs, &ws, NULL, NULL);
+    s = select(maxfd + 1, &rs, &ws, NULL, tvp);
     if (s < 0)
     {
         if(errno==EINTR)
@@ -855,7 +1317,12 @@ static void indiRun(void)
     /* new client? */
     if (s > 0 && FD_ISSET(lsocket, &rs))
     {
-        newClient();
+        newClient(lsocket);
+        s--;
+    }
+    if (s > 0 && usocket >= 0 && FD_ISSET(usocket, &rs))
+    {
+        newClient(usocket);
         s--;
     }
 
@@ -884,9 +1351,9 @@ static void indiRun(void)
     for (i = 0; s > 0 && i < ndvrinfo; i++)
     {
         DvrInfo *dp = &dvrinfo[i];
-        if (dp->active)
+        if (dp->active && dp->pid != REMOTEDVR)
         {
-            if (dp->pid != REMOTEDVR && FD_ISSET(dp->efd, &rs))
+            if (FD_ISSET(dp->efd, &rs))
             {
                 if (stderrFromDriver(dp) < 0)
                     return; /* fds effected */
@@ -906,6 +1373,37 @@ static void indiRun(void)
             }
         }
     }
+
+    /* connect, message to/from chained server? */
+    for (i = 0; s > 0 && i < nlinkinfo; i++)
+    {
+        LinkInfo *lk = &linkinfo[i];
+        if (lk->active && lk->s >= 0)
+        {
+            if (lk->connecting)
+            {
+                if (FD_ISSET(lk->s, &ws))
+                {
+                    if (connectedLink(lk) < 0)
+                        return; /* fds effected */
+                    s--;
+                }
+                continue;
+            }
+            if (FD_ISSET(lk->s, &rs))
+            {
+                if (readFromLink(lk) < 0)
+                    return; /* fds effected */
+                s--;
+            }
+            if (s > 0 && FD_ISSET(lk->s, &ws) && nFQ(lk->msgq) > 0)
+            {
+                if (sendLinkMsg(lk) < 0)
+                    return; /* fds effected */
+                s--;
+            }
+        }
+    }
 }
 
 int isDeviceInDriver(const char *dev, DvrInfo *dp)
@@ -965,7 +1463,7 @@ static void newFIFO(void)
         // If remote driver
         if (strstr(line, "@"))
         {
-            n = sscanf(line, "%s %512[^\n]", cmd, tDriver);
+            n = sscanf(line, "%s %511[^\n]", cmd, tDriver);
 
             // Remove quotes if any
             char *ptr = tDriver;
@@ -982,7 +1480,7 @@ static void newFIFO(void)
         // If local driver
         else
         {
-            n = sscanf(line, "%s %s -%1c \"%512[^\"]\" -%1c \"%512[^\"]\" -%1c \"%512[^\"]\" -%1c \"%512[^\"]\"", cmd,
+            n = sscanf(line, "%s %s -%1c \"%511[^\"]\" -%1c \"%511[^\"]\" -%1c \"%511[^\"]\" -%1c \"%511[^\"]\"", cmd,
                        tDriver, arg[0], var[0], arg[1], var[1], arg[2], var[2], arg[3], var[3]);
             remoteDriver = 0;
         }
@@ -1097,13 +1595,13 @@ static void newFIFO(void)
 /* prepare for new client arriving on lsocket.
  * exit if trouble.
  */
-static void newClient()
+static void newClient(int lfd)
 {
     ClInfo *cp = NULL;
     int s, cli;
 
     /* assign new socket */
-    s = newClSocket();
+    s = newClSocket(lfd);
 
     /* try to reuse a clinfo slot, else add one */
     for (cli = 0; cli < nclinfo; cli++)
@@ -1132,8 +1630,21 @@ static void newClient()
     cp->msgq   = newFQ(1);
     cp->props  = malloc(1);
     cp->nsent  = 0;
+    cp->local  = (lfd == usocket);
 
-    if (verbose > 0)
+    if (verbose > 0 && cp->local)
+    {
+#ifdef SO_PEERCRED
+        struct ucred cred;
+        socklen_t len = sizeof(cred);
+        if (getsockopt(s, SOL_SOCKET, SO_PEERCRED, &cred, &len) == 0)
+            fprintf(stderr, "%s: Client %d: new arrival on %s from pid %d uid %d gid %d - welcome!\n",
+                    indi_tstamp(NULL), cp->s, usockpath, (int)cred.pid, (int)cred.uid, (int)cred.gid);
+        else
+#endif
+            fprintf(stderr, "%s: Client %d: new arrival on %s - welcome!\n", indi_tstamp(NULL), cp->s, usockpath);
+    }
+    else if (verbose > 0)
     {
         struct sockaddr_in addr;
         socklen_t len = sizeof(addr);
@@ -1158,7 +1669,9 @@ static void newClient()
 static int readFromClient(ClInfo *cp)
 {
     char buf[MAXRBUF];
+    char err[1024];
     int shutany = 0;
+    XMLEle **nodes;
     ssize_t i, nr;
 
     /* read client */
@@ -1174,77 +1687,88 @@ static int readFromClient(ClInfo *cp)
     }
 
     /* process XML, sending when find closure */
-    for (i = 0; i < nr; i++)
+    nodes = parseXMLChunk(cp->lp, buf, nr, err);
+    for (i = 0; nodes[i]; i++)
     {
-        char err[1024];
-        XMLEle *root = readXMLEle(cp->lp, buf[i], err);
-        if (root)
-        {
-            char *roottag    = tagXMLEle(root);
-            const char *dev  = findXMLAttValu(root, "device");
-            const char *name = findXMLAttValu(root, "name");
-            int isblob       = !strcmp(tagXMLEle(root), "setBLOBVector");
-            Msg *mp;
+        XMLEle *root     = nodes[i];
+        char *roottag    = tagXMLEle(root);
+        const char *dev  = findXMLAttValu(root, "device");
+        const char *name = findXMLAttValu(root, "name");
+        int isblob       = !strcmp(tagXMLEle(root), "setBLOBVector");
+        Msg *mp;
 
-            if (verbose > 2)
-            {
-                fprintf(stderr, "%s: Client %d: read ", indi_tstamp(NULL), cp->s);
-                traceMsg(root);
-            }
-            else if (verbose > 1)
-            {
-                fprintf(stderr, "%s: Client %d: read <%s device='%s' name='%s'>\n", indi_tstamp(NULL), cp->s,
-                        tagXMLEle(root), findXMLAttValu(root, "device"), findXMLAttValu(root, "name"));
-            }
+        if (verbose > 2)
+        {
+            fprintf(stderr, "%s: Client %d: read ", indi_tstamp(NULL), cp->s);
+            traceMsg(root);
+        }
+        else if (verbose > 1)
+        {
+            fprintf(stderr, "%s: Client %d: read <%s device='%s' name='%s'>\n", indi_tstamp(NULL), cp->s,
+                    tagXMLEle(root), findXMLAttValu(root, "device"), findXMLAttValu(root, "name"));
+        }
 
-            /* snag interested properties.
+        /* snag interested properties.
          * N.B. don't open to alldevs if seen specific dev already, else
          *   remote client connections start returning too much.
          */
-            if (dev[0])
-                addClDevice(cp, dev, name, isblob);
-            else if (!strcmp(roottag, "getProperties") && !cp->nprops)
-                cp->allprops = 1;
+        if (dev[0])
+            addClDevice(cp, dev, name, isblob);
+        else if (!strcmp(roottag, "getProperties") && !cp->nprops && !cp->allprops)
+        {
+            cp->allprops = 1;
+            addId(&allClients, cp - clinfo);
+        }
 
-            /* snag enableBLOB -- send to remote drivers too */
-            if (!strcmp(roottag, "enableBLOB"))
-                crackBLOBHandling(dev, name, pcdataXMLEle(root), cp);
+        /* snag enableBLOB -- send to remote drivers too */
+        if (!strcmp(roottag, "enableBLOB"))
+        {
+            const char *encoding = findXMLAttValu(root, "encoding");
+            if (!strcmp(encoding, "shm"))
+                cp->rawblobs = cp->local ? 2 : 1;
+            else if (encoding[0])
+                cp->rawblobs = !strcmp(encoding, "raw");
+            crackBLOBHandling(dev, name, pcdataXMLEle(root), cp);
+            if (strcmp(pcdataXMLEle(root), "Never"))
+                setBLOBSndBuf(cp);
+        }
 
-            /* build a new message -- set content iff anyone cares */
-            mp = newMsg();
+        /* build a new message -- set content iff anyone cares */
+        mp = newMsg();
 
-            /* send message to driver(s) responsible for dev */
-            q2RDrivers(dev, mp, root);
+        /* send message to driver(s) responsible for dev */
+        q2RDrivers(dev, mp, root);
 
-            /* JM 2016-05-18: Upstream client can be a chained INDI server. If any driver locally is snooping
+        /* JM 2016-05-18: Upstream client can be a chained INDI server. If any driver locally is snooping
          * on any remote drivers, we should catch it and forward it to the responsible snooping driver. */
-            /* send to snooping drivers. */
-            // JM 2016-05-26: Only forward setXXX messages
-            if (!strncmp(roottag, "set", 3))
-                q2SDrivers(NULL, isblob, dev, name, mp, root);
-
-            /* echo new* commands back to other clients */
-            if (!strncmp(roottag, "new", 3))
-            {
-                if (q2Clients(cp, isblob, dev, name, mp, root) < 0)
-                    shutany++;
-            }
+        /* send to snooping drivers. */
+        // JM 2016-05-26: Only forward setXXX messages
+        if (!strncmp(roottag, "set", 3))
+            q2SDrivers(NULL, isblob, dev, name, mp, root);
 
-            /* set message content if anyone cares else forget it */
-            if (mp->count > 0)
-                setMsgXMLEle(mp, root);
-            else
-                freeMsg(mp);
-            delXMLEle(root);
-        }
-        else if (err[0])
+        /* echo new* commands back to other clients */
+        if (!strncmp(roottag, "new", 3))
         {
-            char *ts = indi_tstamp(NULL);
-            fprintf(stderr, "%s: Client %d: XML error: %s\n", ts, cp->s, err);
-            fprintf(stderr, "%s: Client %d: XML read: %.*s\n", ts, cp->s, (int)nr, buf);
-            shutdownClient(cp);
-            return (-1);
+            if (q2Clients(cp, isblob, dev, name, mp, root) < 0)
+                shutany++;
         }
+
+        /* set message content if anyone cares else forget it */
+        if (mp->count > 0)
+            setMsgXMLEle(mp, root);
+        else
+            freeMsg(mp);
+        delXMLEle(root);
+    }
+    free(nodes);
+
+    if (err[0])
+    {
+        char *ts = indi_tstamp(NULL);
+        fprintf(stderr, "%s: Client %d: XML error: %s\n", ts, cp->s, err);
+        fprintf(stderr, "%s: Client %d: XML read: %.*s\n", ts, cp->s, (int)nr, buf);
+        shutdownClient(cp);
+        return (-1);
     }
 
     return (shutany ? -1 : 0);
@@ -1257,15 +1781,18 @@ static int readFromClient(ClInfo *cp)
 static int readFromDriver(DvrInfo *dp)
 {
     char buf[MAXRBUF];
+    char *bp = buf;
     int shutany = 0;
-    ssize_t nr;
+    ssize_t nr, np;
     char err[1024];
-    XMLEle **nodes;
     XMLEle *root;
-    int inode = 0;
+    Msg *mp;
 
-    /* read driver */
-    nr = read(dp->rfd, buf, sizeof(buf));
+    /* read driver, BLOB payloads straight into their message */
+    if (dp->raw.mp)
+        nr = read(dp->rfd, dp->raw.mp->rp + dp->raw.got, dp->raw.mp->rl - dp->raw.got);
+    else
+        nr = read(dp->rfd, buf, sizeof(buf));
     if (nr <= 0)
     {
         if (nr < 0)
@@ -1276,124 +1803,367 @@ static int readFromDriver(DvrInfo *dp)
         shutdownDvr(dp, 1);
         return (-1);
     }
+    if (dp->raw.mp)
+    {
+        dp->raw.got += nr;
+        nr = 0;
+    }
 
     /* process XML chunk */
-    nodes = parseXMLChunk(dp->lp, buf, nr, err);
-
-    if (!nodes)
+    np = nr;
+    while ((root = nextMsg(dp->lp, &dp->raw, &bp, &np, &mp, err)) != NULL)
     {
-        if (err[0])
-        {
-            char *ts = indi_tstamp(NULL);
-            fprintf(stderr, "%s: Driver %s: XML error: %s\n", ts, dp->name, err);
-            fprintf(stderr, "%s: Driver %s: XML read: %.*s\n", ts, dp->name, (int)nr, buf);
-            shutdownDvr(dp, 1);
-            return (-1);
-        }
-        return -1;
+        if (handleDvrMsg(dp, root, mp) < 0)
+            shutany++;
+        if (!mp)
+            delXMLEle(root);
     }
 
-    root = nodes[inode];
-    while (root)
+    if (err[0])
     {
-        char *roottag    = tagXMLEle(root);
-        const char *dev  = findXMLAttValu(root, "device");
-        const char *name = findXMLAttValu(root, "name");
-        int isblob       = !strcmp(tagXMLEle(root), "setBLOBVector");
-        Msg *mp;
+        char *ts = indi_tstamp(NULL);
+        fprintf(stderr, "%s: Driver %s: XML error: %s\n", ts, dp->name, err);
+        fprintf(stderr, "%s: Driver %s: XML read: %.*s\n", ts, dp->name, (int)nr, buf);
+        shutdownDvr(dp, 1);
+        return (-1);
+    }
 
-        if (verbose > 2)
+    return (shutany ? -1 : 0);
+}
+
+/* take the next complete message from the *np bytes at *bufp, advancing both
+ * past what is used. a setBLOBVector with raw BLOBs is only complete once
+ * its payloads are in, they are gathered in the Msg returned in *mpp along
+ * with the message itself, which then belongs to the Msg. *mpp is NULL for
+ * other messages.
+ * return the message root, else NULL when more is needed or on error with
+ * reason in err[].
+ */
+static XMLEle *nextMsg(LilXML *lp, RawIn *rp, char **bufp, ssize_t *np, Msg **mpp, char err[])
+{
+    XMLEle *root;
+    size_t pl;
+    int used, hl;
+
+    err[0] = '\0';
+    *mpp   = NULL;
+
+    while (1)
+    {
+        /* fill the pending raw BLOB message first */
+        if (rp->mp)
         {
-            fprintf(stderr, "%s: Driver %s: read ", indi_tstamp(0), dp->name);
-            traceMsg(root);
-        }
-        else if (verbose > 1)
-        {
-            fprintf(stderr, "%s: Driver %s: read <%s device='%s' name='%s'>\n", indi_tstamp(NULL), dp->name,
-                    tagXMLEle(root), findXMLAttValu(root, "device"), findXMLAttValu(root, "name"));
+            unsigned long n = rp->mp->rl - rp->got;
+            if (n > (unsigned long)*np)
+                n = *np;
+            memcpy(rp->mp->rp + rp->got, *bufp, n);
+            rp->got += n;
+            *bufp += n;
+            *np -= n;
+            if (rp->got < rp->mp->rl)
+                return (NULL);
+
+            *mpp   = rp->mp;
+            rp->mp = NULL;
+            if ((*mpp)->fd >= 0)
+                sealSegment(*mpp);
+            return ((*mpp)->ep);
         }
 
-        /* that's all if driver is just registering a snoop */
-        /* JM 2016-05-18: Send getProperties to upstream chained servers as well.*/
-        if (!strcmp(roottag, "getProperties"))
-        {
-            addSDevice(dp, dev, name);
-            mp = newMsg();
-            /* send to interested chained servers upstream */
-            if (q2Servers(dp, mp, root) < 0)
-                shutany++;
-            /* Send to snooped drivers if they exist so that they can echo back the snooped propertly immediately */
-            q2RDrivers(dev, mp, root);
+        root = parseXMLEle(lp, *bufp, *np, &used, err);
+        *bufp += used;
+        *np -= used;
+        if (!root)
+            return (NULL);
 
-            if (mp->count > 0)
-                setMsgXMLEle(mp, root);
-            else
-                freeMsg(mp);
+        if (rawBLOBLen(root, &pl) < 0)
+        {
+            snprintf(err, 1024, "bad raw BLOB enclen in %s.%s", findXMLAttValu(root, "device"),
+                     findXMLAttValu(root, "name"));
             delXMLEle(root);
-            inode++;
-            root = nodes[inode];
-            continue;
+            return (NULL);
         }
+        if (pl == 0)
+            return (root);
 
-        /* that's all if driver desires to snoop BLOBs from other drivers */
-        if (!strcmp(roottag, "enableBLOB"))
+        /* header as we send it on, then room for the payloads, in shared
+         * memory if any client could use it there
+         */
+        rp->mp = newMsg();
+        hl     = sprlXMLEle(root, 0);
+        if (anyShmClient())
+            rp->mp->rp = newSegment(hl + pl + 1, &rp->mp->fd);
+        if (!rp->mp->rp)
+            rp->mp->rp = malloc(hl + pl + 1);
+        if (!rp->mp->rp)
         {
-            Property *sp = findSDevice(dp, dev, name);
-            if (sp)
-                crackBLOB(pcdataXMLEle(root), &sp->blob);
+            snprintf(err, 1024, "no memory for %zu BLOB bytes", pl);
             delXMLEle(root);
-            inode++;
-            root = nodes[inode];
-            continue;
+            dropRaw(rp);
+            return (NULL);
         }
+        hl = sprXMLEle(rp->mp->rp, root, 0);
+        if (hl > 0 && rp->mp->rp[hl - 1] == '\n')
+            hl--;
+        rp->mp->ep = root;
+        rp->mp->rl = hl + pl;
+        rp->mp->rp[rp->mp->rl] = '\0';
+        rp->got    = hl;
+        if (rp->mp->fd >= 0)
+            setMsgShared(rp->mp, hl);
+    }
+}
 
-        /* Found a new device? Let's add it to driver info */
-        if (dev[0] && isDeviceInDriver(dev, dp) == 0)
-        {
-            dp->dev           = (char **)realloc(dp->dev, (dp->ndev + 1) * sizeof(char *));
-            dp->dev[dp->ndev] = (char *)malloc(MAXINDIDEVICE * sizeof(char));
+/* set *plp to the total length of the raw BLOB payloads following root, 0 if
+ * none.
+ * return 0 if ok, else -1 if an enclen is bad or they add up to more than
+ * MAXRAWBLOB.
+ */
+static int rawBLOBLen(XMLEle *root, size_t *plp)
+{
+    XMLEle *ep;
+    size_t n;
 
-            strncpy(dp->dev[dp->ndev], dev, MAXINDIDEVICE - 1);
-            dp->dev[dp->ndev][MAXINDIDEVICE - 1] = '\0';
+    *plp = 0;
+    if (strcmp(tagXMLEle(root), "setBLOBVector"))
+        return (0);
 
-#ifdef OSX_EMBEDED_MODE
-            if (!dp->ndev)
-                fprintf(stderr, "STARTED \"%s\"\n", dp->name);
-            fflush(stderr);
-#endif
+    for (ep = nextXMLEle(root, 1); ep; ep = nextXMLEle(root, 0))
+    {
+        if (strcmp(tagXMLEle(ep), "oneBLOB") || strcmp(findXMLAttValu(ep, "encoding"), "raw"))
+            continue;
+        if (rawBLOBEnclen(ep, &n) < 0 || n > MAXRAWBLOB - *plp)
+            return (-1);
+        *plp += n;
+    }
 
-            dp->ndev++;
-        }
+    return (0);
+}
 
-        /* log messages if any and wanted */
-        if (ldir)
-            logDMsg(root, dev);
+/* set *np to the enclen of raw oneBLOB ep.
+ * return 0 if ok, else -1 if it is not a plain decimal number up to
+ * MAXRAWBLOB.
+ */
+static int rawBLOBEnclen(XMLEle *ep, size_t *np)
+{
+    const char *enclen = findXMLAttValu(ep, "enclen");
+    unsigned long long n;
+    char *end;
 
-        /* build a new message -- set content iff anyone cares */
-        mp = newMsg();
+    /* strtoull() would take leading blanks and a sign */
+    if (!isdigit((unsigned char)enclen[0]))
+        return (-1);
 
-        /* send to interested clients */
-        if (q2Clients(NULL, isblob, dev, name, mp, root) < 0)
-            shutany++;
+    errno = 0;
+    n     = strtoull(enclen, &end, 10);
+    if (errno || *end || n > MAXRAWBLOB)
+        return (-1);
 
-        /* send to snooping drivers */
-        q2SDrivers(dp, isblob, dev, name, mp, root);
+    *np = (size_t)n;
+    return (0);
+}
+
+/* forget any raw BLOB message still being read into rp */
+static void dropRaw(RawIn *rp)
+{
+    if (rp->mp)
+        freeMsg(rp->mp);
+    rp->mp  = NULL;
+    rp->got = 0;
+}
+
+/* send one message read from driver dp to each interested client and driver.
+ * mp is the Msg of a raw BLOB message, which it frees if nobody wants it, else
+ * NULL.
+ * return 0 if ok else -1 if had to shut down any clients.
+ */
+static int handleDvrMsg(DvrInfo *dp, XMLEle *root, Msg *mp)
+{
+    char *roottag    = tagXMLEle(root);
+    const char *dev  = findXMLAttValu(root, "device");
+    const char *name = findXMLAttValu(root, "name");
+    int isblob       = !strcmp(tagXMLEle(root), "setBLOBVector");
+    int shutany      = 0;
+
+    if (verbose > 2)
+    {
+        fprintf(stderr, "%s: Driver %s: read ", indi_tstamp(0), dp->name);
+        traceMsg(root);
+    }
+    else if (verbose > 1)
+    {
+        fprintf(stderr, "%s: Driver %s: read <%s device='%s' name='%s'>\n", indi_tstamp(NULL), dp->name,
+                tagXMLEle(root), findXMLAttValu(root, "device"), findXMLAttValu(root, "name"));
+    }
+
+    /* that's all if driver is just registering a snoop */
+    /* JM 2016-05-18: Send getProperties to upstream chained servers as well.*/
+    if (!strcmp(roottag, "getProperties"))
+    {
+        addSDevice(dp, dev, name);
+        mp = newMsg();
+        /* send to interested chained servers upstream */
+        if (q2Servers(dp, mp, root) < 0)
+            shutany++;
+        /* Send to snooped drivers if they exist so that they can echo back the snooped propertly immediately */
+        q2RDrivers(dev, mp, root);
 
-        /* set message content if anyone cares else forget it */
         if (mp->count > 0)
             setMsgXMLEle(mp, root);
         else
             freeMsg(mp);
-        delXMLEle(root);
-        inode++;
-        root = nodes[inode];
+        return (shutany ? -1 : 0);
     }
 
-    free(nodes);
+    /* that's all if driver desires to snoop BLOBs from other drivers */
+    if (!strcmp(roottag, "enableBLOB"))
+    {
+        Property *sp = findSDevice(dp, dev, name);
+        if (sp)
+            crackBLOB(pcdataXMLEle(root), &sp->blob);
+        return (0);
+    }
+
+    /* Found a new device? Let's add it to driver info */
+    if (dev[0] && isDeviceInDriver(dev, dp) == 0)
+    {
+        dp->dev           = (char **)realloc(dp->dev, (dp->ndev + 1) * sizeof(char *));
+        dp->dev[dp->ndev] = (char *)malloc(MAXINDIDEVICE * sizeof(char));
+
+        strncpy(dp->dev[dp->ndev], dev, MAXINDIDEVICE - 1);
+        dp->dev[dp->ndev][MAXINDIDEVICE - 1] = '\0';
+        addDvrRoute(dp, dp->dev[dp->ndev]);
+
+#ifdef OSX_EMBEDED_MODE
+        if (!dp->ndev)
+            fprintf(stderr, "STARTED \"%s\"\n", dp->name);
+        fflush(stderr);
+#endif
+
+        dp->ndev++;
+    }
+
+    /* log messages if any and wanted */
+    if (ldir)
+        logDMsg(root, dev);
+
+    /* build a new message -- set content iff anyone cares */
+    if (!mp)
+        mp = newMsg();
+
+    /* send to interested clients */
+    if (q2Clients(NULL, isblob, dev, name, mp, root) < 0)
+        shutany++;
+
+    /* send to snooping drivers */
+    q2SDrivers(dp, isblob, dev, name, mp, root);
+
+    /* set message content if anyone cares else forget it */
+    if (mp->count == 0)
+        freeMsg(mp);
+    else if (!mp->rp)
+        setMsgXMLEle(mp, root);
 
     return (shutany ? -1 : 0);
 }
 
+/* read more from the given chained server link, hand each message to the
+ * remote driver of its device. if the link fails, reconnect later.
+ * return 0 if ok else -1 if had to shut down anything.
+ */
+static int readFromLink(LinkInfo *lk)
+{
+    char buf[MAXRBUF];
+    char *bp = buf;
+    int shutany = 0;
+    ssize_t nr, np;
+    char err[1024];
+    XMLEle *root;
+    Msg *mp;
+
+    /* read link, BLOB payloads straight into their message */
+    if (lk->raw.mp)
+        nr = read(lk->s, lk->raw.mp->rp + lk->raw.got, lk->raw.mp->rl - lk->raw.got);
+    else
+        nr = read(lk->s, buf, sizeof(buf));
+    if (nr <= 0)
+    {
+        if (nr < 0)
+            fprintf(stderr, "%s: Link %s:%d: read %s\n", indi_tstamp(NULL), lk->host, lk->port, strerror(errno));
+        else
+            fprintf(stderr, "%s: Link %s:%d: read EOF\n", indi_tstamp(NULL), lk->host, lk->port);
+        closeLink(lk);
+        return (-1);
+    }
+    if (lk->raw.mp)
+    {
+        lk->raw.got += nr;
+        nr = 0;
+    }
+
+    /* process XML chunk */
+    np = nr;
+    while ((root = nextMsg(lk->lp, &lk->raw, &bp, &np, &mp, err)) != NULL)
+    {
+        DvrInfo *dp = linkDvr(lk, findXMLAttValu(root, "device"));
+
+        if (!dp)
+        {
+            if (verbose > 1)
+                fprintf(stderr, "%s: Link %s:%d: no driver for <%s device='%s'>\n", indi_tstamp(NULL), lk->host,
+                        lk->port, tagXMLEle(root), findXMLAttValu(root, "device"));
+            if (mp)
+                freeMsg(mp);
+        }
+        else if (handleDvrMsg(dp, root, mp) < 0)
+            shutany++;
+        if (!mp)
+            delXMLEle(root);
+    }
+
+    if (err[0])
+    {
+        char *ts = indi_tstamp(NULL);
+        fprintf(stderr, "%s: Link %s:%d: XML error: %s\n", ts, lk->host, lk->port, err);
+        fprintf(stderr, "%s: Link %s:%d: XML read: %.*s\n", ts, lk->host, lk->port, (int)nr, buf);
+        closeLink(lk);
+        return (-1);
+    }
+
+    return (shutany ? -1 : 0);
+}
+
+/* return the remote driver on lk serving dev. messages without device, and
+ * those of devices nobody asked for after a getProperties w/o device, go to
+ * the first driver of the link, which then serves those devices too.
+ * return NULL if none.
+ */
+static DvrInfo *linkDvr(LinkInfo *lk, const char *dev)
+{
+    DvrInfo *first = NULL;
+    Route *rp      = dev[0] ? findRoute(dev, "", 0) : NULL;
+    int i;
+
+    if (rp)
+    {
+        for (i = 0; i < rp->drivers.n; i++)
+        {
+            DvrInfo *dp = &dvrinfo[rp->drivers.ids[i]];
+            if (dp->active && dp->pid == REMOTEDVR && &linkinfo[dp->link] == lk)
+                return (dp);
+        }
+    }
+
+    if (dev[0] && !lk->allprops)
+        return (NULL);
+
+    for (i = 0; i < ndvrinfo && !first; i++)
+        if (dvrinfo[i].active && dvrinfo[i].pid == REMOTEDVR && &linkinfo[dvrinfo[i].link] == lk)
+            first = &dvrinfo[i];
+
+    return (first);
+}
+
 /* read more from the given driver stderr, add prefix and send to our stderr.
  * return 0 if ok else -1 if had to restart.
  */
@@ -1442,6 +2212,7 @@ static void shutdownClient(ClInfo *cp)
     close(cp->s);
 
     /* free memory */
+    rmClRoutes(cp);
     delLilXML(cp->lp);
     free(cp->props);
 
@@ -1456,6 +2227,8 @@ static void shutdownClient(ClInfo *cp)
 
     if (verbose > 0)
         fprintf(stderr, "%s: Client %d: shut down complete - bye!\n", indi_tstamp(NULL), cp->s);
+    if (verbose > 1)
+        fprintf(stderr, "%s: %d routes in use\n", indi_tstamp(NULL), nroutes);
 #ifdef OSX_EMBEDED_MODE
     int active = 0;
     for (int i = 0; i < nclinfo; i++)
@@ -1470,35 +2243,18 @@ static void shutdownClient(ClInfo *cp)
 static void shutdownDvr(DvrInfo *dp, int restart)
 {
     Msg *mp;
-    int i=0;
-
-    // Tell client driver is dead.
-    for (i = 0; i < dp->ndev; i++)
-    {
-        /* Inform clients that this driver is dead */
-        XMLEle *root = addXMLEle(NULL, "delProperty");
-        addXMLAtt(root, "device", dp->dev[i]);
-
-        prXMLEle(stderr, root, 0);
-        Msg *mp = newMsg();
-
-        q2Clients(NULL, 0, dp->dev[i], NULL, mp, root);
-        if (mp->count > 0)
-            setMsgXMLEle(mp, root);
-        else
-            freeMsg(mp);
-        delXMLEle(root);
-    }
 
     /* make sure it's dead, reclaim resources */
     if (dp->pid == REMOTEDVR)
     {
-        /* socket connection */
-        shutdown(dp->wfd, SHUT_RDWR);
-        close(dp->wfd); /* same as rfd */
+        /* devices of a link waiting to reconnect are gone already */
+        if (linkinfo[dp->link].s >= 0 && !linkinfo[dp->link].connecting)
+            delDvrDevices(dp);
     }
     else
     {
+        delDvrDevices(dp);
+
         /* local pipe connection */
         kill(dp->pid, SIGKILL); /* we've insured there are no zombies */
         close(dp->wfd);
@@ -1512,14 +2268,23 @@ static void shutdownDvr(DvrInfo *dp, int restart)
 #endif
 
     /* free memory */
+    rmDvrRoutes(dp);
     free(dp->sprops);
     free(dp->dev);
-    delLilXML(dp->lp);
 
     /* ok now to recycle */
     dp->active = 0;
     dp->ndev   = 0;
 
+    if (dp->pid == REMOTEDVR)
+    {
+        /* the queue and parser belong to the link */
+        releaseLink(&linkinfo[dp->link]);
+        return;
+    }
+    delLilXML(dp->lp);
+    dropRaw(&dp->raw);
+
     /* decrement and possibly free any unsent messages for this client */
     while ((mp = (Msg *)popFQ(dp->msgq)) != NULL)
         if (--mp->count == 0)
@@ -1545,52 +2310,95 @@ static void shutdownDvr(DvrInfo *dp, int restart)
     }
 }
 
+/* tell clients the devices of dp are gone */
+static void delDvrDevices(DvrInfo *dp)
+{
+    int i;
+
+    for (i = 0; i < dp->ndev; i++)
+    {
+        /* Inform clients that this driver is dead */
+        XMLEle *root = addXMLEle(NULL, "delProperty");
+        addXMLAtt(root, "device", dp->dev[i]);
+
+        prXMLEle(stderr, root, 0);
+        Msg *mp = newMsg();
+
+        q2Clients(NULL, 0, dp->dev[i], "", mp, root);
+        if (mp->count > 0)
+            setMsgXMLEle(mp, root);
+        else
+            freeMsg(mp);
+        delXMLEle(root);
+    }
+}
+
+/* put Msg mp on queue of driver dp. remote drivers share the queue of their
+ * link, which takes each message once, and only while connected: the chained
+ * server is asked for everything again when it reconnects.
+ * return 1 if queued else 0.
+ */
+static int q2Dvr(DvrInfo *dp, Msg *mp)
+{
+    if (dp->pid == REMOTEDVR)
+    {
+        LinkInfo *lk = &linkinfo[dp->link];
+        int n        = nFQ(lk->msgq);
+
+        if (lk->s < 0 || (n > 0 && peekiFQ(lk->msgq, n - 1) == mp))
+            return (0);
+    }
+
+    mp->count++;
+    pushFQ(dp->msgq, mp);
+    return (1);
+}
+
 /* put Msg mp on queue of each driver responsible for dev, or all drivers
  * if dev not specified.
  */
 static void q2RDrivers(const char *dev, Msg *mp, XMLEle *root)
 {
+    static IdList rids;
     DvrInfo *dp;
     char *roottag = tagXMLEle(root);
+    Route *rp     = NULL;
+    int i, n;
 
-    char lastRemoteHost[MAXSBUF];
-    int lastRemotePort = -1;
+    /* only drivers known to support dev, all of them if dev not specified */
+    if (dev[0])
+    {
+        rp = findRoute(dev, "", 0);
+        if (!rp)
+            return;
+        mergeIds(&rids, &rp->drivers, NULL, NULL);
+    }
+    n = dev[0] ? rids.n : ndvrinfo;
 
     /* queue message to each interested driver.
-     * N.B. don't send generic getProps to more than one remote driver,
-     *   otherwise they all fan out and we get multiple responses back.
+     * N.B. remote drivers on one chained server share its link, which gets
+     *   the message once, so a generic getProps does not fan out there more
+     *   than once.
      */
-    for (dp = dvrinfo; dp < &dvrinfo[ndvrinfo]; dp++)
+    for (i = 0; i < n; i++)
     {
+        dp           = &dvrinfo[dev[0] ? rids.ids[i] : i];
         int isRemote = (dp->pid == REMOTEDVR);
 
         if (dp->active == 0)
             continue;
 
-        /* driver known to not support this dev */
-        if (dev[0] && isDeviceInDriver(dev, dp) == 0)
-            continue;
-
-        /* Only send message to each *unique* remote driver at a particular host:port
-         * Since it will be propogated to all other devices there */
-        if (!dev[0] && isRemote && !strcmp(lastRemoteHost, dp->host) && lastRemotePort == dp->port)
-            continue;
-
         /* JM 2016-10-30: Only send enableBLOB to remote drivers */
         if (isRemote == 0 && !strcmp(roottag, "enableBLOB"))
             continue;
 
-        /* Retain last remote driver data so that we do not send the same info again to a driver
-         * residing on the same host:port */
-        if (isRemote)
-        {
-            strncpy(lastRemoteHost, dp->host, MAXSBUF);
-            lastRemotePort = dp->port;
-        }
+        /* the chained server now sends all its devices, also after reconnecting */
+        if (isRemote && !dev[0] && !strcmp(roottag, "getProperties"))
+            linkinfo[dp->link].allprops = 1;
 
         /* ok: queue message to this driver */
-        mp->count++;
-        pushFQ(dp->msgq, mp);
+        if (!q2Dvr(dp, mp))
+            continue;
         if (verbose > 1)
         {
             fprintf(stderr, "%s: Driver %s: queuing responsible for <%s device='%s' name='%s'>\n", indi_tstamp(NULL),
@@ -1604,10 +2412,18 @@ static void q2RDrivers(const char *dev, Msg *mp, XMLEle *root)
  */
 static void q2SDrivers(DvrInfo *me, int isblob, const char *dev, const char *name, Msg *mp, XMLEle *root)
 {
+    static IdList sids;
     DvrInfo *dp = NULL;
+    Route *drp  = findRoute(dev, "", 0);
+    Route *prp  = name[0] ? findRoute(dev, name, 0) : NULL;
+    int i;
 
-    for (dp = dvrinfo; dp < &dvrinfo[ndvrinfo]; dp++)
+    /* only drivers snooping the whole device or this property */
+    mergeIds(&sids, drp ? &drp->snoopers : NULL, prp ? &prp->snoopers : NULL, NULL);
+
+    for (i = 0; i < sids.n; i++)
     {
+        dp = &dvrinfo[sids.ids[i]];
         if (dp->active == 0)
             continue;
 
@@ -1627,8 +2443,8 @@ static void q2SDrivers(DvrInfo *me, int isblob, const char *dev, const char *nam
         }
 
         /* ok: queue message to this device */
-        mp->count++;
-        pushFQ(dp->msgq, mp);
+        if (!q2Dvr(dp, mp))
+            continue;
         if (verbose > 1)
         {
             fprintf(stderr, "%s: Driver %s: queuing snooped <%s device='%s' name='%s'>\n", indi_tstamp(NULL), dp->name,
@@ -1664,6 +2480,8 @@ static void addSDevice(DvrInfo *dp, const char *dev, const char *name)
 
     sp->blob = B_NEVER;
 
+    addId(&findRoute(sp->dev, sp->name, 1)->snoopers, dp - dvrinfo);
+
     if (verbose)
         fprintf(stderr, "%s: Driver %s: snooping on %s.%s\n", indi_tstamp(NULL), dp->name, dev, name);
 }
@@ -1690,13 +2508,27 @@ static Property *findSDevice(DvrInfo *dp, const char *dev, const char *name)
  */
 static int q2Clients(ClInfo *notme, int isblob, const char *dev, const char *name, Msg *mp, XMLEle *root)
 {
+    static IdList cids;
     int shutany = 0;
     ClInfo *cp;
-    int ql, i = 0;
+    int ql, i = 0, k, n;
+
+    /* candidates: clients that want everything or this device or this property.
+     * all clients may be interested if dev is not specified.
+     */
+    if (dev[0])
+    {
+        Route *drp = findRoute(dev, "", 0);
+        Route *prp = name[0] ? findRoute(dev, name, 0) : NULL;
+        mergeIds(&cids, &allClients, drp ? &drp->clients : NULL, prp ? &prp->clients : NULL);
+    }
+    n = dev[0] ? cids.n : nclinfo;
 
     /* queue message to each interested client */
-    for (cp = clinfo; cp < &clinfo[nclinfo]; cp++)
+    for (k = 0; k < n; k++)
     {
+        cp = &clinfo[dev[0] ? cids.ids[k] : k];
+
         /* cp in use? notme? want this dev/name? blob? */
         if (!cp->active || cp == notme)
             continue;
@@ -1850,6 +2682,7 @@ static int msgQSize(FQ *q)
         l += sizeof(Msg);
         if (mp->cp != mp->buf)
             l += mp->cl;
+        l += mp->rl + mp->sl;
     }
 
     return (l);
@@ -1859,13 +2692,11 @@ static int msgQSize(FQ *q)
  */
 static void setMsgXMLEle(Msg *mp, XMLEle *root)
 {
-    /* want cl to only count content, but need room for final \0 */
-    mp->cl = sprlXMLEle(root, 0);
-    if (mp->cl < sizeof(mp->buf))
-        mp->cp = mp->buf;
-    else
-        mp->cp = malloc(mp->cl + 1);
-    sprXMLEle(mp->cp, root, 0);
+    int cl;
+
+    /* one pass, into buf unless the message outgrows it */
+    mp->cp = sprmXMLEle(root, 0, mp->buf, sizeof(mp->buf), &cl);
+    mp->cl = cl;
 }
 
 /* save str as content in Msg mp.
@@ -1881,11 +2712,203 @@ static void setMsgStr(Msg *mp, char *str)
     strcpy(mp->cp, str);
 }
 
+/* make the base64 content of raw BLOB message mp from its header and
+ * payloads, once.
+ */
+static void setMsgBase64(Msg *mp)
+{
+    XMLEle *root = mp->ep;
+    unsigned char *pp;
+    XMLEle *ep;
+    size_t pl;
+
+    /* the header was checked by nextMsg() */
+    rawBLOBLen(root, &pl);
+    pp = (unsigned char *)mp->rp + mp->rl - pl;
+
+    for (ep = nextXMLEle(root, 1); ep; ep = nextXMLEle(root, 0))
+    {
+        char *enc, len[32];
+        size_t n;
+
+        if (strcmp(tagXMLEle(ep), "oneBLOB") || strcmp(findXMLAttValu(ep, "encoding"), "raw"))
+            continue;
+
+        rawBLOBEnclen(ep, &n);
+        enc = malloc(4 * ((n + 2) / 3) + 1);
+        if (!enc)
+        {
+            fprintf(stderr, "%s: no memory to encode %zu BLOB bytes\n", indi_tstamp(NULL), n);
+            Bye();
+        }
+        enc[to64frombits((unsigned char *)enc, pp, n)] = '\0';
+        pp += n;
+
+        editXMLEle(ep, enc);
+        snprintf(len, sizeof(len), "%zu", strlen(enc));
+        editXMLAtt(findXMLAtt(ep, "enclen"), len);
+        rmXMLAtt(ep, "encoding");
+        free(enc);
+    }
+
+    setMsgXMLEle(mp, root);
+    delXMLEle(root);
+    mp->ep = NULL;
+}
+
+/* make the shared content of raw BLOB message mp, whose header of hl bytes
+ * and payloads are in its segment: each raw oneBLOB becomes encoding='shm'
+ * with the offset of its payload in the segment.
+ */
+static void setMsgShared(Msg *mp, unsigned long hl)
+{
+    XMLEle *root = mp->ep;
+    unsigned long off = hl;
+    XMLEle *ep;
+    char buf[32];
+    size_t n;
+
+    for (ep = nextXMLEle(root, 1); ep; ep = nextXMLEle(root, 0))
+    {
+        if (strcmp(tagXMLEle(ep), "oneBLOB") || strcmp(findXMLAttValu(ep, "encoding"), "raw"))
+            continue;
+        editXMLAtt(findXMLAtt(ep, "encoding"), "shm");
+        snprintf(buf, sizeof(buf), "%lu", off);
+        addXMLAtt(ep, "offset", buf);
+        rawBLOBEnclen(ep, &n);
+        off += n;
+    }
+
+    mp->sp = malloc(sprlXMLEle(root, 0) + 1);
+    if (mp->sp)
+        mp->sl = sprXMLEle(mp->sp, root, 0);
+
+    /* back to the raw header */
+    for (ep = nextXMLEle(root, 1); ep; ep = nextXMLEle(root, 0))
+    {
+        if (strcmp(tagXMLEle(ep), "oneBLOB") || strcmp(findXMLAttValu(ep, "encoding"), "shm"))
+            continue;
+        editXMLAtt(findXMLAtt(ep, "encoding"), "raw");
+        rmXMLAtt(ep, "offset");
+    }
+}
+
+/* return 1 if any client takes BLOBs in shared memory, else 0 */
+static int anyShmClient()
+{
+    int i;
+
+    for (i = 0; i < nclinfo; i++)
+        if (clinfo[i].active && clinfo[i].rawblobs == 2)
+            return (1);
+
+    return (0);
+}
+
+/* return a new shared memory segment of size bytes mapped for writing, with
+ * its descriptor in *fdp, else NULL if not possible here.
+ */
+static char *newSegment(unsigned long size, int *fdp)
+{
+#ifdef MFD_CLOEXEC
+    char *p;
+    int fd = memfd_create("indiserver-blob", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+
+    if (fd < 0)
+    {
+        fprintf(stderr, "%s: memfd_create: %s\n", indi_tstamp(NULL), strerror(errno));
+        return (NULL);
+    }
+    if (ftruncate(fd, size) < 0)
+    {
+        fprintf(stderr, "%s: ftruncate %lu: %s\n", indi_tstamp(NULL), size, strerror(errno));
+        close(fd);
+        return (NULL);
+    }
+    /* readers can not be cut short */
+    if (fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW) < 0)
+    {
+        fprintf(stderr, "%s: memfd seal: %s\n", indi_tstamp(NULL), strerror(errno));
+        close(fd);
+        return (NULL);
+    }
+
+    p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED)
+    {
+        fprintf(stderr, "%s: mmap %lu: %s\n", indi_tstamp(NULL), size, strerror(errno));
+        close(fd);
+        return (NULL);
+    }
+
+    *fdp = fd;
+    return (p);
+#else
+    (void)size;
+    (void)fdp;
+    return (NULL);
+#endif
+}
+
+/* make the segment of raw BLOB message mp, now filled, read-only for good:
+ * replace our writable mapping, as the write seal requires, by a private
+ * read-only one, which does not count as writable, then seal it. if that
+ * fails mp is only sent raw.
+ */
+static void sealSegment(Msg *mp)
+{
+#ifdef MFD_CLOEXEC
+    char *p = mmap(NULL, mp->rl + 1, PROT_READ, MAP_PRIVATE, mp->fd, 0);
+
+    if (p == MAP_FAILED)
+        fprintf(stderr, "%s: mmap %lu: %s\n", indi_tstamp(NULL), mp->rl + 1, strerror(errno));
+    else
+    {
+        munmap(mp->rp, mp->rl + 1);
+        mp->rp = p;
+        if (fcntl(mp->fd, F_ADD_SEALS, F_SEAL_WRITE | F_SEAL_SEAL) == 0)
+            return;
+        fprintf(stderr, "%s: memfd seal: %s\n", indi_tstamp(NULL), strerror(errno));
+    }
+
+    free(mp->sp);
+    mp->sp = NULL;
+#else
+    (void)mp;
+#endif
+}
+
+/* return the content of mp in the given form, as ClInfo.rawblobs, with its
+ * length in *lenp.
+ */
+static const char *msgContent(Msg *mp, int form, unsigned long *lenp)
+{
+    if (form == 2 && mp->sp)
+    {
+        *lenp = mp->sl;
+        return (mp->sp);
+    }
+
+    if (form && mp->rp)
+    {
+        *lenp = mp->rl;
+        return (mp->rp);
+    }
+
+    if (mp->ep)
+        setMsgBase64(mp);
+    *lenp = mp->cl;
+    return (mp->cp);
+}
+
 /* return pointer to one new nulled Msg
  */
 static Msg *newMsg(void)
 {
-    return ((Msg *)calloc(1, sizeof(Msg)));
+    Msg *mp = (Msg *)calloc(1, sizeof(Msg));
+
+    mp->fd = -1;
+    return (mp);
 }
 
 /* free Msg mp and everything it contains */
@@ -1893,6 +2916,16 @@ static void freeMsg(Msg *mp)
 {
     if (mp->cp && mp->cp != mp->buf)
         free(mp->cp);
+    if (mp->ep)
+        delXMLEle(mp->ep);
+    if (mp->fd >= 0)
+    {
+        munmap(mp->rp, mp->rl + 1);
+        close(mp->fd);
+    }
+    else
+        free(mp->rp);
+    free(mp->sp);
     free(mp);
 }
 
@@ -1905,16 +2938,26 @@ static void freeMsg(Msg *mp)
 static int sendClientMsg(ClInfo *cp)
 {
     ssize_t nsend, nw;
+    const char *content;
+    unsigned long cl;
     Msg *mp;
 
-    /* get current message */
+    /* get current message, its form is chosen as it starts going out */
     mp = (Msg *)peekFQ(cp->msgq);
+    if (cp->nsent == 0)
+        cp->sendraw = (cp->rawblobs == 2 && !mp->sp) ? 1 : cp->rawblobs;
+    content = msgContent(mp, cp->sendraw, &cl);
 
-    /* send next chunk, never more than MAXWSIZ to reduce blocking */
-    nsend = mp->cl - cp->nsent;
+    /* send next chunk, never more than MAXWSIZ to reduce blocking. the
+     * segment of a shared message goes along with its first bytes.
+     */
+    nsend = cl - cp->nsent;
     if (nsend > MAXWSIZ)
         nsend = MAXWSIZ;
-    nw = write(cp->s, &mp->cp[cp->nsent], nsend);
+    if (cp->sendraw == 2 && cp->nsent == 0)
+        nw = sendFd(cp->s, content, nsend, mp->fd);
+    else
+        nw = write(cp->s, &content[cp->nsent], nsend);
 
     /* shut down if trouble */
     if (nw <= 0)
@@ -1931,18 +2974,18 @@ static int sendClientMsg(ClInfo *cp)
     if (verbose > 2)
     {
         fprintf(stderr, "%s: Client %d: sending msg copy %d nq %d:\n%.*s\n", indi_tstamp(NULL), cp->s, mp->count,
-                nFQ(cp->msgq), (int)nw, &mp->cp[cp->nsent]);
+                nFQ(cp->msgq), (int)nw, &content[cp->nsent]);
     }
     else if (verbose > 1)
     {
-        fprintf(stderr, "%s: Client %d: sending %.50s\n", indi_tstamp(NULL), cp->s, &mp->cp[cp->nsent]);
+        fprintf(stderr, "%s: Client %d: sending %.50s\n", indi_tstamp(NULL), cp->s, &content[cp->nsent]);
     }
 
     /* update amount sent. when complete: free message if we are the last
      * to use it and pop from our queue.
      */
     cp->nsent += nw;
-    if (cp->nsent == mp->cl)
+    if (cp->nsent == cl)
     {
         if (--mp->count == 0)
             freeMsg(mp);
@@ -1953,6 +2996,35 @@ static int sendClientMsg(ClInfo *cp)
     return (0);
 }
 
+/* write len bytes of buf to socket s with descriptor fd attached.
+ * return as write(2).
+ */
+static ssize_t sendFd(int s, const char *buf, size_t len, int fd)
+{
+    char cbuf[CMSG_SPACE(sizeof(int))];
+    struct msghdr msg;
+    struct cmsghdr *cmsg;
+    struct iovec iov;
+
+    iov.iov_base = (void *)buf;
+    iov.iov_len  = len;
+
+    memset(&msg, 0, sizeof(msg));
+    memset(cbuf, 0, sizeof(cbuf));
+    msg.msg_iov        = &iov;
+    msg.msg_iovlen     = 1;
+    msg.msg_control    = cbuf;
+    msg.msg_controllen = sizeof(cbuf);
+
+    cmsg             = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type  = SCM_RIGHTS;
+    cmsg->cmsg_len   = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+
+    return (sendmsg(s, &msg, 0));
+}
+
 /* write the next chunk of the current message in the queue to the given
  * driver. pop message from queue when complete and free the message if we are
  * the last one to use it. restart this driver if touble.
@@ -1962,16 +3034,19 @@ static int sendClientMsg(ClInfo *cp)
 static int sendDriverMsg(DvrInfo *dp)
 {
     ssize_t nsend, nw;
+    const char *content;
+    unsigned long cl;
     Msg *mp;
 
     /* get current message */
-    mp = (Msg *)peekFQ(dp->msgq);
+    mp      = (Msg *)peekFQ(dp->msgq);
+    content = msgContent(mp, 0, &cl);
 
     /* send next chunk, never more than MAXWSIZ to reduce blocking */
-    nsend = mp->cl - dp->nsent;
+    nsend = cl - dp->nsent;
     if (nsend > MAXWSIZ)
         nsend = MAXWSIZ;
-    nw = write(dp->wfd, &mp->cp[dp->nsent], nsend);
+    nw = write(dp->wfd, &content[dp->nsent], nsend);
 
     /* restart if trouble */
     if (nw <= 0)
@@ -1988,18 +3063,18 @@ static int sendDriverMsg(DvrInfo *dp)
     if (verbose > 2)
     {
         fprintf(stderr, "%s: Driver %s: sending msg copy %d nq %d:\n%.*s\n", indi_tstamp(NULL), dp->name, mp->count,
-                nFQ(dp->msgq), (int)nw, &mp->cp[dp->nsent]);
+                nFQ(dp->msgq), (int)nw, &content[dp->nsent]);
     }
     else if (verbose > 1)
     {
-        fprintf(stderr, "%s: Driver %s: sending %.50s\n", indi_tstamp(NULL), dp->name, &mp->cp[dp->nsent]);
+        fprintf(stderr, "%s: Driver %s: sending %.50s\n", indi_tstamp(NULL), dp->name, &content[dp->nsent]);
     }
 
     /* update amount sent. when complete: free message if we are the last
      * to use it and pop from our queue.
      */
     dp->nsent += nw;
-    if (dp->nsent == mp->cl)
+    if (dp->nsent == cl)
     {
         if (--mp->count == 0)
             freeMsg(mp);
@@ -2010,6 +3085,66 @@ static int sendDriverMsg(DvrInfo *dp)
     return (0);
 }
 
+/* write the next chunk of the current message in the queue to the given
+ * chained server link. pop message from queue when complete and free the
+ * message if we are the last one to use it. reconnect later if trouble.
+ * N.B. we assume we will never be called with lk->msgq empty.
+ * return 0 if ok else -1 if had to close the link.
+ */
+static int sendLinkMsg(LinkInfo *lk)
+{
+    ssize_t nsend, nw;
+    const char *content;
+    unsigned long cl;
+    Msg *mp;
+
+    /* get current message */
+    mp      = (Msg *)peekFQ(lk->msgq);
+    content = msgContent(mp, 0, &cl);
+
+    /* send next chunk, never more than MAXWSIZ to reduce blocking */
+    nsend = cl - lk->nsent;
+    if (nsend > MAXWSIZ)
+        nsend = MAXWSIZ;
+    nw = write(lk->s, &content[lk->nsent], nsend);
+
+    /* reconnect if trouble */
+    if (nw <= 0)
+    {
+        if (nw == 0)
+            fprintf(stderr, "%s: Link %s:%d: write returned 0\n", indi_tstamp(NULL), lk->host, lk->port);
+        else
+            fprintf(stderr, "%s: Link %s:%d: write: %s\n", indi_tstamp(NULL), lk->host, lk->port, strerror(errno));
+        closeLink(lk);
+        return (-1);
+    }
+
+    /* trace */
+    if (verbose > 2)
+    {
+        fprintf(stderr, "%s: Link %s:%d: sending msg copy %d nq %d:\n%.*s\n", indi_tstamp(NULL), lk->host, lk->port,
+                mp->count, nFQ(lk->msgq), (int)nw, &content[lk->nsent]);
+    }
+    else if (verbose > 1)
+    {
+        fprintf(stderr, "%s: Link %s:%d: sending %.50s\n", indi_tstamp(NULL), lk->host, lk->port, &content[lk->nsent]);
+    }
+
+    /* update amount sent. when complete: free message if we are the last
+     * to use it and pop from our queue.
+     */
+    lk->nsent += nw;
+    if (lk->nsent == cl)
+    {
+        if (--mp->count == 0)
+            freeMsg(mp);
+        popFQ(lk->msgq);
+        lk->nsent = 0;
+    }
+
+    return (0);
+}
+
 /* return 0 if cp may be interested in dev/name else -1
  */
 static int findClDevice(ClInfo *cp, const char *dev, const char *name)
@@ -2063,20 +3198,220 @@ static void addClDevice(ClInfo *cp, const char *dev, const char *name, int isblo
     strncpy(pp->dev, dev, MAXINDIDEVICE);
     strncpy(pp->name, name, MAXINDINAME);
     pp->blob = B_NEVER;
+
+    addId(&findRoute(pp->dev, pp->name, 1)->clients, cp - clinfo);
+}
+
+/* return the hash bucket of dev/name.
+ */
+static unsigned int routeHash(const char *dev, const char *name)
+{
+    unsigned int h = 2166136261u; /* FNV-1a over dev, NUL, name */
+    const char *c;
+
+    for (c = dev; *c; c++)
+        h = (h ^ (unsigned char)*c) * 16777619u;
+    h *= 16777619u;
+    for (c = name; *c; c++)
+        h = (h ^ (unsigned char)*c) * 16777619u;
+    return (h & (NROUTES - 1));
+}
+
+/* return the route of dev/name, or NULL if none and not create.
+ */
+static Route *findRoute(const char *dev, const char *name, int create)
+{
+    unsigned int h = routeHash(dev, name);
+    Route *rp;
+
+    for (rp = routes[h]; rp; rp = rp->next)
+        if (!strcmp(rp->dev, dev) && !strcmp(rp->name, name))
+            return (rp);
+
+    if (!create)
+        return (NULL);
+
+    rp = (Route *)calloc(1, sizeof(Route));
+    if (!rp)
+    {
+        fprintf(stderr, "no memory for new route\n");
+        Bye();
+    }
+    strncpy(rp->dev, dev, MAXINDIDEVICE - 1);
+    strncpy(rp->name, name, MAXINDINAME - 1);
+    rp->next  = routes[h];
+    routes[h] = rp;
+    nroutes++;
+    return (rp);
+}
+
+/* unlink and free rp once nobody subscribes to it anymore.
+ */
+static void dropRoute(Route *rp)
+{
+    Route **rpp;
+
+    if (rp->clients.n > 0 || rp->snoopers.n > 0 || rp->drivers.n > 0)
+        return;
+
+    for (rpp = &routes[routeHash(rp->dev, rp->name)]; *rpp; rpp = &(*rpp)->next)
+    {
+        if (*rpp == rp)
+        {
+            *rpp = rp->next;
+            break;
+        }
+    }
+
+    free(rp->clients.ids);
+    free(rp->snoopers.ids);
+    free(rp->drivers.ids);
+    free(rp);
+    nroutes--;
+}
+
+/* add id to lp if not already there.
+ */
+static void addId(IdList *lp, int id)
+{
+    int i;
+
+    for (i = 0; i < lp->n; i++)
+        if (lp->ids[i] == id)
+            return;
+
+    if (lp->n == lp->max)
+    {
+        lp->max = lp->max ? 2 * lp->max : 4;
+        lp->ids = (int *)realloc(lp->ids, lp->max * sizeof(int));
+    }
+    lp->ids[lp->n++] = id;
+}
+
+/* remove id from lp if there.
+ */
+static void rmId(IdList *lp, int id)
+{
+    int i;
+
+    for (i = 0; i < lp->n; i++)
+    {
+        if (lp->ids[i] == id)
+        {
+            lp->ids[i] = lp->ids[--lp->n];
+            return;
+        }
+    }
+}
+
+static int cmpId(const void *p1, const void *p2)
+{
+    return (*(const int *)p1 - *(const int *)p2);
 }
 
-/* block to accept a new client arriving on lsocket.
+/* set out to the distinct ids of lists a, b and c, any of which may be NULL.
+ * out is a private copy so recipients may be shut down while walking it.
+ */
+static void mergeIds(IdList *out, IdList *a, IdList *b, IdList *c)
+{
+    IdList *in[3] = { a, b, c };
+    int i, j, n = 0;
+
+    out->n = 0;
+    for (i = 0; i < 3; i++)
+        if (in[i])
+            n += in[i]->n;
+
+    if (n > out->max)
+    {
+        out->max = n;
+        out->ids = (int *)realloc(out->ids, n * sizeof(int));
+    }
+
+    for (i = 0; i < 3; i++)
+        if (in[i] && in[i]->n > 0)
+        {
+            memcpy(out->ids + out->n, in[i]->ids, in[i]->n * sizeof(int));
+            out->n += in[i]->n;
+        }
+
+    /* one list is already distinct */
+    if ((a != NULL) + (b != NULL) + (c != NULL) < 2)
+        return;
+
+    qsort(out->ids, out->n, sizeof(int), cmpId);
+    for (i = 0, j = 0; i < out->n; i++)
+        if (j == 0 || out->ids[j - 1] != out->ids[i])
+            out->ids[j++] = out->ids[i];
+    out->n = j;
+}
+
+/* record that dp serves dev.
+ */
+static void addDvrRoute(DvrInfo *dp, const char *dev)
+{
+    addId(&findRoute(dev, "", 1)->drivers, dp - dvrinfo);
+}
+
+/* forget all routes of client cp.
+ */
+static void rmClRoutes(ClInfo *cp)
+{
+    int i, id = cp - clinfo;
+
+    if (cp->allprops)
+        rmId(&allClients, id);
+
+    for (i = 0; i < cp->nprops; i++)
+    {
+        Route *rp = findRoute(cp->props[i].dev, cp->props[i].name, 0);
+        if (rp)
+        {
+            rmId(&rp->clients, id);
+            dropRoute(rp);
+        }
+    }
+}
+
+/* forget all routes of driver dp.
+ */
+static void rmDvrRoutes(DvrInfo *dp)
+{
+    int i, id = dp - dvrinfo;
+
+    for (i = 0; i < dp->nsprops; i++)
+    {
+        Route *rp = findRoute(dp->sprops[i].dev, dp->sprops[i].name, 0);
+        if (rp)
+        {
+            rmId(&rp->snoopers, id);
+            dropRoute(rp);
+        }
+    }
+
+    for (i = 0; i < dp->ndev; i++)
+    {
+        Route *rp = findRoute(dp->dev[i], "", 0);
+        if (rp)
+        {
+            rmId(&rp->drivers, id);
+            dropRoute(rp);
+        }
+    }
+}
+
+/* block to accept a new client arriving on listen socket lfd.
  * return private nonblocking socket or exit.
  */
-static int newClSocket()
+static int newClSocket(int lfd)
 {
-    struct sockaddr_in cli_socket;
+    struct sockaddr_storage cli_socket;
     socklen_t cli_len;
     int cli_fd;
 
     /* get a private connection to new client */
     cli_len = sizeof(cli_socket);
-    cli_fd  = accept(lsocket, (struct sockaddr *)&cli_socket, &cli_len);
+    cli_fd  = accept(lfd, (struct sockaddr *)&cli_socket, &cli_len);
     if (cli_fd < 0)
     {
         fprintf(stderr, "accept: %s\n", strerror(errno));
@@ -2127,6 +3462,28 @@ static void crackBLOBHandling(const char *dev, const char *name, const char *ena
     }
 }
 
+/* give client cp a socket send buffer large enough for BLOBs, once, so each
+ * write moves more of them. the kernel may cap it.
+ */
+static void setBLOBSndBuf(ClInfo *cp)
+{
+    int size      = BLOBSNDBUF;
+    socklen_t len = sizeof(size);
+
+    if (cp->blobbuf)
+        return;
+    cp->blobbuf = 1;
+
+    if (setsockopt(cp->s, SOL_SOCKET, SO_SNDBUF, &size, sizeof(size)) < 0)
+    {
+        fprintf(stderr, "%s: Client %d: setsockopt SO_SNDBUF: %s\n", indi_tstamp(NULL), cp->s, strerror(errno));
+        return;
+    }
+
+    if (verbose > 0 && getsockopt(cp->s, SOL_SOCKET, SO_SNDBUF, &size, &len) == 0)
+        fprintf(stderr, "%s: Client %d: send buffer %d bytes for BLOBs\n", indi_tstamp(NULL), cp->s, size);
+}
+
 /* print key attributes and values of the given xml to stderr.
  */
 static void traceMsg(XMLEle *root)
@@ -2213,6 +3570,12 @@ static void logDMsg(XMLEle *root, const char *dev)
 /* log when then exit */
 static void Bye()
 {
+    struct stat st;
+
+    /* unless another server replaced our socket meanwhile */
+    if (usocket >= 0 && lstat(usockpath, &st) == 0 && st.st_dev == usockstat.st_dev &&
+            st.st_ino == usockstat.st_ino)
+        unlink(usockpath);
     fprintf(stderr, "%s: good bye\n", indi_tstamp(NULL));
     exit(1);
 }
@@ -23,12 +23,15 @@
 #include "basedevice.h"
 #include "locale_compat.h"
 
+#include <cctype>
 #include <cerrno>
 #include <fcntl.h>
+#include <cstdint>
 #include <cstdlib>
 #include <stdarg.h>
 #include <cstring>
 #include <algorithm>
+#include <deque>
 
 #ifdef _WINDOWS
 #include <WinSock2.h>
@@ -45,6 +48,9 @@
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/un.h>
 #define net_read read
 #define net_write write
 #define net_close close
@@ -120,6 +126,52 @@ bool INDI::BaseClient::connectServer()
     }
 #endif
 
+#ifndef _WINDOWS
+    // An absolute path names the Unix-domain socket of a local server
+    if (cServer[0] == '/')
+    {
+        if (!connectUnix())
+            return false;
+    }
+    else
+#endif
+    if (!connectTCP())
+        return false;
+
+#ifndef _WINDOWS
+    int pipefd[2];
+    int ret = socketpair(PF_UNIX, SOCK_STREAM, 0, pipefd);
+
+    if (ret < 0)
+    {
+        IDLog("notify pipe: %s\n", strerror(errno));
+        return false;
+    }
+
+    m_receiveFd = pipefd[0];
+    m_sendFd    = pipefd[1];
+#endif
+
+    sConnected = true;
+
+    /*int result = pthread_create(&listen_thread, nullptr, &INDI::BaseClient::listenHelper, this);
+
+    if (result != 0)
+    {
+        sConnected = false;
+        perror("thread");
+        return false;
+    }*/
+
+    listen_thread = new std::thread(listenHelper, this);
+
+    serverConnected();
+
+    return true;
+}
+
+bool INDI::BaseClient::connectTCP()
+{
     struct timeval ts;
     ts.tv_sec  = timeout_sec;
     ts.tv_usec = timeout_us;
@@ -160,7 +212,7 @@ bool INDI::BaseClient::connectServer()
     //set socket nonblocking flag
 #ifdef _WINDOWS
     u_long iMode = 0;
-    iResult = ioctlsocket(sockfd, FIONBIO, &iMode);
+    int iResult = ioctlsocket(sockfd, FIONBIO, &iMode);
     if (iResult != NO_ERROR)
     {
         IDLog("ioctlsocket failed with error: %ld\n", iResult);
@@ -236,37 +288,48 @@ bool INDI::BaseClient::connectServer()
     }
 #endif
 
+    return true;
+}
+
 #ifndef _WINDOWS
-    int pipefd[2];
-    ret = socketpair(PF_UNIX, SOCK_STREAM, 0, pipefd);
+bool INDI::BaseClient::connectUnix()
+{
+    struct sockaddr_un serv_addr;
 
-    if (ret < 0)
+    if (cServer.size() >= sizeof(serv_addr.sun_path))
     {
-        IDLog("notify pipe: %s\n", strerror(errno));
+        IDLog("Socket path too long: %s\n", cServer.c_str());
         return false;
     }
 
-    m_receiveFd = pipefd[0];
-    m_sendFd    = pipefd[1];
-#endif
+    memset(&serv_addr, 0, sizeof(serv_addr));
+    serv_addr.sun_family = AF_UNIX;
+    strncpy(serv_addr.sun_path, cServer.c_str(), sizeof(serv_addr.sun_path) - 1);
 
-    sConnected = true;
-
-    /*int result = pthread_create(&listen_thread, nullptr, &INDI::BaseClient::listenHelper, this);
-
-    if (result != 0)
+    if ((sockfd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0)
     {
-        sConnected = false;
-        perror("thread");
+        perror("socket");
         return false;
-    }*/
+    }
 
-    listen_thread = new std::thread(listenHelper, this);
+    // A local connect completes at once
+    if (::connect(sockfd, (struct sockaddr *)&serv_addr, sizeof(serv_addr)) < 0)
+    {
+        perror("connect");
+        net_close(sockfd);
+        return false;
+    }
 
-    serverConnected();
+    int flags = 0;
+    if ((flags = fcntl(sockfd, F_GETFL, 0)) < 0 || fcntl(sockfd, F_SETFL, flags | O_NONBLOCK) < 0)
+    {
+        net_close(sockfd);
+        return false;
+    }
 
     return true;
 }
+#endif
 
 bool INDI::BaseClient::disconnectServer()
 {
@@ -369,6 +432,143 @@ INDI::BaseDevice *INDI::BaseClient::getDevice(const char *deviceName)
     return nullptr;
 }
 
+// Largest raw BLOB payload accepted in one message
+static constexpr size_t MAX_RAW_BLOB_SIZE = static_cast<size_t>(1) << 30;
+
+// Parse a BLOB length or offset attribute. False unless it is a plain decimal number that fits a size_t.
+static bool parseBLOBLength(const char *text, size_t &length)
+{
+    // strtoull() would take leading blanks and a sign
+    if (!isdigit(static_cast<unsigned char>(text[0])))
+        return false;
+
+    char *end;
+    errno = 0;
+    unsigned long long value = strtoull(text, &end, 10);
+    if (errno != 0 || *end != '\0' || value > SIZE_MAX)
+        return false;
+
+    length = static_cast<size_t>(value);
+    return true;
+}
+
+// Total length of the raw BLOBs following root, 0 if none. False if an enclen is bad or they add up to more
+// than MAX_RAW_BLOB_SIZE.
+static bool rawBLOBSize(XMLEle *root, size_t &size)
+{
+    size = 0;
+
+    if (strcmp(tagXMLEle(root), "setBLOBVector"))
+        return true;
+
+    for (XMLEle *ep = nextXMLEle(root, 1); ep != nullptr; ep = nextXMLEle(root, 0))
+    {
+        if (strcmp(tagXMLEle(ep), "oneBLOB") || strcmp(findXMLAttValu(ep, "encoding"), "raw"))
+            continue;
+
+        size_t length;
+        if (!parseBLOBLength(findXMLAttValu(ep, "enclen"), length) || length > MAX_RAW_BLOB_SIZE - size)
+            return false;
+        size += length;
+    }
+
+    return true;
+}
+
+#ifndef _WINDOWS
+// True if root is a setBLOBVector with BLOBs in shared memory
+static bool hasSharedBLOBs(XMLEle *root)
+{
+    if (strcmp(tagXMLEle(root), "setBLOBVector"))
+        return false;
+
+    for (XMLEle *ep = nextXMLEle(root, 1); ep != nullptr; ep = nextXMLEle(root, 0))
+    {
+        if (!strcmp(tagXMLEle(ep), "oneBLOB") && !strcmp(findXMLAttValu(ep, "encoding"), "shm"))
+            return true;
+    }
+
+    return false;
+}
+
+// recv() that keeps the descriptors passed along, in order
+static ssize_t recvFds(int s, void *buf, size_t len, int flags, std::deque<int> &fds)
+{
+    char cbuf[CMSG_SPACE(4 * sizeof(int))];
+    struct iovec iov;
+    struct msghdr msg;
+
+    iov.iov_base = buf;
+    iov.iov_len  = len;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov        = &iov;
+    msg.msg_iovlen     = 1;
+    msg.msg_control    = cbuf;
+    msg.msg_controllen = sizeof(cbuf);
+
+    // Close on exec from the start where possible, a fork() in another thread must not leak them
+#ifdef MSG_CMSG_CLOEXEC
+    ssize_t n = recvmsg(s, &msg, flags | MSG_CMSG_CLOEXEC);
+#else
+    ssize_t n = recvmsg(s, &msg, flags);
+#endif
+    if (n < 0)
+        return n;
+
+    for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg))
+    {
+        if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS)
+            continue;
+
+        size_t count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        for (size_t i = 0; i < count; i++)
+        {
+            int fd;
+            memcpy(&fd, CMSG_DATA(cmsg) + i * sizeof(int), sizeof(int));
+#ifndef MSG_CMSG_CLOEXEC
+            fcntl(fd, F_SETFD, FD_CLOEXEC);
+#endif
+            fds.push_back(fd);
+        }
+    }
+
+    return n;
+}
+
+// Map the shared memory segment of root read-only, and close fd. Null if the segment does not hold its BLOBs.
+static std::shared_ptr<const unsigned char> mapSegment(int fd, XMLEle *root)
+{
+    struct stat st;
+    void *map = MAP_FAILED;
+
+    if (fstat(fd, &st) == 0 && st.st_size > 0)
+        map = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        return nullptr;
+
+    size_t size = st.st_size;
+    std::shared_ptr<const unsigned char> segment(static_cast<const unsigned char *>(map),
+            [size](const unsigned char * p)
+    {
+        munmap(const_cast<unsigned char *>(p), size);
+    });
+
+    for (XMLEle *ep = nextXMLEle(root, 1); ep != nullptr; ep = nextXMLEle(root, 0))
+    {
+        if (strcmp(tagXMLEle(ep), "oneBLOB") || strcmp(findXMLAttValu(ep, "encoding"), "shm"))
+            continue;
+
+        size_t offset, length;
+        if (!parseBLOBLength(findXMLAttValu(ep, "offset"), offset) ||
+                !parseBLOBLength(findXMLAttValu(ep, "enclen"), length) || offset > size || length > size - offset)
+            return nullptr;
+    }
+
+    return segment;
+}
+#endif
+
 void *INDI::BaseClient::listenHelper(void *context)
 {
     (static_cast<INDI::BaseClient *>(context))->listenINDI();
@@ -386,9 +586,45 @@ void INDI::BaseClient::listenINDI()
     int maxfd = 0;
 #endif
     fd_set rs;
-    XMLEle **nodes = nullptr;
     XMLEle *root = nullptr;
-    int inode = 0;
+    // setBLOBVector whose raw BLOBs are being read
+    XMLEle *rawRoot = nullptr;
+    std::vector<unsigned char> rawPayload;
+    size_t rawGot = 0;
+    bool badXML   = false;
+#ifdef _WINDOWS
+    const int flags = 0;
+#else
+    const int flags = MSG_DONTWAIT;
+    // Shared memory segments passed along with their messages, in order
+    std::deque<int> segmentFds;
+#endif
+
+    auto receive = [&](void *data, size_t size)
+    {
+#ifdef _WINDOWS
+        return recv(sockfd, static_cast<char *>(data), static_cast<int>(size), flags);
+#else
+        return recvFds(sockfd, data, size, flags, segmentFds);
+#endif
+    };
+
+    auto dispatch = [&](XMLEle * message, const unsigned char *payload,
+                        const std::shared_ptr<const unsigned char> &segment)
+    {
+        if (verbose)
+            prXMLEle(stderr, message, 0);
+
+        if ((err_code = dispatchCommand(message, msg, payload, segment)) < 0)
+        {
+            // Silenty ignore property duplication errors
+            if (err_code != INDI_PROPERTY_DUPLICATED)
+            {
+                IDLog("Dispatch command error(%d): %s\n", err_code, msg);
+                prXMLEle(stderr, message, 0);
+            }
+        }
+    };
 
     AutoCNumeric locale;
 
@@ -468,11 +704,13 @@ void INDI::BaseClient::listenINDI()
 
         if (n > 0 && FD_ISSET(sockfd, &rs))
         {
-#ifdef _WINDOWS
-            n = recv(sockfd, buffer, MAXINDIBUF, 0);
-#else
-            n = recv(sockfd, buffer, MAXINDIBUF, MSG_DONTWAIT);
-#endif
+            char *bp = buffer;
+
+            // Raw BLOB payloads are read in place
+            if (rawRoot != nullptr)
+                n = receive(rawPayload.data() + rawGot, rawPayload.size() - rawGot);
+            else
+                n = receive(buffer, MAXINDIBUF);
             if (n <= 0)
             {
                 if (n == 0)
@@ -484,43 +722,94 @@ void INDI::BaseClient::listenINDI()
                 else
                     continue;
             }
+            if (rawRoot != nullptr)
+            {
+                rawGot += n;
+                n = 0;
+            }
 
-            nodes = parseXMLChunk(lillp, buffer, n, msg);
-
-            if (!nodes)
+            while (true)
             {
-                if (msg[0])
+                // A message with raw BLOBs is complete once its payload is in
+                if (rawRoot != nullptr)
                 {
-                    IDLog("Bad XML from %s/%d: %s\n%s\n", cServer.c_str(), cPort, msg, buffer);
-                    return;
+                    size_t count = std::min(static_cast<size_t>(n), rawPayload.size() - rawGot);
+                    memcpy(rawPayload.data() + rawGot, bp, count);
+                    rawGot += count;
+                    bp += count;
+                    n -= count;
+                    if (rawGot < rawPayload.size())
+                        break;
+
+                    root    = rawRoot;
+                    rawRoot = nullptr;
+                    dispatch(root, rawPayload.data(), nullptr);
+                    delXMLEle(root);
+                    continue;
                 }
-                return;
-            }
-            root = nodes[inode];
-            while (root)
-            {
-                if (verbose)
-                    prXMLEle(stderr, root, 0);
 
-                if ((err_code = dispatchCommand(root, msg)) < 0)
+                int used = 0;
+                root     = parseXMLEle(lillp, bp, n, &used, msg);
+                bp += used;
+                n -= used;
+                if (root == nullptr)
                 {
-                    // Silenty ignore property duplication errors
-                    if (err_code != INDI_PROPERTY_DUPLICATED)
+                    if (msg[0] == '\0')
+                        break;
+                    IDLog("Bad XML from %s/%d: %s\n", cServer.c_str(), cPort, msg);
+                    badXML = true;
+                    break;
+                }
+
+                size_t rawSize;
+                if (!rawBLOBSize(root, rawSize))
+                {
+                    IDLog("Bad XML from %s/%d: bad raw BLOB enclen in %s.%s\n", cServer.c_str(), cPort,
+                          findXMLAttValu(root, "device"), findXMLAttValu(root, "name"));
+                    delXMLEle(root);
+                    badXML = true;
+                    break;
+                }
+                if (rawSize > 0)
+                {
+                    rawRoot = root;
+                    rawPayload.resize(rawSize);
+                    rawGot = 0;
+                    continue;
+                }
+
+                std::shared_ptr<const unsigned char> segment;
+#ifndef _WINDOWS
+                if (hasSharedBLOBs(root))
+                {
+                    if (segmentFds.empty())
+                        IDLog("Shared BLOB without segment from %s\n", cServer.c_str());
+                    else
                     {
-                        IDLog("Dispatch command error(%d): %s\n", err_code, msg);
-                        prXMLEle(stderr, root, 0);
+                        segment = mapSegment(segmentFds.front(), root);
+                        segmentFds.pop_front();
                     }
                 }
+#endif
 
-                delXMLEle(root); // not yet, delete and continue
-                inode++;
-                root = nodes[inode];
+                dispatch(root, nullptr, segment);
+                delXMLEle(root);
+            }
+
+            // The stream cannot be followed past bad XML
+            if (badXML)
+            {
+                net_close(sockfd);
+                break;
             }
-            free(nodes);
-            inode = 0;
         }
     }
 
+#ifndef _WINDOWS
+    for (int fd : segmentFds)
+        close(fd);
+#endif
+    delXMLEle(rawRoot);
     delLilXML(lillp);
 
     serverDisconnected((sConnected == false) ? 0 : -1);
@@ -530,7 +819,8 @@ void INDI::BaseClient::listenINDI()
     //pthread_exit(0);
 }
 
-int INDI::BaseClient::dispatchCommand(XMLEle *root, char *errmsg)
+int INDI::BaseClient::dispatchCommand(XMLEle *root, char *errmsg, const unsigned char *payload,
+                                      const std::shared_ptr<const unsigned char> &segment)
 {
     if (!strcmp(tagXMLEle(root), "message"))
         return messageCmd(root, errmsg);
@@ -559,7 +849,7 @@ int INDI::BaseClient::dispatchCommand(XMLEle *root, char *errmsg)
         if (!strcmp(tagXMLEle(root), "defBLOBVector"))
             return dp->buildProp(root, errmsg);
         else if (!strcmp(tagXMLEle(root), "setBLOBVector"))
-            return dp->setValue(root, errmsg);
+            return dp->setValue(root, errmsg, payload, segment);
 
         // Ignore everything else
         return 0;
@@ -585,7 +875,7 @@ int INDI::BaseClient::dispatchCommand(XMLEle *root, char *errmsg)
     else if (!strcmp(tagXMLEle(root), "setTextVector") || !strcmp(tagXMLEle(root), "setNumberVector") ||
              !strcmp(tagXMLEle(root), "setSwitchVector") || !strcmp(tagXMLEle(root), "setLightVector") ||
              !strcmp(tagXMLEle(root), "setBLOBVector"))
-        return dp->setValue(root, errmsg);
+        return dp->setValue(root, errmsg, payload, segment);
 
     return INDI_DISPATCH_ERROR;
 }
@@ -1054,10 +1344,11 @@ void INDI::BaseClient::setBLOBMode(BLOBHandling blobH, const char *dev, const ch
         bMode->blobMode = blobH;
     }
 
+    const char *encoding = sharedBLOBs ? " encoding='shm'" : rawBLOBs ? " encoding='raw'" : "";
     if (prop != nullptr)
-        snprintf(blobOpenTag, MAXRBUF, "<enableBLOB device='%s' name='%s'>", dev, prop);
+        snprintf(blobOpenTag, MAXRBUF, "<enableBLOB device='%s' name='%s'%s>", dev, prop, encoding);
     else
-        snprintf(blobOpenTag, MAXRBUF, "<enableBLOB device='%s'>", dev);
+        snprintf(blobOpenTag, MAXRBUF, "<enableBLOB device='%s'%s>", dev, encoding);
 
     switch (blobH)
     {
@@ -24,6 +24,7 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <memory>
 #include <set>
 
 #include <thread>
@@ -64,7 +65,8 @@ class INDI::BaseClient : public INDI::BaseMediator
         virtual ~BaseClient();
 
         /** \brief Set the server host name and port
-            \param hostname INDI server host name or IP address.
+            \param hostname INDI server host name or IP address, or the absolute path of the Unix-domain socket of
+            a local server started with -u, in which case port is unused.
             \param port INDI server port.
         */
         void setServer(const char *hostname, unsigned int port);
@@ -170,6 +172,30 @@ class INDI::BaseClient : public INDI::BaseMediator
          */
         BLOBHandling getBLOBMode(const char *dev, const char *prop = nullptr);
 
+        /**
+         * @brief setRawBLOBs Ask the server for BLOBs in raw binary form rather than base64 when it has them so,
+         * as from local drivers. It saves the server and the client the encoding and decoding, and a third of the
+         * traffic. Servers that do not know raw BLOBs keep sending base64, which is always understood.
+         * @param enable True to take raw BLOBs.
+         * @note The request goes along with setBLOBMode(), so call this first.
+         */
+        void setRawBLOBs(bool enable)
+        {
+            rawBLOBs = enable;
+        }
+
+        /**
+         * @brief setSharedBLOBs Ask the server for BLOBs in shared memory. Over the Unix-domain socket of a local
+         * server, BLOBs of local drivers are then mapped rather than sent: IBLOB::blob points into a read-only
+         * segment, which stays mapped until the next update of that BLOB. Elsewhere this is setRawBLOBs().
+         * @param enable True to take shared BLOBs.
+         * @note The request goes along with setBLOBMode(), so call this first.
+         */
+        void setSharedBLOBs(bool enable)
+        {
+            sharedBLOBs = enable;
+        }
+
         // Update
         static void *listenHelper(void *context);
 
@@ -235,8 +261,10 @@ class INDI::BaseClient : public INDI::BaseMediator
         }
 
     protected:
-        /** \brief Dispatch command received from INDI server to respective devices handled by the client */
-        int dispatchCommand(XMLEle *root, char *errmsg);
+        /** \brief Dispatch command received from INDI server to respective devices handled by the client.
+            payload holds the raw BLOBs following a setBLOBVector, if any, segment the shared memory it came with. */
+        int dispatchCommand(XMLEle *root, char *errmsg, const unsigned char *payload = nullptr,
+                            const std::shared_ptr<const unsigned char> &segment = nullptr);
 
         /** \brief Remove device */
         int deleteDevice(const char *devName, char *errmsg);
@@ -296,6 +324,11 @@ class INDI::BaseClient : public INDI::BaseMediator
         // Listen to INDI server and process incoming messages
         void listenINDI();
 
+        bool connectTCP();
+#ifndef _WINDOWS
+        bool connectUnix();
+#endif
+
         void sendString(const char *fmt, ...);
 
         std::vector<INDI::BaseDevice *> cDevices;
@@ -307,6 +340,8 @@ class INDI::BaseClient : public INDI::BaseMediator
         uint32_t cPort;
         bool sConnected;
         bool verbose;
+        bool rawBLOBs {false};
+        bool sharedBLOBs {false};
 
         // Parse & FILE buffers for IO
 
@@ -60,6 +60,8 @@ BaseDevice::BaseDevice()
 BaseDevice::~BaseDevice()
 {
     delLilXML(lp);
+    while (!sharedBLOBs.empty())
+        releaseBLOB(sharedBLOBs.begin()->first);
     while (!pAll.empty())
     {
         delete pAll.back();
@@ -413,6 +415,8 @@ int BaseDevice::removeProperty(const char *name, char *errmsg)
                 bvp = static_cast<IBLOBVectorProperty *>(pPtr);
                 if (!strcmp(name, bvp->name))
                 {
+                    for (int i = 0; i < bvp->nbp; i++)
+                        releaseBLOB(&bvp->bp[i]);
                     (*orderi)->setRegistered(false);
                     delete *orderi;
                     orderi = pAll.erase(orderi);
@@ -914,7 +918,8 @@ bool BaseDevice::isConnected()
 /*
  * return 0 if ok else -1 with reason in errmsg
  */
-int BaseDevice::setValue(XMLEle *root, char *errmsg)
+int BaseDevice::setValue(XMLEle *root, char *errmsg, const unsigned char *payload,
+                         const std::shared_ptr<const unsigned char> &segment)
 {
     XMLEle *ep = nullptr;
     char *name = nullptr;
@@ -1089,7 +1094,7 @@ int BaseDevice::setValue(XMLEle *root, char *errmsg)
         if (timeoutSet)
             bvp->timeout = timeout;
 
-        return setBLOB(bvp, root, errmsg);
+        return setBLOB(bvp, root, errmsg, payload, segment);
     }
 
     snprintf(errmsg, MAXRBUF, "INDI: <%s> Unable to process tag", tagXMLEle(root));
@@ -1099,7 +1104,8 @@ int BaseDevice::setValue(XMLEle *root, char *errmsg)
 /* Set BLOB vector. Process incoming data stream
  * Return 0 if okay, -1 if error
 */
-int BaseDevice::setBLOB(IBLOBVectorProperty *bvp, XMLEle *root, char *errmsg)
+int BaseDevice::setBLOB(IBLOBVectorProperty *bvp, XMLEle *root, char *errmsg, const unsigned char *payload,
+                        const std::shared_ptr<const unsigned char> &segment)
 {
     /* pull out each name/BLOB pair, decode */
     for (XMLEle *ep = nextXMLEle(root, 1); ep; ep = nextXMLEle(root, 0))
@@ -1112,6 +1118,31 @@ int BaseDevice::setBLOB(IBLOBVectorProperty *bvp, XMLEle *root, char *errmsg)
 
             XMLAtt *fa = findXMLAtt(ep, "format");
             XMLAtt *sa = findXMLAtt(ep, "size");
+            bool raw    = !strcmp(findXMLAttValu(ep, "encoding"), "raw");
+            bool shared = !strcmp(findXMLAttValu(ep, "encoding"), "shm");
+            int rawlen  = (raw || shared) ? atoi(findXMLAttValu(ep, "enclen")) : 0;
+
+            // Raw BLOBs follow each other in payload
+            const unsigned char *rawdata = payload;
+            if (raw)
+            {
+                if (payload == nullptr || rawlen < 0)
+                {
+                    snprintf(errmsg, MAXRBUF, "INDI: %s.%s raw BLOB without payload.", bvp->device, bvp->name);
+                    return -1;
+                }
+                payload += rawlen;
+            }
+            else if (shared)
+            {
+                if (segment == nullptr || rawlen < 0)
+                {
+                    snprintf(errmsg, MAXRBUF, "INDI: %s.%s shared BLOB without segment.", bvp->device, bvp->name);
+                    return -1;
+                }
+                rawdata = segment.get() + atol(findXMLAttValu(ep, "offset"));
+            }
+
             if (na && fa && sa)
             {
                 int blobSize = atoi(valuXMLAtt(sa));
@@ -1125,11 +1156,33 @@ int BaseDevice::setBLOB(IBLOBVectorProperty *bvp, XMLEle *root, char *errmsg)
                 }
 
                 blobEL->size    = blobSize;
-                int bloblen     = pcdatalenXMLEle(ep);
-                int blobBufferSize = 3 * bloblen / 4;
-                if (blobBufferSize != blobEL->bloblen)
-                    blobEL->blob    = static_cast<unsigned char *>(realloc(blobEL->blob, blobBufferSize));
-                blobEL->bloblen = from64tobits_fast(static_cast<char *>(blobEL->blob), pcdataXMLEle(ep), bloblen);
+                if (shared)
+                {
+                    // Read in place, no copy
+                    releaseBLOB(blobEL);
+                    free(blobEL->blob);
+                    blobEL->blob        = const_cast<unsigned char *>(rawdata);
+                    blobEL->bloblen     = rawlen;
+                    sharedBLOBs[blobEL] = segment;
+                }
+                else if (raw)
+                {
+                    releaseBLOB(blobEL);
+                    if (rawlen != blobEL->bloblen)
+                        blobEL->blob = static_cast<unsigned char *>(realloc(blobEL->blob, rawlen));
+                    if (rawlen > 0)
+                        memcpy(blobEL->blob, rawdata, rawlen);
+                    blobEL->bloblen = rawlen;
+                }
+                else
+                {
+                    releaseBLOB(blobEL);
+                    int bloblen     = pcdatalenXMLEle(ep);
+                    int blobBufferSize = 3 * bloblen / 4;
+                    if (blobBufferSize != blobEL->bloblen)
+                        blobEL->blob    = static_cast<unsigned char *>(realloc(blobEL->blob, blobBufferSize));
+                    blobEL->bloblen = from64tobits_fast(static_cast<char *>(blobEL->blob), pcdataXMLEle(ep), bloblen);
+                }
 
                 strncpy(blobEL->format, valuXMLAtt(fa), MAXINDIFORMAT);
 
@@ -1154,9 +1207,12 @@ int BaseDevice::setBLOB(IBLOBVectorProperty *bvp, XMLEle *root, char *errmsg)
                         free(dataBuffer);
                         return -1;
                     }
-                    blobEL->size = dataSize;
+                    // Shared or not, the BLOB now holds the uncompressed buffer
+                    releaseBLOB(blobEL);
                     free(blobEL->blob);
-                    blobEL->blob = dataBuffer;
+                    blobEL->blob    = dataBuffer;
+                    blobEL->size    = dataSize;
+                    blobEL->bloblen = dataSize;
                 }
 
                 if (mediator)
@@ -1174,6 +1230,17 @@ int BaseDevice::setBLOB(IBLOBVectorProperty *bvp, XMLEle *root, char *errmsg)
     return 0;
 }
 
+void BaseDevice::releaseBLOB(IBLOB *bp)
+{
+    auto it = sharedBLOBs.find(bp);
+    if (it == sharedBLOBs.end())
+        return;
+
+    bp->blob    = nullptr;
+    bp->bloblen = 0;
+    sharedBLOBs.erase(it);
+}
+
 void BaseDevice::setDeviceName(const char *dev)
 {
     strncpy(deviceID, dev, MAXINDINAME);
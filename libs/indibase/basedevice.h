@@ -21,6 +21,8 @@
 #include "indibase.h"
 #include "indiproperty.h"
 
+#include <map>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -220,16 +222,26 @@ class BaseDevice
           \return 0 if parsing is successful, -1 otherwise and errmsg is set */
         int buildProp(XMLEle *root, char *errmsg);
 
-        /** \brief handle SetXXX commands from client */
-        int setValue(XMLEle *root, char *errmsg);
-        /** \brief Parse and store BLOB in the respective vector */
-        int setBLOB(IBLOBVectorProperty *pp, XMLEle *root, char *errmsg);
+        /** \brief handle SetXXX commands from client. payload holds the raw BLOBs of a setBLOBVector, if any,
+            segment the shared memory its shared BLOBs point into */
+        int setValue(XMLEle *root, char *errmsg, const unsigned char *payload = nullptr,
+                     const std::shared_ptr<const unsigned char> &segment = nullptr);
+        /** \brief Parse and store BLOB in the respective vector, raw BLOBs are taken from payload in order, shared
+            BLOBs are left in segment at their offset, which they keep mapped until their next update */
+        int setBLOB(IBLOBVectorProperty *pp, XMLEle *root, char *errmsg, const unsigned char *payload = nullptr,
+                    const std::shared_ptr<const unsigned char> &segment = nullptr);
 
     private:
         char *deviceID;
 
+        /** Drop the shared memory segment bp points into, if any */
+        void releaseBLOB(IBLOB *bp);
+
         std::vector<INDI::Property *> pAll;
 
+        // BLOBs pointing into shared memory and the segment each keeps mapped
+        std::map<IBLOB *, std::shared_ptr<const unsigned char>> sharedBLOBs;
+
         LilXML *lp;
 
         std::vector<std::string> messageLog;
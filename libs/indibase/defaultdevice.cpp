@@ -21,9 +21,15 @@
 #include "indistandardproperty.h"
 #include "connectionplugins/connectionserial.h"
 
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdarg>
 #include <cstdlib>
 #include <cstring>
 #include <assert.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 const char *COMMUNICATION_TAB = "Communication";
 const char *MAIN_CONTROL_TAB  = "Main Control";
@@ -38,6 +44,9 @@ const char *GUIDE_TAB         = "Guide";
 const char *ALIGNMENT_TAB     = "Alignment";
 const char *INFO_TAB          = "General Info";
 
+// Period of the timer sending updates held back by publish policies, armed while any is pending
+#define PUBLISH_FLUSH_MS 100
+
 void timerfunc(void *t)
 {
     //fprintf(stderr,"Got a timer hit with %x\n",t);
@@ -69,6 +78,15 @@ DefaultDevice::DefaultDevice()
 
 DefaultDevice::~DefaultDevice()
 {
+    if (publishTimerID != -1)
+        RemoveTimer(publishTimerID);
+
+    if (publishPipe[0] != -1)
+    {
+        IERmCallback(publishCallbackID);
+        close(publishPipe[0]);
+        close(publishPipe[1]);
+    }
 }
 
 bool DefaultDevice::loadConfig(bool silent, const char *property)
@@ -95,6 +113,8 @@ bool DefaultDevice::saveConfigItems(FILE *fp)
 {
     IUSaveConfigSwitch(fp, &DebugSP);
     IUSaveConfigNumber(fp, &PollPeriodNP);
+    if (!publishStates.empty())
+        IUSaveConfigNumber(fp, &PublishPolicyNP);
     if (ConnectionModeS != nullptr)
         IUSaveConfigSwitch(fp, &ConnectionModeSP);
 
@@ -548,6 +568,20 @@ bool DefaultDevice::ISNewNumber(const char *dev, const char *name, double values
         return true;
     }
 
+    ////////////////////////////////////////////////////
+    // Publish Policy
+    ////////////////////////////////////////////////////
+    if (!strcmp(name, PublishPolicyNP.name))
+    {
+        {
+            std::lock_guard<std::mutex> lock(publishMutex);
+            IUUpdateNumber(&PublishPolicyNP, values, names, n);
+        }
+        PublishPolicyNP.s = IPS_OK;
+        IDSetNumber(&PublishPolicyNP, nullptr);
+        return true;
+    }
+
     for (Connection::Interface *oneConnection : connections)
         oneConnection->ISNewNumber(dev, name, values, names, n);
 
@@ -765,6 +799,8 @@ void DefaultDevice::ISGetProperties(const char *dev)
         loadConfig(true, "DEBUG_LEVEL");
         loadConfig(true, "LOGGING_LEVEL");
         loadConfig(true, "POLLING_PERIOD");
+        if (!publishStates.empty())
+            loadConfig(true, "PUBLISH_POLICY");
         loadConfig(true, "LOG_OUTPUT");
     }
 
@@ -947,6 +983,11 @@ bool DefaultDevice::initProperties()
     IUFillNumber(&PollPeriodN[0], "PERIOD_MS", "Period (ms)", "%.f", 10, 600000, 1000, POLLMS);
     IUFillNumberVector(&PollPeriodNP, PollPeriodN, 1, getDeviceName(), "POLLING_PERIOD", "Polling", "Options", IP_RW, 0, IPS_IDLE);
 
+    IUFillNumber(&PublishPolicyN[0], "INTERVAL_SCALE", "Interval x", "%.2f", 0, 10, 0.1, 1);
+    IUFillNumber(&PublishPolicyN[1], "DEADBAND_SCALE", "Deadband x", "%.2f", 0, 10, 0.1, 1);
+    IUFillNumberVector(&PublishPolicyNP, PublishPolicyN, 2, getDeviceName(), "PUBLISH_POLICY", "Publishing", "Options",
+                       IP_RW, 0, IPS_IDLE);
+
     INDI::Logger::initProperties(this);
 
     // Ready the logger
@@ -961,6 +1002,16 @@ bool DefaultDevice::deleteProperty(const char *propertyName)
 {
     char errmsg[MAXRBUF];
 
+    // Drop updates held back for the deleted properties
+    {
+        std::lock_guard<std::mutex> lock(publishMutex);
+        for (auto &onePolicy : publishStates)
+        {
+            if (propertyName == nullptr || !strcmp(onePolicy.first->name, propertyName))
+                onePolicy.second.pending = false;
+        }
+    }
+
     if (propertyName == nullptr)
     {
         //while(!pAll.empty()) delete bar.back(), bar.pop_back();
@@ -1100,4 +1151,218 @@ void DefaultDevice::setPollingPeriodRange(uint32_t minimum, uint32_t maximum)
     IUUpdateMinMax(&PollPeriodNP);
 }
 
+
+void DefaultDevice::setPublishPolicy(INumberVectorProperty *nvp, uint32_t minIntervalMs, double absDeadband,
+                                     double relDeadband, uint32_t idleFlushMs)
+{
+    std::lock_guard<std::mutex> lock(publishMutex);
+
+    // publishNumber() may be called from any thread, it wakes the main loop to arm the flush timer
+    if (publishPipe[0] == -1)
+    {
+        if (pipe(publishPipe) < 0)
+        {
+            publishPipe[0] = publishPipe[1] = -1;
+            LOGF_ERROR("Cannot limit updates of %s, pipe: %s", nvp->name, strerror(errno));
+            return;
+        }
+
+        for (int fd : publishPipe)
+        {
+            fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+            fcntl(fd, F_SETFD, FD_CLOEXEC);
+        }
+        publishCallbackID = IEAddCallback(publishPipe[0], publishWakeHelper, this);
+    }
+
+    PublishState &ps = publishStates[nvp];
+    ps.minInterval   = minIntervalMs;
+    ps.idleFlush     = idleFlushMs;
+    ps.absDeadband.assign(nvp->nnp, absDeadband);
+    ps.relDeadband.assign(nvp->nnp, relDeadband);
+    ps.lastValues.assign(nvp->nnp, 0);
+    ps.values.assign(nvp->nnp, 0);
+    ps.sent    = false;
+    ps.pending = false;
+
+    // The client may only scale policies if the driver uses any
+    if (getProperty(PublishPolicyNP.name, INDI_NUMBER) == nullptr)
+        registerProperty(&PublishPolicyNP, INDI_NUMBER);
+}
+
+bool DefaultDevice::setPublishDeadband(INumberVectorProperty *nvp, const char *element, double absDeadband,
+                                       double relDeadband)
+{
+    std::lock_guard<std::mutex> lock(publishMutex);
+
+    auto policy = publishStates.find(nvp);
+    if (policy == publishStates.end())
+        return false;
+
+    for (int i = 0; i < nvp->nnp; i++)
+    {
+        if (!strcmp(nvp->np[i].name, element))
+        {
+            policy->second.absDeadband[i] = absDeadband;
+            policy->second.relDeadband[i] = relDeadband;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void DefaultDevice::publishNumber(INumberVectorProperty *nvp, const char *fmt, ...)
+{
+    char msg[MAXINDIMESSAGE];
+
+    if (fmt)
+    {
+        va_list ap;
+        va_start(ap, fmt);
+        vsnprintf(msg, MAXINDIMESSAGE, fmt, ap);
+        va_end(ap);
+    }
+
+    std::lock_guard<std::mutex> lock(publishMutex);
+
+    auto policy = publishStates.find(nvp);
+    if (policy == publishStates.end())
+    {
+        if (fmt)
+            IDSetNumber(nvp, "%s", msg);
+        else
+            IDSetNumber(nvp, nullptr);
+        return;
+    }
+
+    // The caller may go on updating nvp while the main loop flushes, so the flush works from this copy
+    PublishState &ps = policy->second;
+    ps.lastCall      = std::chrono::steady_clock::now();
+    ps.state         = nvp->s;
+    for (int i = 0; i < nvp->nnp; i++)
+        ps.values[i] = nvp->np[i].value;
+
+    if (publishDue(ps, fmt != nullptr || !ps.sent || ps.state != ps.lastState))
+        sendPublished(nvp, ps, fmt ? msg : nullptr);
+    else
+    {
+        ps.pending = true;
+        // The event loop is not thread safe, leave the timer to the main loop
+        if (publishTimerID == -1 && publishWakePending == false)
+        {
+            char wake = 0;
+            publishWakePending = (write(publishPipe[1], &wake, 1) == 1);
+        }
+    }
+}
+
+/* N.B. publishMutex must be held */
+bool DefaultDevice::publishDue(PublishState &ps, bool force)
+{
+    if (force)
+        return true;
+
+    double intervalScale = PublishPolicyN[0].value;
+    double deadbandScale = PublishPolicyN[1].value;
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - ps.lastSent);
+
+    if (elapsed.count() < ps.minInterval * intervalScale)
+        return false;
+
+    for (size_t i = 0; i < ps.values.size(); i++)
+    {
+        double last      = ps.lastValues[i];
+        double threshold = std::max(ps.absDeadband[i], ps.relDeadband[i] * std::fabs(last)) * deadbandScale;
+        double delta     = std::fabs(ps.values[i] - last);
+
+        if (delta > threshold)
+            return true;
+    }
+
+    return false;
+}
+
+/* N.B. publishMutex must be held */
+void DefaultDevice::sendPublished(INumberVectorProperty *nvp, PublishState &ps, const char *msg)
+{
+    std::vector<INumber> numbers(nvp->nnp);
+    INumberVectorProperty published;
+
+    ps.lastValues = ps.values;
+    ps.lastState  = ps.state;
+    ps.lastSent   = std::chrono::steady_clock::now();
+    ps.sent       = true;
+    ps.pending    = false;
+
+    // Values and state as given to publishNumber(), the rest does not change once defined
+    for (int i = 0; i < nvp->nnp; i++)
+        IUFillNumber(&numbers[i], nvp->np[i].name, nvp->np[i].label, nvp->np[i].format, nvp->np[i].min,
+                     nvp->np[i].max, nvp->np[i].step, ps.values[i]);
+    IUFillNumberVector(&published, numbers.data(), nvp->nnp, nvp->device, nvp->name, nvp->label, nvp->group,
+                       nvp->p, nvp->timeout, ps.state);
+
+    if (msg)
+        IDSetNumber(&published, "%s", msg);
+    else
+        IDSetNumber(&published, nullptr);
+}
+
+void DefaultDevice::flushPublished()
+{
+    std::lock_guard<std::mutex> lock(publishMutex);
+    auto now     = std::chrono::steady_clock::now();
+    bool pending = false;
+
+    for (auto &onePolicy : publishStates)
+    {
+        INumberVectorProperty *nvp = onePolicy.first;
+        PublishState &ps           = onePolicy.second;
+
+        if (ps.pending == false)
+            continue;
+
+        if (publishDue(ps, ps.state != ps.lastState))
+        {
+            sendPublished(nvp, ps, nullptr);
+            continue;
+        }
+
+        // Idle: send whatever the deadband held back so clients end up with the final values
+        auto idle = std::chrono::duration_cast<std::chrono::milliseconds>(now - ps.lastCall);
+        if (idle.count() >= ps.idleFlush)
+        {
+            if (ps.lastValues == ps.values)
+                ps.pending = false;
+            else
+                sendPublished(nvp, ps, nullptr);
+            continue;
+        }
+
+        pending = true;
+    }
+
+    // publishNumber() arms the timer again once an update is held back
+    publishTimerID = pending ? IEAddTimer(PUBLISH_FLUSH_MS, publishTimerHelper, this) : -1;
+}
+
+void DefaultDevice::publishTimerHelper(void *context)
+{
+    static_cast<DefaultDevice *>(context)->flushPublished();
+}
+
+void DefaultDevice::publishWakeHelper(int fd, void *context)
+{
+    DefaultDevice *device = static_cast<DefaultDevice *>(context);
+    char buf[16];
+
+    while (read(fd, buf, sizeof(buf)) > 0)
+        ;
+
+    std::lock_guard<std::mutex> lock(device->publishMutex);
+    device->publishWakePending = false;
+    if (device->publishTimerID == -1)
+        device->publishTimerID = IEAddTimer(PUBLISH_FLUSH_MS, publishTimerHelper, device);
+}
+
 }
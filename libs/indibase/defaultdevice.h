@@ -22,6 +22,9 @@
 #include "indidriver.h"
 #include "indilogger.h"
 
+#include <chrono>
+#include <map>
+#include <mutex>
 #include <stdint.h>
 
 namespace Connection
@@ -176,6 +179,45 @@ class INDI::DefaultDevice : public INDI::BaseDevice
          */
         virtual bool deleteProperty(const char *propertyName);
 
+        /**
+         * @brief setPublishPolicy Bound how often updates of a number property reach the clients
+         * when published with publishNumber(). An update is sent right away if the property state
+         * changed or a message is attached. Otherwise it is sent only once minIntervalMs elapsed
+         * since the last one and at least one element moved past its deadband. Suppressed changes
+         * are flushed once the property has not been published for idleFlushMs, so clients always
+         * end up with the final values.
+         * Call it from initProperties() so the PUBLISH_POLICY property gets defined along the others.
+         * @param nvp Number property to limit.
+         * @param minIntervalMs Minimum time between two updates, 0 for no limit.
+         * @param absDeadband Absolute change below which an element is not republished, 0 to send any change.
+         * @param relDeadband Change relative to the last sent value below which an element is not republished.
+         * @param idleFlushMs Delay after the last publishNumber() call before pending values are flushed.
+         * @note The client can scale all intervals and deadbands of the device with the PUBLISH_POLICY property.
+         */
+        void setPublishPolicy(INumberVectorProperty *nvp, uint32_t minIntervalMs, double absDeadband = 0,
+                              double relDeadband = 0, uint32_t idleFlushMs = 1000);
+
+        /**
+         * @brief setPublishDeadband Override the deadband of a single element of a number property
+         * with a publish policy set by setPublishPolicy().
+         * @param nvp Number property.
+         * @param element Name of the element.
+         * @param absDeadband Absolute deadband of the element.
+         * @param relDeadband Relative deadband of the element.
+         * @return True if the element was found, false otherwise.
+         */
+        bool setPublishDeadband(INumberVectorProperty *nvp, const char *element, double absDeadband,
+                                double relDeadband = 0);
+
+        /**
+         * @brief publishNumber Send the number property to the clients according to its publish
+         * policy. Properties without a policy are sent right away like IDSetNumber().
+         * @param nvp Number property to publish.
+         * @param fmt Optional printf style message. An update carrying a message is never suppressed.
+         * @note Safe to call from any thread, held back updates are flushed by the main loop.
+         */
+        void publishNumber(INumberVectorProperty *nvp, const char *fmt = nullptr, ...);
+
         /**
          * \brief Set connection switch status in the client.
          * \param status If true, the driver will attempt to connect to the device (CONNECT=ON).
@@ -506,6 +548,40 @@ class INDI::DefaultDevice : public INDI::BaseDevice
         std::vector<Connection::Interface *> connections;
         Connection::Interface *activeConnection = nullptr;
 
+        // Publish policies
+        struct PublishState
+        {
+            uint32_t minInterval { 0 };
+            uint32_t idleFlush { 1000 };
+            std::vector<double> absDeadband;
+            std::vector<double> relDeadband;
+            std::vector<double> lastValues;
+            IPState lastState { IPS_IDLE };
+            // Last given to publishNumber()
+            std::vector<double> values;
+            IPState state { IPS_IDLE };
+            bool sent { false };
+            bool pending { false };
+            std::chrono::steady_clock::time_point lastSent;
+            std::chrono::steady_clock::time_point lastCall;
+        };
+
+        bool publishDue(PublishState &ps, bool force);
+        void sendPublished(INumberVectorProperty *nvp, PublishState &ps, const char *msg);
+        void flushPublished();
+        static void publishTimerHelper(void *context);
+        static void publishWakeHelper(int fd, void *context);
+
+        INumber PublishPolicyN[2];
+        INumberVectorProperty PublishPolicyNP;
+        std::map<INumberVectorProperty *, PublishState> publishStates;
+        std::mutex publishMutex;
+        int publishTimerID = -1;
+        // Wakes the main loop to arm the flush timer
+        int publishPipe[2] = { -1, -1 };
+        int publishCallbackID = -1;
+        bool publishWakePending = false;
+
         // Connection Plugins
         friend class Connection::Serial;
         friend class Connection::TCP;
@@ -0,0 +1,259 @@
+/*******************************************************************************
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#include "indibufferpool.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+namespace INDI
+{
+
+// Smallest block handed out by the pool
+static constexpr size_t MIN_BLOCK_SIZE = 4096;
+// Blocks this large are mapped on their own, aligned for transparent huge pages
+static constexpr size_t HUGE_PAGE_SIZE = 2u << 20;
+
+constexpr size_t BufferPool::AUTO_CACHE_LIMIT;
+
+BufferPool &BufferPool::instance()
+{
+    // Never destroyed: chips of static driver instances release their buffers during exit.
+    static BufferPool *pool = new BufferPool();
+    return *pool;
+}
+
+size_t BufferPool::sizeClass(size_t size)
+{
+    if (size <= MIN_BLOCK_SIZE)
+        return MIN_BLOCK_SIZE;
+
+    // Four classes per power of two waste at most a quarter of the block
+    size_t step = 1;
+    for (size_t rest = (size - 1) >> 2; rest > 1; rest >>= 1)
+        step <<= 1;
+
+    if (step < HUGE_PAGE_SIZE && size > HUGE_PAGE_SIZE)
+        step = HUGE_PAGE_SIZE;
+
+    return (size + step - 1) / step * step;
+}
+
+size_t BufferPool::effectiveLimit() const
+{
+    return cacheLimit == AUTO_CACHE_LIMIT ? 2 * largestBlock : cacheLimit;
+}
+
+void *BufferPool::allocate(size_t capacity, bool &mapped)
+{
+    mapped = false;
+
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+    if (capacity >= HUGE_PAGE_SIZE)
+    {
+        // Over-map by one huge page and trim both ends, so the block starts on a huge page boundary
+        size_t length = capacity + HUGE_PAGE_SIZE;
+        void *region  = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (region != MAP_FAILED)
+        {
+            uintptr_t start   = reinterpret_cast<uintptr_t>(region);
+            uintptr_t aligned = (start + HUGE_PAGE_SIZE - 1) & ~(static_cast<uintptr_t>(HUGE_PAGE_SIZE) - 1);
+            size_t head       = aligned - start;
+            size_t tail       = length - head - capacity;
+
+            if (head > 0)
+                munmap(region, head);
+            if (tail > 0)
+                munmap(reinterpret_cast<void *>(aligned + capacity), tail);
+
+            // Advisory only, the block works the same without huge pages
+            madvise(reinterpret_cast<void *>(aligned), capacity, MADV_HUGEPAGE);
+
+            mapped = true;
+            return reinterpret_cast<void *>(aligned);
+        }
+    }
+#endif
+
+    return malloc(capacity);
+}
+
+void BufferPool::deallocate(void *buffer, const Block &block)
+{
+#ifdef __linux__
+    if (block.mapped)
+    {
+        munmap(buffer, block.capacity);
+        return;
+    }
+#endif
+
+    free(buffer);
+}
+
+void *BufferPool::acquire(size_t size)
+{
+    size_t capacity = sizeClass(size);
+
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        if (capacity > largestBlock)
+            largestBlock = capacity;
+
+        auto idle = idleBlocks.find(capacity);
+        if (idle != idleBlocks.end() && !idle->second.empty())
+        {
+            void *buffer = idle->second.back();
+            idle->second.pop_back();
+            stats.cachedBytes -= capacity;
+            stats.hits++;
+            return buffer;
+        }
+        stats.misses++;
+    }
+
+    bool mapped  = false;
+    void *buffer = allocate(capacity, mapped);
+    if (buffer == nullptr)
+    {
+        // Idle blocks of other sizes may be what stands in the way
+        trim();
+        buffer = allocate(capacity, mapped);
+        if (buffer == nullptr)
+            return nullptr;
+    }
+
+    std::lock_guard<std::mutex> guard(lock);
+    blocks[buffer] = Block { capacity, mapped };
+    stats.residentBytes += capacity;
+    return buffer;
+}
+
+void *BufferPool::resize(void *buffer, size_t size)
+{
+    if (buffer == nullptr)
+        return acquire(size);
+
+    size_t oldCapacity = capacity(buffer);
+    if (oldCapacity == 0)
+        return realloc(buffer, size);
+
+    if (size <= oldCapacity)
+        return buffer;
+
+    void *resized = acquire(size);
+    if (resized == nullptr)
+        return nullptr;
+
+    memcpy(resized, buffer, oldCapacity);
+    release(buffer);
+    return resized;
+}
+
+bool BufferPool::release(void *buffer)
+{
+    if (buffer == nullptr)
+        return true;
+
+    Block block;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        auto it = blocks.find(buffer);
+        if (it == blocks.end())
+            return false;
+
+        if (stats.cachedBytes + it->second.capacity <= effectiveLimit())
+        {
+            idleBlocks[it->second.capacity].push_back(buffer);
+            stats.cachedBytes += it->second.capacity;
+            return true;
+        }
+
+        block = it->second;
+        blocks.erase(it);
+        stats.residentBytes -= block.capacity;
+        stats.evictions++;
+    }
+
+    deallocate(buffer, block);
+    return true;
+}
+
+size_t BufferPool::capacity(const void *buffer)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    auto it = blocks.find(buffer);
+    return it == blocks.end() ? 0 : it->second.capacity;
+}
+
+void BufferPool::setCacheLimit(size_t bytes)
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        cacheLimit = bytes;
+        if (stats.cachedBytes <= effectiveLimit())
+            return;
+    }
+
+    trim();
+}
+
+void BufferPool::trim()
+{
+    std::vector<std::pair<void *, Block>> freed;
+
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        for (auto &idle : idleBlocks)
+        {
+            for (void *buffer : idle.second)
+            {
+                auto it = blocks.find(buffer);
+                freed.emplace_back(buffer, it->second);
+                stats.residentBytes -= it->second.capacity;
+                stats.cachedBytes -= it->second.capacity;
+                blocks.erase(it);
+            }
+        }
+        idleBlocks.clear();
+
+        // The automatic limit follows the blocks still in use from here on
+        largestBlock = 0;
+        for (auto &block : blocks)
+            largestBlock = std::max(largestBlock, block.second.capacity);
+    }
+
+    for (auto &one : freed)
+        deallocate(one.first, one.second);
+}
+
+BufferPool::Statistics BufferPool::statistics()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return stats;
+}
+
+void *BufferPool::reallocate(void *buffer, size_t size)
+{
+    return instance().resize(buffer, size);
+}
+
+}
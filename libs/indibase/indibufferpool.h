@@ -0,0 +1,137 @@
+/*******************************************************************************
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace INDI
+{
+
+/**
+ * @brief The BufferPool class keeps released frame sized buffers for reuse.
+ *
+ * Requests are rounded up to a size class (four classes per power of two) and served from the idle blocks of
+ * that class when possible, so frame buffers, binning shadows and FITS memfiles of the same geometry are
+ * recycled instead of going back to the allocator for every exposure or ROI change. Blocks of 2 MiB and more
+ * are mapped on a huge page boundary and advised for transparent huge pages where the platform supports it.
+ *
+ * Idle blocks are kept up to twice the size of the largest block handed out, about two frames of the largest
+ * geometry in use, unless a limit is set with setCacheLimit().
+ *
+ * The pool is shared by all devices of the driver process and is thread safe.
+ */
+class BufferPool
+{
+    public:
+        /** Cache limit following the largest block handed out, see setCacheLimit() */
+        static constexpr size_t AUTO_CACHE_LIMIT = static_cast<size_t>(-1);
+
+        struct Statistics
+        {
+            /** Acquisitions served by an idle block */
+            uint64_t hits { 0 };
+            /** Acquisitions that had to allocate a new block */
+            uint64_t misses { 0 };
+            /** Released blocks freed because the idle cache was full */
+            uint64_t evictions { 0 };
+            /** Bytes held by the pool, in use or idle */
+            size_t residentBytes { 0 };
+            /** Bytes held by idle blocks */
+            size_t cachedBytes { 0 };
+        };
+
+        /**
+         * @return The buffer pool of the driver process.
+         */
+        static BufferPool &instance();
+
+        /**
+         * @brief acquire Get a buffer of at least size bytes. The content is undefined.
+         * @return buffer, or nullptr if no memory could be allocated.
+         */
+        void *acquire(size_t size);
+
+        /**
+         * @brief resize Grow a buffer to at least size bytes, keeping its content like realloc() does. Buffers
+         * not owned by the pool are passed to realloc().
+         * @return resized buffer, or nullptr if no memory could be allocated. The old buffer is then left intact.
+         */
+        void *resize(void *buffer, size_t size);
+
+        /**
+         * @brief release Return a buffer to the pool.
+         * @return True if the buffer was released, false if it is not owned by the pool and must be freed by
+         * whoever allocated it.
+         */
+        bool release(void *buffer);
+
+        /**
+         * @return Usable size of a buffer owned by the pool, 0 for any other pointer.
+         */
+        size_t capacity(const void *buffer);
+
+        /**
+         * @brief setCacheLimit Set the maximum number of bytes kept in idle blocks. All idle blocks are freed if
+         * they exceed the new limit.
+         * @param bytes limit, or AUTO_CACHE_LIMIT for twice the largest block handed out so far (the default).
+         */
+        void setCacheLimit(size_t bytes);
+
+        /**
+         * @brief trim Free all idle blocks.
+         */
+        void trim();
+
+        Statistics statistics();
+
+        /**
+         * @brief reallocate realloc() compatible function for fits_create_memfile(), backed by the pool.
+         */
+        static void *reallocate(void *buffer, size_t size);
+
+    private:
+        BufferPool() = default;
+
+        struct Block
+        {
+            size_t capacity;
+            bool mapped;
+        };
+
+        static size_t sizeClass(size_t size);
+        static void *allocate(size_t capacity, bool &mapped);
+        static void deallocate(void *buffer, const Block &block);
+        // Limit in effect, lock held
+        size_t effectiveLimit() const;
+
+        std::mutex lock;
+        // Every block owned by the pool, in use or idle
+        std::unordered_map<const void *, Block> blocks;
+        // Idle blocks by capacity
+        std::map<size_t, std::vector<void *>> idleBlocks;
+        size_t cacheLimit { AUTO_CACHE_LIMIT };
+        // Capacity of the largest block handed out
+        size_t largestBlock { 0 };
+        Statistics stats;
+};
+
+}
@@ -28,6 +28,7 @@
 #define _FILE_OFFSET_BITS 64
 
 #include "indiccd.h"
+#include "indibufferpool.h"
 
 #include "fpack/fpack.h"
 #include "indicom.h"
@@ -60,6 +61,45 @@ const char * GUIDE_HEAD_TAB     = "Guider Head";
 uint16_t INDIWSServer::m_global_port = 11623;
 #endif
 
+// Replace every occurrence of an upload prefix token
+static void _ccd_replace_all(std::string &str, const std::string &from, const std::string &to)
+{
+    for (size_t pos = str.find(from); pos != std::string::npos; pos = str.find(from, pos + to.size()))
+        str.replace(pos, from.size(), to);
+}
+
+// Part of the upload prefix shared by all files of a sequence
+static std::string _ccd_index_prefix(const char * prefix)
+{
+    std::string prefixIndex = prefix;
+    _ccd_replace_all(prefixIndex, "_ISO8601", "");
+    _ccd_replace_all(prefixIndex, "_XXX", "");
+    return prefixIndex;
+}
+
+// Sequence index of a saved image, the number following the last underscore
+static int _ccd_file_index(const std::string &file)
+{
+    std::size_t start = file.find_last_of("_");
+    std::size_t end   = file.find_last_of(".");
+    if (start == std::string::npos)
+        return -1;
+    return atoi(file.substr(start + 1, end).c_str());
+}
+
+static void _ccd_dir_mtime(const struct stat &st, time_t &sec, long &nsec)
+{
+    sec = st.st_mtime;
+#ifdef __APPLE__
+    nsec = st.st_mtimespec.tv_nsec;
+#else
+    nsec = st.st_mtim.tv_nsec;
+#endif
+}
+
+// Frame being packaged into FITS on this thread, read by getMinMax() instead of the driver frame buffer
+static thread_local const uint8_t * packagedFrame = nullptr;
+
 // Create dir recursively
 static int _ccd_mkdir(const char * dir, mode_t mode)
 {
@@ -88,6 +128,8 @@ static int _ccd_mkdir(const char * dir, mode_t mode)
 namespace INDI
 {
 
+thread_local const CCD::FrameInfo * CCD::packagedInfo = nullptr;
+
 CCD::CCD()
 {
     //ctor
@@ -378,6 +420,25 @@ bool CCD::initProperties()
     IUFillTextVector(&FileNameTP, FileNameT, 1, getDeviceName(), "CCD_FILE_PATH", "Filename", IMAGE_INFO_TAB, IP_RO, 60,
                      IPS_IDLE);
 
+    // Frame Pipeline Timing
+    IUFillNumber(&PipelineTimingN[PIPELINE_SNAPSHOT], "SNAPSHOT", "Snapshot (s)", "%.3f", 0, 3600, 0, 0);
+    IUFillNumber(&PipelineTimingN[PIPELINE_FITS], "FITS", "FITS (s)", "%.3f", 0, 3600, 0, 0);
+    IUFillNumber(&PipelineTimingN[PIPELINE_SAVE], "SAVE", "Save (s)", "%.3f", 0, 3600, 0, 0);
+    IUFillNumber(&PipelineTimingN[PIPELINE_UPLOAD], "UPLOAD", "Upload (s)", "%.3f", 0, 3600, 0, 0);
+    IUFillNumberVector(&PipelineTimingNP, PipelineTimingN, 4, getDeviceName(), "CCD_PIPELINE_TIMING", "Frame timing",
+                       IMAGE_INFO_TAB, IP_RO, 60, IPS_IDLE);
+
+    // Frame Buffer Pool
+    IUFillNumber(&BufferPoolN[POOL_HITS], "HITS", "Reused", "%.f", 0, 1e12, 0, 0);
+    IUFillNumber(&BufferPoolN[POOL_MISSES], "MISSES", "Allocated", "%.f", 0, 1e12, 0, 0);
+    IUFillNumber(&BufferPoolN[POOL_RESIDENT], "RESIDENT", "Resident (MB)", "%.1f", 0, 1e6, 0, 0);
+    IUFillNumber(&BufferPoolN[POOL_CACHED], "CACHED", "Idle (MB)", "%.1f", 0, 1e6, 0, 0);
+    IUFillNumberVector(&BufferPoolNP, BufferPoolN, 4, getDeviceName(), "CCD_BUFFER_POOL", "Buffer pool",
+                       IMAGE_INFO_TAB, IP_RO, 60, IPS_IDLE);
+    IUFillNumber(&BufferPoolLimitN[0], "LIMIT", "Idle (MB), 0 = auto", "%.f", 0, 65536, 64, 0);
+    IUFillNumberVector(&BufferPoolLimitNP, BufferPoolLimitN, 1, getDeviceName(), "CCD_BUFFER_POOL_LIMIT",
+                       "Buffer pool", OPTIONS_TAB, IP_RW, 60, IPS_IDLE);
+
     /**********************************************/
     /****************** FITS Header****************/
     /**********************************************/
@@ -567,6 +628,9 @@ bool CCD::updateProperties()
         if (UploadSettingsT[UPLOAD_DIR].text == nullptr)
             IUSaveText(&UploadSettingsT[UPLOAD_DIR], getenv("HOME"));
         defineText(&UploadSettingsTP);
+        defineNumber(&PipelineTimingNP);
+        defineNumber(&BufferPoolNP);
+        defineNumber(&BufferPoolLimitNP);
 
 #ifdef HAVE_WEBSOCKET
         if (HasWebSocket())
@@ -647,6 +711,12 @@ bool CCD::updateProperties()
         deleteProperty(WorldCoordSP.name);
         deleteProperty(UploadSP.name);
         deleteProperty(UploadSettingsTP.name);
+        deleteProperty(PipelineTimingNP.name);
+        deleteProperty(BufferPoolNP.name);
+        deleteProperty(BufferPoolLimitNP.name);
+
+        // Idle frame buffers are of no use until the next connection
+        BufferPool::instance().trim();
 
 #ifdef HAVE_WEBSOCKET
         if (HasWebSocket())
@@ -1138,6 +1208,17 @@ bool CCD::ISNewNumber(const char * dev, const char * name, double values[], char
             return true;
         }
 
+        if (!strcmp(name, BufferPoolLimitNP.name))
+        {
+            IUUpdateNumber(&BufferPoolLimitNP, values, names, n);
+            BufferPool::instance().setCacheLimit(BufferPoolLimitN[0].value > 0 ?
+                                                 static_cast<size_t>(BufferPoolLimitN[0].value) << 20 :
+                                                 BufferPool::AUTO_CACHE_LIMIT);
+            BufferPoolLimitNP.s = IPS_OK;
+            IDSetNumber(&BufferPoolLimitNP, nullptr);
+            return true;
+        }
+
 #ifdef WITH_EXPOSURE_LOOPING
         if (!strcmp(name, ExposureLoopCountNP.name))
         {
@@ -1727,20 +1808,23 @@ void CCD::addFITSKeywords(fitsfile * fptr, CCDChip * targetChip)
     // Object
     fits_update_key_str(fptr, "OBJECT", FITSHeaderT[FITS_OBJECT].text, "Object name", &status);
 
-    double subPixSize1 = static_cast<double>(targetChip->getPixelSizeX());
-    double subPixSize2 = static_cast<double>(targetChip->getPixelSizeY());
-    uint32_t subW = targetChip->getSubW();
-    uint32_t subH = targetChip->getSubH();
-    uint32_t subBinX = targetChip->getBinX();
-    uint32_t subBinY = targetChip->getBinY();
+    // Describe the frame being packaged, the chip may already be set up for the next one
+    const FrameInfo info = packagedInfo ? *packagedInfo : frameInfo(targetChip);
+
+    double subPixSize1 = static_cast<double>(info.pixelSizeX);
+    double subPixSize2 = static_cast<double>(info.pixelSizeY);
+    uint32_t subW = info.subW;
+    uint32_t subH = info.subH;
+    uint32_t subBinX = info.binX;
+    uint32_t subBinY = info.binY;
 
     strncpy(dev_name, getDeviceName(), MAXINDINAME);
-    strncpy(exp_start, targetChip->getExposureStartTime(), MAXINDINAME);
+    strncpy(exp_start, info.exposureStart, MAXINDINAME);
 
-    fits_update_key_dbl(fptr, "EXPTIME", targetChip->getExposureDuration(), 6, "Total Exposure Time (s)", &status);
+    fits_update_key_dbl(fptr, "EXPTIME", info.exposureDuration, 6, "Total Exposure Time (s)", &status);
 
-    if (targetChip->getFrameType() == CCDChip::DARK_FRAME)
-        fits_update_key_dbl(fptr, "DARKTIME", targetChip->getExposureDuration(), 6, "Total Dark Exposure Time (s)", &status);
+    if (info.frameType == CCDChip::DARK_FRAME)
+        fits_update_key_dbl(fptr, "DARKTIME", info.exposureDuration, 6, "Total Dark Exposure Time (s)", &status);
 
     // If the camera has a cooler OR if the temperature permission was explicitly set to Read-Only, then record the temperature
     if (HasCooler() || TemperatureNP.p == IP_RO)
@@ -1748,15 +1832,15 @@ void CCD::addFITSKeywords(fitsfile * fptr, CCDChip * targetChip)
 
     fits_update_key_dbl(fptr, "PIXSIZE1", subPixSize1, 6, "Pixel Size 1 (microns)", &status);
     fits_update_key_dbl(fptr, "PIXSIZE2", subPixSize2, 6, "Pixel Size 2 (microns)", &status);
-    fits_update_key_lng(fptr, "XBINNING", targetChip->getBinX(), "Binning factor in width", &status);
-    fits_update_key_lng(fptr, "YBINNING", targetChip->getBinY(), "Binning factor in height", &status);
+    fits_update_key_lng(fptr, "XBINNING", info.binX, "Binning factor in width", &status);
+    fits_update_key_lng(fptr, "YBINNING", info.binY, "Binning factor in height", &status);
     // XPIXSZ and YPIXSZ are logical sizes including the binning factor
     double xpixsz = subPixSize1 * subBinX;
     double ypixsz = subPixSize2 * subBinY;
     fits_update_key_dbl(fptr, "XPIXSZ", xpixsz, 6, "X binned pixel size in microns", &status);
     fits_update_key_dbl(fptr, "YPIXSZ", ypixsz, 6, "Y binned pixel size in microns", &status);
 
-    switch (targetChip->getFrameType())
+    switch (info.frameType)
     {
         case CCDChip::LIGHT_FRAME:
             fits_update_key_str(fptr, "FRAME", "Light", "Frame Type", &status);
@@ -1778,7 +1862,7 @@ void CCD::addFITSKeywords(fitsfile * fptr, CCDChip * targetChip)
     }
 
 #ifdef WITH_MINMAX
-    if (targetChip->getNAxis() == 2)
+    if (info.nAxis == 2)
     {
         double min_val, max_val;
         getMinMax(&min_val, &max_val, targetChip);
@@ -1788,7 +1872,7 @@ void CCD::addFITSKeywords(fitsfile * fptr, CCDChip * targetChip)
     }
 #endif
 
-    if (HasBayer() && targetChip->getNAxis() == 2)
+    if (HasBayer() && info.nAxis == 2)
     {
         fits_update_key_lng(fptr, "XBAYROFF", atoi(BayerT[0].text), "X offset of Bayer array", &status);
         fits_update_key_lng(fptr, "YBAYROFF", atoi(BayerT[1].text), "Y offset of Bayer array", &status);
@@ -1819,7 +1903,7 @@ void CCD::addFITSKeywords(fitsfile * fptr, CCDChip * targetChip)
     }
 
 
-    if (targetChip->getFrameType() == CCDChip::LIGHT_FRAME && !std::isnan(J2000RA) && !std::isnan(J2000DE))
+    if (info.frameType == CCDChip::LIGHT_FRAME && !std::isnan(J2000RA) && !std::isnan(J2000DE))
     {
         char ra_str[32] = {0}, de_str[32] = {0};
 
@@ -1935,18 +2019,102 @@ bool CCD::ExposureComplete(CCDChip * targetChip)
 }
 
 bool CCD::ExposureCompletePrivate(CCDChip * targetChip)
+{
+    FramePipeline &pipeline = framePipeline[targetChip == &PrimaryCCD ? 0 : 1];
+    FrameInfo info;
+    uint8_t *frame = nullptr;
+    size_t frameSize = 0;
+    uint32_t ticket = 0;
+    double timing[4] = {0};
+    auto start = std::chrono::steady_clock::now();
+
+    // Copy the frame out of the driver buffer, so the driver can read out the next frame while this one is
+    // packaged, saved and uploaded. Once FRAME_PIPELINE_DEPTH frames are in flight, the next readout waits here.
+    {
+        std::unique_lock<std::mutex> guard(ccdBufferLock);
+        std::unique_lock<std::mutex> pipelineGuard(pipeline.lock);
+        pipeline.cond.wait(pipelineGuard, [&pipeline] { return pipeline.inFlight < FRAME_PIPELINE_DEPTH; });
+        pipeline.inFlight++;
+        ticket = pipeline.nextTicket++;
+        pipelineGuard.unlock();
+
+        // FITS packaging reads exactly the image, other formats upload the whole buffer
+        info      = frameInfo(targetChip);
+        frameSize = targetChip->getFrameBufferSize();
+        if (!strcmp(info.extension, "fits"))
+            frameSize = std::min(frameSize, static_cast<size_t>(info.subW / info.binX) * (info.subH / info.binY) *
+                                 (info.nAxis == 3 ? 3 : 1) * (info.bpp / 8));
+
+        frame = static_cast<uint8_t *>(BufferPool::instance().acquire(frameSize));
+        if (frame)
+            memcpy(frame, targetChip->getFrameBuffer(), frameSize);
+    }
+
+    timing[PIPELINE_SNAPSHOT] = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // Frames of a chip leave the pipeline in the order they were taken
+    {
+        std::unique_lock<std::mutex> pipelineGuard(pipeline.lock);
+        pipeline.cond.wait(pipelineGuard, [&pipeline, ticket] { return pipeline.serving == ticket; });
+    }
+
+    bool rc = false;
+    if (frame)
+    {
+        rc = processFrame(targetChip, frame, frameSize, info, timing);
+        BufferPool::instance().release(frame);
+    }
+    else
+    {
+        LOGF_ERROR("Error: failed to allocate memory: %lu", static_cast<unsigned long>(frameSize));
+        targetChip->setExposureFailed();
+    }
+
+    {
+        std::lock_guard<std::mutex> pipelineGuard(pipeline.lock);
+        pipeline.serving++;
+        pipeline.inFlight--;
+    }
+    pipeline.cond.notify_all();
+
+    return rc;
+}
+
+CCD::FrameInfo CCD::frameInfo(CCDChip * targetChip)
+{
+    FrameInfo info;
+
+    info.subW             = targetChip->getSubW();
+    info.subH             = targetChip->getSubH();
+    info.binX             = std::max(targetChip->getBinX(), 1);
+    info.binY             = std::max(targetChip->getBinY(), 1);
+    info.bpp              = targetChip->getBPP();
+    info.nAxis            = targetChip->getNAxis();
+    info.pixelSizeX       = targetChip->getPixelSizeX();
+    info.pixelSizeY       = targetChip->getPixelSizeY();
+    info.exposureDuration = targetChip->getExposureDuration();
+    info.frameType        = targetChip->getFrameType();
+    strncpy(info.exposureStart, targetChip->getExposureStartTime(), sizeof(info.exposureStart) - 1);
+    strncpy(info.extension, targetChip->getImageExtension(), sizeof(info.extension) - 1);
+
+    return info;
+}
+
+/* Package and upload one frame. Everything about the frame comes from info, the chip may be taking the next one. */
+bool CCD::processFrame(CCDChip * targetChip, const uint8_t * frame, size_t frameSize, const FrameInfo &info,
+                       double timing[])
 {
     if(HasDSP()) {
-        uint8_t* buf = static_cast<uint8_t*>(malloc(targetChip->getFrameBufferSize()));
-        memcpy(buf, targetChip->getFrameBuffer(), targetChip->getFrameBufferSize());
-        DSP->processBLOB(buf, 2, new int[2]{ targetChip->getSubW() / targetChip->getBinX(), targetChip->getSubH() / targetChip->getBinY() }, targetChip->getBPP());
-        free(buf);
+        uint8_t* buf = static_cast<uint8_t*>(BufferPool::instance().acquire(frameSize));
+        memcpy(buf, frame, frameSize);
+        DSP->processBLOB(buf, 2, new int[2]{ info.subW / info.binX, info.subH / info.binY }, info.bpp);
+        BufferPool::instance().release(buf);
     }
 #ifdef WITH_EXPOSURE_LOOPING
     // If looping is on, let's immediately take another capture
     if (ExposureLoopS[EXPOSURE_LOOP_ON].s == ISS_ON)
     {
-        double duration = targetChip->getExposureDuration();
+        double duration = info.exposureDuration;
 
         if (ExposureLoopCountN[0].value > 1)
         {
@@ -2442,14 +2610,14 @@ bool CCD::ExposureCompletePrivate(CCDChip * targetChip)
 
     if (sendImage || saveImage /* || useSolver*/)
     {
-        if (!strcmp(targetChip->getImageExtension(), "fits"))
+        if (!strcmp(info.extension, "fits"))
         {
             void * memptr;
             size_t memsize;
             int img_type  = 0;
             int byte_type = 0;
             int status    = 0;
-            long naxis    = targetChip->getNAxis();
+            long naxis    = info.nAxis;
             long naxes[3];
             int nelements = 0;
             std::string bit_depth;
@@ -2457,10 +2625,10 @@ bool CCD::ExposureCompletePrivate(CCDChip * targetChip)
 
             fitsfile * fptr = nullptr;
 
-            naxes[0] = targetChip->getSubW() / targetChip->getBinX();
-            naxes[1] = targetChip->getSubH() / targetChip->getBinY();
+            naxes[0] = info.subW / info.binX;
+            naxes[1] = info.subH / info.binY;
 
-            switch (targetChip->getBPP())
+            switch (info.bpp)
             {
                 case 8:
                     byte_type = TBYTE;
@@ -2481,7 +2649,7 @@ bool CCD::ExposureCompletePrivate(CCDChip * targetChip)
                     break;
 
                 default:
-                    LOGF_ERROR("Unsupported bits per pixel value %d", targetChip->getBPP());
+                    LOGF_ERROR("Unsupported bits per pixel value %d", info.bpp);
                     return false;
             }
 
@@ -2495,25 +2663,26 @@ bool CCD::ExposureCompletePrivate(CCDChip * targetChip)
             /*DEBUGF(Logger::DBG_DEBUG, "Exposure complete. Image Depth: %s. Width: %d Height: %d nelements: %d", bit_depth.c_str(), naxes[0],
                     naxes[1], nelements);*/
 
-            std::unique_lock<std::mutex> guard(ccdBufferLock);
+            auto fitsStart = std::chrono::steady_clock::now();
 
-            //  Now we have to send fits format data to the client
+            //  Now we have to send fits format data to the client. The memfile starts out with room for the
+            //  image and a few header blocks, so cfitsio grows it in place instead of copying it around.
             memsize = 5760;
-            memptr  = malloc(memsize);
+            memptr  = BufferPool::instance().acquire(memsize + static_cast<size_t>(nelements) * (info.bpp / 8) + 4 * 2880);
             if (!memptr)
             {
                 LOGF_ERROR("Error: failed to allocate memory: %lu", memsize);
                 return false;
             }
 
-            fits_create_memfile(&fptr, &memptr, &memsize, 2880, realloc, &status);
+            fits_create_memfile(&fptr, &memptr, &memsize, 2880, BufferPool::reallocate, &status);
 
             if (status)
             {
                 fits_report_error(stderr, status); /* print out any error messages */
                 fits_get_errstatus(status, error_status);
                 fits_close_file(fptr, &status);
-                free(memptr);
+                BufferPool::instance().release(memptr);
                 LOGF_ERROR("FITS Error: %s", error_status);
                 return false;
             }
@@ -2525,32 +2694,37 @@ bool CCD::ExposureCompletePrivate(CCDChip * targetChip)
                 fits_report_error(stderr, status); /* print out any error messages */
                 fits_get_errstatus(status, error_status);
                 fits_close_file(fptr, &status);
-                free(memptr);
+                BufferPool::instance().release(memptr);
                 LOGF_ERROR("FITS Error: %s", error_status);
                 return false;
             }
 
+            // DATAMIN/DATAMAX are computed over the copied frame, not the driver buffer
+            packagedFrame = frame;
+            packagedInfo  = &info;
             addFITSKeywords(fptr, targetChip);
+            packagedFrame = nullptr;
+            packagedInfo  = nullptr;
 
-            fits_write_img(fptr, byte_type, 1, nelements, targetChip->getFrameBuffer(), &status);
+            fits_write_img(fptr, byte_type, 1, nelements, const_cast<uint8_t *>(frame), &status);
 
             if (status)
             {
                 fits_report_error(stderr, status); /* print out any error messages */
                 fits_get_errstatus(status, error_status);
                 fits_close_file(fptr, &status);
-                free(memptr);
+                BufferPool::instance().release(memptr);
                 LOGF_ERROR("FITS Error: %s", error_status);
                 return false;
             }
 
             fits_close_file(fptr, &status);
 
-            bool rc = uploadFile(targetChip, memptr, memsize, sendImage, saveImage /*, useSolver*/);
+            timing[PIPELINE_FITS] = std::chrono::duration<double>(std::chrono::steady_clock::now() - fitsStart).count();
 
-            free(memptr);
+            bool rc = uploadFile(targetChip, memptr, memsize, info.extension, sendImage, saveImage, timing /*, useSolver*/);
 
-            guard.unlock();
+            BufferPool::instance().release(memptr);
 
             if (rc == false)
             {
@@ -2560,10 +2734,7 @@ bool CCD::ExposureCompletePrivate(CCDChip * targetChip)
         }
         else
         {
-            std::unique_lock<std::mutex> guard(ccdBufferLock);
-            bool rc = uploadFile(targetChip, targetChip->getFrameBuffer(), targetChip->getFrameBufferSize(), sendImage,
-                                 saveImage);
-            guard.unlock();
+            bool rc = uploadFile(targetChip, frame, frameSize, info.extension, sendImage, saveImage, timing);
 
             if (rc == false)
             {
@@ -2576,6 +2747,23 @@ bool CCD::ExposureCompletePrivate(CCDChip * targetChip)
     targetChip->ImageExposureNP.s = IPS_OK;
     IDSetNumber(&targetChip->ImageExposureNP, nullptr);
 
+    // Guide frames would hide the timing of the imaging chip
+    if (targetChip == &PrimaryCCD)
+    {
+        for (int i = 0; i < 4; i++)
+            PipelineTimingN[i].value = timing[i];
+        PipelineTimingNP.s = IPS_OK;
+        IDSetNumber(&PipelineTimingNP, nullptr);
+
+        BufferPool::Statistics poolStats = BufferPool::instance().statistics();
+        BufferPoolN[POOL_HITS].value     = poolStats.hits;
+        BufferPoolN[POOL_MISSES].value   = poolStats.misses;
+        BufferPoolN[POOL_RESIDENT].value = poolStats.residentBytes / 1048576.0;
+        BufferPoolN[POOL_CACHED].value   = poolStats.cachedBytes / 1048576.0;
+        BufferPoolNP.s = IPS_OK;
+        IDSetNumber(&BufferPoolNP, nullptr);
+    }
+
 #if 0
     if (autoLoop)
     {
@@ -2639,79 +2827,124 @@ bool CCD::ExposureCompletePrivate(CCDChip * targetChip)
     return true;
 }
 
-bool CCD::uploadFile(CCDChip * targetChip, const void * fitsData, size_t totalBytes, bool sendImage,
-                     bool saveImage /*, bool useSolver*/)
+bool CCD::uploadFile(CCDChip * targetChip, const void * fitsData, size_t totalBytes, const char * extension,
+                     bool sendImage, bool saveImage, double timing[] /*, bool useSolver*/)
 {
-    uint8_t * compressedData = nullptr;
-
     DEBUGF(Logger::DBG_DEBUG, "Uploading file. Ext: %s, Size: %d, sendImage? %s, saveImage? %s",
-           targetChip->getImageExtension(), totalBytes, sendImage ? "Yes" : "No", saveImage ? "Yes" : "No");
+           extension, totalBytes, sendImage ? "Yes" : "No", saveImage ? "Yes" : "No");
+
+    // Both stages only read the packaged image, so the disk write overlaps the client upload
+    bool saved = true, sent = true;
+    std::thread saver;
 
     if (saveImage)
     {
-        targetChip->FitsB.blob    = const_cast<void *>(fitsData);
-        targetChip->FitsB.bloblen = totalBytes;
-        snprintf(targetChip->FitsB.format, MAXINDIBLOBFMT, ".%s", targetChip->getImageExtension());
+        saver = std::thread([&]()
+        {
+            auto start            = std::chrono::steady_clock::now();
+            saved                 = saveFile(targetChip, fitsData, totalBytes, extension);
+            timing[PIPELINE_SAVE] = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        });
+    }
 
-        FILE * fp = nullptr;
-        char imageFileName[MAXRBUF];
+    if (sendImage)
+    {
+        auto start              = std::chrono::steady_clock::now();
+        sent                    = sendFile(targetChip, fitsData, totalBytes, extension);
+        timing[PIPELINE_UPLOAD] = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
 
-        std::string prefix = UploadSettingsT[UPLOAD_PREFIX].text;
-        int maxIndex       = getFileIndex(UploadSettingsT[UPLOAD_DIR].text, UploadSettingsT[UPLOAD_PREFIX].text,
-                                          targetChip->FitsB.format);
+    if (saver.joinable())
+        saver.join();
 
-        if (maxIndex < 0)
-        {
-            LOGF_ERROR("Error iterating directory %s. %s", UploadSettingsT[0].text,
-                       strerror(errno));
-            return false;
-        }
+    if (!saved || !sent)
+        return false;
 
-        if (maxIndex > 0)
-        {
-            char ts[32];
-            struct tm * tp;
-            time_t t;
-            time(&t);
-            tp = localtime(&t);
-            strftime(ts, sizeof(ts), "%Y-%m-%dT%H-%M-%S", tp);
-            std::string filets(ts);
-            prefix = std::regex_replace(prefix, std::regex("ISO8601"), filets);
+    DEBUG(Logger::DBG_DEBUG, "Upload complete");
 
-            char indexString[8];
-            snprintf(indexString, 8, "%03d", maxIndex);
-            std::string prefixIndex = indexString;
-            //prefix.replace(prefix.find("XXX"), std::string::npos, prefixIndex);
-            prefix = std::regex_replace(prefix, std::regex("XXX"), prefixIndex);
-        }
+    return true;
+}
 
-        snprintf(imageFileName, MAXRBUF, "%s/%s%s", UploadSettingsT[0].text, prefix.c_str(), targetChip->FitsB.format);
+bool CCD::saveFile(CCDChip * targetChip, const void * fitsData, size_t totalBytes, const char * extension)
+{
+    char format[MAXINDIBLOBFMT];
+    snprintf(format, MAXINDIBLOBFMT, ".%s", extension);
 
-        fp = fopen(imageFileName, "w");
-        if (fp == nullptr)
-        {
-            LOGF_ERROR("Unable to save image file (%s). %s", imageFileName, strerror(errno));
-            return false;
-        }
+    FILE * fp = nullptr;
+    char imageFileName[MAXRBUF];
+
+    std::string prefix = UploadSettingsT[UPLOAD_PREFIX].text;
+    int maxIndex       = getFileIndex(UploadSettingsT[UPLOAD_DIR].text, UploadSettingsT[UPLOAD_PREFIX].text, format);
+
+    if (maxIndex < 0)
+    {
+        LOGF_ERROR("Error iterating directory %s. %s", UploadSettingsT[0].text,
+                   strerror(errno));
+        return false;
+    }
 
-        int n = 0;
-        for (int nr = 0; nr < (int)targetChip->FitsB.bloblen; nr += n)
-            n = fwrite((static_cast<char *>(targetChip->FitsB.blob) + nr), 1, targetChip->FitsB.bloblen - nr, fp);
+    if (maxIndex > 0)
+    {
+        char ts[32];
+        struct tm * tp;
+        time_t t;
+        time(&t);
+        tp = localtime(&t);
+        strftime(ts, sizeof(ts), "%Y-%m-%dT%H-%M-%S", tp);
+        std::string filets(ts);
+        _ccd_replace_all(prefix, "ISO8601", filets);
+
+        char indexString[8];
+        snprintf(indexString, 8, "%03d", maxIndex);
+        std::string prefixIndex = indexString;
+        //prefix.replace(prefix.find("XXX"), std::string::npos, prefixIndex);
+        _ccd_replace_all(prefix, "XXX", prefixIndex);
+    }
 
-        fclose(fp);
+    snprintf(imageFileName, MAXRBUF, "%s/%s%s", UploadSettingsT[0].text, prefix.c_str(), format);
 
-        // Save image file path
-        IUSaveText(&FileNameT[0], imageFileName);
+    // The directory right before our file goes in, to tell our change from anyone else's
+    struct stat before;
+    if (stat(UploadSettingsT[UPLOAD_DIR].text, &before) == -1)
+        memset(&before, 0, sizeof(before));
 
-        DEBUGF(Logger::DBG_SESSION, "Image saved to %s", imageFileName);
-        FileNameTP.s = IPS_OK;
-        IDSetText(&FileNameTP, nullptr);
+    fp = fopen(imageFileName, "w");
+    if (fp == nullptr)
+    {
+        LOGF_ERROR("Unable to save image file (%s). %s", imageFileName, strerror(errno));
+        return false;
     }
 
+    int n = 0;
+    for (int nr = 0; nr < (int)totalBytes; nr += n)
+        n = fwrite((static_cast<const char *>(fitsData) + nr), 1, totalBytes - nr, fp);
+
+    fclose(fp);
+
+    updateFileIndex(UploadSettingsT[UPLOAD_DIR].text, UploadSettingsT[UPLOAD_PREFIX].text, prefix + format, before);
+
+    // Save image file path
+    IUSaveText(&FileNameT[0], imageFileName);
+
+    DEBUGF(Logger::DBG_SESSION, "Image saved to %s", imageFileName);
+    FileNameTP.s = IPS_OK;
+    IDSetText(&FileNameTP, nullptr);
+
+    return true;
+}
+
+bool CCD::sendFile(CCDChip * targetChip, const void * fitsData, size_t totalBytes, const char * extension)
+{
+    uint8_t * compressedData = nullptr;
+
     if (targetChip->SendCompressed)
     {
-        if (!strcmp(targetChip->getImageExtension(), "fits"))
+        if (!strcmp(extension, "fits"))
         {
+            // fpack works on a fixed temporary file, so primary and guide frames take turns
+            static std::mutex fpackLock;
+            std::lock_guard<std::mutex> fpackGuard(fpackLock);
+
             int  compressedBytes = 0;
             char filename[MAXRBUF] = {0};
             strncpy(filename, "/tmp/compressedfits.fits", MAXRBUF);
@@ -2754,7 +2987,7 @@ bool CCD::uploadFile(CCDChip * targetChip, const void * fitsData, size_t totalBy
             stat(filename, &st);
             compressedBytes = st.st_size;
 
-            compressedData = new uint8_t[compressedBytes];
+            compressedData = static_cast<uint8_t *>(BufferPool::instance().acquire(compressedBytes));
 
             if (compressedData == nullptr)
             {
@@ -2766,7 +2999,7 @@ bool CCD::uploadFile(CCDChip * targetChip, const void * fitsData, size_t totalBy
             if (fp == nullptr)
             {
                 LOGF_ERROR("Unable to open temporary image file: %s", strerror(errno));
-                delete [] compressedData;
+                BufferPool::instance().release(compressedData);
                 return false;
             }
 
@@ -2781,17 +3014,17 @@ bool CCD::uploadFile(CCDChip * targetChip, const void * fitsData, size_t totalBy
             targetChip->FitsB.blob    = compressedData;
             targetChip->FitsB.bloblen = compressedBytes;
             totalBytes = compressedBytes;
-            snprintf(targetChip->FitsB.format, MAXINDIBLOBFMT, ".%s.fz", targetChip->getImageExtension());
+            snprintf(targetChip->FitsB.format, MAXINDIBLOBFMT, ".%s.fz", extension);
         }
         else
         {
             uLong compressedBytes = sizeof(char) * totalBytes + totalBytes / 64 + 16 + 3;
-            compressedData  = new uint8_t[compressedBytes];
+            compressedData  = static_cast<uint8_t *>(BufferPool::instance().acquire(compressedBytes));
 
             if (fitsData == nullptr || compressedData == nullptr)
             {
                 if (compressedData)
-                    delete [] compressedData;
+                    BufferPool::instance().release(compressedData);
                 LOG_ERROR("Error: Ran out of memory compressing image");
                 return false;
             }
@@ -2801,55 +3034,50 @@ bool CCD::uploadFile(CCDChip * targetChip, const void * fitsData, size_t totalBy
             {
                 /* this should NEVER happen */
                 LOG_ERROR("Error: Failed to compress image");
-                delete [] compressedData;
+                BufferPool::instance().release(compressedData);
                 return false;
             }
 
             targetChip->FitsB.blob    = compressedData;
             targetChip->FitsB.bloblen = compressedBytes;
-            snprintf(targetChip->FitsB.format, MAXINDIBLOBFMT, ".%s.z", targetChip->getImageExtension());
+            snprintf(targetChip->FitsB.format, MAXINDIBLOBFMT, ".%s.z", extension);
         }
     }
     else
     {
         targetChip->FitsB.blob    = const_cast<void *>(fitsData);
         targetChip->FitsB.bloblen = totalBytes;
-        snprintf(targetChip->FitsB.format, MAXINDIBLOBFMT, ".%s", targetChip->getImageExtension());
+        snprintf(targetChip->FitsB.format, MAXINDIBLOBFMT, ".%s", extension);
     }
 
     targetChip->FitsB.size = totalBytes;
     targetChip->FitsBP.s   = IPS_OK;
 
-    if (sendImage)
-    {
 #ifdef HAVE_WEBSOCKET
-        if (HasWebSocket() && WebSocketS[WEBSOCKET_ENABLED].s == ISS_ON)
-        {
-            auto start = std::chrono::high_resolution_clock::now();
+    if (HasWebSocket() && WebSocketS[WEBSOCKET_ENABLED].s == ISS_ON)
+    {
+        auto start = std::chrono::high_resolution_clock::now();
 
-            // Send format/size/..etc first later
-            wsServer.send_text(std::string(targetChip->FitsB.format));
-            wsServer.send_binary(targetChip->FitsB.blob, targetChip->FitsB.bloblen);
+        // Send format/size/..etc first later
+        wsServer.send_text(std::string(targetChip->FitsB.format));
+        wsServer.send_binary(targetChip->FitsB.blob, targetChip->FitsB.bloblen);
 
-            auto end = std::chrono::high_resolution_clock::now();
-            std::chrono::duration<double> diff = end - start;
-            LOGF_DEBUG("Websocket transfer took %g seconds", diff.count());
-        }
-        else
+        auto end = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double> diff = end - start;
+        LOGF_DEBUG("Websocket transfer took %g seconds", diff.count());
+    }
+    else
 #endif
-        {
-            auto start = std::chrono::high_resolution_clock::now();
-            IDSetBLOB(&targetChip->FitsBP, nullptr);
-            auto end = std::chrono::high_resolution_clock::now();
-            std::chrono::duration<double> diff = end - start;
-            LOGF_DEBUG("BLOB transfer took %g seconds", diff.count());
-        }
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        IDSetBLOB(&targetChip->FitsBP, nullptr);
+        auto end = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double> diff = end - start;
+        LOGF_DEBUG("BLOB transfer took %g seconds", diff.count());
     }
 
     if (compressedData)
-        delete [] compressedData;
-
-    DEBUG(Logger::DBG_DEBUG, "Upload complete");
+        BufferPool::instance().release(compressedData);
 
     return true;
 }
@@ -2881,6 +3109,7 @@ bool CCD::saveConfigItems(FILE * fp)
     IUSaveConfigText(fp, &ActiveDeviceTP);
     IUSaveConfigSwitch(fp, &UploadSP);
     IUSaveConfigText(fp, &UploadSettingsTP);
+    IUSaveConfigNumber(fp, &BufferPoolLimitNP);
     IUSaveConfigSwitch(fp, &TelescopeTypeSP);
 #ifdef WITH_EXPOSURE_LOOPING
     IUSaveConfigSwitch(fp, &ExposureLoopSP);
@@ -2942,16 +3171,18 @@ IPState CCD::GuideWest(uint32_t ms)
 
 void CCD::getMinMax(double * min, double * max, CCDChip * targetChip)
 {
+    const FrameInfo info  = packagedInfo ? *packagedInfo : frameInfo(targetChip);
     int ind         = 0, i, j;
-    int imageHeight = targetChip->getSubH() / targetChip->getBinY();
-    int imageWidth  = targetChip->getSubW() / targetChip->getBinX();
+    int imageHeight = info.subH / info.binY;
+    int imageWidth  = info.subW / info.binX;
     double lmin = 0, lmax = 0;
+    const uint8_t * frame = packagedFrame ? packagedFrame : targetChip->getFrameBuffer();
 
-    switch (targetChip->getBPP())
+    switch (info.bpp)
     {
         case 8:
         {
-            uint8_t * imageBuffer = targetChip->getFrameBuffer();
+            const uint8_t * imageBuffer = frame;
             lmin = lmax = imageBuffer[0];
 
             for (i = 0; i < imageHeight; i++)
@@ -2968,7 +3199,7 @@ void CCD::getMinMax(double * min, double * max, CCDChip * targetChip)
 
         case 16:
         {
-            uint16_t * imageBuffer = reinterpret_cast<uint16_t*>(targetChip->getFrameBuffer());
+            const uint16_t * imageBuffer = reinterpret_cast<const uint16_t*>(frame);
             lmin = lmax = imageBuffer[0];
 
             for (i = 0; i < imageHeight; i++)
@@ -2985,7 +3216,7 @@ void CCD::getMinMax(double * min, double * max, CCDChip * targetChip)
 
         case 32:
         {
-            uint32_t * imageBuffer = reinterpret_cast<uint32_t*>(targetChip->getFrameBuffer());
+            const uint32_t * imageBuffer = reinterpret_cast<const uint32_t*>(frame);
             lmin = lmax = imageBuffer[0];
 
             for (i = 0; i < imageHeight; i++)
@@ -3017,11 +3248,8 @@ int CCD::getFileIndex(const char * dir, const char * prefix, const char * ext)
 
     DIR * dpdf = nullptr;
     struct dirent * epdf = nullptr;
-    std::vector<std::string> files = std::vector<std::string>();
 
-    std::string prefixIndex = prefix;
-    prefixIndex             = regex_replace_compat(prefixIndex, "_ISO8601", "");
-    prefixIndex             = regex_replace_compat(prefixIndex, "_XXX", "");
+    std::string prefixIndex = _ccd_index_prefix(prefix);
 
     // Create directory if does not exist
     struct stat st;
@@ -3033,6 +3261,8 @@ int CCD::getFileIndex(const char * dir, const char * prefix, const char * ext)
             DEBUGF(Logger::DBG_DEBUG, "Creating directory %s...", dir);
             if (_ccd_mkdir(dir, 0755) == -1)
                 LOGF_ERROR("Error creating directory %s (%s)", dir, strerror(errno));
+            if (stat(dir, &st) == -1)
+                return -1;
         }
         else
         {
@@ -3041,41 +3271,65 @@ int CCD::getFileIndex(const char * dir, const char * prefix, const char * ext)
         }
     }
 
+    time_t mtime;
+    long mtimeNsec;
+    _ccd_dir_mtime(st, mtime, mtimeNsec);
+
+    std::lock_guard<std::mutex> guard(fileIndexLock);
+    FileIndexEntry &entry = fileIndexCache[std::make_pair(std::string(dir), prefixIndex)];
+
+    // Nothing was added or removed since the last scan
+    if (entry.valid && entry.mtime == mtime && entry.mtimeNsec == mtimeNsec)
+        return (entry.maxIndex + 1);
+
     dpdf = opendir(dir);
-    if (dpdf != nullptr)
-    {
-        while ((epdf = readdir(dpdf)))
-        {
-            if (strstr(epdf->d_name, prefixIndex.c_str()))
-                files.push_back(epdf->d_name);
-        }
-    }
-    else
-    {
-        closedir(dpdf);
+    if (dpdf == nullptr)
         return -1;
-    }
-    int maxIndex = 0;
 
-    for (int i = 0; i < (int)files.size(); i++)
+    int maxIndex = 0;
+    while ((epdf = readdir(dpdf)))
     {
-        int index = -1;
-
-        std::string file  = files.at(i);
-        std::size_t start = file.find_last_of("_");
-        std::size_t end   = file.find_last_of(".");
-        if (start != std::string::npos)
-        {
-            index = atoi(file.substr(start + 1, end).c_str());
-            if (index > maxIndex)
-                maxIndex = index;
-        }
+        if (strstr(epdf->d_name, prefixIndex.c_str()))
+            maxIndex = std::max(maxIndex, _ccd_file_index(epdf->d_name));
     }
 
     closedir(dpdf);
+
+    entry.valid     = true;
+    entry.mtime     = mtime;
+    entry.mtimeNsec = mtimeNsec;
+    entry.maxIndex  = maxIndex;
+
     return (maxIndex + 1);
 }
 
+void CCD::updateFileIndex(const char * dir, const char * prefix, const std::string &fileName,
+                          const struct stat &before)
+{
+    std::string prefixIndex = _ccd_index_prefix(prefix);
+    struct stat st;
+    time_t mtime;
+    long mtimeNsec;
+
+    std::lock_guard<std::mutex> guard(fileIndexLock);
+    auto entry = fileIndexCache.find(std::make_pair(std::string(dir), prefixIndex));
+    if (entry == fileIndexCache.end() || !entry->second.valid)
+        return;
+
+    // Something else changed the directory since it was scanned, files we do not know of may be there
+    _ccd_dir_mtime(before, mtime, mtimeNsec);
+    if (stat(dir, &st) == -1 || mtime != entry->second.mtime || mtimeNsec != entry->second.mtimeNsec)
+    {
+        entry->second.valid = false;
+        return;
+    }
+
+    // Account for the file we just wrote, so our own save does not force a rescan
+    if (strstr(fileName.c_str(), prefixIndex.c_str()))
+        entry->second.maxIndex = std::max(entry->second.maxIndex, _ccd_file_index(fileName));
+    _ccd_dir_mtime(st, entry->second.mtime, entry->second.mtimeNsec);
+}
+
 void CCD::GuideComplete(INDI_EQ_AXIS axis)
 {
     GuiderInterface::GuideComplete(axis);
@@ -37,12 +37,17 @@
 
 #include <fitsio.h>
 
+#include <map>
 #include <memory>
 #include <cstring>
 #include <chrono>
 #include <stdint.h>
+#include <condition_variable>
 #include <mutex>
 #include <thread>
+#include <vector>
+
+#include <sys/stat.h>
 
 //JM 2019-01-17: Disabled until further notice
 //#define WITH_EXPOSURE_LOOPING
@@ -594,6 +599,41 @@ class CCD : public DefaultDevice, GuiderInterface
         ITextVectorProperty FileNameTP;
         IText FileNameT[1] {};
 
+        /**
+         *@brief PipelineTimingNP Seconds the last primary frame spent copying out of the frame buffer, in FITS
+         * packaging, on disk and in client upload. Saving and upload run concurrently.
+         */
+        INumberVectorProperty PipelineTimingNP;
+        INumber PipelineTimingN[4];
+        enum
+        {
+            PIPELINE_SNAPSHOT,
+            PIPELINE_FITS,
+            PIPELINE_SAVE,
+            PIPELINE_UPLOAD
+        };
+
+        /**
+         *@brief BufferPoolNP Frame buffer pool statistics of the driver: buffers reused and newly allocated,
+         * and megabytes held by the pool in total and in idle buffers.
+         */
+        INumberVectorProperty BufferPoolNP;
+        INumber BufferPoolN[4];
+        enum
+        {
+            POOL_HITS,
+            POOL_MISSES,
+            POOL_RESIDENT,
+            POOL_CACHED
+        };
+
+        /**
+         *@brief BufferPoolLimitNP Megabytes of idle buffers the frame buffer pool keeps for reuse. 0 keeps about
+         * two frames of the largest geometry in use.
+         */
+        INumberVectorProperty BufferPoolLimitNP;
+        INumber BufferPoolLimitN[1];
+
         ISwitch UploadS[3];
         ISwitchVectorProperty UploadSP;
 
@@ -673,11 +713,60 @@ class CCD : public DefaultDevice, GuiderInterface
         ///////////////////////////////////////////////////////////////////////////////
         /// Utility Functions
         ///////////////////////////////////////////////////////////////////////////////
-        bool uploadFile(CCDChip * targetChip, const void * fitsData, size_t totalBytes, bool sendImage, bool saveImage);
+        bool uploadFile(CCDChip * targetChip, const void * fitsData, size_t totalBytes, const char * extension,
+                        bool sendImage, bool saveImage, double timing[]);
+        bool saveFile(CCDChip * targetChip, const void * fitsData, size_t totalBytes, const char * extension);
+        bool sendFile(CCDChip * targetChip, const void * fitsData, size_t totalBytes, const char * extension);
         void getMinMax(double * min, double * max, CCDChip * targetChip);
         int getFileIndex(const char * dir, const char * prefix, const char * ext);
+        void updateFileIndex(const char * dir, const char * prefix, const std::string &fileName,
+                             const struct stat &before);
         bool ExposureCompletePrivate(CCDChip * targetChip);
 
+        // Chip settings a frame was taken with. They are copied along with its pixels, since the driver may set
+        // up the chip for the next frame while this one is still packaged.
+        struct FrameInfo
+        {
+            int subW { 0 }, subH { 0 };
+            int binX { 1 }, binY { 1 };
+            int bpp { 16 };
+            int nAxis { 2 };
+            float pixelSizeX { 0 }, pixelSizeY { 0 };
+            double exposureDuration { 0 };
+            char exposureStart[32] { 0 };
+            CCDChip::CCD_FRAME frameType { CCDChip::LIGHT_FRAME };
+            char extension[MAXINDIBLOBFMT] { 0 };
+        };
+        static FrameInfo frameInfo(CCDChip * targetChip);
+        // Settings of the frame being packaged on this thread, read by addFITSKeywords() and getMinMax()
+        static thread_local const FrameInfo * packagedInfo;
+
+        bool processFrame(CCDChip * targetChip, const uint8_t * frame, size_t frameSize, const FrameInfo &info,
+                          double timing[]);
+
+        // Completed frames are copied into pooled buffers and handed to processFrame() in order, per chip.
+        struct FramePipeline
+        {
+            std::mutex lock;
+            std::condition_variable cond;
+            uint32_t inFlight { 0 };
+            uint32_t nextTicket { 0 };
+            uint32_t serving { 0 };
+        } framePipeline[2];
+        // Frames per chip that may be copied out before the driver has to wait for the upload to finish
+        static constexpr uint32_t FRAME_PIPELINE_DEPTH { 2 };
+
+        // Highest image index per upload directory and prefix, rescanned only when the directory mtime changes
+        struct FileIndexEntry
+        {
+            bool valid { false };
+            time_t mtime { 0 };
+            long mtimeNsec { 0 };
+            int maxIndex { 0 };
+        };
+        std::map<std::pair<std::string, std::string>, FileIndexEntry> fileIndexCache;
+        std::mutex fileIndexLock;
+
         // Threading for Websocket
 #ifdef HAVE_WEBSOCKET
         std::thread wsThread;
@@ -16,6 +16,7 @@
  Boston, MA 02110-1301, USA.
 *******************************************************************************/
 #include "indiccdchip.h"
+#include "indibufferpool.h"
 #include "indidevapi.h"
 #include "locale_compat.h"
 
@@ -46,8 +47,15 @@ CCDChip::CCDChip()
 
 CCDChip::~CCDChip()
 {
-    delete [] RawFrame;
-    delete[] BinFrame;
+    releaseBuffer(RawFrame);
+    releaseBuffer(BinFrame);
+}
+
+void CCDChip::releaseBuffer(uint8_t *buffer)
+{
+    // Drivers may install their own frame buffer with setFrameBuffer()
+    if (BufferPool::instance().release(buffer) == false)
+        delete [] buffer;
 }
 
 void CCDChip::setFrameType(CCD_FRAME type)
@@ -164,13 +172,14 @@ void CCDChip::setFrameBufferSize(int nbuf, bool allocMem)
     if (allocMem == false)
         return;
 
-    delete [] RawFrame;
-    RawFrame = new uint8_t[nbuf];
+    // Buffers go back to the pool, so switching between subframes and full frames reuses the same blocks
+    releaseBuffer(RawFrame);
+    RawFrame = static_cast<uint8_t *>(BufferPool::instance().acquire(nbuf));
 
     if (BinFrame)
     {
-        delete [] BinFrame;
-        BinFrame = new uint8_t[nbuf];
+        releaseBuffer(BinFrame);
+        BinFrame = static_cast<uint8_t *>(BufferPool::instance().acquire(nbuf));
     }
 }
 
@@ -248,7 +257,7 @@ void CCDChip::binFrame()
 
     // Jasem: Keep full frame shadow in memory to enhance performance and just swap frame pointers after operation is complete
     if (BinFrame == nullptr)
-        BinFrame = new uint8_t[RawFrameSize];
+        BinFrame = static_cast<uint8_t *>(BufferPool::instance().acquire(RawFrameSize));
 
     memset(BinFrame, 0, RawFrameSize);
 
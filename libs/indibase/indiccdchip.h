@@ -195,7 +195,8 @@ class CCDChip
          * /note CCD Chip allocates the frame buffer internally once SetFrameBufferSize is called
          * with allocMem set to true which is the default behavior. If you allocated the memory
          * yourself (i.e. allocMem is false), then you must call this function to set the pointer
-         * to the raw frame buffer.
+         * to the raw frame buffer. A buffer that does not come from INDI::BufferPool must be
+         * allocated with new[].
          */
         void setFrameBuffer(uint8_t *buffer)
         {
@@ -381,6 +382,9 @@ class CCDChip
         void binFrame();
 
     private:
+        /// Return a frame buffer to the buffer pool, or delete it if the driver allocated it
+        static void releaseBuffer(uint8_t *buffer);
+
         /// Native x resolution of the ccd
         int XRes;
         /// Native y resolution of the ccd
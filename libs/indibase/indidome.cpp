@@ -29,8 +29,8 @@
 
 #include <libnova/julian_day.h>
 #include <libnova/sidereal_time.h>
-#include <libnova/transform.h>
 
+#include <algorithm>
 #include <cerrno>
 #include <cmath>
 #include <cstring>
@@ -1130,8 +1130,7 @@ To do that we need to calculate the optical axis line taking the centre of the d
 // maxAz: Maximum azimuth in order to avoid any dome interference to the full aperture of the telescope
 bool Dome::GetTargetAz(double &Az, double &Alt, double &minAz, double &maxAz)
 {
-    point3D MountCenter, OptCenter, OptVector, DomeIntersect;
-    double hourAngle;
+    point3D OptCenter, DomeIntersect;
     double mu1, mu2;
     double yx;
     double HalfApertureChordAngle;
@@ -1145,21 +1144,13 @@ bool Dome::GetTargetAz(double &Az, double &Alt, double &minAz, double &maxAz)
         return false;
     }
 
-    double JD  = ln_get_julian_from_sys();
-    double MSD = ln_get_mean_sidereal_time(JD);
-
-    LOGF_DEBUG("JD: %g - MSD: %g", JD, MSD);
-
-    MountCenter.x = DomeMeasurementsN[DM_EAST_DISPLACEMENT].value; // Positive to East
-    MountCenter.y = DomeMeasurementsN[DM_NORTH_DISPLACEMENT].value;  // Positive to North
-    MountCenter.z = DomeMeasurementsN[DM_UP_DISPLACEMENT].value;    // Positive Up
-
-    LOGF_DEBUG("MC.x: %g - MC.y: %g MC.z: %g", MountCenter.x, MountCenter.y, MountCenter.z);
+    // Reuses the solution from UpdateMountCoords() when called for the same snooped update
+    solveMountPosition();
 
-    // Get hour angle in hours
-    hourAngle = rangeHA( MSD + observer.lng / 15.0 - mountEquatorialCoords.ra / 15.0);
+    const SlavingGeometry &geometry = m_SlavingGeometry;
+    const MountSolution &mount      = m_MountSolution;
 
-    LOGF_DEBUG("HA: %g  Lng: %g RA: %g", hourAngle, observer.lng, mountEquatorialCoords.ra);
+    LOGF_DEBUG("HA: %g  Lng: %g RA: %g", mount.hourAngle, observer.lng, mountEquatorialCoords.ra);
 
     //  this will have state OK if the mount sent us information
     //  and it will be IDLE if not
@@ -1172,7 +1163,7 @@ bool Dome::GetTargetAz(double &Az, double &Alt, double &minAz, double &maxAz)
     else
     {
         //  figure out the pier side without help from the mount
-        if(hourAngle > 0) OTASide = -1;
+        if(mount.hourAngle > 0) OTASide = -1;
         else OTASide = 1;
         //  if we got here because we turned off the PIER_SIDE switches in a target goto
         //  lets try get it back on
@@ -1181,35 +1172,32 @@ bool Dome::GetTargetAz(double &Az, double &Alt, double &minAz, double &maxAz)
 
     }
 
-    OpticalCenter(MountCenter, OTASide * DomeMeasurementsN[DM_OTA_OFFSET].value, observer.lat, hourAngle, OptCenter);
+    // Same transformation as OpticalCenter(), with the latitude terms taken from the cached geometry
+    double offset = OTASide * DomeMeasurementsN[DM_OTA_OFFSET].value;
+    OptCenter.x   = geometry.mountCenter.x - offset * mount.cosHA;
+    OptCenter.y   = geometry.mountCenter.y + offset * mount.sinHA * geometry.sinLat;
+    OptCenter.z   = geometry.mountCenter.z + offset * mount.sinHA * geometry.cosLat;
 
     LOGF_DEBUG("OTA_SIDE: %d", OTASide);
-    LOGF_DEBUG("OTA_OFFSET: %g  Lat: %g", DomeMeasurementsN[DM_OTA_OFFSET].value, observer.lat);
     LOGF_DEBUG("OC.x: %g - OC.y: %g OC.z: %g", OptCenter.x, OptCenter.y, OptCenter.z);
-
-    // To be sure mountHoriztonalCoords is up to date.
-    ln_get_hrz_from_equ(&mountEquatorialCoords, &observer, JD, &mountHoriztonalCoords);
-
-    mountHoriztonalCoords.az += 180;
-    if (mountHoriztonalCoords.az >= 360)
-        mountHoriztonalCoords.az -= 360;
-    if (mountHoriztonalCoords.az < 0)
-        mountHoriztonalCoords.az += 360;
-
-    // Get optical axis point. This and the previous form the optical axis line
-    OpticalVector(mountHoriztonalCoords.az, mountHoriztonalCoords.alt, OptVector);
     LOGF_DEBUG("Mount Az: %g  Alt: %g", mountHoriztonalCoords.az, mountHoriztonalCoords.alt);
-    LOGF_DEBUG("OV.x: %g - OV.y: %g OV.z: %g", OptVector.x, OptVector.y, OptVector.z);
 
-    if (Intersection(OptCenter, OptVector, DomeMeasurementsN[DM_DOME_RADIUS].value, mu1, mu2))
+    // The optical axis is a unit vector, so Intersection() reduces to mu^2 + 2 * b * mu + c = 0
+    double b     = mount.axis.x * OptCenter.x + mount.axis.y * OptCenter.y + mount.axis.z * OptCenter.z;
+    double c     = OptCenter.x * OptCenter.x + OptCenter.y * OptCenter.y + OptCenter.z * OptCenter.z - geometry.radiusSq;
+    double disc  = b * b - c;
+    if (disc >= 0)
     {
+        mu1 = -b + sqrt(disc);
+        mu2 = -b - sqrt(disc);
+
         // If telescope is pointing over the horizon, the solution is mu1, else is mu2
         if (mu1 < 0)
             mu1 = mu2;
 
-        DomeIntersect.x = OptCenter.x + mu1 * (OptVector.x );
-        DomeIntersect.y = OptCenter.y + mu1 * (OptVector.y );
-        DomeIntersect.z = OptCenter.z + mu1 * (OptVector.z );
+        DomeIntersect.x = OptCenter.x + mu1 * (mount.axis.x );
+        DomeIntersect.y = OptCenter.y + mu1 * (mount.axis.y );
+        DomeIntersect.z = OptCenter.z + mu1 * (mount.axis.z );
 
         if (fabs(DomeIntersect.x) > 0.00001)
         {
@@ -1346,6 +1334,68 @@ bool Dome::CheckHorizon(double HA, double dec, double lat)
     return false;
 }
 
+void Dome::refreshSlavingGeometry()
+{
+    SlavingGeometry &geometry = m_SlavingGeometry;
+
+    bool changed = (geometry.lat != observer.lat);
+    for (int i = 0; i < 6 && !changed; i++)
+        changed = (geometry.measurements[i] != DomeMeasurementsN[i].value);
+    if (!changed)
+        return;
+
+    for (int i = 0; i < 6; i++)
+        geometry.measurements[i] = DomeMeasurementsN[i].value;
+    geometry.lat = observer.lat;
+
+    geometry.mountCenter.x = DomeMeasurementsN[DM_EAST_DISPLACEMENT].value;  // Positive to East
+    geometry.mountCenter.y = DomeMeasurementsN[DM_NORTH_DISPLACEMENT].value; // Positive to North
+    geometry.mountCenter.z = DomeMeasurementsN[DM_UP_DISPLACEMENT].value;    // Positive Up
+    geometry.sinLat        = sin(observer.lat * M_PI / 180);
+    geometry.cosLat        = cos(observer.lat * M_PI / 180);
+    geometry.radiusSq      = DomeMeasurementsN[DM_DOME_RADIUS].value * DomeMeasurementsN[DM_DOME_RADIUS].value;
+
+    LOGF_DEBUG("MC.x: %g - MC.y: %g MC.z: %g", geometry.mountCenter.x, geometry.mountCenter.y, geometry.mountCenter.z);
+}
+
+void Dome::solveMountPosition()
+{
+    MountSolution &mount = m_MountSolution;
+    double JD            = ln_get_julian_from_sys();
+
+    refreshSlavingGeometry();
+
+    if (mount.ra == mountEquatorialCoords.ra && mount.dec == mountEquatorialCoords.dec && mount.lng == observer.lng &&
+            mount.lat == observer.lat && fabs(JD - mount.JD) < MOUNT_SOLUTION_TTL)
+        return;
+
+    double MSD = ln_get_mean_sidereal_time(JD);
+
+    mount.JD        = JD;
+    mount.ra        = mountEquatorialCoords.ra;
+    mount.dec       = mountEquatorialCoords.dec;
+    mount.lng       = observer.lng;
+    mount.lat       = observer.lat;
+    mount.hourAngle = rangeHA(MSD + observer.lng / 15.0 - mountEquatorialCoords.ra / 15.0);
+    mount.sinHA     = sin(mount.hourAngle * M_PI / 12);
+    mount.cosHA     = cos(mount.hourAngle * M_PI / 12);
+
+    LOGF_DEBUG("JD: %g - MSD: %g", JD, MSD);
+
+    // Equatorial to horizontal using the same sidereal time as the hour angle above.
+    double sinDec = sin(mountEquatorialCoords.dec * M_PI / 180);
+    double cosDec = cos(mountEquatorialCoords.dec * M_PI / 180);
+
+    mount.axis.x = -cosDec * mount.sinHA;
+    mount.axis.y = m_SlavingGeometry.cosLat * sinDec - m_SlavingGeometry.sinLat * cosDec * mount.cosHA;
+    mount.axis.z = m_SlavingGeometry.sinLat * sinDec + m_SlavingGeometry.cosLat * cosDec * mount.cosHA;
+
+    mountHoriztonalCoords.alt = asin(std::max(-1.0, std::min(1.0, mount.axis.z))) * 180 / M_PI;
+    mountHoriztonalCoords.az  = atan2(mount.axis.x, mount.axis.y) * 180 / M_PI;
+    if (mountHoriztonalCoords.az < 0)
+        mountHoriztonalCoords.az += 360;
+}
+
 void Dome::UpdateMountCoords()
 {
     if (m_HorizontalUpdateTimerID > 0)
@@ -1364,13 +1414,7 @@ void Dome::UpdateMountCoords()
     if (!HaveRaDec)
         return;
 
-    ln_get_hrz_from_equ(&mountEquatorialCoords, &observer, ln_get_julian_from_sys(), &mountHoriztonalCoords);
-
-    mountHoriztonalCoords.az += 180;
-    if (mountHoriztonalCoords.az > 360)
-        mountHoriztonalCoords.az -= 360;
-    if (mountHoriztonalCoords.az < 0)
-        mountHoriztonalCoords.az += 360;
+    solveMountPosition();
 
     // Control debug flooding
     if (fabs(mountHoriztonalCoords.az - prev_az) > DOME_COORD_THRESHOLD ||
@@ -26,6 +26,7 @@
 
 #include <libnova/ln_types.h>
 
+#include <limits>
 #include <string>
 
 // Defines a point in a 3 dimension space
@@ -617,8 +618,45 @@ class Dome : public DefaultDevice
         bool callHandshake();
         uint8_t domeConnection = CONNECTION_SERIAL | CONNECTION_TCP;
 
+        /**
+         * @brief SlavingGeometry Observatory terms that only change when the dome measurements or the
+         * observer latitude change. Keyed by the values it was built from so drivers that write
+         * DomeMeasurementsN directly are picked up as well.
+         */
+        struct SlavingGeometry
+        {
+            double measurements[6] { 0, 0, 0, 0, 0, 0 };
+            double lat { std::numeric_limits<double>::quiet_NaN() };
+            point3D mountCenter { 0, 0, 0 };
+            double sinLat { 0 }, cosLat { 1 };
+            double radiusSq { 0 };
+        } m_SlavingGeometry;
+
+        /**
+         * @brief MountSolution Mount pointing solved for one instant, shared by UpdateMountCoords() and
+         * GetTargetAz() so each snooped update does a single sidereal time and horizontal conversion.
+         */
+        struct MountSolution
+        {
+            double JD { 0 };
+            double ra { std::numeric_limits<double>::quiet_NaN() };
+            double dec { std::numeric_limits<double>::quiet_NaN() };
+            double lng { std::numeric_limits<double>::quiet_NaN() };
+            // The horizontal axis depends on the latitude too
+            double lat { std::numeric_limits<double>::quiet_NaN() };
+            double hourAngle { 0 };
+            double sinHA { 0 }, cosHA { 1 };
+            // Unit vector of the optical axis (x: east, y: north, z: up)
+            point3D axis { 0, 0, 1 };
+        } m_MountSolution;
+
+        void refreshSlavingGeometry();
+        void solveMountPosition();
+
         // How often we update horizontal coordinates (10 seconds).
         static constexpr uint32_t HORZ_UPDATE_TIMER { 10000 };
+        // A mount solution is reused for this long (1 s of sidereal time, 15 arcsec in hour angle).
+        static constexpr double MOUNT_SOLUTION_TTL { 1.0 / 86400.0 };
 };
 
 }
@@ -0,0 +1,333 @@
+/*******************************************************************************
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#include "indihttpfetcher.h"
+
+#include "indidevapi.h"
+
+#include <curl/curl.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace INDI
+{
+
+// Time allowed to set up a connection, within the timeout of the transfer
+static constexpr long CONNECT_TIMEOUT = 10000;
+// Idle connections kept open for the next requests
+static constexpr long MAX_CONNECTIONS = 8;
+
+static bool openPipe(int fds[2])
+{
+    if (pipe(fds) < 0)
+        return false;
+
+    fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+    fcntl(fds[1], F_SETFL, fcntl(fds[1], F_GETFL) | O_NONBLOCK);
+    fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+    fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+    return true;
+}
+
+static void drainPipe(int fd)
+{
+    char buf[64];
+
+    while (read(fd, buf, sizeof(buf)) > 0)
+        ;
+}
+
+HTTPFetcher &HTTPFetcher::instance()
+{
+    // Never destroyed: static driver instances cancel their requests during exit.
+    static HTTPFetcher *fetcher = new HTTPFetcher();
+    return *fetcher;
+}
+
+HTTPFetcher::HTTPFetcher()
+{
+    // Not thread safe, so done here before the worker exists
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+
+    multi = curl_multi_init();
+    curl_multi_setopt(multi, CURLMOPT_MAXCONNECTS, MAX_CONNECTIONS);
+
+    if (!openPipe(workerPipe) || !openPipe(mainLoopPipe))
+    {
+        IDLog("HTTPFetcher: pipe: %s\n", strerror(errno));
+        return;
+    }
+
+    IEAddCallback(mainLoopPipe[0], mainLoopCallback, this);
+
+    worker = std::thread(&HTTPFetcher::run, this);
+    worker.detach();
+}
+
+int HTTPFetcher::fetch(const std::string &url, Callback callback, long timeout)
+{
+    Request request;
+
+    request.url      = url;
+    request.timeout  = timeout;
+    request.callback = std::move(callback);
+
+    return submit(std::move(request));
+}
+
+HTTPFetcher::Result HTTPFetcher::fetchNow(const std::string &url, long timeout)
+{
+    Request request;
+
+    request.url     = url;
+    request.timeout = timeout;
+    request.now     = true;
+
+    int id = submit(std::move(request));
+
+    std::unique_lock<std::mutex> guard(lock);
+    nowDone.wait(guard, [&]()
+    {
+        return nowResults.count(id) > 0;
+    });
+
+    Result result = std::move(nowResults[id]);
+    nowResults.erase(id);
+    return result;
+}
+
+void HTTPFetcher::cancel(int id)
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+
+        auto matches = [id](const Request & request)
+        {
+            return request.id == id;
+        };
+
+        // Not started yet, or finished and waiting for the main loop
+        auto it = std::find_if(submitted.begin(), submitted.end(), matches);
+        if (it != submitted.end())
+        {
+            submitted.erase(it);
+            return;
+        }
+
+        it = std::find_if(finished.begin(), finished.end(), matches);
+        if (it != finished.end())
+        {
+            finished.erase(it);
+            return;
+        }
+
+        // Running, or unknown
+        cancelled.push_back(id);
+    }
+
+    wakeWorker();
+}
+
+int HTTPFetcher::submit(Request request)
+{
+    int id;
+
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        id = request.id = nextID++;
+        submitted.push_back(std::move(request));
+    }
+
+    wakeWorker();
+    return id;
+}
+
+void HTTPFetcher::wakeWorker()
+{
+    char c = 0;
+
+    // A full pipe wakes the worker just as well
+    if (write(workerPipe[1], &c, 1) < 0 && errno != EAGAIN)
+        IDLog("HTTPFetcher: write: %s\n", strerror(errno));
+}
+
+void HTTPFetcher::run()
+{
+    for (;;)
+    {
+        int active = 0;
+        int left   = 0;
+        CURLMsg *message;
+        struct curl_waitfd wake;
+
+        startTransfers();
+
+        curl_multi_perform(multi, &active);
+        while ((message = curl_multi_info_read(multi, &left)) != nullptr)
+        {
+            if (message->msg == CURLMSG_DONE)
+                finishTransfer(message->easy_handle, message->data.result);
+        }
+
+        // Until a transfer needs attention, curl times out a transfer, or new requests arrive
+        wake.fd      = workerPipe[0];
+        wake.events  = CURL_WAIT_POLLIN;
+        wake.revents = 0;
+        curl_multi_wait(multi, &wake, 1, 1000, nullptr);
+        if (wake.revents)
+            drainPipe(workerPipe[0]);
+    }
+}
+
+void HTTPFetcher::startTransfers()
+{
+    std::deque<Request> requests;
+    std::vector<int> aborted;
+
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        requests.swap(submitted);
+        aborted.swap(cancelled);
+    }
+
+    for (int id : aborted)
+    {
+        auto it = running.find(id);
+        if (it == running.end())
+            continue;
+
+        curl_multi_remove_handle(multi, it->second.handle);
+        idleHandles.push_back(it->second.handle);
+        running.erase(it);
+    }
+
+    for (Request &next : requests)
+    {
+        CURL *handle = nullptr;
+
+        if (!idleHandles.empty())
+        {
+            handle = idleHandles.back();
+            idleHandles.pop_back();
+            curl_easy_reset(handle);
+        }
+        else
+            handle = curl_easy_init();
+
+        if (handle == nullptr)
+        {
+            next.result.error = "curl_easy_init failed";
+            complete(next);
+            continue;
+        }
+
+        // Entries of running stay in place, so the transfer can write straight into its result
+        Request &request = running.emplace(next.id, std::move(next)).first->second;
+        request.handle   = handle;
+
+        curl_easy_setopt(handle, CURLOPT_URL, request.url.c_str());
+        curl_easy_setopt(handle, CURLOPT_WRITEFUNCTION, writeCallback);
+        curl_easy_setopt(handle, CURLOPT_WRITEDATA, &request.result.body);
+        curl_easy_setopt(handle, CURLOPT_PRIVATE, &request);
+        curl_easy_setopt(handle, CURLOPT_USERAGENT, "libcurl-agent/1.0");
+        curl_easy_setopt(handle, CURLOPT_ACCEPT_ENCODING, "");
+        curl_easy_setopt(handle, CURLOPT_NOSIGNAL, 1L);
+        curl_easy_setopt(handle, CURLOPT_TIMEOUT_MS, request.timeout);
+        curl_easy_setopt(handle, CURLOPT_CONNECTTIMEOUT_MS, std::min(request.timeout, CONNECT_TIMEOUT));
+
+        curl_multi_add_handle(multi, handle);
+    }
+}
+
+void HTTPFetcher::finishTransfer(void *handle, int code)
+{
+    Request *request = nullptr;
+
+    curl_easy_getinfo(handle, CURLINFO_PRIVATE, &request);
+    curl_easy_getinfo(handle, CURLINFO_RESPONSE_CODE, &request->result.status);
+    curl_multi_remove_handle(multi, handle);
+    idleHandles.push_back(handle);
+
+    request->result.ok = (code == CURLE_OK);
+    if (!request->result.ok)
+        request->result.error = curl_easy_strerror(static_cast<CURLcode>(code));
+
+    int id = request->id;
+    complete(*request);
+    running.erase(id);
+}
+
+void HTTPFetcher::complete(Request &request)
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+
+        // Cancelled while running
+        if (std::find(cancelled.begin(), cancelled.end(), request.id) != cancelled.end())
+            return;
+
+        if (request.now)
+        {
+            nowResults[request.id] = std::move(request.result);
+            nowDone.notify_all();
+            return;
+        }
+
+        finished.push_back(std::move(request));
+    }
+
+    char c = 0;
+    if (write(mainLoopPipe[1], &c, 1) < 0 && errno != EAGAIN)
+        IDLog("HTTPFetcher: write: %s\n", strerror(errno));
+}
+
+void HTTPFetcher::mainLoopCallback(int fd, void *userpointer)
+{
+    drainPipe(fd);
+    static_cast<HTTPFetcher *>(userpointer)->deliver();
+}
+
+void HTTPFetcher::deliver()
+{
+    for (;;)
+    {
+        Request request;
+
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            if (finished.empty())
+                return;
+            request = std::move(finished.front());
+            finished.pop_front();
+        }
+
+        // Without the lock, the callback may well fetch again
+        request.callback(request.result);
+    }
+}
+
+size_t HTTPFetcher::writeCallback(char *data, size_t size, size_t count, void *userpointer)
+{
+    static_cast<std::string *>(userpointer)->append(data, size * count);
+    return size * count;
+}
+
+}
@@ -0,0 +1,133 @@
+/*******************************************************************************
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace INDI
+{
+
+/**
+ * @brief The HTTPFetcher class fetches URLs in the background for drivers of web based services.
+ *
+ * Transfers run on a worker thread through one curl multi handle, so connections to a service and its DNS
+ * lookups are reused from one request to the next. The result of a transfer is handed back on the driver's
+ * main loop, where the callback given to fetch() may update properties as usual. A slow or dead service
+ * therefore never stalls the timers and client requests of the driver.
+ *
+ * Any URL supported by libcurl can be fetched, file:// URLs included.
+ *
+ * The fetcher is shared by all devices of the driver process.
+ */
+class HTTPFetcher
+{
+    public:
+        struct Result
+        {
+            /** True if the transfer completed, whatever the HTTP status */
+            bool ok { false };
+            /** HTTP status code, 0 if none was received */
+            long status { 0 };
+            std::string body;
+            /** Reason of the failure if not ok */
+            std::string error;
+        };
+
+        using Callback = std::function<void(const Result &)>;
+
+        /** Default time allowed for a whole transfer */
+        static constexpr long DEFAULT_TIMEOUT = 30000;
+
+        /**
+         * @return The fetcher of the driver process.
+         */
+        static HTTPFetcher &instance();
+
+        /**
+         * @brief fetch Start fetching url. Returns at once.
+         * @param url URL to fetch.
+         * @param callback called on the main loop with the result once the transfer completed or failed.
+         * @param timeout time allowed for the transfer in milliseconds.
+         * @return id of the request for cancel().
+         */
+        int fetch(const std::string &url, Callback callback, long timeout = DEFAULT_TIMEOUT);
+
+        /**
+         * @brief fetchNow Fetch url through the shared connections and wait for the result. Meant for the few
+         * places that cannot proceed without it, like connecting a device.
+         */
+        Result fetchNow(const std::string &url, long timeout = DEFAULT_TIMEOUT);
+
+        /**
+         * @brief cancel Abort request id. Its callback is not called anymore, even if the result is already
+         * waiting for the main loop. Unknown or finished ids are ignored.
+         */
+        void cancel(int id);
+
+    private:
+        HTTPFetcher();
+
+        struct Request
+        {
+            int id;
+            std::string url;
+            long timeout;
+            Callback callback;
+            // fetchNow() requests are handed back to the waiting caller instead of the main loop
+            bool now { false };
+            void *handle { nullptr };
+            Result result;
+        };
+
+        int submit(Request request);
+        void run();
+        void startTransfers();
+        void finishTransfer(void *handle, int code);
+        void complete(Request &request);
+        void wakeWorker();
+        static void mainLoopCallback(int fd, void *userpointer);
+        void deliver();
+        static size_t writeCallback(char *data, size_t size, size_t count, void *userpointer);
+
+        std::mutex lock;
+        std::condition_variable nowDone;
+        std::thread worker;
+        // Requests waiting for the worker, and results waiting for the main loop or fetchNow()
+        std::deque<Request> submitted;
+        std::deque<Request> finished;
+        std::map<int, Result> nowResults;
+        std::vector<int> cancelled;
+        int nextID { 1 };
+        // Wake the worker out of curl_multi_wait(), and the main loop when results are ready
+        int workerPipe[2] { -1, -1 };
+        int mainLoopPipe[2] { -1, -1 };
+
+        // Only used by the worker
+        void *multi { nullptr };
+        std::map<int, Request> running;
+        // Easy handles of finished transfers, kept for reuse
+        std::vector<void *> idleHandles;
+};
+
+}
@@ -22,11 +22,15 @@
 
 #include <dirent.h>
 #include <cerrno>
+#include <chrono>
 #include <iostream>
 #include <cstdlib>
 #include <cstring>
 #include <sys/stat.h>
 
+// Longest time a file log record waits in the ring before it is written
+#define LOG_WRITER_PERIOD_MS 50
+
 namespace INDI
 {
 char Logger::Tags[Logger::nlevels][MAXINDINAME] = { "ERROR",       "WARNING",     "INFO",        "DEBUG",
@@ -305,13 +309,17 @@ void Logger::configure(const std::string &outputFile, const loggerConf configura
                        const int screenVerbosityLevel)
 {
     Logger::lock();
+    std::unique_lock<std::mutex> fileLock(fileLock_);
 
     fileVerbosityLevel_   = fileVerbosityLevel;
     screenVerbosityLevel_ = screenVerbosityLevel;
     rememberscreenlevel_  = screenVerbosityLevel_;
     // Close the old stream, if needed
     if (configuration_ & file_on)
+    {
+        drain();
         out_.close();
+    }
 
     // Compute a new file name, if needed
     if (outputFile != logFile_)
@@ -339,19 +347,42 @@ void Logger::configure(const std::string &outputFile, const loggerConf configura
     {
         _mkdir(logDir_.c_str(), 0775);
         out_.open(logFile_.c_str(), std::ios::app);
+
+        // File records are written by a background thread, started the first time they are needed
+        if (ring_ == nullptr)
+        {
+            ring_.reset(new Record[ringSize]);
+            for (size_t i = 0; i < ringSize; i++)
+                ring_[i].seq.store(i, std::memory_order_relaxed);
+            ringHead_ = 0;
+            ringTail_ = 0;
+            writer_   = std::thread(&Logger::writerLoop, this);
+            atexit(flushAtExit);
+        }
     }
 
     configuration_ = configuration;
     configured_    = true;
 
+    fileLock.unlock();
     Logger::unlock();
 }
 
 Logger::~Logger()
 {
     Logger::lock();
+    if (writer_.joinable())
+    {
+        stopWriter_ = true;
+        wake_.notify_one();
+        writer_.join();
+    }
+
     if (configuration_ & file_on)
+    {
+        drain();
         out_.close();
+    }
 
     m_ = nullptr;
     Logger::unlock();
@@ -400,12 +431,15 @@ void Logger::print(const char *devicename, const unsigned int verbosityLevel, co
 
     INDI_UNUSED(file);
     INDI_UNUSED(line);
-    bool filelog   = (verbosityLevel & fileVerbosityLevel_) != 0;
-    bool screenlog = (verbosityLevel & screenVerbosityLevel_) != 0;
+    bool filelog   = (configuration_ & file_on) && (verbosityLevel & fileVerbosityLevel_) != 0;
+    bool screenlog = (configuration_ & screen_on) && (verbosityLevel & screenVerbosityLevel_) != 0;
+
+    // Nothing will see it, do not even format it
+    if (configured_ && !filelog && !screenlog)
+        return;
 
     va_list ap;
     char msg[257];
-    char usec[7];
 
     msg[256] = '\0';
     va_start(ap, message);
@@ -418,30 +452,128 @@ void Logger::print(const char *devicename, const unsigned int verbosityLevel, co
         std::cerr << msg << std::endl;
         return;
     }
-    struct timeval currentTime, resTime;
-    usec[6] = '\0';
-    gettimeofday(&currentTime, nullptr);
-    timersub(&currentTime, &initialTime_, &resTime);
-#if defined(__APPLE__)
-    snprintf(usec, 7, "%06d", resTime.tv_usec);
-#else
-    snprintf(usec, 7, "%06ld", resTime.tv_usec);
-#endif
-    Logger::lock();
 
-    if ((configuration_ & file_on) && filelog)
+    if (filelog)
     {
-        if (nDevices == 1)
-            out_ << Tags[rank(verbosityLevel)] << "\t" << (resTime.tv_sec) << "." << (usec) << " sec"
-                 << "\t: " << msg << std::endl;
-        else
-            out_ << Tags[rank(verbosityLevel)] << "\t" << (resTime.tv_sec) << "." << (usec) << " sec"
-                 << "\t: [" << devicename << "] " << msg << std::endl;
+        struct timeval currentTime, resTime;
+        gettimeofday(&currentTime, nullptr);
+        timersub(&currentTime, &initialTime_, &resTime);
+        enqueue(devicename, verbosityLevel, resTime, msg);
     }
 
-    if ((configuration_ & screen_on) && screenlog)
+    if (screenlog)
         IDMessage(devicename, "[%s] %s", Tags[rank(verbosityLevel)], msg);
+}
 
-    Logger::unlock();
+void Logger::enqueue(const char *devicename, unsigned int verbosityLevel, const struct timeval &resTime,
+                     const char *msg)
+{
+    Record *ring = ring_.get();
+    if (ring == nullptr)
+        return;
+
+    // Claim a slot, give up rather than wait if the writer is a full ring behind
+    size_t pos = ringHead_.load(std::memory_order_relaxed);
+    Record *r  = nullptr;
+    for (;;)
+    {
+        r           = &ring[pos & (ringSize - 1)];
+        size_t seq  = r->seq.load(std::memory_order_acquire);
+        intptr_t df = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+        if (df == 0)
+        {
+            if (ringHead_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                break;
+        }
+        else if (df < 0)
+        {
+            dropped_++;
+            droppedTotal_++;
+            return;
+        }
+        else
+            pos = ringHead_.load(std::memory_order_relaxed);
+    }
+
+    r->level = verbosityLevel;
+    r->time  = resTime;
+    strncpy(r->device, devicename ? devicename : "", MAXINDIDEVICE - 1);
+    r->device[MAXINDIDEVICE - 1] = '\0';
+    strncpy(r->message, msg, sizeof(r->message) - 1);
+    r->message[sizeof(r->message) - 1] = '\0';
+    r->seq.store(pos + 1, std::memory_order_release);
+
+    // The writer wakes up on its own every LOG_WRITER_PERIOD_MS, only hurry it when the ring fills up
+    if (pos - ringTail_.load(std::memory_order_relaxed) == ringSize / 2)
+        wake_.notify_one();
+}
+
+void Logger::drain()
+{
+    Record *ring = ring_.get();
+    std::string batch;
+    char line[96];
+
+    if (ring == nullptr)
+        return;
+
+    unsigned long lost = dropped_.exchange(0);
+    if (lost > 0)
+    {
+        struct timeval currentTime, resTime;
+        gettimeofday(&currentTime, nullptr);
+        timersub(&currentTime, &initialTime_, &resTime);
+        snprintf(line, sizeof(line), "\t%ld.%06ld sec\t: Logger dropped %lu records\n",
+                 static_cast<long>(resTime.tv_sec), static_cast<long>(resTime.tv_usec), lost);
+        batch.append(Tags[rank(DBG_WARNING)]).append(line);
+    }
+
+    size_t tail = ringTail_.load(std::memory_order_relaxed);
+    for (;; tail++)
+    {
+        Record *r = &ring[tail & (ringSize - 1)];
+        if (r->seq.load(std::memory_order_acquire) != tail + 1)
+            break;
+
+        snprintf(line, sizeof(line), "\t%ld.%06ld sec\t: ", static_cast<long>(r->time.tv_sec),
+                 static_cast<long>(r->time.tv_usec));
+        batch.append(Tags[rank(r->level)]).append(line);
+        if (nDevices != 1)
+            batch.append("[").append(r->device).append("] ");
+        batch.append(r->message).append("\n");
+
+        r->seq.store(tail + ringSize, std::memory_order_release);
+    }
+    ringTail_.store(tail, std::memory_order_relaxed);
+
+    if (!batch.empty() && out_.is_open())
+    {
+        out_.write(batch.data(), batch.size());
+        out_.flush();
+    }
 }
+
+void Logger::writerLoop()
+{
+    while (!stopWriter_)
+    {
+        {
+            std::unique_lock<std::mutex> lock(wakeLock_);
+            wake_.wait_for(lock, std::chrono::milliseconds(LOG_WRITER_PERIOD_MS));
+        }
+
+        std::lock_guard<std::mutex> lock(fileLock_);
+        drain();
+    }
+}
+
+void Logger::flushAtExit()
+{
+    if (m_ == nullptr || m_->ring_ == nullptr)
+        return;
+
+    std::lock_guard<std::mutex> lock(m_->fileLock_);
+    m_->drain();
+}
+
 }
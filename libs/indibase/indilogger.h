@@ -24,10 +24,15 @@
 #include "defaultdevice.h"
 
 #include <stdarg.h>
+#include <atomic>
+#include <condition_variable>
 #include <fstream>
+#include <memory>
+#include <mutex>
 #include <ostream>
 #include <string>
 #include <sstream>
+#include <thread>
 #include <sys/time.h>
 
 /**
@@ -153,6 +158,48 @@ class Logger
 
     /// Stream used when logging on a file
     std::ofstream out_;
+
+    /**
+     * @brief A log record waiting in the ring to be written to the file.
+     * seq implements the bounded MPSC queue: a slot is free for the producer claiming
+     * position pos when seq == pos, and ready for the writer when seq == pos + 1.
+     */
+    struct Record
+    {
+        std::atomic<size_t> seq;
+        unsigned int level;
+        struct timeval time;
+        char device[MAXINDIDEVICE];
+        char message[MAXINDIMESSAGE + 2];
+    };
+
+    /// Number of records the ring holds, must be a power of two
+    static const size_t ringSize = 2048;
+    /// Ring of records, allocated when logging to file is first enabled
+    std::unique_ptr<Record[]> ring_;
+    /// Next position producers claim
+    std::atomic<size_t> ringHead_ { 0 };
+    /// Next position the writer drains, only advanced with fileLock_ held
+    std::atomic<size_t> ringTail_ { 0 };
+    /// Records dropped because the ring was full, since last reported in the file / in total
+    std::atomic<unsigned long> dropped_ { 0 };
+    std::atomic<unsigned long> droppedTotal_ { 0 };
+    /// Serializes the writer with configure(), which reopens out_
+    std::mutex fileLock_;
+    std::mutex wakeLock_;
+    std::condition_variable wake_;
+    std::thread writer_;
+    std::atomic<bool> stopWriter_ { false };
+
+    /** Queue a record for the writer thread. Never blocks, counts the record as dropped if the ring is full. */
+    void enqueue(const char *devicename, unsigned int verbosityLevel, const struct timeval &resTime,
+                 const char *msg);
+    /** Write all queued records to the file in one batch. N.B. fileLock_ must be held */
+    void drain();
+    /** Writer thread body */
+    void writerLoop();
+    /** Write out what is still queued when the driver exits */
+    static void flushAtExit();
     /// Initial time (used to print relative times)
     struct timeval initialTime_;
     /// Verbosity threshold for files
@@ -223,6 +270,8 @@ class Logger
     static unsigned int nDevices;
 
     static std::string getLogFile() { return logFile_; }
+    /** @return Number of file log records dropped so far because the writer could not keep up. */
+    unsigned long getDroppedRecords() { return droppedTotal_.load(); }
     static loggerConf_ getConfiguration() { return configuration_; }
 
     /**
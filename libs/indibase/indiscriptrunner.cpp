@@ -0,0 +1,474 @@
+/*******************************************************************************
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#include "indiscriptrunner.h"
+
+#include "indidevapi.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char **environ;
+
+namespace INDI
+{
+
+// How often running scripts are checked for exit
+static constexpr int REAP_INTERVAL = 20;
+// Time left to a script to exit after SIGTERM, before SIGKILL
+static constexpr int TERMINATE_GRACE = 2000;
+// Output kept from each of stdout and stderr, the rest is read and dropped
+static constexpr size_t MAX_OUTPUT = 1024 * 1024;
+
+// The write end is left blocking, it becomes the standard output of the script
+static bool openPipe(int fds[2])
+{
+    if (pipe(fds) < 0)
+        return false;
+
+    fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+    fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+    fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+    return true;
+}
+
+// True once pid exited. If the driver ignores SIGCHLD, the exit status is lost and reads as success.
+static bool reaped(pid_t pid, int &status)
+{
+    pid_t rc = waitpid(pid, &status, WNOHANG);
+    return rc == pid || (rc < 0 && errno == ECHILD);
+}
+
+ScriptRunner &ScriptRunner::instance()
+{
+    // Never destroyed: static driver instances cancel their scripts during exit.
+    static ScriptRunner *runner = new ScriptRunner();
+    return *runner;
+}
+
+int ScriptRunner::run(const std::vector<std::string> &args, Callback callback, int timeout, bool urgent)
+{
+    Job job;
+
+    job.id       = nextID++;
+    job.args     = args;
+    job.callback = std::move(callback);
+    job.timeout  = timeout;
+
+    int id = job.id;
+
+    if (urgent)
+        start(std::move(job));
+    else
+    {
+        waiting.push_back(std::move(job));
+        startWaiting();
+    }
+
+    return id;
+}
+
+ScriptRunner::Result ScriptRunner::runNow(const std::vector<std::string> &args, int timeout)
+{
+    Result result;
+    int fds[2];
+
+    pid_t pid = spawn(args, fds, result.error);
+    if (pid < 0)
+        return result;
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
+    int status    = 0;
+
+    while (!reaped(pid, status))
+    {
+        struct pollfd pfds[2];
+        int count = 0;
+
+        for (int fd : fds)
+        {
+            if (fd >= 0)
+                pfds[count++] = { fd, POLLIN, 0 };
+        }
+        poll(pfds, count, REAP_INTERVAL);
+
+        for (int i = 0; i < 2; i++)
+        {
+            if (fds[i] >= 0 && !readOutput(fds[i], i == 0 ? result.output : result.errors))
+            {
+                close(fds[i]);
+                fds[i] = -1;
+            }
+        }
+
+        if (timeout > 0 && std::chrono::steady_clock::now() >= deadline)
+        {
+            signalGroup(pid, result.timedOut ? SIGKILL : SIGTERM);
+            result.timedOut = true;
+            deadline += std::chrono::milliseconds(TERMINATE_GRACE);
+        }
+    }
+
+    for (int i = 0; i < 2; i++)
+    {
+        if (fds[i] >= 0)
+        {
+            readOutput(fds[i], i == 0 ? result.output : result.errors);
+            close(fds[i]);
+        }
+    }
+
+    setExitStatus(result, status, timeout);
+    return result;
+}
+
+void ScriptRunner::cancel(int id)
+{
+    auto matches = [id](const Job & job)
+    {
+        return job.id == id;
+    };
+
+    auto it = std::find_if(waiting.begin(), waiting.end(), matches);
+    if (it != waiting.end())
+    {
+        waiting.erase(it);
+        return;
+    }
+
+    it = std::find_if(failed.begin(), failed.end(), matches);
+    if (it != failed.end())
+    {
+        failed.erase(it);
+        return;
+    }
+
+    auto job = running.find(id);
+    if (job == running.end())
+        return;
+
+    signalGroup(job->second.pid, SIGKILL);
+    killed.push_back(job->second.pid);
+    release(job->second);
+    running.erase(job);
+
+    startWaiting();
+    watchExits();
+}
+
+bool ScriptRunner::isActive(int id) const
+{
+    auto matches = [id](const Job & job)
+    {
+        return job.id == id;
+    };
+
+    return running.count(id) > 0 || std::any_of(waiting.begin(), waiting.end(), matches) ||
+           std::any_of(failed.begin(), failed.end(), matches);
+}
+
+void ScriptRunner::setMaxRunning(int count)
+{
+    maximum = std::max(count, 1);
+    startWaiting();
+}
+
+int ScriptRunner::maxRunning() const
+{
+    return maximum;
+}
+
+pid_t ScriptRunner::spawn(const std::vector<std::string> &args, int fds[2], std::string &error)
+{
+    int out[2], err[2];
+
+    if (args.empty())
+    {
+        error = "No program to run";
+        return -1;
+    }
+
+    if (!openPipe(out))
+    {
+        error = std::string("pipe: ") + strerror(errno);
+        return -1;
+    }
+
+    if (!openPipe(err))
+    {
+        error = std::string("pipe: ") + strerror(errno);
+        close(out[0]);
+        close(out[1]);
+        return -1;
+    }
+
+    posix_spawn_file_actions_t actions;
+    posix_spawnattr_t attributes;
+    sigset_t defaults, mask;
+
+    // Keep the script off the driver's stdin and stdout, they carry the protocol to indiserver
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+    posix_spawn_file_actions_adddup2(&actions, out[1], STDOUT_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, err[1], STDERR_FILENO);
+
+    // Own process group, so a timeout also ends whatever the script started
+    sigemptyset(&mask);
+    sigemptyset(&defaults);
+    sigaddset(&defaults, SIGPIPE);
+    posix_spawnattr_init(&attributes);
+    posix_spawnattr_setflags(&attributes, POSIX_SPAWN_SETPGROUP | POSIX_SPAWN_SETSIGDEF | POSIX_SPAWN_SETSIGMASK);
+    posix_spawnattr_setpgroup(&attributes, 0);
+    posix_spawnattr_setsigdefault(&attributes, &defaults);
+    posix_spawnattr_setsigmask(&attributes, &mask);
+
+    std::vector<char *> argv;
+    for (const std::string &arg : args)
+        argv.push_back(const_cast<char *>(arg.c_str()));
+    argv.push_back(nullptr);
+
+    pid_t pid;
+    int rc = posix_spawnp(&pid, argv[0], &actions, &attributes, argv.data(), environ);
+
+    posix_spawn_file_actions_destroy(&actions);
+    posix_spawnattr_destroy(&attributes);
+    close(out[1]);
+    close(err[1]);
+
+    if (rc != 0)
+    {
+        error = args[0] + ": " + strerror(rc);
+        close(out[0]);
+        close(err[0]);
+        return -1;
+    }
+
+    fds[0] = out[0];
+    fds[1] = err[0];
+    return pid;
+}
+
+void ScriptRunner::signalGroup(pid_t pid, int signal)
+{
+    if (::kill(-pid, signal) < 0)
+        ::kill(pid, signal);
+}
+
+bool ScriptRunner::readOutput(int fd, std::string &output)
+{
+    char buf[4096];
+
+    for (;;)
+    {
+        ssize_t n = read(fd, buf, sizeof(buf));
+
+        if (n > 0)
+        {
+            output.append(buf, std::min(static_cast<size_t>(n), MAX_OUTPUT - std::min(output.size(), MAX_OUTPUT)));
+            continue;
+        }
+
+        if (n < 0 && errno == EINTR)
+            continue;
+
+        // Nothing more for now, or end of file
+        return n < 0 && errno == EAGAIN;
+    }
+}
+
+void ScriptRunner::setExitStatus(Result &result, int status, int timeout)
+{
+    if (WIFEXITED(status))
+    {
+        result.status = WEXITSTATUS(status);
+        if (result.status != 0)
+            result.error = "Exited with status " + std::to_string(result.status);
+    }
+    else if (WIFSIGNALED(status))
+        result.error = "Terminated by signal " + std::to_string(WTERMSIG(status));
+
+    if (result.timedOut)
+        result.error = "Timed out after " + std::to_string(timeout) + " ms";
+
+    result.ok = (result.status == 0 && !result.timedOut);
+}
+
+void ScriptRunner::startWaiting()
+{
+    while (!waiting.empty() && static_cast<int>(running.size()) < maximum)
+    {
+        Job job = std::move(waiting.front());
+        waiting.pop_front();
+        start(std::move(job));
+    }
+}
+
+void ScriptRunner::start(Job job)
+{
+    job.pid = spawn(job.args, job.fds, job.result.error);
+
+    // Reported from the main loop like any other result
+    if (job.pid < 0)
+    {
+        failed.push_back(std::move(job));
+        if (failedTimer == -1)
+            failedTimer = IEAddTimer(0, failedCallback, this);
+        return;
+    }
+
+    Job &started = running.emplace(job.id, std::move(job)).first->second;
+
+    for (int i = 0; i < 2; i++)
+        started.callbacks[i] = IEAddCallback(started.fds[i], outputCallback, &started);
+
+    if (started.timeout > 0)
+        started.timer = IEAddTimer(started.timeout, timeoutCallback, &started);
+
+    watchExits();
+}
+
+void ScriptRunner::finish(Job &job)
+{
+    release(job);
+
+    Callback callback = std::move(job.callback);
+    Result result     = std::move(job.result);
+
+    running.erase(job.id);
+    startWaiting();
+    watchExits();
+
+    if (callback)
+        callback(result);
+}
+
+void ScriptRunner::release(Job &job)
+{
+    for (int i = 0; i < 2; i++)
+    {
+        if (job.fds[i] < 0)
+            continue;
+
+        // Whatever the script wrote before exiting
+        readOutput(job.fds[i], i == 0 ? job.result.output : job.result.errors);
+        IERmCallback(job.callbacks[i]);
+        close(job.fds[i]);
+        job.fds[i] = -1;
+    }
+
+    if (job.timer != -1)
+    {
+        IERmTimer(job.timer);
+        job.timer = -1;
+    }
+}
+
+void ScriptRunner::watchExits()
+{
+    if (reapTimer == -1 && (!running.empty() || !killed.empty()))
+        reapTimer = IEAddTimer(REAP_INTERVAL, reapCallback, this);
+}
+
+void ScriptRunner::outputCallback(int fd, void *userpointer)
+{
+    Job *job = static_cast<Job *>(userpointer);
+    int i    = (fd == job->fds[0]) ? 0 : 1;
+
+    if (readOutput(fd, i == 0 ? job->result.output : job->result.errors))
+        return;
+
+    // End of file, the script may still be running
+    IERmCallback(job->callbacks[i]);
+    close(fd);
+    job->fds[i] = -1;
+}
+
+void ScriptRunner::timeoutCallback(void *userpointer)
+{
+    Job *job   = static_cast<Job *>(userpointer);
+    job->timer = -1;
+
+    if (job->result.timedOut)
+    {
+        signalGroup(job->pid, SIGKILL);
+        return;
+    }
+
+    job->result.timedOut = true;
+    signalGroup(job->pid, SIGTERM);
+    job->timer = IEAddTimer(TERMINATE_GRACE, timeoutCallback, job);
+}
+
+void ScriptRunner::reapCallback(void *userpointer)
+{
+    ScriptRunner *runner = static_cast<ScriptRunner *>(userpointer);
+    std::vector<std::pair<int, int>> exited;
+
+    runner->reapTimer = -1;
+
+    runner->killed.erase(std::remove_if(runner->killed.begin(), runner->killed.end(), [](pid_t pid)
+    {
+        return waitpid(pid, nullptr, WNOHANG) != 0;
+    }), runner->killed.end());
+
+    for (auto &entry : runner->running)
+    {
+        int status = 0;
+        if (reaped(entry.second.pid, status))
+            exited.emplace_back(entry.first, status);
+    }
+
+    // Callbacks may run and cancel scripts, so look each one up again
+    for (auto &exit : exited)
+    {
+        auto it = runner->running.find(exit.first);
+        if (it == runner->running.end())
+            continue;
+
+        setExitStatus(it->second.result, exit.second, it->second.timeout);
+        runner->finish(it->second);
+    }
+
+    runner->watchExits();
+}
+
+void ScriptRunner::failedCallback(void *userpointer)
+{
+    ScriptRunner *runner = static_cast<ScriptRunner *>(userpointer);
+
+    runner->failedTimer = -1;
+
+    // One at a time, a callback may cancel the next ones
+    while (!runner->failed.empty())
+    {
+        Job job = std::move(runner->failed.front());
+        runner->failed.pop_front();
+
+        if (job.callback)
+            job.callback(job.result);
+    }
+}
+
+}
@@ -0,0 +1,150 @@
+/*******************************************************************************
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#pragma once
+
+#include <deque>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <sys/types.h>
+
+namespace INDI
+{
+
+/**
+ * @brief The ScriptRunner class runs helper scripts and programs for drivers without waiting for them.
+ *
+ * Scripts are started with posix_spawn() in their own process group, with stdin on /dev/null so they cannot
+ * take the driver's traffic from indiserver. Their output is collected by the driver's main loop, and the
+ * callback given to run() gets it on the main loop once the script exited. A script still running when its
+ * timeout expires is terminated along with anything it started.
+ *
+ * At most maxRunning() scripts run at the same time, the others wait in order. Urgent scripts, like the ones
+ * aborting a motion, start at once regardless.
+ *
+ * The runner is shared by all devices of the driver process and must only be used from the main loop.
+ */
+class ScriptRunner
+{
+    public:
+        struct Result
+        {
+            /** True if the script ran and exited with status 0 */
+            bool ok { false };
+            /** Exit status, or -1 if the script did not run or was killed by a signal */
+            int status { -1 };
+            bool timedOut { false };
+            /** What the script wrote on its standard output and standard error */
+            std::string output;
+            std::string errors;
+            /** Reason why the script did not run or did not complete, if so */
+            std::string error;
+        };
+
+        using Callback = std::function<void(const Result &)>;
+
+        /** Default time allowed for a script in milliseconds */
+        static constexpr int DEFAULT_TIMEOUT = 60000;
+
+        /**
+         * @return The script runner of the driver process.
+         */
+        static ScriptRunner &instance();
+
+        /**
+         * @brief run Start a script. Returns at once.
+         * @param args program and its arguments. The program is searched in PATH unless it contains a slash.
+         * @param callback called on the main loop with the result once the script exited, or could not be run.
+         * @param timeout time allowed for the script in milliseconds, 0 for no limit.
+         * @param urgent start even if maxRunning() scripts are already running.
+         * @return id of the script for cancel().
+         */
+        int run(const std::vector<std::string> &args, Callback callback, int timeout = DEFAULT_TIMEOUT,
+                bool urgent = false);
+
+        /**
+         * @brief runNow Run a script and wait for its result. Meant for the few places that cannot proceed
+         * without it, like connecting a device.
+         */
+        Result runNow(const std::vector<std::string> &args, int timeout = DEFAULT_TIMEOUT);
+
+        /**
+         * @brief cancel Drop script id. A waiting script is not started, a running one is terminated, and the
+         * callback is not called. Unknown or finished ids are ignored.
+         */
+        void cancel(int id);
+
+        /**
+         * @return True if script id is waiting or running.
+         */
+        bool isActive(int id) const;
+
+        /**
+         * @brief setMaxRunning Set the number of scripts allowed to run at the same time. Defaults to 4.
+         */
+        void setMaxRunning(int count);
+        int maxRunning() const;
+
+    private:
+        ScriptRunner() = default;
+
+        struct Job
+        {
+            int id { 0 };
+            std::vector<std::string> args;
+            Callback callback;
+            int timeout { 0 };
+            pid_t pid { -1 };
+            // Standard output and error, -1 once closed
+            int fds[2] { -1, -1 };
+            int callbacks[2] { -1, -1 };
+            int timer { -1 };
+            Result result;
+        };
+
+        static pid_t spawn(const std::vector<std::string> &args, int fds[2], std::string &error);
+        static void signalGroup(pid_t pid, int signal);
+        static bool readOutput(int fd, std::string &output);
+        static void setExitStatus(Result &result, int status, int timeout);
+
+        void startWaiting();
+        void start(Job job);
+        void finish(Job &job);
+        void release(Job &job);
+        void watchExits();
+
+        static void outputCallback(int fd, void *userpointer);
+        static void timeoutCallback(void *userpointer);
+        static void reapCallback(void *userpointer);
+        static void failedCallback(void *userpointer);
+
+        std::deque<Job> waiting;
+        // Entries stay in place, their address is handed to the event loop
+        std::map<int, Job> running;
+        // Started scripts that could not be run, reported from the main loop
+        std::deque<Job> failed;
+        // Cancelled scripts, reaped once they are gone
+        std::vector<pid_t> killed;
+        int nextID { 1 };
+        int maximum { 4 };
+        int reapTimer { -1 };
+        int failedTimer { -1 };
+};
+
+}
@@ -19,6 +19,7 @@
 
 #include "defaultdevice.h"
 #include "indisensorinterface.h"
+#include "indibufferpool.h"
 
 #include "indicom.h"
 #include "stream/streammanager.h"
@@ -88,7 +89,7 @@ SensorInterface::SensorInterface()
     El              = -1000;
     primaryAperture = primaryFocalLength - 1;
 
-    Buffer     = static_cast<uint8_t *>(malloc(sizeof(uint8_t))); // Seed for realloc
+    Buffer     = static_cast<uint8_t *>(BufferPool::instance().acquire(sizeof(uint8_t))); // Seed for resize
     BufferSize = 0;
     NAxis       = 2;
 
@@ -99,7 +100,9 @@ SensorInterface::SensorInterface()
 
 SensorInterface::~SensorInterface()
 {
-    free(Buffer);
+    // Drivers may install their own buffer with setBuffer()
+    if (BufferPool::instance().release(Buffer) == false)
+        free(Buffer);
     BufferSize = 0;
     Buffer = nullptr;
 }
@@ -568,7 +571,7 @@ void SensorInterface::setBufferSize(int nbuf, bool allocMem)
     if (allocMem == false)
         return;
 
-    Buffer = static_cast<uint8_t *>(realloc(Buffer, nbuf * sizeof(uint8_t)));
+    Buffer = static_cast<uint8_t *>(BufferPool::instance().resize(Buffer, nbuf * sizeof(uint8_t)));
 }
 
 bool SensorInterface::StartIntegration(double duration)
@@ -840,13 +843,13 @@ void* SensorInterface::sendFITS(uint8_t *buf, int len)
 
     //  Now we have to send fits format data to the client
     memsize = 5760;
-    memptr  = malloc(memsize);
+    memptr  = BufferPool::instance().acquire(memsize + static_cast<size_t>(nelements) * (abs(getBPS()) / 8) + 4 * 2880);
     if (!memptr)
     {
         DEBUGF(Logger::DBG_ERROR, "Error: failed to allocate memory: %lu", static_cast<unsigned long>(memsize));
     }
 
-    fits_create_memfile(&fptr, &memptr, &memsize, 2880, realloc, &status);
+    fits_create_memfile(&fptr, &memptr, &memsize, 2880, BufferPool::reallocate, &status);
 
     if (status)
     {
@@ -854,7 +857,7 @@ void* SensorInterface::sendFITS(uint8_t *buf, int len)
         fits_get_errstatus(status, error_status);
         DEBUGF(Logger::DBG_ERROR, "FITS Error: %s", error_status);
         if(memptr != nullptr)
-            free(memptr);
+            BufferPool::instance().release(memptr);
         return nullptr;
     }
 
@@ -866,7 +869,7 @@ void* SensorInterface::sendFITS(uint8_t *buf, int len)
         fits_get_errstatus(status, error_status);
         DEBUGF(Logger::DBG_ERROR, "FITS Error: %s", error_status);
         if(memptr != nullptr)
-            free(memptr);
+            BufferPool::instance().release(memptr);
         return nullptr;
     }
 
@@ -880,7 +883,7 @@ void* SensorInterface::sendFITS(uint8_t *buf, int len)
         fits_get_errstatus(status, error_status);
         DEBUGF(Logger::DBG_ERROR, "FITS Error: %s", error_status);
         if(memptr != nullptr)
-            free(memptr);
+            BufferPool::instance().release(memptr);
         return nullptr;
     }
 
@@ -897,10 +900,10 @@ bool SensorInterface::IntegrationComplete()
     POLLMS = getPollingPeriod();
 
     if(HasDSP()) {
-        uint8_t* buf = (uint8_t*)malloc(getBufferSize());
+        uint8_t* buf = (uint8_t*)BufferPool::instance().acquire(getBufferSize());
         memcpy(buf, getBuffer(), getBufferSize());
         DSP->processBLOB(buf, 1, new int[1]{ getBufferSize()*8/getBPS() }, getBPS());
-        free(buf);
+        BufferPool::instance().release(buf);
     }
     // Run async
     std::thread(&SensorInterface::IntegrationCompletePrivate, this).detach();
@@ -930,9 +933,12 @@ bool SensorInterface::IntegrationCompletePrivate()
         if (sendIntegration)
             IDSetBLOB(&FitsBP, nullptr);
         if(blob != nullptr)
-            free(blob);
+            BufferPool::instance().release(blob);
 
-        DEBUG(Logger::DBG_DEBUG, "Upload complete");
+        BufferPool::Statistics poolStats = BufferPool::instance().statistics();
+        DEBUGF(Logger::DBG_DEBUG, "Upload complete. Buffer pool: %llu reused, %llu allocated, %.1f MB resident",
+               static_cast<unsigned long long>(poolStats.hits), static_cast<unsigned long long>(poolStats.misses),
+               poolStats.residentBytes / 1048576.0);
     }
 
     FramedIntegrationNP.s = IPS_OK;
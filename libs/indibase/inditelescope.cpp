@@ -86,6 +86,10 @@ bool Telescope::initProperties()
     IUFillNumberVector(&EqNP, EqN, 2, getDeviceName(), "EQUATORIAL_EOD_COORD", "Eq. Coordinates", MAIN_CONTROL_TAB,
                        IP_RW, 60, IPS_IDLE);
     lastEqState = IPS_IDLE;
+    // Sub-arcsecond jitter is not worth an update, and a slewing mount reports at most 4 times a second
+    setPublishPolicy(&EqNP, 250);
+    setPublishDeadband(&EqNP, "RA", 0.5 / 54000.0);
+    setPublishDeadband(&EqNP, "DEC", 0.5 / 3600.0);
 
     IUFillNumber(&TargetN[AXIS_RA], "RA", "RA (hh:mm:ss)", "%010.6m", 0, 24, 0, 0);
     IUFillNumber(&TargetN[AXIS_DE], "DEC", "DEC (dd:mm:ss)", "%010.6m", -90, 90, 0, 0);
@@ -700,7 +704,7 @@ void Telescope::NewRaDec(double ra, double dec)
         EqN[AXIS_RA].value = ra;
         EqN[AXIS_DE].value = dec;
         lastEqState        = EqNP.s;
-        IDSetNumber(&EqNP, nullptr);
+        publishNumber(&EqNP);
     }
 }
 
@@ -0,0 +1,348 @@
+/*******************************************************************************
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#include "indiusbtransfer.h"
+
+#include <cstdio>
+
+namespace INDI
+{
+
+// How long the event thread waits for completions before checking whether to quit
+static constexpr int EVENT_TIMEOUT = 100;
+
+LibUSBTransport::LibUSBTransport(libusb_context *context, libusb_device_handle *handle)
+    : context(context), handle(handle)
+{
+}
+
+int LibUSBTransport::submit(Transfer *transfer)
+{
+    libusb_transfer *usb = static_cast<libusb_transfer *>(transfer->handle);
+
+    if (usb == nullptr)
+    {
+        usb = libusb_alloc_transfer(0);
+        if (usb == nullptr)
+            return LIBUSB_ERROR_NO_MEM;
+        transfer->handle = usb;
+    }
+
+    if (transfer->type == LIBUSB_TRANSFER_TYPE_INTERRUPT)
+        libusb_fill_interrupt_transfer(usb, handle, transfer->endpoint, transfer->data, transfer->length,
+                                       transferCallback, transfer, transfer->timeout);
+    else
+        libusb_fill_bulk_transfer(usb, handle, transfer->endpoint, transfer->data, transfer->length,
+                                  transferCallback, transfer, transfer->timeout);
+
+    int rc = libusb_submit_transfer(usb);
+    if (rc < 0)
+    {
+        fprintf(stderr, "LibUSBTransport: libusb_submit_transfer -> %s\n", libusb_error_name(rc));
+    }
+    return rc;
+}
+
+int LibUSBTransport::cancel(Transfer *transfer)
+{
+    if (transfer->handle == nullptr)
+        return LIBUSB_ERROR_NOT_FOUND;
+
+    return libusb_cancel_transfer(static_cast<libusb_transfer *>(transfer->handle));
+}
+
+void LibUSBTransport::handleEvents(int timeout)
+{
+    struct timeval tv;
+
+    tv.tv_sec  = timeout / 1000;
+    tv.tv_usec = (timeout % 1000) * 1000;
+
+    int rc = libusb_handle_events_timeout_completed(context, &tv, nullptr);
+    if (rc < 0)
+    {
+        fprintf(stderr, "LibUSBTransport: libusb_handle_events -> %s\n", libusb_error_name(rc));
+    }
+}
+
+void LibUSBTransport::release(Transfer *transfer)
+{
+    libusb_free_transfer(static_cast<libusb_transfer *>(transfer->handle));
+    transfer->handle = nullptr;
+}
+
+void LIBUSB_CALL LibUSBTransport::transferCallback(libusb_transfer *usb)
+{
+    Transfer *transfer = static_cast<Transfer *>(usb->user_data);
+
+    transfer->status = usb->status;
+    transfer->actual = usb->actual_length;
+    transfer->completed(transfer);
+}
+
+// Shared by the ring and the buffers it handed over, which may outlive it
+struct USBBuffer::State : public std::enable_shared_from_this<USBBuffer::State>
+{
+    enum SlotState
+    {
+        IDLE,
+        IN_FLIGHT,
+        HELD
+    };
+
+    struct Slot
+    {
+        std::vector<unsigned char> data;
+        USBTransport::Transfer transfer;
+        SlotState state { IDLE };
+    };
+
+    USBTransport *transport { nullptr };
+    std::vector<Slot> slots;
+    USBTransferRing::Callback callback;
+
+    std::mutex lock;
+    std::condition_variable idle;
+    int inFlight { 0 };
+    bool stopping { true };
+    // The device is gone, nothing is submitted anymore
+    bool gone { false };
+
+    // Called with lock held
+    bool submit(int index)
+    {
+        Slot &slot = slots[index];
+
+        slot.transfer.status = LIBUSB_TRANSFER_COMPLETED;
+        slot.transfer.actual = 0;
+
+        int rc = transport->submit(&slot.transfer);
+        if (rc < 0)
+        {
+            if (rc == LIBUSB_ERROR_NO_DEVICE)
+                gone = true;
+            slot.state = IDLE;
+            return false;
+        }
+
+        slot.state = IN_FLIGHT;
+        inFlight++;
+        return true;
+    }
+
+    // On the event thread
+    void completed(int index)
+    {
+        Slot &slot = slots[index];
+
+        {
+            std::lock_guard<std::mutex> guard(lock);
+
+            inFlight--;
+            if (stopping || slot.transfer.status == LIBUSB_TRANSFER_CANCELLED)
+            {
+                slot.state = IDLE;
+                idle.notify_all();
+                return;
+            }
+
+            // Nothing arrived in time, keep waiting
+            if (slot.transfer.status == LIBUSB_TRANSFER_TIMED_OUT && slot.transfer.actual == 0)
+            {
+                submit(index);
+                return;
+            }
+
+            if (slot.transfer.status == LIBUSB_TRANSFER_NO_DEVICE)
+                gone = true;
+
+            slot.state = HELD;
+        }
+
+        // Without the lock, the user may release the buffer at once
+        callback(USBBuffer(shared_from_this(), index));
+    }
+
+    void release(int index)
+    {
+        std::lock_guard<std::mutex> guard(lock);
+
+        slots[index].state = IDLE;
+        if (!stopping && !gone)
+            submit(index);
+    }
+};
+
+USBBuffer::USBBuffer(std::shared_ptr<State> state, int slot) : state(std::move(state)), slot(slot)
+{
+}
+
+USBBuffer::USBBuffer(USBBuffer &&other) noexcept : state(std::move(other.state)), slot(other.slot)
+{
+    other.slot = -1;
+}
+
+USBBuffer &USBBuffer::operator=(USBBuffer &&other) noexcept
+{
+    if (this != &other)
+    {
+        release();
+        state      = std::move(other.state);
+        slot       = other.slot;
+        other.slot = -1;
+    }
+    return *this;
+}
+
+USBBuffer::~USBBuffer()
+{
+    release();
+}
+
+const unsigned char *USBBuffer::data() const
+{
+    return state ? state->slots[slot].data.data() : nullptr;
+}
+
+int USBBuffer::size() const
+{
+    return state ? state->slots[slot].transfer.actual : 0;
+}
+
+libusb_transfer_status USBBuffer::status() const
+{
+    return state ? state->slots[slot].transfer.status : LIBUSB_TRANSFER_ERROR;
+}
+
+void USBBuffer::release()
+{
+    if (!state)
+        return;
+
+    state->release(slot);
+    state.reset();
+    slot = -1;
+}
+
+USBTransferRing::USBTransferRing(USBTransport &transport, unsigned char endpoint, int bufferSize, int depth,
+                                 unsigned int timeout, unsigned char type)
+    : state(std::make_shared<USBBuffer::State>())
+{
+    USBBuffer::State *shared = state.get();
+
+    state->transport = &transport;
+    // Never resized, the transport keeps pointers to the transfers
+    state->slots.resize(depth > 0 ? depth : 1);
+
+    for (size_t i = 0; i < state->slots.size(); i++)
+    {
+        USBBuffer::State::Slot &slot = state->slots[i];
+        int index                    = static_cast<int>(i);
+
+        slot.data.resize(bufferSize);
+        slot.transfer.endpoint  = endpoint;
+        slot.transfer.type      = type;
+        slot.transfer.data      = slot.data.data();
+        slot.transfer.length    = bufferSize;
+        slot.transfer.timeout   = timeout;
+        slot.transfer.completed = [shared, index](USBTransport::Transfer *)
+        {
+            shared->completed(index);
+        };
+    }
+}
+
+USBTransferRing::~USBTransferRing()
+{
+    stop();
+}
+
+bool USBTransferRing::start(Callback callback)
+{
+    if (eventThread.joinable())
+        return false;
+
+    bool submitted = true;
+
+    {
+        std::lock_guard<std::mutex> guard(state->lock);
+
+        state->callback = std::move(callback);
+        state->stopping = false;
+        state->gone     = false;
+
+        // Buffers still held from a previous run are submitted once released
+        for (size_t i = 0; i < state->slots.size() && submitted; i++)
+        {
+            if (state->slots[i].state == USBBuffer::State::IDLE)
+                submitted = state->submit(static_cast<int>(i));
+        }
+    }
+
+    quit        = false;
+    eventThread = std::thread(&USBTransferRing::eventLoop, this);
+
+    if (!submitted)
+    {
+        stop();
+        return false;
+    }
+
+    return true;
+}
+
+void USBTransferRing::stop()
+{
+    if (!eventThread.joinable())
+        return;
+
+    {
+        std::unique_lock<std::mutex> guard(state->lock);
+
+        state->stopping = true;
+        for (auto &slot : state->slots)
+        {
+            if (slot.state == USBBuffer::State::IN_FLIGHT)
+                state->transport->cancel(&slot.transfer);
+        }
+
+        // The event thread runs the cancelled transfers to completion
+        state->idle.wait(guard, [this]()
+        {
+            return state->inFlight == 0;
+        });
+    }
+
+    quit = true;
+    eventThread.join();
+
+    for (auto &slot : state->slots)
+        state->transport->release(&slot.transfer);
+}
+
+bool USBTransferRing::isRunning() const
+{
+    std::lock_guard<std::mutex> guard(state->lock);
+    return eventThread.joinable() && !state->stopping && !state->gone;
+}
+
+void USBTransferRing::eventLoop()
+{
+    while (!quit)
+        state->transport->handleEvents(EVENT_TIMEOUT);
+}
+
+}
@@ -0,0 +1,206 @@
+/*******************************************************************************
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#pragma once
+
+#include <libusb.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace INDI
+{
+
+/**
+ * @brief The USBTransport class is what USBTransferRing needs from a USB device: start and cancel transfers,
+ * and report the completed ones. LibUSBTransport is the implementation on libusb, tests use a fake device.
+ */
+class USBTransport
+{
+    public:
+        struct Transfer
+        {
+            unsigned char endpoint { 0 };
+            /** LIBUSB_TRANSFER_TYPE_BULK or LIBUSB_TRANSFER_TYPE_INTERRUPT */
+            unsigned char type { LIBUSB_TRANSFER_TYPE_BULK };
+            unsigned char *data { nullptr };
+            int length { 0 };
+            /** Milliseconds, 0 for no limit */
+            unsigned int timeout { 0 };
+
+            /** Set by the transport before calling completed */
+            libusb_transfer_status status { LIBUSB_TRANSFER_COMPLETED };
+            int actual { 0 };
+            std::function<void(Transfer *)> completed;
+
+            /** Private to the transport */
+            void *handle { nullptr };
+        };
+
+        virtual ~USBTransport() = default;
+
+        /**
+         * @brief submit Start transfer. Its completed function is called from handleEvents() once done.
+         * @return 0, or a libusb error code.
+         */
+        virtual int submit(Transfer *transfer) = 0;
+
+        /**
+         * @brief cancel Make a submitted transfer complete early with LIBUSB_TRANSFER_CANCELLED.
+         */
+        virtual int cancel(Transfer *transfer) = 0;
+
+        /**
+         * @brief handleEvents Wait up to timeout milliseconds, and call the completed function of transfers that
+         * are done. Called from a single thread.
+         */
+        virtual void handleEvents(int timeout) = 0;
+
+        /**
+         * @brief release Free what the transport allocated for transfer, which is not in flight anymore.
+         */
+        virtual void release(Transfer *transfer)
+        {
+            (void)transfer;
+        }
+};
+
+/**
+ * @brief The LibUSBTransport class runs transfers on an open libusb device.
+ */
+class LibUSBTransport : public USBTransport
+{
+    public:
+        LibUSBTransport(libusb_context *context, libusb_device_handle *handle);
+
+        virtual int submit(Transfer *transfer) override;
+        virtual int cancel(Transfer *transfer) override;
+        virtual void handleEvents(int timeout) override;
+        virtual void release(Transfer *transfer) override;
+
+    private:
+        static void LIBUSB_CALL transferCallback(libusb_transfer *transfer);
+
+        libusb_context *context { nullptr };
+        libusb_device_handle *handle { nullptr };
+};
+
+class USBTransferRing;
+
+/**
+ * @brief The USBBuffer class hands a completed transfer of USBTransferRing to its user without copying the data.
+ *
+ * The buffer goes back to the ring, and is submitted again, when the USBBuffer is destroyed or released. Until
+ * then the user may keep it, or pass it to another thread, to process its data. A ring whose buffers are all
+ * held stops reading until one comes back.
+ */
+class USBBuffer
+{
+    public:
+        USBBuffer() = default;
+        USBBuffer(USBBuffer &&other) noexcept;
+        USBBuffer &operator=(USBBuffer &&other) noexcept;
+        USBBuffer(const USBBuffer &) = delete;
+        USBBuffer &operator=(const USBBuffer &) = delete;
+        ~USBBuffer();
+
+        /** Data received, valid until the buffer is released */
+        const unsigned char *data() const;
+        int size() const;
+
+        /** LIBUSB_TRANSFER_COMPLETED, or the error that ended the transfer */
+        libusb_transfer_status status() const;
+
+        explicit operator bool() const
+        {
+            return state != nullptr;
+        }
+
+        /**
+         * @brief release Give the buffer back to the ring now.
+         */
+        void release();
+
+    private:
+        friend class USBTransferRing;
+        struct State;
+
+        USBBuffer(std::shared_ptr<State> state, int slot);
+
+        std::shared_ptr<State> state;
+        int slot { -1 };
+};
+
+/**
+ * @brief The USBTransferRing class reads an endpoint continuously with several transfers in flight.
+ *
+ * While the user processes a buffer, the next transfers are already queued on the device, so the readout of a
+ * frame overlaps with the processing of the previous one. Completed transfers are handed over as they complete,
+ * on a thread of the ring, through the callback given to start().
+ *
+ * Transfers that time out without data are submitted again silently. Other errors are handed over like data,
+ * with their status; the ring stops reading once the device is gone.
+ */
+class USBTransferRing
+{
+    public:
+        using Callback = std::function<void(USBBuffer buffer)>;
+
+        /** Default number of transfers in flight */
+        static constexpr int DEFAULT_DEPTH = 4;
+
+        /**
+         * @param transport device to read from.
+         * @param endpoint input endpoint.
+         * @param bufferSize size of each transfer in bytes.
+         * @param depth number of transfers, and buffers, of the ring.
+         * @param timeout of each transfer in milliseconds, 0 for no limit.
+         * @param type LIBUSB_TRANSFER_TYPE_BULK or LIBUSB_TRANSFER_TYPE_INTERRUPT, as the endpoint.
+         */
+        USBTransferRing(USBTransport &transport, unsigned char endpoint, int bufferSize, int depth = DEFAULT_DEPTH,
+                        unsigned int timeout = 0, unsigned char type = LIBUSB_TRANSFER_TYPE_BULK);
+
+        /** Stops the ring. Buffers still held remain valid. */
+        ~USBTransferRing();
+
+        /**
+         * @brief start Submit all transfers and start handing over the results to callback.
+         * @return false if the transfers could not be submitted.
+         */
+        bool start(Callback callback);
+
+        /**
+         * @brief stop Cancel the transfers in flight and wait for them. No callback is called anymore once stop()
+         * returns. Must not be called from the callback.
+         */
+        void stop();
+
+        bool isRunning() const;
+
+    private:
+        void eventLoop();
+
+        std::shared_ptr<USBBuffer::State> state;
+        std::thread eventThread;
+        std::atomic<bool> quit { false };
+};
+
+}
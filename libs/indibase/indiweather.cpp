@@ -38,6 +38,11 @@ Weather::Weather() : WI(this)
 {
 }
 
+Weather::~Weather()
+{
+    cancelFetch();
+}
+
 bool Weather::initProperties()
 {
     DefaultDevice::initProperties();
@@ -119,6 +124,7 @@ bool Weather::updateProperties()
     else
     {
         WI::updateProperties();
+        cancelFetch();
 
         deleteProperty(RefreshSP.name);
         deleteProperty(UpdatePeriodNP.name);
@@ -398,6 +404,50 @@ bool Weather::callHandshake()
     return Handshake();
 }
 
+IPState Weather::fetchURL(const std::string &url, std::string &body, long timeout)
+{
+    if (fetchDone && fetchedURL == url)
+    {
+        fetchDone = false;
+        if (!fetchResult.ok)
+        {
+            LOGF_ERROR("Failed to fetch %s: %s", url.c_str(), fetchResult.error.c_str());
+            return IPS_ALERT;
+        }
+
+        body.swap(fetchResult.body);
+        fetchResult.body.clear();
+        return IPS_OK;
+    }
+
+    if (fetchID >= 0 && fetchedURL == url)
+        return IPS_BUSY;
+
+    cancelFetch();
+
+    LOGF_DEBUG("Fetching %s", url.c_str());
+    fetchedURL = url;
+    fetchID    = HTTPFetcher::instance().fetch(url, [this](const HTTPFetcher::Result & result)
+    {
+        fetchID     = -1;
+        fetchDone   = true;
+        fetchResult = result;
+        // Back to updateWeather() with the result
+        TimerHit();
+    }, timeout);
+
+    return IPS_BUSY;
+}
+
+void Weather::cancelFetch()
+{
+    if (fetchID >= 0)
+        HTTPFetcher::instance().cancel(fetchID);
+
+    fetchID   = -1;
+    fetchDone = false;
+}
+
 uint8_t Weather::getWeatherConnection() const
 {
     return weatherConnection;
@@ -25,6 +25,7 @@
 #pragma once
 
 #include "defaultdevice.h"
+#include "indihttpfetcher.h"
 #include "indiweatherinterface.h"
 
 #include <list>
@@ -57,6 +58,9 @@ class TCP;
  * Weather update period is controlled by the WEATHER_UPDATE property which stores the update period
  * in seconds and calls updateWeather() every X seconds as given in the property.
  *
+ * Drivers reading a web service should get their data with fetchURL(), which leaves the driver responsive
+ * while the service takes its time to answer.
+ *
  * \e IMPORTANT: GEOGRAPHIC_COORD stores latitude and longitude in INDI specific format, refer to
  * <a href="http://indilib.org/develop/developer-manual/101-standard-properties.html">INDI Standard
  * Properties</a> for details.
@@ -86,6 +90,7 @@ class Weather : public DefaultDevice, public WeatherInterface
         } WeatherConnection;
 
         Weather();
+        virtual ~Weather();
 
         virtual bool initProperties() override;
         virtual bool updateProperties() override;
@@ -128,6 +133,22 @@ class Weather : public DefaultDevice, public WeatherInterface
         /** \brief perform handshake with device to check communication */
         virtual bool Handshake();
 
+        /**
+         * @brief fetchURL Fetch a URL from updateWeather() without blocking the driver. The first call starts
+         * the transfer and returns IPS_BUSY, as do the calls made while it runs. Once the transfer finished,
+         * TimerHit() runs again and the call returns IPS_OK with the content fetched, or logs the error and
+         * returns IPS_ALERT.
+         * @param url URL to fetch. Asking for another URL than the one in progress starts over.
+         * @param body set to the content fetched if IPS_OK is returned.
+         * @param timeout time allowed for the transfer in milliseconds.
+         */
+        IPState fetchURL(const std::string &url, std::string &body, long timeout = HTTPFetcher::DEFAULT_TIMEOUT);
+
+        /**
+         * @brief cancelFetch Abort the transfer of fetchURL() if any, and drop its result.
+         */
+        void cancelFetch();
+
         // A number vector that stores lattitude and longitude
         INumberVectorProperty LocationNP;
         INumber LocationN[3];
@@ -159,5 +180,11 @@ class Weather : public DefaultDevice, public WeatherInterface
 
         bool callHandshake();
         uint8_t weatherConnection = CONNECTION_SERIAL | CONNECTION_TCP;
+
+        // Transfer of fetchURL()
+        int fetchID { -1 };
+        bool fetchDone { false };
+        std::string fetchedURL;
+        HTTPFetcher::Result fetchResult;
 };
 }
@@ -27,6 +27,12 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
  * <! ... > and <? ... > are silently ignored.
  * pcdata is collected into one string, sans leading whitespace first line.
  *
+ * the parser copies runs of plain tag, attribute and pcdata characters in
+ * one go and only steps through the state machine for markup. the elements,
+ * attributes and strings of each parsed message come from one arena which is
+ * released at once when the root is deleted. elements, attributes and
+ * strings added or edited later are malloced individually as before.
+ *
  * #define MAIN_TST to create standalone test program
  */
 
@@ -47,26 +53,66 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 /* used to efficiently manage growing malloced string space */
 typedef struct
 {
-    char *s; /* malloced memory for string */
+    char *s; /* malloced memory for string, or arena memory if sm is 0 */
     int sl;  /* string length, sans trailing \0 */
-    int sm;  /* total malloced bytes */
+    int sm;  /* total malloced bytes, 0 if not malloced */
 } String;
 #define MINMEM 64 /* starting string length */
 
+/* one block of a message arena, the memory handed out follows the header */
+typedef struct arena_block_
+{
+    struct arena_block_ *prev; /* block filled before this one */
+    size_t size;               /* bytes after the header */
+    size_t used;               /* bytes handed out */
+} ArenaBlock;
+#define ARENA_FIRST 4096  /* first block of a message, header included */
+#define ARENA_MAX   65536 /* blocks double up to this size */
+#define ARENA_ALIGN (sizeof(void *))
+
+/* what parts of an element are malloced rather than from its arena */
+#define ELE_HEAP  1 /* the element itself */
+#define ATLS_HEAP 2 /* at[] */
+#define ELLS_HEAP 4 /* el[] */
+
+/* where the printers write: nowhere when only counting (s is NULL), the
+ * caller's buffer, or a malloced buffer once that is outgrown
+ */
+typedef struct
+{
+    char *s;    /* output, or NULL to only count */
+    int sl;     /* chars written or counted */
+    int sz;     /* room in s, -1 if the caller guarantees enough */
+    char *user; /* caller's buffer, never realloced or freed here */
+} XMLOut;
+
 static int oneXMLchar(LilXML *lp, int c, char ynot[]);
+static XMLEle *parseXMLBytes(LilXML *lp, const char *buf, int size, int *used, char ynot[]);
+static int scanXMLRun(LilXML *lp, const unsigned char *buf, int size);
 static void initParser(LilXML *lp);
 static void pushXMLEle(LilXML *lp);
 static void popXMLEle(LilXML *lp);
 static void resetEndTag(LilXML *lp);
+static XMLAtt *pushXMLAtt(LilXML *lp);
 static XMLAtt *growAtt(XMLEle *e);
 static XMLEle *growEle(XMLEle *pe);
+static void appendEle(XMLEle *pe, XMLEle *ep);
 static void freeAtt(XMLAtt *a);
 static int isTokenChar(int start, int c);
 static void growString(String *sp, int c);
 static void appendString(String *sp, const char *str);
+static void heapString(String *sp, int l);
+static void resetString(String *sp);
 static void freeString(String *sp);
 static void newString(String *sp);
 static void *moremem(void *old, int n);
+static void *arenaAlloc(LilXML *lp, size_t n);
+static void arenaString(LilXML *lp, String *sp, const char *str, int n);
+static void arenaChar(LilXML *lp, String *sp, int c);
+static void arenaSeal(LilXML *lp);
+static void freeArena(ArenaBlock *ap);
+static void outRoom(XMLOut *op, int n);
+static void outXMLEle(XMLOut *op, XMLEle *ep, int level);
 
 typedef enum {
     LOOK4START = 0, /* looking for first element start */
@@ -97,7 +143,8 @@ struct LilXML_
     int delim;     /* attribute value delimiter */
     int lastc;     /* last char (just used wiht skipping)*/
     int skipping;  /* in comment or declaration */
-    int inblob;    /* in oneBLOB element */
+    ArenaBlock *arena; /* memory of the message being parsed */
+    String *open;      /* string growing at the end of arena, if any */
 };
 
 /* internal representation of a (possibly nested) XML element */
@@ -113,6 +160,10 @@ struct xml_ele_
     int eit;           /* used to iterate over el[] */
     String pcdata;     /* character data in this element */
     int pcdata_hasent; /* 1 if pcdata contains an entity char*/
+    int mat;           /* room in at[] */
+    int mel;           /* room in el[] */
+    int heap;          /* ELE_HEAP, ATLS_HEAP and ELLS_HEAP bits */
+    ArenaBlock *arena; /* memory of the whole tree if this is a parsed root */
 };
 
 /* internal representation of an attribute */
@@ -121,12 +172,19 @@ struct xml_att_
     String name; /* name */
     String valu; /* value */
     XMLEle *ce;  /* containing element */
+    int heap;    /* 1 if malloced rather than from an arena */
+    int valu_hasent; /* 1 if valu contains an entity char */
 };
 
 /* characters that need escaping as "entities" in attr values and pcdata
  */
 static char entities[] = "&<>'\"";
 
+#define PRINDENT 4 /* sample print indent each level */
+
+/* the value of every empty string, never written to */
+static char nullstr[1];
+
 /* default memory managers, override with lilxmlMalloc() */
 static void *(*mymalloc)(size_t size)             = malloc;
 static void *(*myrealloc)(void *ptr, size_t size) = realloc;
@@ -148,6 +206,8 @@ LilXML *newLilXML()
 {
     LilXML *lp = (LilXML *)moremem(NULL, sizeof(LilXML));
     memset(lp, 0, sizeof(LilXML));
+    newString(&lp->endtag);
+    newString(&lp->entity);
     initParser(lp);
     return (lp);
 }
@@ -155,8 +215,9 @@ LilXML *newLilXML()
 /* discard */
 void delLilXML(LilXML *lp)
 {
-    delXMLEle(lp->ce);
+    initParser(lp);
     freeString(&lp->endtag);
+    freeString(&lp->entity);
     (*myfree)(lp);
 }
 
@@ -169,14 +230,18 @@ void delXMLEle(XMLEle *ep)
     if (!ep)
         return;
 
-    /* delete all parts of ep */
+    /* delete all parts of ep.
+     * N.B. parts from an arena are only released with the arena, but children
+     * may still hold malloced parts or be trees of their own.
+     */
     freeString(&ep->tag);
     freeString(&ep->pcdata);
     if (ep->at)
     {
         for (i = 0; i < ep->nat; i++)
             freeAtt(ep->at[i]);
-        (*myfree)(ep->at);
+        if (ep->heap & ATLS_HEAP)
+            (*myfree)(ep->at);
     }
     if (ep->el)
     {
@@ -187,7 +252,8 @@ void delXMLEle(XMLEle *ep)
 
             delXMLEle(ep->el[i]);
         }
-        (*myfree)(ep->el);
+        if (ep->heap & ELLS_HEAP)
+            (*myfree)(ep->el);
     }
 
     /* remove from parent's list if known */
@@ -204,103 +270,118 @@ void delXMLEle(XMLEle *ep)
         }
     }
 
-    /* delete ep itself */
-    (*myfree)(ep);
+    /* delete ep itself, a parsed root lives in its own arena */
+    if (ep->arena)
+        freeArena(ep->arena);
+    else if (ep->heap & ELE_HEAP)
+        (*myfree)(ep);
 }
 
-//#define WITH_MEMCHR
 XMLEle **parseXMLChunk(LilXML *lp, char *buf, int size, char ynot[])
 {
     XMLEle **nodes = (XMLEle **)malloc(sizeof(XMLEle *));
-    int nnodes     = 1;
-    *nodes         = NULL;
-    char *curr     = buf;
-    int s;
-    ynot[0] = '\0';
+    int nnodes     = 0;
+    int mnodes     = 1;
+    int used;
+
+    ynot[0]   = '\0';
+    nodes[0]  = NULL;
 
-    if (lp->inblob)
+    while (size > 0)
     {
-#ifdef WITH_ENCLEN
-        if (size < lp->ce->pcdata.sm - lp->ce->pcdata.sl)
-        {
-            memcpy((void *)(lp->ce->pcdata.s + lp->ce->pcdata.sl), (const void *)buf, size);
-            lp->ce->pcdata.sl += size;
-            return nodes;
-        }
-        else
-            lp->inblob = 0;
-#endif
-#ifdef WITH_MEMCHR
-        char *ltpos = memchr(buf, '<', size);
-        if (!ltpos)
+        XMLEle *root = parseXMLBytes(lp, buf, size, &used, ynot);
+        buf += used;
+        size -= used;
+
+        /* N.B. up to caller to call delXMLEle with what we return. */
+        if (root)
         {
-            lp->ce->pcdata.s = (char *)moremem(lp->ce->pcdata.s, lp->ce->pcdata.sm + size);
-            lp->ce->pcdata.sm += size;
-            memcpy((void *)(lp->ce->pcdata.s + lp->ce->pcdata.sl), (const void *)buf, size);
-            lp->ce->pcdata.sl += size;
-            return nodes;
+            if (nnodes + 1 >= mnodes)
+                nodes = (XMLEle **)realloc(nodes, (mnodes *= 2) * sizeof(XMLEle *));
+            nodes[nnodes++] = root;
+            nodes[nnodes]   = NULL;
         }
-        else
-            lp->inblob = 0;
-#endif
     }
-    else
+
+    /*
+     * N.B. up to caller to free nodes.
+     */
+    return nodes;
+}
+
+/* process buf up to the end of the first root element.
+ * return the root, with the number of chars it took in *used, else NULL when
+ * buf is used up or an error is found, with the reason in ynot[].
+ * N.B. it is up to the caller to delete any tree returned with delXMLEle().
+ */
+XMLEle *parseXMLEle(LilXML *lp, char *buf, int size, int *used, char ynot[])
+{
+    ynot[0] = '\0';
+    *used   = 0;
+
+    return (size > 0 ? parseXMLBytes(lp, buf, size, used, ynot) : NULL);
+}
+
+/* process one more character of an XML file.
+ * when find closure with outter element return root of complete tree.
+ * when find error return NULL with reason in ynot[].
+ * when need more return NULL with ynot[0] = '\0'.
+ * N.B. it is up to the caller to delete any tree returned with delXMLEle().
+ */
+XMLEle *readXMLEle(LilXML *lp, int newc, char ynot[])
+{
+    char c = (char)newc;
+    int used;
+
+    /* start optimistic */
+    ynot[0] = '\0';
+
+    /* plain pcdata, as in BLOBs, needs none of the state machine */
+    if (lp->cs == INCON && lp->lastc != '<' && !lp->skipping && c != '<' && c != '&' && c != '\0' && c != '\n')
     {
-        if (lp->ce)
+        arenaChar(lp, &lp->ce->pcdata, c);
+        lp->lastc = c;
+        return (NULL);
+    }
+
+    return (parseXMLBytes(lp, &c, 1, &used, ynot));
+}
+
+/* process buf until a root element is complete, an error is found or buf is
+ * used up, and report in *used how many chars were processed.
+ * return a completed root, else NULL with any reason why in ynot[]. ynot[] is
+ * left alone if there is no error.
+ */
+static XMLEle *parseXMLBytes(LilXML *lp, const char *buf, int size, int *used, char ynot[])
+{
+    const unsigned char *curr = (const unsigned char *)buf;
+    const unsigned char *end  = curr + size;
+
+    while (curr < end)
+    {
+        XMLEle *root;
+        int newc;
+        int s;
+
+        /* copy plain characters in bulk unless a '<' is pending */
+        if (end - curr > 1 && !lp->skipping && lp->lastc != '<')
         {
-            char *ctag = tagXMLEle(lp->ce);
-            if (ctag && !(strcmp(ctag, "oneBLOB")) && (lp->cs == INCON))
+            int n = scanXMLRun(lp, curr, end - curr);
+            if (n > 0)
             {
-#ifdef WITH_ENCLEN
-                XMLAtt *blenatt = findXMLAtt(lp->ce, "enclen");
-                if (blenatt)
-                {
-                    int blen;
-                    sscanf(valuXMLAtt(blenatt), "%d", &blen);
-                    // if (lp->ce->pcdata.sm < blen) { // always realloc
-                    if (blen % 72 != 0)
-                        blen += (blen / 72) + 1; // add room for those '\n'
-                    else
-                        blen += (blen / 72);
-                    lp->ce->pcdata.s  = (char *)moremem(lp->ce->pcdata.s, blen);
-                    lp->ce->pcdata.sm = blen; // or always set sm
-                    //}
-                    if (size < blen - lp->ce->pcdata.sl)
-                    {
-                        memcpy((void *)(lp->ce->pcdata.s + lp->ce->pcdata.sl), (const void *)buf, size);
-                        lp->ce->pcdata.sl += size;
-                        lp->inblob = 1;
-                        return nodes;
-                    }
-                }
-#endif
-#ifdef WITH_MEMCHR
-                char *ltpos = memchr(buf, '<', size);
-                if (!ltpos)
-                {
-                    lp->ce->pcdata.s = (char *)moremem(lp->ce->pcdata.s, lp->ce->pcdata.sm + size);
-                    lp->ce->pcdata.sm += size;
-                    memcpy((void *)(lp->ce->pcdata.s + lp->ce->pcdata.sl), (const void *)buf, size);
-                    lp->ce->pcdata.sl += size;
-                    lp->inblob = 1;
-                    return nodes;
-                }
-                else
-                    lp->inblob = 0;
-#endif
+                curr += n;
+                continue;
             }
         }
-    }
-    while (curr - buf < size)
-    {
-        char newc = *curr;
+
+        newc = *curr++;
+
         /* EOF? */
         if (newc == 0)
         {
             sprintf(ynot, "Line %d: early XML EOF", lp->ln);
             initParser(lp);
-            curr++;
-            continue;
+            break;
         }
 
         /* new line? */
@@ -312,7 +393,6 @@ XMLEle **parseXMLChunk(LilXML *lp, char *buf, int size, char ynot[])
         {
             lp->skipping = 1;
             lp->lastc    = newc;
-            curr++;
             continue;
         }
         if (lp->skipping)
@@ -320,13 +400,11 @@ XMLEle **parseXMLChunk(LilXML *lp, char *buf, int size, char ynot[])
             if (newc == '>')
                 lp->skipping = 0;
             lp->lastc = newc;
-            curr++;
             continue;
         }
         if (newc == '<')
         {
             lp->lastc = '<';
-            curr++;
             continue;
         }
 
@@ -336,8 +414,7 @@ XMLEle **parseXMLChunk(LilXML *lp, char *buf, int size, char ynot[])
             if (oneXMLchar(lp, '<', ynot) < 0)
             {
                 initParser(lp);
-                curr++;
-                continue;
+                break;
             }
             /* N.B. we assume '<' will never result in closure */
         }
@@ -347,110 +424,116 @@ XMLEle **parseXMLChunk(LilXML *lp, char *buf, int size, char ynot[])
         if (s == 0)
         {
             lp->lastc = newc;
-            curr++;
             continue;
         }
         if (s < 0)
         {
             initParser(lp);
-            curr++;
-            continue;
+            break;
         }
 
-        /* Ok! store ce in nodes and we start over.
-         * N.B. up to caller to call delXMLEle with what we return.
-         */
-        nodes[nnodes - 1] = lp->ce;
-        nodes             = (XMLEle **)realloc(nodes, (nnodes + 1) * sizeof(XMLEle *));
-        nodes[nnodes]     = NULL;
-        nnodes += 1;
-        lp->ce = NULL;
+        /* Ok! hand over ce with all its memory and we start over. */
+        arenaSeal(lp);
+        root        = lp->ce;
+        root->arena = lp->arena;
+        lp->ce      = NULL;
+        lp->arena   = NULL;
         initParser(lp);
-        curr++;
+
+        *used = (const char *)curr - buf;
+        return (root);
     }
-    /*
-     * N.B. up to caller to free nodes.
-     */
-    return nodes;
+
+    *used = (const char *)curr - buf;
+    return (NULL);
 }
 
-/* process one more character of an XML file.
- * when find closure with outter element return root of complete tree.
- * when find error return NULL with reason in ynot[].
- * when need more return NULL with ynot[0] = '\0'.
- * N.B. it is up to the caller to delete any tree returned with delXMLEle().
+/* chars that never end a tag or attribute name */
+#define TOKEN_CHAR(c) (((c) >= 'a' && (c) <= 'z') || ((c) >= 'A' && (c) <= 'Z') || ((c) >= '0' && (c) <= '9') || (c) == '_')
+
+/* consume the longest run at buf that the current state merely appends to
+ * the string being read, and return its length. 0 if the first char needs the
+ * state machine. pcdata may run on for megabytes in BLOBs, it is scanned with
+ * memchr(). tags, names and values are short, anything unusual in them is
+ * left to oneXMLchar().
  */
-XMLEle *readXMLEle(LilXML *lp, int newc, char ynot[])
+static int scanXMLRun(LilXML *lp, const unsigned char *buf, int size)
 {
-    XMLEle *root;
-    int s;
+    const unsigned char *end = buf + size;
+    const unsigned char *p   = buf;
+    String *sp;
 
-    /* start optimistic */
-    ynot[0] = '\0';
-
-    /* EOF? */
-    if (newc == 0)
+    switch (lp->cs)
     {
-        sprintf(ynot, "Line %d: early XML EOF", lp->ln);
-        initParser(lp);
-        return (NULL);
-    }
+        case INTAG:
+            sp = &lp->ce->tag;
+            while (p < end && TOKEN_CHAR(*p))
+                p++;
+            break;
 
-    /* new line? */
-    if (newc == '\n')
-        lp->ln++;
+        case INATTRN:
+            sp = &lp->ce->at[lp->ce->nat - 1]->name;
+            while (p < end && TOKEN_CHAR(*p))
+                p++;
+            break;
 
-    /* skip comments and declarations. requires 1 char history */
-    if (!lp->skipping && lp->lastc == '<' && (newc == '?' || newc == '!'))
-    {
-        lp->skipping = 1;
-        lp->lastc    = newc;
-        return (NULL);
-    }
-    if (lp->skipping)
-    {
-        if (newc == '>')
-            lp->skipping = 0;
-        lp->lastc = newc;
-        return (NULL);
-    }
-    if (newc == '<')
-    {
-        lp->lastc = '<';
-        return (NULL);
-    }
+        case INCLOSETAG:
+            /* endtag is not in the arena */
+            while (p < end && TOKEN_CHAR(*p))
+                p++;
+            if (p > buf)
+            {
+                heapString(&lp->endtag, lp->endtag.sl + (p - buf) + 1);
+                memcpy(lp->endtag.s + lp->endtag.sl, buf, p - buf);
+                lp->endtag.sl += p - buf;
+                lp->endtag.s[lp->endtag.sl] = '\0';
+                lp->lastc                    = p[-1];
+            }
+            return (p - buf);
 
-    /* do a pending '<' first then newc */
-    if (lp->lastc == '<')
-    {
-        if (oneXMLchar(lp, '<', ynot) < 0)
+        case INATTRV:
+            /* control chars are dropped, so they go the slow way */
         {
-            initParser(lp);
-            return (NULL);
+            XMLAtt *ap = lp->ce->at[lp->ce->nat - 1];
+
+            sp = &ap->valu;
+            while (p < end && *p >= ' ' && *p < 0x7f && *p != '&' && *p != '<' && *p != lp->delim)
+            {
+                if (*p == '>' || *p == '\'' || *p == '"')
+                    ap->valu_hasent = 1;
+                p++;
+            }
+            break;
         }
-        /* N.B. we assume '<' will never result in closure */
-    }
 
-    /* process newc (at last!) */
-    s = oneXMLchar(lp, newc, ynot);
-    if (s == 0)
-    {
-        lp->lastc = newc;
-        return (NULL);
+        case INCON:
+        {
+            const unsigned char *q;
+
+            sp = &lp->ce->pcdata;
+            p  = memchr(buf, '<', size);
+            if (!p)
+                p = end;
+            if ((q = memchr(buf, '&', p - buf)) != NULL)
+                p = q;
+            if ((q = memchr(buf, '\0', p - buf)) != NULL)
+                p = q;
+            for (q = buf; (q = memchr(q, '\n', p - q)) != NULL; q++)
+                lp->ln++;
+            break;
+        }
+
+        default:
+            return (0);
     }
-    if (s < 0)
+
+    if (p > buf)
     {
-        initParser(lp);
-        return (NULL);
+        arenaString(lp, sp, (const char *)buf, p - buf);
+        lp->lastc = p[-1];
     }
 
-    /* Ok! return ce and we start over.
-     * N.B. up to caller to call delXMLEle with what we return.
-     */
-    root   = lp->ce;
-    lp->ce = NULL;
-    initParser(lp);
-    return (root);
+    return (p - buf);
 }
 
 /* parse the given XML string.
@@ -478,11 +561,11 @@ XMLEle *cloneXMLEle(XMLEle *ep)
     char *buf;
     char ynot[1024];
     XMLEle *newep;
+    int l;
 
-    buf = (*mymalloc)(sprlXMLEle(ep, 0) + 1);
-    sprXMLEle(buf, ep, 0);
+    buf   = sprmXMLEle(ep, 0, NULL, 0, &l);
     newep = parseXML(buf, ynot);
-    (*myfree)(buf);
+    free(buf);
 
     return (newep);
 }
@@ -648,8 +731,7 @@ XMLEle *addXMLEle(XMLEle *parent, const char *tag)
  */
 void appXMLEle(XMLEle *ep, XMLEle *newep)
 {
-    ep->el            = (XMLEle **)moremem(ep->el, (ep->nel + 1) * sizeof(XMLEle *));
-    ep->el[ep->nel++] = newep;
+    appendEle(ep, newep);
 }
 
 /* set the pcdata of the given element */
@@ -666,6 +748,7 @@ XMLAtt *addXMLAtt(XMLEle *ep, const char *name, const char *valu)
     XMLAtt *ap = growAtt(ep);
     appendString(&ap->name, name);
     appendString(&ap->valu, valu);
+    ap->valu_hasent = (strpbrk(valu, entities) != NULL);
     return (ap);
 }
 
@@ -690,41 +773,22 @@ void editXMLAtt(XMLAtt *ap, const char *str)
 {
     freeString(&ap->valu);
     appendString(&ap->valu, str);
+    ap->valu_hasent = (strpbrk(str, entities) != NULL);
 }
 
 /* sample print ep to fp
  * N.B. set level = 0 on first call
  */
-#define PRINDENT 4 /* sample print indent each level */
 void prXMLEle(FILE *fp, XMLEle *ep, int level)
 {
-    int indent = level * PRINDENT;
-    int i;
-
-    fprintf(fp, "%*s<%s", indent, "", ep->tag.s);
-    for (i = 0; i < ep->nat; i++)
-        fprintf(fp, " %s=\"%s\"", ep->at[i]->name.s, entityXML(ep->at[i]->valu.s));
-    if (ep->nel > 0)
-    {
-        fprintf(fp, ">\n");
-        for (i = 0; i < ep->nel; i++)
-            prXMLEle(fp, ep->el[i], level + 1);
-    }
-    if (ep->pcdata.sl > 0)
-    {
-        if (ep->nel == 0)
-            fprintf(fp, ">\n");
-        if (ep->pcdata_hasent)
-            fprintf(fp, "%s", entityXML(ep->pcdata.s));
-        else
-            fprintf(fp, "%s", ep->pcdata.s);
-        if (ep->pcdata.s[ep->pcdata.sl - 1] != '\n')
-            fprintf(fp, "\n");
-    }
-    if (ep->nel > 0 || ep->pcdata.sl > 0)
-        fprintf(fp, "%*s</%s>\n", indent, "", ep->tag.s);
-    else
-        fprintf(fp, "/>\n");
+    char buf[4096];
+    char *s;
+    int l;
+
+    s = sprmXMLEle(ep, level, buf, sizeof(buf), &l);
+    fwrite(s, 1, l, fp);
+    if (s != buf)
+        free(s);
 }
 
 /* sample print ep to string s.
@@ -734,39 +798,16 @@ void prXMLEle(FILE *fp, XMLEle *ep, int level)
  */
 int sprXMLEle(char *s, XMLEle *ep, int level)
 {
-    int indent = level * PRINDENT;
-    int sl     = 0;
-    int i;
+    XMLOut out;
 
-    sl += sprintf(s + sl, "%*s<%s", indent, "", ep->tag.s);
-    for (i = 0; i < ep->nat; i++)
-        sl += sprintf(s + sl, " %s=\"%s\"", ep->at[i]->name.s, entityXML(ep->at[i]->valu.s));
-    if (ep->nel > 0)
-    {
-        sl += sprintf(s + sl, ">\n");
-        for (i = 0; i < ep->nel; i++)
-            sl += sprXMLEle(s + sl, ep->el[i], level + 1);
-    }
-    if (ep->pcdata.sl > 0)
-    {
-        if (ep->nel == 0)
-            sl += sprintf(s + sl, ">\n");
-        if (ep->pcdata_hasent)
-            sl += sprintf(s + sl, "%s", entityXML(ep->pcdata.s));
-        else
-        {
-            strcpy(s + sl, ep->pcdata.s);
-            sl += ep->pcdata.sl;
-        }
-        if (ep->pcdata.s[ep->pcdata.sl - 1] != '\n')
-            sl += sprintf(s + sl, "\n");
-    }
-    if (ep->nel > 0 || ep->pcdata.sl > 0)
-        sl += sprintf(s + sl, "%*s</%s>\n", indent, "", ep->tag.s);
-    else
-        sl += sprintf(s + sl, "/>\n");
+    out.s    = s;
+    out.sl   = 0;
+    out.sz   = -1;
+    out.user = s;
+    outXMLEle(&out, ep, level);
+    s[out.sl] = '\0';
 
-    return (sl);
+    return (out.sl);
 }
 
 /* return number of bytes in a string guaranteed able to hold result of
@@ -774,38 +815,173 @@ int sprXMLEle(char *s, XMLEle *ep, int level)
  * N.B. set level = 0 on first call
  */
 int sprlXMLEle(XMLEle *ep, int level)
+{
+    XMLOut out;
+
+    out.s    = NULL;
+    out.sl   = 0;
+    out.sz   = 0;
+    out.user = NULL;
+    outXMLEle(&out, ep, level);
+
+    return (out.sl);
+}
+
+/* sample print ep in one pass to buf if it fits in bufsize bytes, else to a
+ * malloced buffer. buf may be NULL.
+ * N.B. set level = 0 on first call
+ * return buf or the malloced buffer, with the length of the string (sans
+ * trailing \0) in *len.
+ */
+char *sprmXMLEle(XMLEle *ep, int level, char *buf, int bufsize, int *len)
+{
+    XMLOut out;
+
+    out.s    = buf;
+    out.sl   = 0;
+    out.sz   = buf ? bufsize : 0;
+    out.user = buf;
+    if (!buf)
+        outRoom(&out, 1024);
+    outXMLEle(&out, ep, level);
+    out.s[out.sl] = '\0';
+
+    *len = out.sl;
+    return (out.s);
+}
+
+/* make room in op for n more chars plus a trailing \0.
+ * a string outgrowing the caller's buffer moves to a malloced one, grown
+ * with generous slack so big pcdata such as BLOBs is copied at most once.
+ * N.B. plain malloc/realloc, not the lilxmlMalloc() ones: callers of
+ *   sprmXMLEle() release the string with free().
+ */
+static void outRoom(XMLOut *op, int n)
+{
+    int need = op->sl + n + 1;
+    int sz;
+
+    if (op->sz < 0 || need <= op->sz)
+        return;
+
+    sz = 2 * op->sz;
+    if (sz < need)
+        sz = need + need / 4;
+
+    if (op->s == op->user)
+    {
+        char *s = (char *)malloc(sz);
+        if (op->sl > 0)
+            memcpy(s, op->s, op->sl);
+        op->s = s;
+    }
+    else
+        op->s = (char *)realloc(op->s, sz);
+    op->sz = sz;
+}
+
+/* append n chars of str to op, or just count them if op has no string */
+static void outBytes(XMLOut *op, const char *str, int n)
+{
+    if (op->s)
+    {
+        outRoom(op, n);
+        memcpy(op->s + op->sl, str, n);
+    }
+    op->sl += n;
+}
+
+/* append n spaces to op */
+static void outIndent(XMLOut *op, int n)
+{
+    if (op->s)
+    {
+        outRoom(op, n);
+        memset(op->s + op->sl, ' ', n);
+    }
+    op->sl += n;
+}
+
+/* append the n chars of str to op, with the xml-sensitive characters replaced
+ * by their entity sequences if hasent. Clean runs are copied as they are.
+ */
+static void outEntity(XMLOut *op, const char *str, int n, int hasent)
+{
+    const char *end = str + n;
+    const char *ep;
+
+    if (!hasent)
+    {
+        outBytes(op, str, n);
+        return;
+    }
+
+    for (; (ep = strpbrk(str, entities)) != NULL && ep < end; str = ep + 1)
+    {
+        outBytes(op, str, ep - str);
+        switch (*ep)
+        {
+            case '&':
+                outBytes(op, "&amp;", 5);
+                break;
+            case '<':
+                outBytes(op, "&lt;", 4);
+                break;
+            case '>':
+                outBytes(op, "&gt;", 4);
+                break;
+            case '\'':
+                outBytes(op, "&apos;", 6);
+                break;
+            case '"':
+                outBytes(op, "&quot;", 6);
+                break;
+        }
+    }
+    outBytes(op, str, end - str);
+}
+
+/* the one printer behind prXMLEle(), sprXMLEle(), sprlXMLEle() and sprmXMLEle() */
+static void outXMLEle(XMLOut *op, XMLEle *ep, int level)
 {
     int indent = level * PRINDENT;
-    int l      = 0;
     int i;
 
-    l += indent + 1 + ep->tag.sl;
+    outIndent(op, indent);
+    outBytes(op, "<", 1);
+    outBytes(op, ep->tag.s, ep->tag.sl);
     for (i = 0; i < ep->nat; i++)
-        l += ep->at[i]->name.sl + 4 + strlen(entityXML(ep->at[i]->valu.s));
-
+    {
+        XMLAtt *ap = ep->at[i];
+        outBytes(op, " ", 1);
+        outBytes(op, ap->name.s, ap->name.sl);
+        outBytes(op, "=\"", 2);
+        outEntity(op, ap->valu.s, ap->valu.sl, ap->valu_hasent);
+        outBytes(op, "\"", 1);
+    }
     if (ep->nel > 0)
     {
-        l += 2;
+        outBytes(op, ">\n", 2);
         for (i = 0; i < ep->nel; i++)
-            l += sprlXMLEle(ep->el[i], level + 1);
+            outXMLEle(op, ep->el[i], level + 1);
     }
     if (ep->pcdata.sl > 0)
     {
         if (ep->nel == 0)
-            l += 2;
-        if (ep->pcdata_hasent)
-            l += strlen(entityXML(ep->pcdata.s));
-        else
-            l += ep->pcdata.sl;
+            outBytes(op, ">\n", 2);
+        outEntity(op, ep->pcdata.s, ep->pcdata.sl, ep->pcdata_hasent);
         if (ep->pcdata.s[ep->pcdata.sl - 1] != '\n')
-            l += 1;
+            outBytes(op, "\n", 1);
     }
     if (ep->nel > 0 || ep->pcdata.sl > 0)
-        l += indent + 4 + ep->tag.sl;
+    {
+        outIndent(op, indent);
+        outBytes(op, "</", 2);
+        outBytes(op, ep->tag.s, ep->tag.sl);
+        outBytes(op, ">\n", 2);
+    }
     else
-        l += 3;
-
-    return (l);
+        outBytes(op, "/>\n", 3);
 }
 
 /* return a string with all xml-sensitive characters within the passed string s
@@ -916,7 +1092,7 @@ static int oneXMLchar(LilXML *lp, int c, char ynot[])
         case LOOK4TAG: /* looking for element tag */
             if (isTokenChar(1, c))
             {
-                growString(&lp->ce->tag, c);
+                arenaChar(lp, &lp->ce->tag, c);
                 lp->cs = INTAG;
             }
             else if (!isspace(c))
@@ -928,7 +1104,7 @@ static int oneXMLchar(LilXML *lp, int c, char ynot[])
 
         case INTAG: /* reading tag */
             if (isTokenChar(0, c))
-                growString(&lp->ce->tag, c);
+                arenaChar(lp, &lp->ce->tag, c);
             else if (c == '>')
                 lp->cs = LOOK4CON;
             else if (c == '/')
@@ -944,8 +1120,8 @@ static int oneXMLchar(LilXML *lp, int c, char ynot[])
                 lp->cs = SAWSLASH;
             else if (isTokenChar(1, c))
             {
-                XMLAtt *ap = growAtt(lp->ce);
-                growString(&ap->name, c);
+                XMLAtt *ap = pushXMLAtt(lp);
+                arenaChar(lp, &ap->name, c);
                 lp->cs = INATTRN;
             }
             else if (!isspace(c))
@@ -972,7 +1148,7 @@ static int oneXMLchar(LilXML *lp, int c, char ynot[])
 
         case INATTRN: /* reading attr name */
             if (isTokenChar(0, c))
-                growString(&lp->ce->at[lp->ce->nat - 1]->name, c);
+                arenaChar(lp, &lp->ce->at[lp->ce->nat - 1]->name, c);
             else if (isspace(c) || c == '=')
                 lp->cs = LOOK4ATTRV;
             else
@@ -998,14 +1174,18 @@ static int oneXMLchar(LilXML *lp, int c, char ynot[])
         case INATTRV: /* in attr value */
             if (c == '&')
             {
-                newString(&lp->entity);
+                resetString(&lp->entity);
                 growString(&lp->entity, c);
                 lp->cs = ENTINATTRV;
             }
             else if (c == lp->delim)
                 lp->cs = LOOK4ATTRN;
             else if (!iscntrl(c))
-                growString(&lp->ce->at[lp->ce->nat - 1]->valu, c);
+            {
+                arenaChar(lp, &lp->ce->at[lp->ce->nat - 1]->valu, c);
+                if (strchr(entities, c))
+                    lp->ce->at[lp->ce->nat - 1]->valu_hasent = 1;
+            }
             break;
 
         case ENTINATTRV: /* working on entity in attr valu */
@@ -1014,10 +1194,11 @@ static int oneXMLchar(LilXML *lp, int c, char ynot[])
                 /* if find a recongized esp seq, add equiv char else raw seq */
                 growString(&lp->entity, c);
                 if (decodeEntity(lp->entity.s, &c))
-                    growString(&lp->ce->at[lp->ce->nat - 1]->valu, c);
+                    arenaChar(lp, &lp->ce->at[lp->ce->nat - 1]->valu, c);
                 else
-                    appendString(&lp->ce->at[lp->ce->nat - 1]->valu, lp->entity.s);
-                freeString(&lp->entity);
+                    arenaString(lp, &lp->ce->at[lp->ce->nat - 1]->valu, lp->entity.s, lp->entity.sl);
+                /* either way it is encoded again when printed */
+                lp->ce->at[lp->ce->nat - 1]->valu_hasent = 1;
                 lp->cs = INATTRV;
             }
             else
@@ -1029,7 +1210,7 @@ static int oneXMLchar(LilXML *lp, int c, char ynot[])
                 lp->cs = SAWLTINCON;
             else if (!isspace(c))
             {
-                growString(&lp->ce->pcdata, c);
+                arenaChar(lp, &lp->ce->pcdata, c);
                 lp->cs = INCON;
             }
             break;
@@ -1037,7 +1218,7 @@ static int oneXMLchar(LilXML *lp, int c, char ynot[])
         case INCON: /* reading content */
             if (c == '&')
             {
-                newString(&lp->entity);
+                resetString(&lp->entity);
                 growString(&lp->entity, c);
                 lp->cs = ENTINCON;
             }
@@ -1050,7 +1231,7 @@ static int oneXMLchar(LilXML *lp, int c, char ynot[])
             }
             else
             {
-                growString(&lp->ce->pcdata, c);
+                arenaChar(lp, &lp->ce->pcdata, c);
             }
             break;
 
@@ -1060,17 +1241,16 @@ static int oneXMLchar(LilXML *lp, int c, char ynot[])
                 /* if find a recognized esc seq, add equiv char else raw seq */
                 growString(&lp->entity, c);
                 if (decodeEntity(lp->entity.s, &c))
-                    growString(&lp->ce->pcdata, c);
+                    arenaChar(lp, &lp->ce->pcdata, c);
                 else
                 {
-                    appendString(&lp->ce->pcdata, lp->entity.s);
+                    arenaString(lp, &lp->ce->pcdata, lp->entity.s, lp->entity.sl);
                     //lp->ce->pcdata_hasent = 1;
                 }
                 // JM 2018-09-26: Even if decoded, we always set
                 // pcdata_hasent to 1 since we need to encode it again
                 // before sending it over to clients and drivers.
                 lp->ce->pcdata_hasent = 1;
-                freeString(&lp->entity);
                 lp->cs = INCON;
             }
             else
@@ -1088,7 +1268,7 @@ static int oneXMLchar(LilXML *lp, int c, char ynot[])
                 pushXMLEle(lp);
                 if (isTokenChar(1, c))
                 {
-                    growString(&lp->ce->tag, c);
+                    arenaChar(lp, &lp->ce->tag, c);
                     lp->cs = INTAG;
                 }
                 else
@@ -1141,12 +1321,28 @@ static int oneXMLchar(LilXML *lp, int c, char ynot[])
 /* set up for a fresh start again */
 static void initParser(LilXML *lp)
 {
-    delXMLEle(lp->ce);
-    freeString(&lp->endtag);
-    memset(lp, 0, sizeof(*lp));
-    newString(&lp->endtag);
-    lp->cs = LOOK4START;
-    lp->ln = 1;
+    /* a partial tree is all in the arena, delete it from its root */
+    if (lp->ce)
+    {
+        XMLEle *root = lp->ce;
+        while (root->pe)
+            root = root->pe;
+        root->arena = lp->arena;
+        lp->arena   = NULL;
+        delXMLEle(root);
+    }
+    freeArena(lp->arena);
+
+    lp->cs       = LOOK4START;
+    lp->ln       = 1;
+    lp->ce       = NULL;
+    lp->delim    = 0;
+    lp->lastc    = 0;
+    lp->skipping = 0;
+    lp->arena    = NULL;
+    lp->open     = NULL;
+    resetString(&lp->endtag);
+    resetString(&lp->entity);
 }
 
 /* start a new XMLEle.
@@ -1156,7 +1352,27 @@ static void initParser(LilXML *lp)
  */
 static void pushXMLEle(LilXML *lp)
 {
-    lp->ce = growEle(lp->ce);
+    XMLEle *pe   = lp->ce;
+    XMLEle *newe = (XMLEle *)arenaAlloc(lp, sizeof(XMLEle));
+
+    memset(newe, 0, sizeof(XMLEle));
+    newe->tag.s    = nullstr;
+    newe->pcdata.s = nullstr;
+    newe->pe       = pe;
+
+    if (pe)
+    {
+        if (pe->nel == pe->mel)
+        {
+            XMLEle **el = (XMLEle **)arenaAlloc(lp, (pe->mel = pe->mel ? 2 * pe->mel : 4) * sizeof(XMLEle *));
+            if (pe->nel > 0)
+                memcpy(el, pe->el, pe->nel * sizeof(XMLEle *));
+            pe->el = el;
+        }
+        pe->el[pe->nel++] = newe;
+    }
+
+    lp->ce = newe;
     resetEndTag(lp);
 }
 
@@ -1169,36 +1385,92 @@ static void popXMLEle(LilXML *lp)
     resetEndTag(lp);
 }
 
+/* add room for and return one new XMLAtt to the element being parsed */
+static XMLAtt *pushXMLAtt(LilXML *lp)
+{
+    XMLEle *ep   = lp->ce;
+    XMLAtt *newa = (XMLAtt *)arenaAlloc(lp, sizeof(XMLAtt));
+
+    memset(newa, 0, sizeof(*newa));
+    newa->name.s = nullstr;
+    newa->valu.s = nullstr;
+    newa->ce     = ep;
+
+    if (ep->nat == ep->mat)
+    {
+        XMLAtt **at = (XMLAtt **)arenaAlloc(lp, (ep->mat = ep->mat ? 2 * ep->mat : 8) * sizeof(XMLAtt *));
+        if (ep->nat > 0)
+            memcpy(at, ep->at, ep->nat * sizeof(XMLAtt *));
+        ep->at = at;
+    }
+    ep->at[ep->nat++] = newa;
+
+    return (newa);
+}
+
 /* return one new XMLEle, added to the given element if given */
 static XMLEle *growEle(XMLEle *pe)
 {
     XMLEle *newe = (XMLEle *)moremem(NULL, sizeof(XMLEle));
 
     memset(newe, 0, sizeof(XMLEle));
-    newString(&newe->tag);
-    newString(&newe->pcdata);
-    newe->pe = pe;
+    newe->tag.s    = nullstr;
+    newe->pcdata.s = nullstr;
+    newe->pe       = pe;
+    newe->heap     = ELE_HEAP;
 
     if (pe)
-    {
-        pe->el            = (XMLEle **)moremem(pe->el, (pe->nel + 1) * sizeof(XMLEle *));
-        pe->el[pe->nel++] = newe;
-    }
+        appendEle(pe, newe);
 
     return (newe);
 }
 
+/* add ep to the child elements of pe */
+static void appendEle(XMLEle *pe, XMLEle *ep)
+{
+    if (pe->nel == pe->mel)
+    {
+        pe->mel = pe->mel ? 2 * pe->mel : 4;
+        if (pe->heap & ELLS_HEAP)
+            pe->el = (XMLEle **)moremem(pe->el, pe->mel * sizeof(XMLEle *));
+        else
+        {
+            /* first growth of a parsed list, leave the old one to the arena */
+            XMLEle **el = (XMLEle **)moremem(NULL, pe->mel * sizeof(XMLEle *));
+            if (pe->nel > 0)
+                memcpy(el, pe->el, pe->nel * sizeof(XMLEle *));
+            pe->el = el;
+            pe->heap |= ELLS_HEAP;
+        }
+    }
+    pe->el[pe->nel++] = ep;
+}
+
 /* add room for and return one new XMLAtt to the given element */
 static XMLAtt *growAtt(XMLEle *ep)
 {
     XMLAtt *newa = (XMLAtt *)moremem(NULL, sizeof(XMLAtt));
 
     memset(newa, 0, sizeof(*newa));
-    newString(&newa->name);
-    newString(&newa->valu);
-    newa->ce = ep;
+    newa->name.s = nullstr;
+    newa->valu.s = nullstr;
+    newa->ce     = ep;
+    newa->heap   = 1;
 
-    ep->at            = (XMLAtt **)moremem(ep->at, (ep->nat + 1) * sizeof(XMLAtt *));
+    if (ep->nat == ep->mat)
+    {
+        ep->mat = ep->mat ? 2 * ep->mat : 8;
+        if (ep->heap & ATLS_HEAP)
+            ep->at = (XMLAtt **)moremem(ep->at, ep->mat * sizeof(XMLAtt *));
+        else
+        {
+            XMLAtt **at = (XMLAtt **)moremem(NULL, ep->mat * sizeof(XMLAtt *));
+            if (ep->nat > 0)
+                memcpy(at, ep->at, ep->nat * sizeof(XMLAtt *));
+            ep->at = at;
+            ep->heap |= ATLS_HEAP;
+        }
+    }
     ep->at[ep->nat++] = newa;
 
     return (newa);
@@ -1211,14 +1483,14 @@ static void freeAtt(XMLAtt *a)
         return;
     freeString(&a->name);
     freeString(&a->valu);
-    (*myfree)(a);
+    if (a->heap)
+        (*myfree)(a);
 }
 
 /* reset endtag */
 static void resetEndTag(LilXML *lp)
 {
-    freeString(&lp->endtag);
-    newString(&lp->endtag);
+    resetString(&lp->endtag);
 }
 
 /* 1 if c is a valid token character, else 0.
@@ -1232,18 +1504,9 @@ static int isTokenChar(int start, int c)
 /* grow the String storage at *sp to append c */
 static void growString(String *sp, int c)
 {
-    int l = sp->sl + 2; /* need room for '\0' plus c */
-
-    if (l > sp->sm)
-    {
-        if (!sp->s)
-            newString(sp);
-        else
-            sp->s = (char *)moremem(sp->s, sp->sm *= 2);
-    }
-    sp->s[--l] = '\0';
-    sp->s[--l] = (char)c;
-    sp->sl++;
+    heapString(sp, sp->sl + 2); /* need room for '\0' plus c */
+    sp->s[sp->sl++] = (char)c;
+    sp->s[sp->sl]   = '\0';
 }
 
 /* append str to the String storage at *sp */
@@ -1253,19 +1516,33 @@ static void appendString(String *sp, const char *str)
         return;
 
     int strl = strlen(str);
-    int l    = sp->sl + strl + 1; /* need room for '\0' */
 
-    if (l > sp->sm)
+    heapString(sp, sp->sl + strl + 1); /* need room for '\0' */
+    memcpy(&sp->s[sp->sl], str, strl + 1);
+    sp->sl += strl;
+}
+
+/* make *sp malloced with room for l bytes, keeping its content */
+static void heapString(String *sp, int l)
+{
+    if (sp->sm == 0)
     {
+        /* empty, or still in the arena of a parsed tree */
+        int sm  = l > MINMEM ? l : MINMEM;
+        char *s = (char *)moremem(NULL, sm);
+
         if (!sp->s)
-            newString(sp);
-        if (l > sp->sm)
-            sp->s = (char *)moremem(sp->s, (sp->sm = l));
+            sp->sl = 0;
+        else if (sp->sl > 0)
+            memcpy(s, sp->s, sp->sl);
+        s[sp->sl] = '\0';
+        sp->s     = s;
+        sp->sm    = sm;
     }
-    if (sp->s)
+    else if (l > sp->sm)
     {
-        strcpy(&sp->s[sp->sl], str);
-        sp->sl += strl;
+        sp->sm = 2 * sp->sm > l ? 2 * sp->sm : l;
+        sp->s  = (char *)moremem(sp->s, sp->sm);
     }
 }
 
@@ -1281,10 +1558,18 @@ static void newString(String *sp)
     sp->sl = 0;
 }
 
-/* free memory used by the given String */
-static void freeString(String *sp)
+/* empty a malloced String, keeping its memory */
+static void resetString(String *sp)
 {
+    sp->sl = 0;
     if (sp->s)
+        *sp->s = '\0';
+}
+
+/* free memory used by the given String, if it is not in an arena */
+static void freeString(String *sp)
+{
+    if (sp->sm > 0)
         (*myfree)(sp->s);
     sp->s  = NULL;
     sp->sl = 0;
@@ -1297,6 +1582,135 @@ static void *moremem(void *old, int n)
     return (old ? (*myrealloc)(old, n) : (*mymalloc)(n));
 }
 
+/* round n up to the arena alignment */
+static size_t arenaRound(size_t n)
+{
+    return ((n + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1));
+}
+
+/* start a new arena block with room for at least n bytes */
+static void arenaBlock(LilXML *lp, size_t n)
+{
+    size_t size = lp->arena ? 2 * (sizeof(ArenaBlock) + lp->arena->size) : ARENA_FIRST;
+    ArenaBlock *ap;
+
+    if (size > ARENA_MAX)
+        size = ARENA_MAX;
+    size -= sizeof(ArenaBlock);
+    if (size < n)
+        size = arenaRound(n);
+
+    ap        = (ArenaBlock *)moremem(NULL, sizeof(ArenaBlock) + size);
+    ap->prev  = lp->arena;
+    ap->size  = size;
+    ap->used  = 0;
+    lp->arena = ap;
+}
+
+/* return n bytes from the arena of the message being parsed */
+static void *arenaAlloc(LilXML *lp, size_t n)
+{
+    ArenaBlock *ap;
+    void *mem;
+
+    arenaSeal(lp);
+
+    n = arenaRound(n);
+    if (!lp->arena || lp->arena->used + n > lp->arena->size)
+        arenaBlock(lp, n);
+
+    ap  = lp->arena;
+    mem = (char *)(ap + 1) + ap->used;
+    ap->used += n;
+    return (mem);
+}
+
+/* append n chars at str to *sp, which is being parsed.
+ * the string being read is kept open at the end of the arena so it can grow
+ * in place. a string that is reopened, such as pcdata continuing after a
+ * child element, is moved there first.
+ */
+static void arenaString(LilXML *lp, String *sp, const char *str, int n)
+{
+    size_t need    = arenaRound(sp->sl + n + 1);
+    ArenaBlock *ap = lp->arena;
+
+    if (lp->open != sp)
+    {
+        char *s;
+
+        arenaSeal(lp);
+        if (!ap || ap->used + need > ap->size)
+        {
+            arenaBlock(lp, need);
+            ap = lp->arena;
+        }
+        s = (char *)(ap + 1) + ap->used;
+        if (sp->sl > 0)
+            memcpy(s, sp->s, sp->sl);
+        sp->s    = s;
+        lp->open = sp;
+    }
+    else if (ap->used + need > ap->size)
+    {
+        if (ap->used == 0)
+        {
+            /* nothing else in this block, let realloc() move it */
+            ap->size  = 2 * ap->size > need ? 2 * ap->size : need;
+            ap        = (ArenaBlock *)moremem(ap, sizeof(ArenaBlock) + ap->size);
+            lp->arena = ap;
+        }
+        else
+        {
+            arenaBlock(lp, 2 * need);
+            ap = lp->arena;
+            memcpy(ap + 1, sp->s, sp->sl);
+        }
+        sp->s = (char *)(ap + 1);
+    }
+
+    memcpy(sp->s + sp->sl, str, n);
+    sp->sl += n;
+    sp->s[sp->sl] = '\0';
+}
+
+/* append c to *sp, which is being parsed */
+static void arenaChar(LilXML *lp, String *sp, int c)
+{
+    char ch = (char)c;
+
+    /* the common case of readXMLEle(), room in the open string */
+    if (lp->open == sp && lp->arena->used + sp->sl + 2 <= lp->arena->size)
+    {
+        sp->s[sp->sl++] = ch;
+        sp->s[sp->sl]   = '\0';
+        return;
+    }
+
+    arenaString(lp, sp, &ch, 1);
+}
+
+/* close the string open at the end of the arena, if any */
+static void arenaSeal(LilXML *lp)
+{
+    if (lp->open)
+    {
+        lp->arena->used += arenaRound(lp->open->sl + 1);
+        lp->open = NULL;
+    }
+}
+
+/* free all blocks of an arena */
+static void freeArena(ArenaBlock *ap)
+{
+    while (ap)
+    {
+        ArenaBlock *prev = ap->prev;
+        (*myfree)(ap);
+        ap = prev;
+    }
+}
+
 #if defined(MAIN_TST)
 int main(int ac, char *av[])
 {
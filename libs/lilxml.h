@@ -106,6 +106,16 @@ extern void delXMLEle(XMLEle *e);
  */
 extern XMLEle **parseXMLChunk(LilXML *lp, char *buf, int size, char errmsg[]);
 
+/** \brief Process an XML chunk up to the end of the first complete element.
+    \param lp a pointer to a lilxml parser.
+    \param buf buffer to process.
+    \param size size of buf
+    \param used set to the number of characters of buf that were processed.
+    \param errmsg a buffer to store error messages if an error in parsing is encountered.
+    \return the complete element, the rest of buf is left alone so that what follows the element, such as raw BLOB payloads, may be read by the caller. NULL if all of buf was processed without completing an element, or if a parsing error occurs. Check errmsg for errors if NULL is returned.
+ */
+extern XMLEle *parseXMLEle(LilXML *lp, char *buf, int size, int *used, char errmsg[]);
+
 /** \brief Process an XML one char at a time.
   \param lp a pointer to a lilxml parser.
   \param c one character to process.
@@ -230,7 +240,7 @@ extern void rmXMLAtt(XMLEle *ep, const char *name);
 extern void editXMLAtt(XMLAtt *ap, const char *str);
 
 /** \brief return a string with all xml-sensitive characters within the passed string replaced with their entity sequence equivalents.
-*   N.B. caller must use the returned string before calling us again.
+*   N.B. caller must use the returned string before calling us again, the printers below do not use it and are reentrant.
 */
 extern char *entityXML(char *str);
 
@@ -269,6 +279,18 @@ extern int sprXMLEle(char *s, XMLEle *ep, int level);
 */
 extern int sprlXMLEle(XMLEle *ep, int level);
 
+/** \brief sample print ep in one pass to buf if it fits, else to a malloced buffer.
+*   N.B. set level = 0 on first call.
+*   \param ep the XML element to print.
+*   \param level the printing level, set to 0 to print the whole element.
+*   \param buf buffer to print to while the output fits, may be NULL.
+*   \param bufsize size of buf.
+*   \param len set to the length of the resulting string (sans trailing @\0@).
+*   \return buf, or a buffer from malloc() the caller must free() if buf was too small. It is always malloc(),
+*   even when other memory managers were installed for lilxml.
+*/
+extern char *sprmXMLEle(XMLEle *ep, int level, char *buf, int bufsize, int *len);
+
 /* install alternatives to malloc/realloc/free */
 extern void indi_xmlMalloc(void *(*newmalloc)(size_t size), void *(*newrealloc)(void *ptr, size_t size),
                            void (*newfree)(void *ptr));
@@ -186,6 +186,17 @@ void bayer16_2_rgb24(unsigned short *dst, unsigned short *src, long int WIDTH, l
 void bayer_rggb_2rgb24(unsigned char *dst, unsigned char *srcc, long int WIDTH, long int HEIGHT);
 
 void bayer_grbg_to_rgb24(unsigned char *dst, unsigned char *srcc, long int WIDTH, long int HEIGHT);
+
+/** Bayer colour filter layouts, named after the top left 2x2 pixels */
+typedef enum { CCVT_BAYER_BGGR, CCVT_BAYER_RGGB, CCVT_BAYER_GRBG, CCVT_BAYER_GBRG } ccvt_bayer_pattern;
+
+/** Demosaic methods: bilinear, or green interpolated along edges instead of across them */
+typedef enum { CCVT_DEMOSAIC_BILINEAR, CCVT_DEMOSAIC_EDGE_AWARE } ccvt_demosaic_method;
+
+/** Bayer 8 bit of any layout to RGB 24. Image borders are interpolated from mirrored pixels. */
+void ccvt_bayer8_rgb24(int width, int height, const void *src, void *dst, ccvt_bayer_pattern pattern,
+                       ccvt_demosaic_method method);
+
 // void convert_border_bayer_line_to_bgr24( uint8_t* bayer, uint8_t* adjacent_bayer, uint8_t *bgr, int width, uint8_t start_with_green, uint8_t blue_line);
 // void bayer_to_rgbbgr24(uint8_t *bayer, uint8_t *bgr, int width, int height, uint8_t start_with_green, uint8_t blue_line);
 
@@ -21,112 +21,65 @@
 */
 
 #include "ccvt.h"
-#include "ccvt_types.h"
-
-/* by suitable definition of PIXTYPE, can do yuv to rgb or bgr, with or
-without word alignment */
-
-/* This doesn't exactly earn a prize in a programming beauty contest. */
-
-#define WHOLE_FUNC2RGB(type)                                        \
-    const unsigned char *y1, *y2, *u, *v;                           \
-    PIXTYPE_##type *l1, *l2;                                        \
-    int r, g, b, cr, cg, cb, yp, j, i;                              \
-                                                                    \
-    if ((width & 1) || (height & 1))                                \
-        return;                                                     \
-                                                                    \
-    l1 = (PIXTYPE_##type *)dst;                                     \
-    l2 = l1 + width;                                                \
-    y1 = (unsigned char *)src;                                      \
-    y2 = y1 + width;                                                \
-    u  = (unsigned char *)src + width * height;                     \
-    v  = u + (width * height) / 4;                                  \
-    j  = height / 2;                                                \
-    while (j--)                                                     \
-    {                                                               \
-        i = width / 2;                                              \
-        while (i--)                                                 \
-        {                                                           \
-            /* Since U & V are valid for 4 pixels, repeat code 4 	\
-			   times for different Y */ \
-            cb = ((*u - 128) * 454) >> 8;                           \
-            cr = ((*v - 128) * 359) >> 8;                           \
-            cg = ((*v - 128) * 183 + (*u - 128) * 88) >> 8;         \
-                                                                    \
-            yp = *(y1++);                                           \
-            r  = yp + cr;                                           \
-            b  = yp + cb;                                           \
-            g  = yp - cg;                                           \
-            SAT(r);                                                 \
-            SAT(g);                                                 \
-            SAT(b);                                                 \
-            l1->b = b;                                              \
-            l1->g = g;                                              \
-            l1->r = r;                                              \
-            l1++;                                                   \
-                                                                    \
-            yp = *(y1++);                                           \
-            r  = yp + cr;                                           \
-            b  = yp + cb;                                           \
-            g  = yp - cg;                                           \
-            SAT(r);                                                 \
-            SAT(g);                                                 \
-            SAT(b);                                                 \
-            l1->b = b;                                              \
-            l1->g = g;                                              \
-            l1->r = r;                                              \
-            l1++;                                                   \
-                                                                    \
-            yp = *(y2++);                                           \
-            r  = yp + cr;                                           \
-            b  = yp + cb;                                           \
-            g  = yp - cg;                                           \
-            SAT(r);                                                 \
-            SAT(g);                                                 \
-            SAT(b);                                                 \
-            l2->b = b;                                              \
-            l2->g = g;                                              \
-            l2->r = r;                                              \
-            l2++;                                                   \
-                                                                    \
-            yp = *(y2++);                                           \
-            r  = yp + cr;                                           \
-            b  = yp + cb;                                           \
-            g  = yp - cg;                                           \
-            SAT(r);                                                 \
-            SAT(g);                                                 \
-            SAT(b);                                                 \
-            l2->b = b;                                              \
-            l2->g = g;                                              \
-            l2->r = r;                                              \
-            l2++;                                                   \
-                                                                    \
-            u++;                                                    \
-            v++;                                                    \
-        }                                                           \
-        y1 = y2;                                                    \
-        y2 += width;                                                \
-        l1 = l2;                                                    \
-        l2 += width;                                                \
-    }
+#include "ccvt_simd.h"
+
+/* Rows are converted by the vectorised kernels of ccvt_simd.c, split across the CPUs for large images. */
+
+struct ccvt_420p_job
+{
+    int width;
+    int height;
+    const unsigned char *src;
+    unsigned char *dst;
+    int format;
+    int bytes;
+};
+
+static void ccvt_420p_rows(void *context, int first, int last)
+{
+    const struct ccvt_420p_job *job = context;
+    const unsigned char *u          = job->src + job->width * job->height;
+    const unsigned char *v          = u + (job->width * job->height) / 4;
+    int l;
+
+    for (l = first; l < last; l++)
+        ccvt_simd_420p_row(job->src + l * job->width, u + (l / 2) * (job->width / 2), v + (l / 2) * (job->width / 2),
+                           job->dst + l * job->width * job->bytes, job->width / 2, job->format);
+}
+
+static void ccvt_420p(int width, int height, const void *src, void *dst, int format, int bytes)
+{
+    struct ccvt_420p_job job;
+
+    if ((width & 1) || (height & 1))
+        return;
+
+    job.width  = width;
+    job.height = height;
+    job.src    = src;
+    job.dst    = dst;
+    job.format = format;
+    job.bytes  = bytes;
+
+    ccvt_parallel_rows(height, (long)width * height, ccvt_420p_rows, &job);
+}
 
 void ccvt_420p_bgr32(int width, int height, const void *src, void *dst)
 {
-    WHOLE_FUNC2RGB(bgr32)
+    ccvt_420p(width, height, src, dst, CCVT_FMT_BGR32, 4);
 }
 
 void ccvt_420p_bgr24(int width, int height, const void *src, void *dst)
 {
-    WHOLE_FUNC2RGB(bgr24)
+    ccvt_420p(width, height, src, dst, CCVT_FMT_BGR24, 3);
 }
 
 void ccvt_420p_rgb32(int width, int height, const void *src, void *dst)
 {
-    WHOLE_FUNC2RGB(rgb32)
+    ccvt_420p(width, height, src, dst, CCVT_FMT_RGB32, 4);
 }
 
 void ccvt_420p_rgb24(int width, int height, const void *src, void *dst)
 {
-    WHOLE_FUNC2RGB(rgb24)
+    ccvt_420p(width, height, src, dst, CCVT_FMT_RGB24, 3);
 }
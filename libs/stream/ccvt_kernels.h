@@ -0,0 +1,213 @@
+/*  CCVT_KERNELS: row kernels of the colour conversions
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/* This file is included by ccvt_simd.c once for every instruction set, with
+   CCVT_TARGET set to the target attribute and CCVT_NAME() appending its suffix.
+
+   Every kernel works on at most CCVT_CHUNK pixels and keeps the inner loops free
+   of branches and interleaved stores, so the compiler can vectorise them. Colour
+   channels are computed into planar buffers first and interleaved in a second pass.
+ */
+
+/* Y + U/V to planar R, G, B, two pixels share one U/V pair */
+CCVT_TARGET static inline void CCVT_NAME(yuv_planar)(const uint8_t *restrict y, const uint8_t *restrict u,
+                                                     int ustride, const uint8_t *restrict v, int vstride, int ystride,
+                                                     uint8_t *restrict r, uint8_t *restrict g, uint8_t *restrict b,
+                                                     int pairs)
+{
+    int k;
+
+    for (k = 0; k < pairs; k++)
+    {
+        int y1 = y[ystride * 2 * k];
+        int y2 = y[ystride * (2 * k + 1)];
+        int cu = u[ustride * k] - 128;
+        int cv = v[vstride * k] - 128;
+        int cb = (cu * 454) >> 8;
+        int cr = (cv * 359) >> 8;
+        int cg = (cv * 183 + cu * 88) >> 8;
+
+        r[2 * k]     = ccvt_sat(y1 + cr);
+        g[2 * k]     = ccvt_sat(y1 - cg);
+        b[2 * k]     = ccvt_sat(y1 + cb);
+        r[2 * k + 1] = ccvt_sat(y2 + cr);
+        g[2 * k + 1] = ccvt_sat(y2 - cg);
+        b[2 * k + 1] = ccvt_sat(y2 + cb);
+    }
+}
+
+/* The strides above are constant in every caller, spelling them out lets the compiler pick the right loads */
+CCVT_TARGET static void CCVT_NAME(yuyv_planar)(const uint8_t *restrict src, uint8_t *restrict r, uint8_t *restrict g,
+                                               uint8_t *restrict b, int pairs)
+{
+    CCVT_NAME(yuv_planar)(src, src + 1, 4, src + 3, 4, 2, r, g, b, pairs);
+}
+
+CCVT_TARGET static void CCVT_NAME(i420_planar)(const uint8_t *restrict y, const uint8_t *restrict u,
+                                               const uint8_t *restrict v, uint8_t *restrict r, uint8_t *restrict g,
+                                               uint8_t *restrict b, int pairs)
+{
+    CCVT_NAME(yuv_planar)(y, u, 1, v, 1, 1, r, g, b, pairs);
+}
+
+CCVT_TARGET static void CCVT_NAME(interleave3)(const uint8_t *restrict c0, const uint8_t *restrict c1,
+                                               const uint8_t *restrict c2, uint8_t *restrict dst, int n)
+{
+    int k;
+
+    for (k = 0; k < n; k++)
+    {
+        dst[3 * k]     = c0[k];
+        dst[3 * k + 1] = c1[k];
+        dst[3 * k + 2] = c2[k];
+    }
+}
+
+CCVT_TARGET static void CCVT_NAME(interleave4)(const uint8_t *restrict c0, const uint8_t *restrict c1,
+                                               const uint8_t *restrict c2, uint8_t *restrict dst, int n)
+{
+    int k;
+
+    /* Whole words vectorise far better than stride 4 byte stores */
+    for (k = 0; k < n; k++)
+    {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        uint32_t word = ((uint32_t)c0[k] << 24) | ((uint32_t)c1[k] << 16) | ((uint32_t)c2[k] << 8);
+#else
+        uint32_t word = c0[k] | ((uint32_t)c1[k] << 8) | ((uint32_t)c2[k] << 16);
+#endif
+        memcpy(dst + 4 * k, &word, sizeof(word));
+    }
+}
+
+CCVT_TARGET static void CCVT_NAME(interleave3_16)(const uint16_t *restrict c0, const uint16_t *restrict c1,
+                                                  const uint16_t *restrict c2, uint16_t *restrict dst, int n)
+{
+    int k;
+
+    for (k = 0; k < n; k++)
+    {
+        dst[3 * k]     = c0[k];
+        dst[3 * k + 1] = c1[k];
+        dst[3 * k + 2] = c2[k];
+    }
+}
+
+/* Bayer interpolation around the centre pixel p, u and d point to the same column one row up and down */
+#define CCVT_CENTER(u, p, d) ((p)[0])
+#define CCVT_CROSS(u, p, d)  (((p)[-1] + (p)[1] + (u)[0] + (d)[0]) >> 2)
+#define CCVT_DIAG(u, p, d)   (((u)[-1] + (u)[1] + (d)[-1] + (d)[1]) >> 2)
+#define CCVT_VERT(u, p, d)   (((u)[0] + (d)[0]) >> 1)
+#define CCVT_HORZ(u, p, d)   (((p)[-1] + (p)[1]) >> 1)
+/* Green along the direction with the smaller gradient, the cross average on flat areas */
+#define CCVT_EDGE(u, p, d)   ccvt_edge_green((p)[-1], (p)[1], (u)[0], (d)[0])
+
+/* Sites of the colour filter, by the interpolation of their R, G and B */
+#define CCVT_SITE_R(GREEN, j, u, p, d)                  \
+    do                                                  \
+    {                                                   \
+        r[j] = CCVT_CENTER(u, p, d);                    \
+        g[j] = GREEN(u, p, d);                          \
+        b[j] = CCVT_DIAG(u, p, d);                      \
+    } while (0)
+#define CCVT_SITE_B(GREEN, j, u, p, d)                  \
+    do                                                  \
+    {                                                   \
+        r[j] = CCVT_DIAG(u, p, d);                      \
+        g[j] = GREEN(u, p, d);                          \
+        b[j] = CCVT_CENTER(u, p, d);                    \
+    } while (0)
+/* Green with red to the left and right */
+#define CCVT_SITE_GR(GREEN, j, u, p, d)                 \
+    do                                                  \
+    {                                                   \
+        r[j] = CCVT_HORZ(u, p, d);                      \
+        g[j] = CCVT_CENTER(u, p, d);                    \
+        b[j] = CCVT_VERT(u, p, d);                      \
+    } while (0)
+/* Green with blue to the left and right */
+#define CCVT_SITE_GB(GREEN, j, u, p, d)                 \
+    do                                                  \
+    {                                                   \
+        r[j] = CCVT_VERT(u, p, d);                      \
+        g[j] = CCVT_CENTER(u, p, d);                    \
+        b[j] = CCVT_HORZ(u, p, d);                      \
+    } while (0)
+
+/* Pairs start on an odd column, so the odd site comes first */
+#define CCVT_BAYER_LOOP(ODD, EVEN, GREEN)                                              \
+    for (k = 0; k < pairs; k++)                                                        \
+    {                                                                                  \
+        ODD(GREEN, 2 * k, up + 2 * k, row + 2 * k, down + 2 * k);                      \
+        EVEN(GREEN, 2 * k + 1, up + 2 * k + 1, row + 2 * k + 1, down + 2 * k + 1);     \
+    }
+
+#define CCVT_BAYER_KIND(GREEN)                                                         \
+    switch (kind)                                                                      \
+    {                                                                                  \
+        case CCVT_ROW_BG:                                                              \
+            CCVT_BAYER_LOOP(CCVT_SITE_GB, CCVT_SITE_B, GREEN)                          \
+            break;                                                                     \
+        case CCVT_ROW_GR:                                                              \
+            CCVT_BAYER_LOOP(CCVT_SITE_R, CCVT_SITE_GR, GREEN)                          \
+            break;                                                                     \
+        case CCVT_ROW_RG:                                                              \
+            CCVT_BAYER_LOOP(CCVT_SITE_GR, CCVT_SITE_R, GREEN)                          \
+            break;                                                                     \
+        case CCVT_ROW_GB:                                                              \
+            CCVT_BAYER_LOOP(CCVT_SITE_B, CCVT_SITE_GB, GREEN)                          \
+            break;                                                                     \
+    }
+
+CCVT_TARGET static void CCVT_NAME(bayer8_planar)(const uint8_t *restrict up, const uint8_t *restrict row,
+                                                 const uint8_t *restrict down, uint8_t *restrict r,
+                                                 uint8_t *restrict g, uint8_t *restrict b, int pairs, int kind,
+                                                 int method)
+{
+    int k;
+
+    if (method == CCVT_DEMOSAIC_EDGE_AWARE)
+    {
+        CCVT_BAYER_KIND(CCVT_EDGE)
+    }
+    else
+    {
+        CCVT_BAYER_KIND(CCVT_CROSS)
+    }
+}
+
+CCVT_TARGET static void CCVT_NAME(bayer16_planar)(const uint16_t *restrict up, const uint16_t *restrict row,
+                                                  const uint16_t *restrict down, uint16_t *restrict r,
+                                                  uint16_t *restrict g, uint16_t *restrict b, int pairs, int kind)
+{
+    int k;
+
+    CCVT_BAYER_KIND(CCVT_CROSS)
+}
+
+#undef CCVT_BAYER_KIND
+#undef CCVT_BAYER_LOOP
+#undef CCVT_SITE_GB
+#undef CCVT_SITE_GR
+#undef CCVT_SITE_B
+#undef CCVT_SITE_R
+#undef CCVT_EDGE
+#undef CCVT_HORZ
+#undef CCVT_VERT
+#undef CCVT_DIAG
+#undef CCVT_CROSS
+#undef CCVT_CENTER
@@ -58,6 +58,7 @@
  */
 
 #include "ccvt.h"
+#include "ccvt_simd.h"
 #include "ccvt_types.h"
 //#include "indidevapi.h"
 #include "jpegutils.h"
@@ -78,142 +79,46 @@ void ccvt_yuyv_rgb32(int width, int height, const void *src, void *dst)
 }
 #endif
 
+struct ccvt_yuyv_job
+{
+    int pairs;
+    const unsigned char *src;
+    unsigned char *dst;
+    int format;
+    int bytes;
+};
+
+static void ccvt_yuyv_rows(void *context, int first, int last)
+{
+    const struct ccvt_yuyv_job *job = context;
+    int l;
+
+    for (l = first; l < last; l++)
+        ccvt_simd_yuyv_row(job->src + l * 4 * job->pairs, job->dst + l * 2 * job->pairs * job->bytes, job->pairs,
+                           job->format);
+}
+
+/* An odd last column is dropped, rows are packed without it */
+static void ccvt_yuyv(int width, int height, const void *src, void *dst, int format, int bytes)
+{
+    struct ccvt_yuyv_job job = { width >> 1, src, dst, format, bytes };
+
+    ccvt_parallel_rows(height, (long)width * height, ccvt_yuyv_rows, &job);
+}
+
 void ccvt_yuyv_bgr32(int width, int height, const void *src, void *dst)
 {
-    const unsigned char *s;
-    PIXTYPE_bgr32 *d;
-    int l, c;
-    int r, g, b, cr, cg, cb, y1, y2;
-
-    l = height;
-    s = src;
-    d = dst;
-    while (l--)
-    {
-        c = width >> 1;
-        while (c--)
-        {
-            y1 = *s++;
-            cb = ((*s - 128) * 454) >> 8;
-            cg = (*s++ - 128) * 88;
-            y2 = *s++;
-            cr = ((*s - 128) * 359) >> 8;
-            cg = (cg + (*s++ - 128) * 183) >> 8;
-
-            r = y1 + cr;
-            b = y1 + cb;
-            g = y1 - cg;
-            SAT(r);
-            SAT(g);
-            SAT(b);
-            d->b = b;
-            d->g = g;
-            d->r = r;
-            d++;
-            r = y2 + cr;
-            b = y2 + cb;
-            g = y2 - cg;
-            SAT(r);
-            SAT(g);
-            SAT(b);
-            d->b = b;
-            d->g = g;
-            d->r = r;
-            d++;
-        }
-    }
+    ccvt_yuyv(width, height, src, dst, CCVT_FMT_BGR32, 4);
 }
 
 void ccvt_yuyv_bgr24(int width, int height, const void *src, void *dst)
 {
-    const unsigned char *s;
-    PIXTYPE_bgr24 *d;
-    int l, c;
-    int r, g, b, cr, cg, cb, y1, y2;
-
-    l = height;
-    s = src;
-    d = dst;
-    while (l--)
-    {
-        c = width >> 1;
-        while (c--)
-        {
-            y1 = *s++;
-            cb = ((*s - 128) * 454) >> 8;
-            cg = (*s++ - 128) * 88;
-            y2 = *s++;
-            cr = ((*s - 128) * 359) >> 8;
-            cg = (cg + (*s++ - 128) * 183) >> 8;
-
-            r = y1 + cr;
-            b = y1 + cb;
-            g = y1 - cg;
-            SAT(r);
-            SAT(g);
-            SAT(b);
-            d->b = b;
-            d->g = g;
-            d->r = r;
-            d++;
-            r = y2 + cr;
-            b = y2 + cb;
-            g = y2 - cg;
-            SAT(r);
-            SAT(g);
-            SAT(b);
-            d->b = b;
-            d->g = g;
-            d->r = r;
-            d++;
-        }
-    }
+    ccvt_yuyv(width, height, src, dst, CCVT_FMT_BGR24, 3);
 }
 
 void ccvt_yuyv_rgb24(int width, int height, const void *src, void *dst)
 {
-    const unsigned char *s;
-    PIXTYPE_rgb24 *d;
-    int l, c;
-    int r, g, b, cr, cg, cb, y1, y2;
-
-    l = height;
-    s = src;
-    d = dst;
-    while (l--)
-    {
-        c = width >> 1;
-        while (c--)
-        {
-            y1 = *s++;
-            cb = ((*s - 128) * 454) >> 8;
-            cg = (*s++ - 128) * 88;
-            y2 = *s++;
-            cr = ((*s - 128) * 359) >> 8;
-            cg = (cg + (*s++ - 128) * 183) >> 8;
-
-            r = y1 + cr;
-            b = y1 + cb;
-            g = y1 - cg;
-            SAT(r);
-            SAT(g);
-            SAT(b);
-            d->r = r;
-            d->g = g;
-            d->b = b;
-            d++;
-            r = y2 + cr;
-            b = y2 + cb;
-            g = y2 - cg;
-            SAT(r);
-            SAT(g);
-            SAT(b);
-            d->r = r;
-            d->g = g;
-            d->b = b;
-            d++;
-        }
-    }
+    ccvt_yuyv(width, height, src, dst, CCVT_FMT_RGB24, 3);
 }
 
 void ccvt_yuyv_420p(int width, int height, const void *src, void *dsty, void *dstu, void *dstv)
@@ -260,289 +165,277 @@ void ccvt_yuyv_420p(int width, int height, const void *src, void *dsty, void *ds
     }
 }
 
-void bayer2rgb24(unsigned char *dst, unsigned char *src, long int WIDTH, long int HEIGHT)
-{
-    long int i;
-    unsigned char *rawpt, *scanpt;
-    long int size;
+/* Bayer demosaicing
 
-    rawpt  = src;
-    scanpt = dst;
-    size   = WIDTH * HEIGHT;
+   The interior of an image is interpolated by the vectorised row kernels of ccvt_simd.c. The first and last row
+   and column, and images with odd sizes, go through the per pixel code below, which keeps the border handling
+   of every function exactly as it was.
+ */
+
+typedef void (*bayer8_pixel_fn)(unsigned char *dst, const unsigned char *src, long int i, long int WIDTH,
+                                long int HEIGHT);
+
+/* One pixel of bayer2rgb24(), i is its index in the image */
+static void bayer_bggr8_pixel(unsigned char *dst, const unsigned char *src, long int i, long int WIDTH, long int HEIGHT)
+{
+    const unsigned char *rawpt = src + i;
+    unsigned char *scanpt      = dst + 3 * i;
 
-    for (i = 0; i < size; i++)
+    if ((i / WIDTH) % 2 == 0)
     {
-        if ((i / WIDTH) % 2 == 0)
+        if ((i % 2) == 0)
         {
-            if ((i % 2) == 0)
+            /* B */
+            if ((i > WIDTH) && ((i % WIDTH) > 0))
             {
-                /* B */
-                if ((i > WIDTH) && ((i % WIDTH) > 0))
-                {
-                    *scanpt++ =
-                        (*(rawpt - WIDTH - 1) + *(rawpt - WIDTH + 1) + *(rawpt + WIDTH - 1) + *(rawpt + WIDTH + 1)) /
-                        4;                                                                               /* R */
-                    *scanpt++ = (*(rawpt - 1) + *(rawpt + 1) + *(rawpt + WIDTH) + *(rawpt - WIDTH)) / 4; /* G */
-                    *scanpt++ = *rawpt;                                                                  /* B */
-                }
-                else
-                {
-                    /* first line or left column */
-                    *scanpt++ = *(rawpt + WIDTH + 1);                  /* R */
-                    *scanpt++ = (*(rawpt + 1) + *(rawpt + WIDTH)) / 2; /* G */
-                    *scanpt++ = *rawpt;                                /* B */
-                }
+                *scanpt++ =
+                    (*(rawpt - WIDTH - 1) + *(rawpt - WIDTH + 1) + *(rawpt + WIDTH - 1) + *(rawpt + WIDTH + 1)) /
+                    4;                                                                               /* R */
+                *scanpt++ = (*(rawpt - 1) + *(rawpt + 1) + *(rawpt + WIDTH) + *(rawpt - WIDTH)) / 4; /* G */
+                *scanpt++ = *rawpt;                                                                  /* B */
             }
             else
             {
-                /* (B)G */
-                if ((i > WIDTH) && ((i % WIDTH) < (WIDTH - 1)))
-                {
-                    *scanpt++ = (*(rawpt + WIDTH) + *(rawpt - WIDTH)) / 2; /* R */
-                    *scanpt++ = *rawpt;                                    /* G */
-                    *scanpt++ = (*(rawpt - 1) + *(rawpt + 1)) / 2;         /* B */
-                }
-                else
-                {
-                    /* first line or right column */
-                    *scanpt++ = *(rawpt + WIDTH); /* R */
-                    *scanpt++ = *rawpt;           /* G */
-                    *scanpt++ = *(rawpt - 1);     /* B */
-                }
+                /* first line or left column */
+                *scanpt++ = *(rawpt + WIDTH + 1);                  /* R */
+                *scanpt++ = (*(rawpt + 1) + *(rawpt + WIDTH)) / 2; /* G */
+                *scanpt++ = *rawpt;                                /* B */
             }
         }
         else
         {
-            if ((i % 2) == 0)
+            /* (B)G */
+            if ((i > WIDTH) && ((i % WIDTH) < (WIDTH - 1)))
             {
-                /* G(R) */
-                if ((i < (WIDTH * (HEIGHT - 1))) && ((i % WIDTH) > 0))
-                {
-                    *scanpt++ = (*(rawpt - 1) + *(rawpt + 1)) / 2;         /* R */
-                    *scanpt++ = *rawpt;                                    /* G */
-                    *scanpt++ = (*(rawpt + WIDTH) + *(rawpt - WIDTH)) / 2; /* B */
-                }
-                else
-                {
-                    /* bottom line or left column */
-                    *scanpt++ = *(rawpt + 1);     /* R */
-                    *scanpt++ = *rawpt;           /* G */
-                    *scanpt++ = *(rawpt - WIDTH); /* B */
-                }
+                *scanpt++ = (*(rawpt + WIDTH) + *(rawpt - WIDTH)) / 2; /* R */
+                *scanpt++ = *rawpt;                                    /* G */
+                *scanpt++ = (*(rawpt - 1) + *(rawpt + 1)) / 2;         /* B */
             }
             else
             {
-                /* R */
-                if (i < (WIDTH * (HEIGHT - 1)) && ((i % WIDTH) < (WIDTH - 1)))
-                {
-                    *scanpt++ = *rawpt;                                                                  /* R */
-                    *scanpt++ = (*(rawpt - 1) + *(rawpt + 1) + *(rawpt - WIDTH) + *(rawpt + WIDTH)) / 4; /* G */
-                    *scanpt++ =
-                        (*(rawpt - WIDTH - 1) + *(rawpt - WIDTH + 1) + *(rawpt + WIDTH - 1) + *(rawpt + WIDTH + 1)) /
-                        4; /* B */
-                }
-                else
-                {
-                    /* bottom line or right column */
-                    *scanpt++ = *rawpt;                                /* R */
-                    *scanpt++ = (*(rawpt - 1) + *(rawpt - WIDTH)) / 2; /* G */
-                    *scanpt++ = *(rawpt - WIDTH - 1);                  /* B */
-                }
+                /* first line or right column */
+                *scanpt++ = *(rawpt + WIDTH); /* R */
+                *scanpt++ = *rawpt;           /* G */
+                *scanpt++ = *(rawpt - 1);     /* B */
+            }
+        }
+    }
+    else
+    {
+        if ((i % 2) == 0)
+        {
+            /* G(R) */
+            if ((i < (WIDTH * (HEIGHT - 1))) && ((i % WIDTH) > 0))
+            {
+                *scanpt++ = (*(rawpt - 1) + *(rawpt + 1)) / 2;         /* R */
+                *scanpt++ = *rawpt;                                    /* G */
+                *scanpt++ = (*(rawpt + WIDTH) + *(rawpt - WIDTH)) / 2; /* B */
+            }
+            else
+            {
+                /* bottom line or left column */
+                *scanpt++ = *(rawpt + 1);     /* R */
+                *scanpt++ = *rawpt;           /* G */
+                *scanpt++ = *(rawpt - WIDTH); /* B */
+            }
+        }
+        else
+        {
+            /* R */
+            if (i < (WIDTH * (HEIGHT - 1)) && ((i % WIDTH) < (WIDTH - 1)))
+            {
+                *scanpt++ = *rawpt;                                                                  /* R */
+                *scanpt++ = (*(rawpt - 1) + *(rawpt + 1) + *(rawpt - WIDTH) + *(rawpt + WIDTH)) / 4; /* G */
+                *scanpt++ =
+                    (*(rawpt - WIDTH - 1) + *(rawpt - WIDTH + 1) + *(rawpt + WIDTH - 1) + *(rawpt + WIDTH + 1)) /
+                    4; /* B */
+            }
+            else
+            {
+                /* bottom line or right column */
+                *scanpt++ = *rawpt;                                /* R */
+                *scanpt++ = (*(rawpt - 1) + *(rawpt - WIDTH)) / 2; /* G */
+                *scanpt++ = *(rawpt - WIDTH - 1);                  /* B */
             }
         }
-        rawpt++;
     }
 }
 
-void bayer16_2_rgb24(unsigned short *dst, unsigned short *src, long int WIDTH, long int HEIGHT)
+/* One pixel of bayer16_2_rgb24() */
+static void bayer_bggr16_pixel(unsigned short *dst, const unsigned short *src, long int i, long int WIDTH,
+                               long int HEIGHT)
 {
-    long int i;
-    unsigned short *rawpt, *scanpt;
-    long int size;
-
-    rawpt  = src;
-    scanpt = dst;
-    size   = WIDTH * HEIGHT;
+    const unsigned short *rawpt = src + i;
+    unsigned short *scanpt      = dst + 3 * i;
 
-    for (i = 0; i < size; i++)
+    if ((i / WIDTH) % 2 == 0)
     {
-        if ((i / WIDTH) % 2 == 0)
+        if ((i % 2) == 0)
         {
-            if ((i % 2) == 0)
+            /* B */
+            if ((i > WIDTH) && ((i % WIDTH) > 0))
             {
-                /* B */
-                if ((i > WIDTH) && ((i % WIDTH) > 0))
-                {
-                    *scanpt++ =
-                        (*(rawpt - WIDTH - 1) + *(rawpt - WIDTH + 1) + *(rawpt + WIDTH - 1) + *(rawpt + WIDTH + 1)) /
-                        4;                                                                               /* R */
-                    *scanpt++ = (*(rawpt - 1) + *(rawpt + 1) + *(rawpt + WIDTH) + *(rawpt - WIDTH)) / 4; /* G */
-                    *scanpt++ = *rawpt;                                                                  /* B */
-                }
-                else
-                {
-                    /* first line or left column */
-                    *scanpt++ = *(rawpt + WIDTH + 1);                  /* R */
-                    *scanpt++ = (*(rawpt + 1) + *(rawpt + WIDTH)) / 2; /* G */
-                    *scanpt++ = *rawpt;                                /* B */
-                }
+                *scanpt++ =
+                    (*(rawpt - WIDTH - 1) + *(rawpt - WIDTH + 1) + *(rawpt + WIDTH - 1) + *(rawpt + WIDTH + 1)) /
+                    4;                                                                               /* R */
+                *scanpt++ = (*(rawpt - 1) + *(rawpt + 1) + *(rawpt + WIDTH) + *(rawpt - WIDTH)) / 4; /* G */
+                *scanpt++ = *rawpt;                                                                  /* B */
             }
             else
             {
-                /* (B)G */
-                if ((i > WIDTH) && ((i % WIDTH) < (WIDTH - 1)))
-                {
-                    *scanpt++ = (*(rawpt + WIDTH) + *(rawpt - WIDTH)) / 2; /* R */
-                    *scanpt++ = *rawpt;                                    /* G */
-                    *scanpt++ = (*(rawpt - 1) + *(rawpt + 1)) / 2;         /* B */
-                }
-                else
-                {
-                    /* first line or right column */
-                    *scanpt++ = *(rawpt + WIDTH); /* R */
-                    *scanpt++ = *rawpt;           /* G */
-                    *scanpt++ = *(rawpt - 1);     /* B */
-                }
+                /* first line or left column */
+                *scanpt++ = *(rawpt + WIDTH + 1);                  /* R */
+                *scanpt++ = (*(rawpt + 1) + *(rawpt + WIDTH)) / 2; /* G */
+                *scanpt++ = *rawpt;                                /* B */
             }
         }
         else
         {
-            if ((i % 2) == 0)
+            /* (B)G */
+            if ((i > WIDTH) && ((i % WIDTH) < (WIDTH - 1)))
             {
-                /* G(R) */
-                if ((i < (WIDTH * (HEIGHT - 1))) && ((i % WIDTH) > 0))
-                {
-                    *scanpt++ = (*(rawpt - 1) + *(rawpt + 1)) / 2;         /* R */
-                    *scanpt++ = *rawpt;                                    /* G */
-                    *scanpt++ = (*(rawpt + WIDTH) + *(rawpt - WIDTH)) / 2; /* B */
-                }
-                else
-                {
-                    /* bottom line or left column */
-                    *scanpt++ = *(rawpt + 1);     /* R */
-                    *scanpt++ = *rawpt;           /* G */
-                    *scanpt++ = *(rawpt - WIDTH); /* B */
-                }
+                *scanpt++ = (*(rawpt + WIDTH) + *(rawpt - WIDTH)) / 2; /* R */
+                *scanpt++ = *rawpt;                                    /* G */
+                *scanpt++ = (*(rawpt - 1) + *(rawpt + 1)) / 2;         /* B */
             }
             else
             {
-                /* R */
-                if (i < (WIDTH * (HEIGHT - 1)) && ((i % WIDTH) < (WIDTH - 1)))
-                {
-                    *scanpt++ = *rawpt;                                                                  /* R */
-                    *scanpt++ = (*(rawpt - 1) + *(rawpt + 1) + *(rawpt - WIDTH) + *(rawpt + WIDTH)) / 4; /* G */
-                    *scanpt++ =
-                        (*(rawpt - WIDTH - 1) + *(rawpt - WIDTH + 1) + *(rawpt + WIDTH - 1) + *(rawpt + WIDTH + 1)) /
-                        4; /* B */
-                }
-                else
-                {
-                    /* bottom line or right column */
-                    *scanpt++ = *rawpt;                                /* R */
-                    *scanpt++ = (*(rawpt - 1) + *(rawpt - WIDTH)) / 2; /* G */
-                    *scanpt++ = *(rawpt - WIDTH - 1);                  /* B */
-                }
+                /* first line or right column */
+                *scanpt++ = *(rawpt + WIDTH); /* R */
+                *scanpt++ = *rawpt;           /* G */
+                *scanpt++ = *(rawpt - 1);     /* B */
+            }
+        }
+    }
+    else
+    {
+        if ((i % 2) == 0)
+        {
+            /* G(R) */
+            if ((i < (WIDTH * (HEIGHT - 1))) && ((i % WIDTH) > 0))
+            {
+                *scanpt++ = (*(rawpt - 1) + *(rawpt + 1)) / 2;         /* R */
+                *scanpt++ = *rawpt;                                    /* G */
+                *scanpt++ = (*(rawpt + WIDTH) + *(rawpt - WIDTH)) / 2; /* B */
+            }
+            else
+            {
+                /* bottom line or left column */
+                *scanpt++ = *(rawpt + 1);     /* R */
+                *scanpt++ = *rawpt;           /* G */
+                *scanpt++ = *(rawpt - WIDTH); /* B */
+            }
+        }
+        else
+        {
+            /* R */
+            if (i < (WIDTH * (HEIGHT - 1)) && ((i % WIDTH) < (WIDTH - 1)))
+            {
+                *scanpt++ = *rawpt;                                                                  /* R */
+                *scanpt++ = (*(rawpt - 1) + *(rawpt + 1) + *(rawpt - WIDTH) + *(rawpt + WIDTH)) / 4; /* G */
+                *scanpt++ =
+                    (*(rawpt - WIDTH - 1) + *(rawpt - WIDTH + 1) + *(rawpt + WIDTH - 1) + *(rawpt + WIDTH + 1)) /
+                    4; /* B */
+            }
+            else
+            {
+                /* bottom line or right column */
+                *scanpt++ = *rawpt;                                /* R */
+                *scanpt++ = (*(rawpt - 1) + *(rawpt - WIDTH)) / 2; /* G */
+                *scanpt++ = *(rawpt - WIDTH - 1);                  /* B */
             }
         }
-        rawpt++;
     }
 }
 
-void bayer_rggb_2rgb24(unsigned char *dst, unsigned char *src, long int WIDTH, long int HEIGHT)
+/* One pixel of bayer_rggb_2rgb24() */
+static void bayer_rggb8_pixel(unsigned char *dst, const unsigned char *src, long int i, long int WIDTH, long int HEIGHT)
 {
-    long int i;
-    unsigned char *rawpt, *scanpt;
-    long int size;
-
-    rawpt  = src;
-    scanpt = dst;
-    size   = WIDTH * HEIGHT;
+    const unsigned char *rawpt = src + i;
+    unsigned char *scanpt      = dst + 3 * i;
 
-    for (i = 0; i < size; i++)
+    if ((i / WIDTH) % 2 == 0) //wenn zeile grade
     {
-        if ((i / WIDTH) % 2 == 0) //wenn zeile grade
+        if ((i % 2) == 0) //spalte gerade
         {
-            if ((i % 2) == 0) //spalte gerade
+            /* B */
+            if ((i > WIDTH) && ((i % WIDTH) > 0)) // wenn nicht erste zeile oder linke spalte
             {
-                /* B */
-                if ((i > WIDTH) && ((i % WIDTH) > 0)) // wenn nicht erste zeile oder linke spalte
-                {
-                    *scanpt++ = *rawpt;                                                                  /* R */
-                    *scanpt++ = (*(rawpt - 1) + *(rawpt + 1) + *(rawpt + WIDTH) + *(rawpt - WIDTH)) / 4; /* G */
-                    *scanpt++ =
-                        (*(rawpt - WIDTH - 1) + *(rawpt - WIDTH + 1) + *(rawpt + WIDTH - 1) + *(rawpt + WIDTH + 1)) /
-                        4; /* B */
-                }
-                else
-                {
-                    /* first line or left column */
-                    *scanpt++ = *rawpt;                                /* R */
-                    *scanpt++ = (*(rawpt + 1) + *(rawpt + WIDTH)) / 2; /* G */
-                    *scanpt++ = *(rawpt + WIDTH + 1);                  /* B */
-                }
+                *scanpt++ = *rawpt;                                                                  /* R */
+                *scanpt++ = (*(rawpt - 1) + *(rawpt + 1) + *(rawpt + WIDTH) + *(rawpt - WIDTH)) / 4; /* G */
+                *scanpt++ =
+                    (*(rawpt - WIDTH - 1) + *(rawpt - WIDTH + 1) + *(rawpt + WIDTH - 1) + *(rawpt + WIDTH + 1)) /
+                    4; /* B */
             }
             else
             {
-                /* (B)G */
-                if ((i > WIDTH) && ((i % WIDTH) < (WIDTH - 1)))
-                {
-                    *scanpt++ = (*(rawpt - 1) + *(rawpt + 1)) / 2;         /* R */
-                    *scanpt++ = *rawpt;                                    /* G */
-                    *scanpt++ = (*(rawpt + WIDTH) + *(rawpt - WIDTH)) / 2; /* B */
-                }
-                else
-                {
-                    /* first line or right column */
-                    *scanpt++ = *(rawpt - 1);     /* R */
-                    *scanpt++ = *rawpt;           /* G */
-                    *scanpt++ = *(rawpt + WIDTH); /* B */
-                }
+                /* first line or left column */
+                *scanpt++ = *rawpt;                                /* R */
+                *scanpt++ = (*(rawpt + 1) + *(rawpt + WIDTH)) / 2; /* G */
+                *scanpt++ = *(rawpt + WIDTH + 1);                  /* B */
             }
         }
         else
         {
-            if ((i % 2) == 0)
+            /* (B)G */
+            if ((i > WIDTH) && ((i % WIDTH) < (WIDTH - 1)))
             {
-                /* G(R) */
-                if ((i < (WIDTH * (HEIGHT - 1))) && ((i % WIDTH) > 0))
-                {
-                    *scanpt++ = (*(rawpt + WIDTH) + *(rawpt - WIDTH)) / 2; /* R */
-                    *scanpt++ = *rawpt;                                    /* G */
-                    *scanpt++ = (*(rawpt - 1) + *(rawpt + 1)) / 2;         /* B */
-                }
-                else
-                {
-                    /* bottom line or left column */
-                    *scanpt++ = *(rawpt - WIDTH); /* R */
-                    *scanpt++ = *rawpt;           /* G */
-                    *scanpt++ = *(rawpt + 1);     /* B */
-                }
+                *scanpt++ = (*(rawpt - 1) + *(rawpt + 1)) / 2;         /* R */
+                *scanpt++ = *rawpt;                                    /* G */
+                *scanpt++ = (*(rawpt + WIDTH) + *(rawpt - WIDTH)) / 2; /* B */
             }
             else
             {
-                /* R */
-                if (i < (WIDTH * (HEIGHT - 1)) && ((i % WIDTH) < (WIDTH - 1)))
-                {
-                    *scanpt++ =
-                        (*(rawpt - WIDTH - 1) + *(rawpt - WIDTH + 1) + *(rawpt + WIDTH - 1) + *(rawpt + WIDTH + 1)) /
-                        4;                                                                               /* R */
-                    *scanpt++ = (*(rawpt - 1) + *(rawpt + 1) + *(rawpt - WIDTH) + *(rawpt + WIDTH)) / 4; /* G */
-                    *scanpt++ = *rawpt;                                                                  /* B */
-                }
-                else
-                {
-                    /* bottom line or right column */
-                    *scanpt++ = *(rawpt - WIDTH - 1);                  /* R */
-                    *scanpt++ = (*(rawpt - 1) + *(rawpt - WIDTH)) / 2; /* G */
-                    *scanpt++ = *rawpt;                                /* B */
-                }
+                /* first line or right column */
+                *scanpt++ = *(rawpt - 1);     /* R */
+                *scanpt++ = *rawpt;           /* G */
+                *scanpt++ = *(rawpt + WIDTH); /* B */
+            }
+        }
+    }
+    else
+    {
+        if ((i % 2) == 0)
+        {
+            /* G(R) */
+            if ((i < (WIDTH * (HEIGHT - 1))) && ((i % WIDTH) > 0))
+            {
+                *scanpt++ = (*(rawpt + WIDTH) + *(rawpt - WIDTH)) / 2; /* R */
+                *scanpt++ = *rawpt;                                    /* G */
+                *scanpt++ = (*(rawpt - 1) + *(rawpt + 1)) / 2;         /* B */
+            }
+            else
+            {
+                /* bottom line or left column */
+                *scanpt++ = *(rawpt - WIDTH); /* R */
+                *scanpt++ = *rawpt;           /* G */
+                *scanpt++ = *(rawpt + 1);     /* B */
+            }
+        }
+        else
+        {
+            /* R */
+            if (i < (WIDTH * (HEIGHT - 1)) && ((i % WIDTH) < (WIDTH - 1)))
+            {
+                *scanpt++ =
+                    (*(rawpt - WIDTH - 1) + *(rawpt - WIDTH + 1) + *(rawpt + WIDTH - 1) + *(rawpt + WIDTH + 1)) /
+                    4;                                                                               /* R */
+                *scanpt++ = (*(rawpt - 1) + *(rawpt + 1) + *(rawpt - WIDTH) + *(rawpt + WIDTH)) / 4; /* G */
+                *scanpt++ = *rawpt;                                                                  /* B */
+            }
+            else
+            {
+                /* bottom line or right column */
+                *scanpt++ = *(rawpt - WIDTH - 1);                  /* R */
+                *scanpt++ = (*(rawpt - 1) + *(rawpt - WIDTH)) / 2; /* G */
+                *scanpt++ = *rawpt;                                /* B */
             }
         }
-        rawpt++;
     }
 }
 
-void bayer_grbg_to_rgb24(unsigned char *dst, unsigned char *src, long int WIDTH, long int HEIGHT)
+/* One pixel of bayer_grbg_to_rgb24() */
+static void bayer_grbg8_pixel(unsigned char *dst, const unsigned char *src, long int i, long int WIDTH, long int HEIGHT)
 {
 	//Format is
 	// GRGRGRGRGR row width = width,  
@@ -554,172 +447,399 @@ void bayer_grbg_to_rgb24(unsigned char *dst, unsigned char *src, long int WIDTH,
 	// RGBRGBRGBRGBRGB row width = 3x width
 	// RGBRGBRGBRGBRGB each pixel = 3 bytes
 	
-	long int i;
-	long int row;
-	long int col;
+	long int row = i / WIDTH;
+	long int col = i % WIDTH;
 	long int width=WIDTH;
 	int RED = 0;
 	int GREEN = 1;
 	int BLUE = 2;
-	for (row = 0; row < HEIGHT; row++) {
-		for (col = 0; col < WIDTH; col++) {
-			i=(row*WIDTH+col)*3;  //Output is in 3 bytes RGB, so convert a single pixel (3 bytes) each time. (USE RED, GREEN, BLUE as offsets 0, 1, 2 respectively) 
-			//General case:
-			if(row % 2 == 0) { //GRGRGR Row
-				if(col % 2 == 0) {//Over Green
-					//TODO: Double check 1st/last row
-					if (col != 0 && col != WIDTH -1) { // NORMAL
-					dst[(row*width+col)*3+RED]=(src[row*width+col+1]+src[row*width+col-1])/2; // Reds are to L/R
-					} else { //EDGE
-						if (col == 0) { dst[(row*width+col)*3+RED]=src[row*width+col+1];}
-						if (col == WIDTH -1 ) { dst[(row*width+col)*3+RED]=src[row*width+col-1]; }
-					}
-					dst[(row*width+col)*3+GREEN]=src[row*width+col];
-					if (row !=0 && row !=HEIGHT-1) { // NORMAL
-					dst[(row*width+col)*3+BLUE]=(src[(row+1)*width+col]+src[(row-1)*width+col])/2; //Blues are above and below.
-					} else { // EDGE
-						if (row == 0) {dst[(row*width+col)*3+BLUE]=src[(row+1)*width+col];}
-						if (row == WIDTH -1) {dst[(row*width+col)*3+BLUE]=src[(row-1)*width+col];}
-					}
-				} else { // Over RED
-					dst[(row*width+col)*3+RED]=src[row*width+col]; 
-					if (col != WIDTH -1 && row !=0 ) { // NORMAL (Left side and bottom count as normal
+
+	//General case:
+	if(row % 2 == 0) { //GRGRGR Row
+		if(col % 2 == 0) {//Over Green
+			//TODO: Double check 1st/last row
+			if (col != 0 && col != WIDTH -1) { // NORMAL
+			dst[(row*width+col)*3+RED]=(src[row*width+col+1]+src[row*width+col-1])/2; // Reds are to L/R
+			} else { //EDGE
+				if (col == 0) { dst[(row*width+col)*3+RED]=src[row*width+col+1];}
+				if (col == WIDTH -1 ) { dst[(row*width+col)*3+RED]=src[row*width+col-1]; }
+			}
+			dst[(row*width+col)*3+GREEN]=src[row*width+col];
+			if (row !=0 && row !=HEIGHT-1) { // NORMAL
+			dst[(row*width+col)*3+BLUE]=(src[(row+1)*width+col]+src[(row-1)*width+col])/2; //Blues are above and below.
+			} else { // EDGE
+				if (row == 0) {dst[(row*width+col)*3+BLUE]=src[(row+1)*width+col];}
+				if (row == WIDTH -1) {dst[(row*width+col)*3+BLUE]=src[(row-1)*width+col];}
+			}
+		} else { // Over RED
+			dst[(row*width+col)*3+RED]=src[row*width+col]; 
+			if (col != WIDTH -1 && row !=0 ) { // NORMAL (Left side and bottom count as normal
+			dst[(row*width+col)*3+GREEN]=(src[(row+1)*width+col]+src[(row-1)*width+col]+src[(row+0)*width+col+1]+src[(row+0)*width+col-1])/4; //GREENS are in all 4 directions
+			dst[(row*width+col)*3+BLUE]=(src[(row+1)*width+col+1]+src[(row-1)*width+col+1]+src[(row+1)*width+col-1]+src[(row-1)*width+col-1])/4; //Blues are caddy corner and below.
+			} else { // EDGE
+				if (col != WIDTH -1 && row == 0) {
+					//Corner && Side: 
+					//     
+					//,G*G.
+					//,BGB.
+					//,....
+					dst[(row*width+col)*3+GREEN]=(src[(row+1)*width+col]+src[(row)*width+col+1]+src[(row)*width+col+1])/3;
+					dst[(row*width+col)*3+BLUE]=(src[(row+1)*width+col+1]+src[(row+1)*width+col-1])/2;
+				} 
+
+				if (col == WIDTH -1 && row !=0 ) {
+					//Side
+					//...
+					//.BG
+					//.GR
+					//.BG
+					//...
+					dst[(row*width+col)*3+GREEN]=(src[(row+1)*width+col]+src[(row-1)*width+col]+src[(row)*width+col-1])/3;
+					dst[(row*width+col)*3+BLUE]=(src[(row+1)*width+col-1]+src[(row-1)*width+col-1])/2;
+					
+				}
+				if (col == WIDTH -1 && row ==0) {
+					//Corner (col=max, row=0)
+					//
+					//.G*
+					//.BG
+					//...
+					dst[(row*width+col)*3+GREEN]=(src[(row-1)*width+col]+src[(row+0)*width+col-1]+src[(row+1)*width+col])/3;
+					dst[(row*width+col)*3+BLUE]=src[(row+1)*width+col-1];
+				}
+				if (col == 1 && row !=0) { //Unnecessary Left here to explain why 
+					//Side && Corner (col=1, row=max)
+					// .....
+					// BGBG..
+					// G*GR
+					// BGBG..
+					// ,,,,,, 
+					// NORMAL
+					dst[(row*width+col)*3+GREEN]=(src[(row+1)*width+col]+src[(row-1)*width+col]+src[(row+0)*width+col+1]+src[(row+0)*width+col-1])/4; //GREENS are in all 4 directions
+					dst[(row*width+col)*3+BLUE]=(src[(row+1)*width+col+1]+src[(row-1)*width+col+1]+src[(row+1)*width+col-1]+src[(row-1)*width+col-1])/4; //Blues are caddy corner and below.
+				}
+				if (row == HEIGHT -1) {//Unnecessary Left here to explain why 
+					//Bottom row (would actually be HEIGHT -2 it still looks like a normal pixel for us
+					// ,.....
+					// ,.BGBG..
+					// ,.G*RG..
+					// ,.BGBG..
+					//        
+					// NORMAL
 					dst[(row*width+col)*3+GREEN]=(src[(row+1)*width+col]+src[(row-1)*width+col]+src[(row+0)*width+col+1]+src[(row+0)*width+col-1])/4; //GREENS are in all 4 directions
 					dst[(row*width+col)*3+BLUE]=(src[(row+1)*width+col+1]+src[(row-1)*width+col+1]+src[(row+1)*width+col-1]+src[(row-1)*width+col-1])/4; //Blues are caddy corner and below.
-					} else { // EDGE
-						if (col != WIDTH -1 && row == 0) {
-							//Corner && Side: 
-							//     
-							//,G*G.
-							//,BGB.
-							//,....
-							dst[(row*width+col)*3+GREEN]=(src[(row+1)*width+col]+src[(row)*width+col+1]+src[(row)*width+col+1])/3;
-							dst[(row*width+col)*3+BLUE]=(src[(row+1)*width+col+1]+src[(row+1)*width+col-1])/2;
-						} 
-
-						if (col == WIDTH -1 && row !=0 ) {
-							//Side
-							//...
-							//.BG
-							//.GR
-							//.BG
-							//...
-							dst[(row*width+col)*3+GREEN]=(src[(row+1)*width+col]+src[(row-1)*width+col]+src[(row)*width+col-1])/3;
-							dst[(row*width+col)*3+BLUE]=(src[(row+1)*width+col-1]+src[(row-1)*width+col-1])/2;
-							
-						}
-						if (col == WIDTH -1 && row ==0) {
-							//Corner (col=max, row=0)
-							//
-							//.G*
-							//.BG
-							//...
-							dst[(row*width+col)*3+GREEN]=(src[(row-1)*width+col]+src[(row+0)*width+col-1]+src[(row+1)*width+col])/3;
-							dst[(row*width+col)*3+BLUE]=src[(row+1)*width+col-1];
-						}
-						if (col == 1 && row !=0) { //Unnecessary Left here to explain why 
-							//Side && Corner (col=1, row=max)
-							// .....
-							// BGBG..
-							// G*GR
-							// BGBG..
-							// ,,,,,, 
-							// NORMAL
-							dst[(row*width+col)*3+GREEN]=(src[(row+1)*width+col]+src[(row-1)*width+col]+src[(row+0)*width+col+1]+src[(row+0)*width+col-1])/4; //GREENS are in all 4 directions
-							dst[(row*width+col)*3+BLUE]=(src[(row+1)*width+col+1]+src[(row-1)*width+col+1]+src[(row+1)*width+col-1]+src[(row-1)*width+col-1])/4; //Blues are caddy corner and below.
-						}
-						if (row == HEIGHT -1) {//Unnecessary Left here to explain why 
-							//Bottom row (would actually be HEIGHT -2 it still looks like a normal pixel for us
-							// ,.....
-							// ,.BGBG..
-							// ,.G*RG..
-							// ,.BGBG..
-							//        
-							// NORMAL
-							dst[(row*width+col)*3+GREEN]=(src[(row+1)*width+col]+src[(row-1)*width+col]+src[(row+0)*width+col+1]+src[(row+0)*width+col-1])/4; //GREENS are in all 4 directions
-							dst[(row*width+col)*3+BLUE]=(src[(row+1)*width+col+1]+src[(row-1)*width+col+1]+src[(row+1)*width+col-1]+src[(row-1)*width+col-1])/4; //Blues are caddy corner and below.
-							
-						}
-					}
+					
+				}
+			}
+		}
+	} else { //BRBRBR Row
+		//if (col != 0 && col != WIDTH -1 && row != 0 && row != HEIGHT-1) {
+		if (col % 2 == 0) {//Over Blue
+			dst[(row*width+col)*3+BLUE]=src[row*width+col];
+			if ( col != 0 && row != HEIGHT -1) { //Normal 
+				// Enough clearance to use this:
+				// RGR
+				// G*G
+				// RGR
+				dst[(row*width+col)*3+RED]=(src[(row+1)*width+col+1]+src[(row-1)*width+col+1]+src[(row+1)*width+col-1]+src[(row-1)*width+col-1])/4;//Reds are caddy corner and below.
+				dst[(row*width+col)*3+GREEN]=(src[(row+1)*width+col]+src[(row-1)*width+col]+src[(row+0)*width+col+1]+src[(row+0)*width+col-1])/4; //GREENS are in all 4 directions
+			} else { // EDGE CASES over blue
+				if (col == 0 && row != HEIGHT -1) {
+					//  ,,,,,,,
+					//  GRGRGR.
+					//  *GBGBG.
+					//  GRGRGR.
+					//  .......
+					dst[(row*width+col)*3+RED]=(src[(row+1)*width+col+1]+src[(row-1)*width+col+1])/2;
+					dst[(row*width+col)*3+GREEN]=(src[(row+1)*width+col]+src[(row+0)*width+col+1]+src[(row+0)*width+col-1])/3;
+				}
+				if (row == HEIGHT -1 && col !=0) {
+					//  ........
+					//  .GRGRGR.
+					//  .BG*GBG.
+					dst[(row*width+col)*3+RED]=(src[(row-1)*width+col+1]+src[(row-1)*width+col-1])/2;
+					dst[(row*width+col)*3+GREEN]=(src[(row+1)*width+col]+src[(row-1)*width+col]+src[(row+0)*width+col+1]+src[(row+0)*width+col-1])/3;
+				}
+				if (row == HEIGHT -1 && col ==0) {
+					//  .....
+					//  GRGR.
+					//  *GBG.
+					dst[(row*width+col)*3+RED]=(src[(row-1)*width+col+1]+src[(row-1)*width+col-1])/2;
+					dst[(row*width+col)*3+GREEN]=(src[(row+1)*width+col]+src[(row-1)*width+col]+src[(row+0)*width+col+1]+src[(row+0)*width+col-1])/3;
+				}
+				
+			}
+		} else { // Over Green
+			dst[(row*width+col)*3+GREEN]=src[row*width+col]; // Over Green Pixel
+			if (col != WIDTH -1 && row != HEIGHT -1) { //NORMAL 
+				// Enough clearance to use this:
+				// GRG
+				// B*B
+				// GRG
+				
+				dst[(row*width+col)*3+RED]=(src[(row+1)*width+col]+src[(row-1)*width+col])/2; // Reds are above/below
+				dst[(row*width+col)*3+BLUE]=(src[row*width+col+1]+src[row*width+col-1])/2; //Blues are left/right
+			} else {
+				if (col == WIDTH -1 && row != HEIGHT -1) {
+					// ,,,,,
+					// .GRGR
+					// .BGB*
+					// .GRGR
+					// .....
+					dst[(row*width+col)*3+RED]=(src[(row+1)*width+col]+src[(row-1)*width+col])/2; // Reds are above/below
+					dst[(row*width+col)*3+BLUE]=src[row*width+col-1]; //Blue is left
+				}
+				if (row == HEIGHT -1 && col != WIDTH -1) {
+					// .....
+					// .GRGR
+					// .B*BG
+					dst[(row*width+col)*3+RED]=src[(row-1)*width+col]; // Red is above
+					dst[(row*width+col)*3+BLUE]=(src[row*width+col+1]+src[row*width+col-1])/2; //Blues are left/right
 				}
-			} else { //BRBRBR Row
-				//if (col != 0 && col != WIDTH -1 && row != 0 && row != HEIGHT-1) {
-				if (col % 2 == 0) {//Over Blue
-					dst[(row*width+col)*3+BLUE]=src[row*width+col];
-					if ( col != 0 && row != HEIGHT -1) { //Normal 
-						// Enough clearance to use this:
-						// RGR
-						// G*G
-						// RGR
-						dst[(row*width+col)*3+RED]=(src[(row+1)*width+col+1]+src[(row-1)*width+col+1]+src[(row+1)*width+col-1]+src[(row-1)*width+col-1])/4;//Reds are caddy corner and below.
-						dst[(row*width+col)*3+GREEN]=(src[(row+1)*width+col]+src[(row-1)*width+col]+src[(row+0)*width+col+1]+src[(row+0)*width+col-1])/4; //GREENS are in all 4 directions
-					} else { // EDGE CASES over blue
-						if (col == 0 && row != HEIGHT -1) {
-							//  ,,,,,,,
-							//  GRGRGR.
-							//  *GBGBG.
-							//  GRGRGR.
-							//  .......
-							dst[(row*width+col)*3+RED]=(src[(row+1)*width+col+1]+src[(row-1)*width+col+1])/2;
-							dst[(row*width+col)*3+GREEN]=(src[(row+1)*width+col]+src[(row+0)*width+col+1]+src[(row+0)*width+col-1])/3;
-						}
-						if (row == HEIGHT -1 && col !=0) {
-							//  ........
-							//  .GRGRGR.
-							//  .BG*GBG.
-							dst[(row*width+col)*3+RED]=(src[(row-1)*width+col+1]+src[(row-1)*width+col-1])/2;
-							dst[(row*width+col)*3+GREEN]=(src[(row+1)*width+col]+src[(row-1)*width+col]+src[(row+0)*width+col+1]+src[(row+0)*width+col-1])/3;
-						}
-						if (row == HEIGHT -1 && col ==0) {
-							//  .....
-							//  GRGR.
-							//  *GBG.
-							dst[(row*width+col)*3+RED]=(src[(row-1)*width+col+1]+src[(row-1)*width+col-1])/2;
-							dst[(row*width+col)*3+GREEN]=(src[(row+1)*width+col]+src[(row-1)*width+col]+src[(row+0)*width+col+1]+src[(row+0)*width+col-1])/3;
-						}
-						
-					}
-				} else { // Over Green
-					dst[(row*width+col)*3+GREEN]=src[row*width+col]; // Over Green Pixel
-					if (col != WIDTH -1 && row != HEIGHT -1) { //NORMAL 
-						// Enough clearance to use this:
-						// GRG
-						// B*B
-						// GRG
-						
-						dst[(row*width+col)*3+RED]=(src[(row+1)*width+col]+src[(row-1)*width+col])/2; // Reds are above/below
-						dst[(row*width+col)*3+BLUE]=(src[row*width+col+1]+src[row*width+col-1])/2; //Blues are left/right
-					} else {
-						if (col == WIDTH -1 && row != HEIGHT -1) {
-							// ,,,,,
-							// .GRGR
-							// .BGB*
-							// .GRGR
-							// .....
-							dst[(row*width+col)*3+RED]=(src[(row+1)*width+col]+src[(row-1)*width+col])/2; // Reds are above/below
-							dst[(row*width+col)*3+BLUE]=src[row*width+col-1]; //Blue is left
-						}
-						if (row == HEIGHT -1 && col != WIDTH -1) {
-							// .....
-							// .GRGR
-							// .B*BG
-							dst[(row*width+col)*3+RED]=src[(row-1)*width+col]; // Red is above
-							dst[(row*width+col)*3+BLUE]=(src[row*width+col+1]+src[row*width+col-1])/2; //Blues are left/right
-						}
-						if (row == HEIGHT -1 && col == WIDTH -1) {
-							// ...
-							// .GR
-							// .B*
-							dst[(row*width+col)*3+RED]=src[(row-1)*width+col]; // Red is above
-							dst[(row*width+col)*3+BLUE]=src[row*width+col-1]; //Blue is left
-						}
-					}
+				if (row == HEIGHT -1 && col == WIDTH -1) {
+					// ...
+					// .GR
+					// .B*
+					dst[(row*width+col)*3+RED]=src[(row-1)*width+col]; // Red is above
+					dst[(row*width+col)*3+BLUE]=src[row*width+col-1]; //Blue is left
 				}
 			}
 		}
 	}
 }
 
+struct bayer8_job
+{
+    unsigned char *dst;
+    const unsigned char *src;
+    long int width;
+    long int height;
+    ccvt_bayer_pattern pattern;
+    ccvt_demosaic_method method;
+    bayer8_pixel_fn pixel;
+};
+
+static void bayer8_rows(void *context, int first, int last)
+{
+    const struct bayer8_job *job = context;
+    long int W                   = job->width;
+    long int H                   = job->height;
+    long int l, c;
+
+    for (l = first; l < last; l++)
+    {
+        long int i = l * W;
+
+        if (l == 0 || l == H - 1)
+        {
+            for (c = 0; c < W; c++)
+                job->pixel(job->dst, job->src, i + c, W, H);
+            continue;
+        }
+
+        job->pixel(job->dst, job->src, i, W, H);
+        ccvt_simd_bayer8_row(job->src + i + 1 - W, job->src + i + 1, job->src + i + 1 + W, job->dst + 3 * (i + 1),
+                             (W - 2) / 2, ccvt_bayer_row_kind(job->pattern, l), job->method);
+        job->pixel(job->dst, job->src, i + W - 1, W, H);
+    }
+}
+
+static void bayer8_convert(unsigned char *dst, const unsigned char *src, long int WIDTH, long int HEIGHT,
+                           ccvt_bayer_pattern pattern, bayer8_pixel_fn pixel)
+{
+    struct bayer8_job job = { dst, src, WIDTH, HEIGHT, pattern, CCVT_DEMOSAIC_BILINEAR, pixel };
+    long int i;
+
+    /* The pattern of the per pixel code follows the pixel index, not the column, on odd widths */
+    if ((WIDTH & 1) || (HEIGHT & 1) || WIDTH < 4 || HEIGHT < 4)
+    {
+        for (i = 0; i < WIDTH * HEIGHT; i++)
+            pixel(dst, src, i, WIDTH, HEIGHT);
+        return;
+    }
+
+    ccvt_parallel_rows(HEIGHT, WIDTH * HEIGHT, bayer8_rows, &job);
+}
+
+void bayer2rgb24(unsigned char *dst, unsigned char *src, long int WIDTH, long int HEIGHT)
+{
+    bayer8_convert(dst, src, WIDTH, HEIGHT, CCVT_BAYER_BGGR, bayer_bggr8_pixel);
+}
+
+void bayer_rggb_2rgb24(unsigned char *dst, unsigned char *src, long int WIDTH, long int HEIGHT)
+{
+    bayer8_convert(dst, src, WIDTH, HEIGHT, CCVT_BAYER_RGGB, bayer_rggb8_pixel);
+}
+
+void bayer_grbg_to_rgb24(unsigned char *dst, unsigned char *src, long int WIDTH, long int HEIGHT)
+{
+    bayer8_convert(dst, src, WIDTH, HEIGHT, CCVT_BAYER_GRBG, bayer_grbg8_pixel);
+}
+
+struct bayer16_job
+{
+    unsigned short *dst;
+    const unsigned short *src;
+    long int width;
+    long int height;
+};
+
+static void bayer16_rows(void *context, int first, int last)
+{
+    const struct bayer16_job *job = context;
+    long int W                    = job->width;
+    long int H                    = job->height;
+    long int l, c;
+
+    for (l = first; l < last; l++)
+    {
+        long int i = l * W;
+
+        if (l == 0 || l == H - 1)
+        {
+            for (c = 0; c < W; c++)
+                bayer_bggr16_pixel(job->dst, job->src, i + c, W, H);
+            continue;
+        }
+
+        bayer_bggr16_pixel(job->dst, job->src, i, W, H);
+        ccvt_simd_bayer16_row(job->src + i + 1 - W, job->src + i + 1, job->src + i + 1 + W, job->dst + 3 * (i + 1),
+                              (W - 2) / 2, ccvt_bayer_row_kind(CCVT_BAYER_BGGR, l));
+        bayer_bggr16_pixel(job->dst, job->src, i + W - 1, W, H);
+    }
+}
+
+void bayer16_2_rgb24(unsigned short *dst, unsigned short *src, long int WIDTH, long int HEIGHT)
+{
+    struct bayer16_job job = { dst, src, WIDTH, HEIGHT };
+    long int i;
+
+    if ((WIDTH & 1) || (HEIGHT & 1) || WIDTH < 4 || HEIGHT < 4)
+    {
+        for (i = 0; i < WIDTH * HEIGHT; i++)
+            bayer_bggr16_pixel(dst, src, i, WIDTH, HEIGHT);
+        return;
+    }
+
+    ccvt_parallel_rows(HEIGHT, WIDTH * HEIGHT, bayer16_rows, &job);
+}
+
+/* Colour filter sites of ccvt_bayer8_rgb24(): red, blue, green between reds, green between blues */
+enum
+{
+    BAYER_SITE_R,
+    BAYER_SITE_B,
+    BAYER_SITE_GR,
+    BAYER_SITE_GB
+};
+
+/* Site on the even and odd columns of each row kind */
+static const int bayer_sites[4][2] = {
+    { BAYER_SITE_B, BAYER_SITE_GB },  /* CCVT_ROW_BG */
+    { BAYER_SITE_GR, BAYER_SITE_R },  /* CCVT_ROW_GR */
+    { BAYER_SITE_R, BAYER_SITE_GR },  /* CCVT_ROW_RG */
+    { BAYER_SITE_GB, BAYER_SITE_B }   /* CCVT_ROW_GB */
+};
+
+static long int bayer_mirror(long int x, long int n)
+{
+    if (x < 0)
+        return -x;
+    if (x >= n)
+        return 2 * n - 2 - x;
+    return x;
+}
+
+/* One pixel of ccvt_bayer8_rgb24(). Neighbours outside the image are mirrored, which keeps their colour. */
+static void bayer8_mirror_pixel(unsigned char *dst, const unsigned char *src, long int W, long int H, long int row,
+                                long int col, ccvt_bayer_pattern pattern, ccvt_demosaic_method method)
+{
+    const unsigned char *up   = src + bayer_mirror(row - 1, H) * W;
+    const unsigned char *here = src + row * W;
+    const unsigned char *down = src + bayer_mirror(row + 1, H) * W;
+    long int left             = bayer_mirror(col - 1, W);
+    long int right            = bayer_mirror(col + 1, W);
+    unsigned char *out        = dst + 3 * (row * W + col);
+    int center                = here[col];
+    int horz                  = (here[left] + here[right]) >> 1;
+    int vert                  = (up[col] + down[col]) >> 1;
+    int cross                 = (here[left] + here[right] + up[col] + down[col]) >> 2;
+    int diag                  = (up[left] + up[right] + down[left] + down[right]) >> 2;
+
+    if (method == CCVT_DEMOSAIC_EDGE_AWARE)
+    {
+        int dh = abs(here[left] - here[right]);
+        int dv = abs(up[col] - down[col]);
+
+        if (dh < dv)
+            cross = horz;
+        else if (dv < dh)
+            cross = vert;
+    }
+
+    switch (bayer_sites[ccvt_bayer_row_kind(pattern, row)][col & 1])
+    {
+        case BAYER_SITE_R:
+            out[0] = center;
+            out[1] = cross;
+            out[2] = diag;
+            break;
+        case BAYER_SITE_B:
+            out[0] = diag;
+            out[1] = cross;
+            out[2] = center;
+            break;
+        case BAYER_SITE_GR:
+            out[0] = horz;
+            out[1] = center;
+            out[2] = vert;
+            break;
+        case BAYER_SITE_GB:
+            out[0] = vert;
+            out[1] = center;
+            out[2] = horz;
+            break;
+    }
+}
+
+static void bayer8_generic_rows(void *context, int first, int last)
+{
+    const struct bayer8_job *job = context;
+    long int W                   = job->width;
+    long int H                   = job->height;
+    long int pairs               = (W - 2) / 2;
+    long int l, c;
+
+    for (l = first; l < last; l++)
+    {
+        long int i = l * W;
+
+        if (l == 0 || l == H - 1 || W < 3)
+        {
+            for (c = 0; c < W; c++)
+                bayer8_mirror_pixel(job->dst, job->src, W, H, l, c, job->pattern, job->method);
+            continue;
+        }
+
+        bayer8_mirror_pixel(job->dst, job->src, W, H, l, 0, job->pattern, job->method);
+        ccvt_simd_bayer8_row(job->src + i + 1 - W, job->src + i + 1, job->src + i + 1 + W, job->dst + 3 * (i + 1),
+                             pairs, ccvt_bayer_row_kind(job->pattern, l), job->method);
+        for (c = 1 + 2 * pairs; c < W; c++)
+            bayer8_mirror_pixel(job->dst, job->src, W, H, l, c, job->pattern, job->method);
+    }
+}
+
+void ccvt_bayer8_rgb24(int width, int height, const void *src, void *dst, ccvt_bayer_pattern pattern,
+                       ccvt_demosaic_method method)
+{
+    struct bayer8_job job = { dst, src, width, height, pattern, method, NULL };
+
+    if (width < 2 || height < 2)
+        return;
+
+    ccvt_parallel_rows(height, (long)width * height, bayer8_generic_rows, &job);
+}
+
 int mjpegtoyuv420p(unsigned char *map, unsigned char *cap_map, int width, int height, unsigned int size)
 {
     unsigned char *yuv[3];
@@ -0,0 +1,343 @@
+/*  CCVT_SIMD: vectorised, row parallel building blocks of the colour conversions
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/* The kernels rely on the loop vectoriser, which GCC only enables by default from -O3 */
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC optimize("tree-vectorize")
+#endif
+
+#include "ccvt_simd.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* Pixels per kernel call, the planar intermediates of a chunk live on the stack */
+#define CCVT_CHUNK 512
+
+/* Images smaller than this are not worth waking up other threads */
+#define CCVT_PARALLEL_PIXELS (256 * 256)
+
+/* Rows handed to a thread at a time */
+#define CCVT_PARALLEL_ROWS 16
+
+#define CCVT_MAX_THREADS 8
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CCVT_HAVE_AVX2 1
+#endif
+
+static inline uint8_t ccvt_sat(int c)
+{
+    return c < 0 ? 0 : (c > 255 ? 255 : c);
+}
+
+static inline int ccvt_edge_green(int left, int right, int up, int down)
+{
+    int dh = abs(left - right);
+    int dv = abs(up - down);
+
+    return dh < dv ? (left + right) >> 1 : (dv < dh ? (up + down) >> 1 : (left + right + up + down) >> 2);
+}
+
+#define CCVT_TARGET
+#define CCVT_NAME(name) name##_generic
+#include "ccvt_kernels.h"
+#undef CCVT_NAME
+#undef CCVT_TARGET
+
+#ifdef CCVT_HAVE_AVX2
+#define CCVT_TARGET __attribute__((target("avx2")))
+#define CCVT_NAME(name) name##_avx2
+#include "ccvt_kernels.h"
+#undef CCVT_NAME
+#undef CCVT_TARGET
+#endif
+
+/* Kernels of the instruction set picked at run time */
+static struct
+{
+    void (*yuyv_planar)(const uint8_t *, uint8_t *, uint8_t *, uint8_t *, int);
+    void (*i420_planar)(const uint8_t *, const uint8_t *, const uint8_t *, uint8_t *, uint8_t *, uint8_t *, int);
+    void (*interleave3)(const uint8_t *, const uint8_t *, const uint8_t *, uint8_t *, int);
+    void (*interleave4)(const uint8_t *, const uint8_t *, const uint8_t *, uint8_t *, int);
+    void (*interleave3_16)(const uint16_t *, const uint16_t *, const uint16_t *, uint16_t *, int);
+    void (*bayer8_planar)(const uint8_t *, const uint8_t *, const uint8_t *, uint8_t *, uint8_t *, uint8_t *, int,
+                          int, int);
+    void (*bayer16_planar)(const uint16_t *, const uint16_t *, const uint16_t *, uint16_t *, uint16_t *, uint16_t *,
+                           int, int);
+} kernels;
+
+static pthread_once_t kernels_once = PTHREAD_ONCE_INIT;
+
+static void ccvt_select_kernels(void)
+{
+#define CCVT_USE(suffix)                                  \
+    do                                                    \
+    {                                                     \
+        kernels.yuyv_planar    = yuyv_planar_##suffix;    \
+        kernels.i420_planar    = i420_planar_##suffix;    \
+        kernels.interleave3    = interleave3_##suffix;    \
+        kernels.interleave4    = interleave4_##suffix;    \
+        kernels.interleave3_16 = interleave3_16_##suffix; \
+        kernels.bayer8_planar  = bayer8_planar_##suffix;  \
+        kernels.bayer16_planar = bayer16_planar_##suffix; \
+    } while (0)
+
+    CCVT_USE(generic);
+
+#ifdef CCVT_HAVE_AVX2
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        CCVT_USE(avx2);
+#endif
+
+#undef CCVT_USE
+}
+
+static void ccvt_interleave(const uint8_t *r, const uint8_t *g, const uint8_t *b, uint8_t *dst, int n, int format)
+{
+    switch (format)
+    {
+        case CCVT_FMT_RGB24:
+            kernels.interleave3(r, g, b, dst, n);
+            break;
+        case CCVT_FMT_BGR24:
+            kernels.interleave3(b, g, r, dst, n);
+            break;
+        case CCVT_FMT_RGB32:
+            kernels.interleave4(r, g, b, dst, n);
+            break;
+        case CCVT_FMT_BGR32:
+            kernels.interleave4(b, g, r, dst, n);
+            break;
+    }
+}
+
+static int ccvt_format_bytes(int format)
+{
+    return (format == CCVT_FMT_RGB32 || format == CCVT_FMT_BGR32) ? 4 : 3;
+}
+
+int ccvt_bayer_row_kind(ccvt_bayer_pattern pattern, int parity)
+{
+    static const int kinds[4][2] = {
+        { CCVT_ROW_BG, CCVT_ROW_GR }, /* BGGR */
+        { CCVT_ROW_RG, CCVT_ROW_GB }, /* RGGB */
+        { CCVT_ROW_GR, CCVT_ROW_BG }, /* GRBG */
+        { CCVT_ROW_GB, CCVT_ROW_RG }  /* GBRG */
+    };
+
+    return kinds[pattern][parity & 1];
+}
+
+void ccvt_simd_yuyv_row(const uint8_t *src, uint8_t *dst, int pairs, int format)
+{
+    uint8_t r[CCVT_CHUNK], g[CCVT_CHUNK], b[CCVT_CHUNK];
+    int bytes = ccvt_format_bytes(format);
+
+    pthread_once(&kernels_once, ccvt_select_kernels);
+
+    while (pairs > 0)
+    {
+        int n = pairs < CCVT_CHUNK / 2 ? pairs : CCVT_CHUNK / 2;
+
+        kernels.yuyv_planar(src, r, g, b, n);
+        ccvt_interleave(r, g, b, dst, 2 * n, format);
+
+        src += 4 * n;
+        dst += 2 * n * bytes;
+        pairs -= n;
+    }
+}
+
+void ccvt_simd_420p_row(const uint8_t *y, const uint8_t *u, const uint8_t *v, uint8_t *dst, int pairs, int format)
+{
+    uint8_t r[CCVT_CHUNK], g[CCVT_CHUNK], b[CCVT_CHUNK];
+    int bytes = ccvt_format_bytes(format);
+
+    pthread_once(&kernels_once, ccvt_select_kernels);
+
+    while (pairs > 0)
+    {
+        int n = pairs < CCVT_CHUNK / 2 ? pairs : CCVT_CHUNK / 2;
+
+        kernels.i420_planar(y, u, v, r, g, b, n);
+        ccvt_interleave(r, g, b, dst, 2 * n, format);
+
+        y += 2 * n;
+        u += n;
+        v += n;
+        dst += 2 * n * bytes;
+        pairs -= n;
+    }
+}
+
+void ccvt_simd_bayer8_row(const uint8_t *up, const uint8_t *row, const uint8_t *down, uint8_t *dst, int pairs,
+                          int kind, ccvt_demosaic_method method)
+{
+    uint8_t r[CCVT_CHUNK], g[CCVT_CHUNK], b[CCVT_CHUNK];
+
+    pthread_once(&kernels_once, ccvt_select_kernels);
+
+    while (pairs > 0)
+    {
+        int n = pairs < CCVT_CHUNK / 2 ? pairs : CCVT_CHUNK / 2;
+
+        kernels.bayer8_planar(up, row, down, r, g, b, n, kind, method);
+        kernels.interleave3(r, g, b, dst, 2 * n);
+
+        up += 2 * n;
+        row += 2 * n;
+        down += 2 * n;
+        dst += 6 * n;
+        pairs -= n;
+    }
+}
+
+void ccvt_simd_bayer16_row(const uint16_t *up, const uint16_t *row, const uint16_t *down, uint16_t *dst, int pairs,
+                           int kind)
+{
+    uint16_t r[CCVT_CHUNK], g[CCVT_CHUNK], b[CCVT_CHUNK];
+
+    pthread_once(&kernels_once, ccvt_select_kernels);
+
+    while (pairs > 0)
+    {
+        int n = pairs < CCVT_CHUNK / 2 ? pairs : CCVT_CHUNK / 2;
+
+        kernels.bayer16_planar(up, row, down, r, g, b, n, kind);
+        kernels.interleave3_16(r, g, b, dst, 2 * n);
+
+        up += 2 * n;
+        row += 2 * n;
+        down += 2 * n;
+        dst += 6 * n;
+        pairs -= n;
+    }
+}
+
+/* Worker threads of ccvt_parallel_rows(). One conversion runs on them at a time, the rows of a conversion are
+   claimed CCVT_PARALLEL_ROWS at a time by the workers and by the calling thread. */
+static struct
+{
+    pthread_mutex_t busy;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    pthread_cond_t done;
+    int workers;
+    unsigned int generation;
+    ccvt_rows_fn fn;
+    void *context;
+    int rows;
+    int next;
+    int finished;
+} pool = { .busy = PTHREAD_MUTEX_INITIALIZER, .lock = PTHREAD_MUTEX_INITIALIZER, .wake = PTHREAD_COND_INITIALIZER,
+            .done = PTHREAD_COND_INITIALIZER, .workers = 0, .generation = 0, .fn = NULL, .context = NULL, .rows = 0,
+            .next = 0, .finished = 0 };
+
+static pthread_once_t pool_once = PTHREAD_ONCE_INIT;
+
+/* Called and returns with pool.lock held */
+static void ccvt_run_rows(void)
+{
+    while (pool.next < pool.rows)
+    {
+        ccvt_rows_fn fn = pool.fn;
+        void *context   = pool.context;
+        int first       = pool.next;
+        int last        = first + CCVT_PARALLEL_ROWS < pool.rows ? first + CCVT_PARALLEL_ROWS : pool.rows;
+
+        pool.next = last;
+        pthread_mutex_unlock(&pool.lock);
+
+        fn(context, first, last);
+
+        pthread_mutex_lock(&pool.lock);
+        pool.finished += last - first;
+        if (pool.finished == pool.rows)
+            pthread_cond_signal(&pool.done);
+    }
+}
+
+static void *ccvt_worker(void *arg)
+{
+    unsigned int generation = 0;
+
+    (void)arg;
+
+    pthread_mutex_lock(&pool.lock);
+    for (;;)
+    {
+        while (pool.generation == generation)
+            pthread_cond_wait(&pool.wake, &pool.lock);
+        generation = pool.generation;
+        ccvt_run_rows();
+    }
+
+    return NULL;
+}
+
+static void ccvt_start_workers(void)
+{
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int i;
+
+    if (cpus > CCVT_MAX_THREADS)
+        cpus = CCVT_MAX_THREADS;
+
+    for (i = 0; i < cpus - 1; i++)
+    {
+        pthread_t thread;
+
+        if (pthread_create(&thread, NULL, ccvt_worker, NULL) != 0)
+            break;
+        pthread_detach(thread);
+        pool.workers++;
+    }
+}
+
+void ccvt_parallel_rows(int rows, long pixels, ccvt_rows_fn fn, void *context)
+{
+    if (pixels >= CCVT_PARALLEL_PIXELS && rows > CCVT_PARALLEL_ROWS)
+        pthread_once(&pool_once, ccvt_start_workers);
+
+    /* Small images, single CPU machines, or another conversion already using the workers */
+    if (pixels < CCVT_PARALLEL_PIXELS || rows <= CCVT_PARALLEL_ROWS || pool.workers == 0 ||
+            pthread_mutex_trylock(&pool.busy) != 0)
+    {
+        fn(context, 0, rows);
+        return;
+    }
+
+    pthread_mutex_lock(&pool.lock);
+    pool.fn       = fn;
+    pool.context  = context;
+    pool.rows     = rows;
+    pool.next     = 0;
+    pool.finished = 0;
+    pool.generation++;
+    pthread_cond_broadcast(&pool.wake);
+
+    ccvt_run_rows();
+    while (pool.finished < pool.rows)
+        pthread_cond_wait(&pool.done, &pool.lock);
+    pthread_mutex_unlock(&pool.lock);
+
+    pthread_mutex_unlock(&pool.busy);
+}
@@ -0,0 +1,71 @@
+/*  CCVT_SIMD: vectorised, row parallel building blocks of the colour conversions
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#pragma once
+
+#include "ccvt.h"
+
+#include <stdint.h>
+
+/* Internal to libs/stream, not installed */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Packed output formats */
+enum
+{
+    CCVT_FMT_RGB24,
+    CCVT_FMT_BGR24,
+    CCVT_FMT_RGB32,
+    CCVT_FMT_BGR32
+};
+
+/* Bayer rows by the colours on their even and odd columns */
+enum
+{
+    CCVT_ROW_BG,
+    CCVT_ROW_GR,
+    CCVT_ROW_RG,
+    CCVT_ROW_GB
+};
+
+/* Row kind of a pattern, row parity 0 or 1 */
+int ccvt_bayer_row_kind(ccvt_bayer_pattern pattern, int parity);
+
+/* 2 * pairs pixels of a YUYV row to a packed format */
+void ccvt_simd_yuyv_row(const uint8_t *src, uint8_t *dst, int pairs, int format);
+
+/* 2 * pairs pixels of a 4:2:0 planar row to a packed format */
+void ccvt_simd_420p_row(const uint8_t *y, const uint8_t *u, const uint8_t *v, uint8_t *dst, int pairs, int format);
+
+/* Demosaic 2 * pairs pixels of a row to RGB 24 (RGB 48 for 16 bit). The span starts on an odd column, and the
+   pixels left, right, above and below it must be readable. */
+void ccvt_simd_bayer8_row(const uint8_t *up, const uint8_t *row, const uint8_t *down, uint8_t *dst, int pairs,
+                          int kind, ccvt_demosaic_method method);
+void ccvt_simd_bayer16_row(const uint16_t *up, const uint16_t *row, const uint16_t *down, uint16_t *dst, int pairs,
+                           int kind);
+
+/* Calls fn for consecutive row ranges that together cover [0, rows). Images of many pixels are split across
+   the CPUs, small ones are converted by the calling thread. */
+typedef void (*ccvt_rows_fn)(void *context, int first, int last);
+void ccvt_parallel_rows(int rows, long pixels, ccvt_rows_fn fn, void *context);
+
+#ifdef __cplusplus
+}
+#endif
@@ -43,6 +43,14 @@ class Detector;
 class EncoderInterface
 {
   public:
+    /** Chroma subsampling used by lossy encoders for color frames. */
+    typedef enum
+    {
+        SUBSAMPLING_444,
+        SUBSAMPLING_422,
+        SUBSAMPLING_420
+    } ChromaSubsampling;
+
     EncoderInterface() = default;
     virtual ~EncoderInterface() = default;
 
@@ -52,6 +60,12 @@ class EncoderInterface
 
     virtual bool setSize(uint16_t width, uint16_t height);
 
+    /** Set encoding quality (1-100). Encoders without a quality setting ignore it. */
+    virtual void setQuality(uint8_t value) { quality = value; }
+
+    /** Set chroma subsampling. Encoders without chroma subsampling ignore it. */
+    virtual void setChromaSubsampling(ChromaSubsampling value) { subsampling = value; }
+
     virtual bool upload(IBLOB *bp, const uint8_t *buffer, uint32_t nbytes, bool isCompressed=false) = 0;
 
     const char *getName();
@@ -62,6 +76,8 @@ class EncoderInterface
     INDI_PIXEL_FORMAT pixelFormat;            // INDI Pixel Format
     uint8_t pixelDepth = 8;                   // Bits per Pixels
     uint16_t rawWidth, rawHeight;
+    uint8_t quality = 70;
+    ChromaSubsampling subsampling = SUBSAMPLING_420;
 };
 
 }
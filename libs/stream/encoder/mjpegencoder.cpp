@@ -23,31 +23,111 @@
 #include "stream/streammanager.h"
 #include "indiccd.h"
 
-#include <zlib.h>
+#include <config.h>
+
+#include <cstring>
+
+#ifdef HAVE_TURBOJPEG
+#include <turbojpeg.h>
+#else
+#include <csetjmp>
 #include <jpeglib.h>
 #include <jerror.h>
+#endif
 
-static void init_destination(j_compress_ptr cinfo)
+namespace INDI
 {
-    INDI_UNUSED(cinfo);
-    /* No work necessary here */
-}
 
-static boolean empty_output_buffer(j_compress_ptr cinfo)
-{
-    INDI_UNUSED(cinfo);
-    /* No work necessary here */
-    return TRUE;
-}
+#ifdef HAVE_TURBOJPEG
 
-static void term_destination(j_compress_ptr cinfo)
+struct MJPEGEncoder::Compressor
 {
-    INDI_UNUSED(cinfo);
-    /* no work necessary here */
-}
+    Compressor() { handle = tjInitCompress(); }
+    ~Compressor()
+    {
+        if (handle)
+            tjDestroy(handle);
+    }
 
-namespace INDI
+    tjhandle handle = nullptr;
+};
+
+#else
+
+/*
+ * Persistent libjpeg compressor. jpeg_set_defaults() and the quality tables are only recomputed when the
+ * frame geometry, quality or subsampling change. Errors unwind through setjmp/longjmp instead of the libjpeg
+ * default of calling exit().
+ */
+struct MJPEGEncoder::Compressor
 {
+    struct ErrorManager
+    {
+        struct jpeg_error_mgr pub;
+        jmp_buf setjmp_buffer;
+    };
+
+    Compressor()
+    {
+        cinfo.err           = jpeg_std_error(&jerr.pub);
+        jerr.pub.error_exit = errorExit;
+        jpeg_create_compress(&cinfo);
+
+        dest.init_destination    = initDestination;
+        dest.empty_output_buffer = emptyOutputBuffer;
+        dest.term_destination    = termDestination;
+        cinfo.dest               = &dest;
+        cinfo.client_data        = this;
+    }
+
+    ~Compressor() { jpeg_destroy_compress(&cinfo); }
+
+    static void errorExit(j_common_ptr cinfo)
+    {
+        ErrorManager *err = reinterpret_cast<ErrorManager *>(cinfo->err);
+        (*cinfo->err->output_message)(cinfo);
+        longjmp(err->setjmp_buffer, 1);
+    }
+
+    static void initDestination(j_compress_ptr cinfo)
+    {
+        Compressor *self            = static_cast<Compressor *>(cinfo->client_data);
+        cinfo->dest->next_output_byte = self->output->data();
+        cinfo->dest->free_in_buffer   = self->output->size();
+    }
+
+    // libjpeg only calls this when the whole buffer is full: grow it instead of overwriting the frame.
+    static boolean emptyOutputBuffer(j_compress_ptr cinfo)
+    {
+        Compressor *self = static_cast<Compressor *>(cinfo->client_data);
+        size_t used      = self->output->size();
+        self->output->resize(used * 2);
+        cinfo->dest->next_output_byte = self->output->data() + used;
+        cinfo->dest->free_in_buffer   = self->output->size() - used;
+        return TRUE;
+    }
+
+    static void termDestination(j_compress_ptr cinfo)
+    {
+        Compressor *self = static_cast<Compressor *>(cinfo->client_data);
+        self->written    = self->output->size() - cinfo->dest->free_in_buffer;
+    }
+
+    struct jpeg_compress_struct cinfo;
+    ErrorManager jerr;
+    struct jpeg_destination_mgr dest;
+
+    std::vector<uint8_t> *output = nullptr;
+    size_t written               = 0;
+
+    // Current configuration, zero until the first frame.
+    uint16_t width = 0, height = 0;
+    int components = 0;
+    uint8_t quality = 0;
+    EncoderInterface::ChromaSubsampling subsampling = EncoderInterface::SUBSAMPLING_420;
+};
+
+#endif
 
 MJPEGEncoder::MJPEGEncoder()
 {
@@ -56,7 +136,6 @@ MJPEGEncoder::MJPEGEncoder()
 
 MJPEGEncoder::~MJPEGEncoder()
 {
-    delete [] jpegBuffer;
 }
 
 const char *MJPEGEncoder::getDeviceName()
@@ -74,117 +153,129 @@ bool MJPEGEncoder::upload(IBLOB *bp, const uint8_t *buffer, uint32_t nbytes, boo
     }
 
     INDI_UNUSED(nbytes);
-    int bufsize = rawWidth * rawHeight * ((pixelFormat == INDI_RGB) ? 3 : 1);
-    if (bufsize != jpegBufferSize)
-    {
-        delete [] jpegBuffer;
-        jpegBuffer = new uint8_t[bufsize];
-        jpegBufferSize = bufsize;
-    }
 
-    if (pixelFormat == INDI_RGB)
-        jpeg_compress_8u_rgb(buffer, rawWidth, rawHeight, rawWidth*3, jpegBuffer, &bufsize, 70);
-    else
-        jpeg_compress_8u_gray(buffer, rawWidth, rawHeight, rawWidth, jpegBuffer, &bufsize, 70);
+    size_t size = 0;
+    if (compress(buffer, rawWidth, rawHeight, (pixelFormat == INDI_RGB) ? 3 : 1, &size) == false)
+        return false;
 
-    bp->blob    = jpegBuffer;
-    bp->bloblen = bufsize;
-    bp->size    = bufsize;
+    bp->blob    = jpegBuffer.data();
+    bp->bloblen = size;
+    bp->size    = size;
     strcpy(bp->format, ".stream_jpg");
 
     return true;
 }
 
-/*
-FROM: https://svn.csail.mit.edu/rrg_pods/jpeg-utils/
+#ifdef HAVE_TURBOJPEG
 
-Name:         jpeg-utils
-Maintainers:  Albert Huang <albert@csail.mit.edu>
-Summary:      Wrapper functions around libjpeg to simplify JPEG compression and
-              decompression with in-memory buffers.
-Description:
-  note: This is a simple enough library that you could just copy the .c
-  and .h files in to your own programs.
+bool MJPEGEncoder::compress(const uint8_t *src, uint16_t width, uint16_t height, int components, size_t *destsize)
+{
+    if (!compressor)
+        compressor.reset(new Compressor());
 
-  To use the library, link against -ljpeg-utils, or use
-  pkg-config --cflags --libs jpeg-utils
+    if (compressor->handle == nullptr)
+    {
+        LOG_ERROR("Failed to initialize TurboJPEG compressor.");
+        return false;
+    }
 
-Requirements:
-  libjpeg62
+    int samp = TJSAMP_GRAY;
+    if (components == 3)
+    {
+        switch (subsampling)
+        {
+            case SUBSAMPLING_444:
+                samp = TJSAMP_444;
+                break;
+            case SUBSAMPLING_422:
+                samp = TJSAMP_422;
+                break;
+            default:
+                samp = TJSAMP_420;
+                break;
+        }
+    }
 
-  For faster performance, install libjpeg-turbo, an SSE-accelerated
-  library that is ABI compatible with libjpeg62.
-*/
+    // Worst case size, so TurboJPEG never has to reallocate behind our back.
+    unsigned long maxSize = tjBufSize(width, height, samp);
+    if (jpegBuffer.size() < maxSize)
+        jpegBuffer.resize(maxSize);
 
-int MJPEGEncoder::jpeg_compress_8u_gray (const uint8_t * src, uint16_t width, uint16_t height, int stride, uint8_t * dest, int * destsize, int quality)
-{
-    struct jpeg_compress_struct cinfo;
-    struct jpeg_error_mgr jerr;
-    struct jpeg_destination_mgr jdest;
-    int out_size = *destsize;
-
-    cinfo.err = jpeg_std_error (&jerr);
-    jpeg_create_compress (&cinfo);
-    jdest.next_output_byte = dest;
-    jdest.free_in_buffer = out_size;
-    jdest.init_destination = init_destination;
-    jdest.empty_output_buffer = empty_output_buffer;
-    jdest.term_destination = term_destination;
-    cinfo.dest = &jdest;
-
-    cinfo.image_width = width;
-    cinfo.image_height = height;
-    cinfo.input_components = 1;
-    cinfo.in_color_space = JCS_GRAYSCALE;
-    jpeg_set_defaults (&cinfo);
-    jpeg_set_quality (&cinfo, quality, TRUE);
-
-    jpeg_start_compress (&cinfo, TRUE);
-    while (cinfo.next_scanline < height)
+    unsigned char *dest = jpegBuffer.data();
+    unsigned long size  = jpegBuffer.size();
+    if (tjCompress2(compressor->handle, src, width, width * components, height,
+                    components == 3 ? TJPF_RGB : TJPF_GRAY, &dest, &size, samp, quality, TJFLAG_NOREALLOC) != 0)
     {
-        JSAMPROW row = (JSAMPROW)(src + cinfo.next_scanline * stride);
-        jpeg_write_scanlines (&cinfo, &row, 1);
+        LOGF_ERROR("JPEG compression failed: %s", tjGetErrorStr());
+        return false;
     }
 
-    jpeg_finish_compress (&cinfo);
-    *destsize = out_size - jdest.free_in_buffer;
-    jpeg_destroy_compress (&cinfo);
-    return 0;
+    *destsize = size;
+    return true;
 }
 
-int MJPEGEncoder::jpeg_compress_8u_rgb (const uint8_t * src, uint16_t width, uint16_t height, int stride, uint8_t * dest, int * destsize, int quality)
+#else
+
+bool MJPEGEncoder::compress(const uint8_t *src, uint16_t width, uint16_t height, int components, size_t *destsize)
 {
-    struct jpeg_compress_struct cinfo;
-    struct jpeg_error_mgr jerr;
-    struct jpeg_destination_mgr jdest;
-    int out_size = *destsize;
-
-    cinfo.err = jpeg_std_error (&jerr);
-    jpeg_create_compress (&cinfo);
-    jdest.next_output_byte = dest;
-    jdest.free_in_buffer = out_size;
-    jdest.init_destination = init_destination;
-    jdest.empty_output_buffer = empty_output_buffer;
-    jdest.term_destination = term_destination;
-    cinfo.dest = &jdest;
-
-    cinfo.image_width = width;
-    cinfo.image_height = height;
-    cinfo.input_components = 3;
-    cinfo.in_color_space = JCS_RGB;
-    jpeg_set_defaults (&cinfo);
-    jpeg_set_quality (&cinfo, quality, TRUE);
-
-    jpeg_start_compress (&cinfo, TRUE);
-    while (cinfo.next_scanline < height)
+    if (!compressor)
+        compressor.reset(new Compressor());
+
+    Compressor *c                   = compressor.get();
+    struct jpeg_compress_struct *ci = &c->cinfo;
+
+    // Start at half the raw size, the output buffer grows on demand and is kept for the next frames.
+    size_t initialSize = static_cast<size_t>(width) * height * components / 2 + 4096;
+    if (jpegBuffer.size() < initialSize)
+        jpegBuffer.resize(initialSize);
+    c->output = &jpegBuffer;
+
+    if (setjmp(c->jerr.setjmp_buffer))
+    {
+        jpeg_abort_compress(ci);
+        // Force a full reconfiguration on the next frame.
+        c->components = 0;
+        LOG_ERROR("JPEG compression failed.");
+        return false;
+    }
+
+    if (c->width != width || c->height != height || c->components != components || c->quality != quality ||
+            c->subsampling != subsampling)
+    {
+        ci->image_width      = width;
+        ci->image_height     = height;
+        ci->input_components = components;
+        ci->in_color_space   = (components == 3) ? JCS_RGB : JCS_GRAYSCALE;
+        jpeg_set_defaults(ci);
+        jpeg_set_quality(ci, quality, TRUE);
+
+        if (components == 3)
+        {
+            // Luma sampling factors, chroma components stay at 1x1.
+            ci->comp_info[0].h_samp_factor = (subsampling == SUBSAMPLING_444) ? 1 : 2;
+            ci->comp_info[0].v_samp_factor = (subsampling == SUBSAMPLING_420) ? 2 : 1;
+        }
+
+        c->width       = width;
+        c->height      = height;
+        c->components  = components;
+        c->quality     = quality;
+        c->subsampling = subsampling;
+    }
+
+    jpeg_start_compress(ci, TRUE);
+    const int stride = width * components;
+    while (ci->next_scanline < height)
     {
-        JSAMPROW row = (JSAMPROW)(src + cinfo.next_scanline * stride);
-        jpeg_write_scanlines (&cinfo, &row, 1);
+        JSAMPROW row = const_cast<JSAMPROW>(src + ci->next_scanline * stride);
+        jpeg_write_scanlines(ci, &row, 1);
     }
-    jpeg_finish_compress (&cinfo);
-    *destsize = out_size - jdest.free_in_buffer;
-    jpeg_destroy_compress (&cinfo);
-    return 0;
+    jpeg_finish_compress(ci);
+
+    *destsize = c->written;
+    return true;
 }
 
+#endif
+
 }
@@ -23,13 +23,19 @@
 
 #include "encoderinterface.h"
 
+#include <memory>
+#include <vector>
+
 namespace INDI
 {
 
 /**
  * @brief The MJPEGEncoder class encodes frames in JPEG format before transmitting them to the client.
  *
- * The quality is now hard-coded at 70 when encoding the JPEG image. Further compression is not supported.
+ * The compressor state is created once per stream and only reconfigured when the frame geometry, quality
+ * or chroma subsampling change. When libjpeg-turbo's TurboJPEG API is available it is used instead of the
+ * plain libjpeg API. The output buffer only ever grows, so frames of a steady stream are encoded without
+ * any allocation.
  */
 class MJPEGEncoder : public EncoderInterface
 {
@@ -40,12 +46,13 @@ public:
     virtual bool upload(IBLOB *bp, const uint8_t *buffer, uint32_t nbytes, bool isCompressed=false) override;
 
 private:
+    struct Compressor;
+
     const char *getDeviceName();
-    int jpeg_compress_8u_gray (const uint8_t * src, uint16_t width, uint16_t height, int stride, uint8_t * dest, int * destsize, int quality);
-    int jpeg_compress_8u_rgb (const uint8_t * src, uint16_t width, uint16_t height, int stride, uint8_t * dest, int * destsize, int quality);
-    uint8_t *jpegBuffer = nullptr;
-    uint16_t jpegBufferSize=1;
+    bool compress(const uint8_t *src, uint16_t width, uint16_t height, int components, size_t *destsize);
 
+    std::unique_ptr<Compressor> compressor;
+    std::vector<uint8_t> jpegBuffer;
 };
 
 }
@@ -56,6 +56,17 @@ namespace INDI
 class RecorderInterface
 {
   public:
+    /** Frame counters of the current or last recording */
+    struct Statistics
+    {
+        // Frames written to disk
+        uint64_t written { 0 };
+        // Frames discarded because the recorder could not keep up
+        uint64_t dropped { 0 };
+        // Frames that reached the disk more than one second after they were captured
+        uint64_t late { 0 };
+    };
+
     RecorderInterface() = default;
     virtual ~RecorderInterface() = default;
 
@@ -76,6 +87,16 @@ class RecorderInterface
     // This is to reduce process time and save memory for a dedicated subframe buffer
     virtual void setStreamEnabled(bool enable) = 0;
 
+    // Buffered recording options. They take effect on the next open() and are ignored by recorders writing synchronously.
+    // Memory reserved for frames waiting to be written to disk
+    virtual void setBufferSize(uint64_t bytes) { (void)bytes; }
+    // Split the recording into files no larger than bytes, 0 for a single file
+    virtual void setMaxSegmentSize(uint64_t bytes) { (void)bytes; }
+    // Bypass the page cache when writing frames, if supported by the system
+    virtual void setDirectIO(bool enable) { (void)enable; }
+
+    virtual Statistics getStatistics() { return Statistics(); }
+
   protected:
     const char *name;
     float m_FPS = 1;
@@ -28,14 +28,24 @@
 #include "serrecorder.h"
 #include "jpegutils.h"
 
+#include <algorithm>
 #include <ctime>
 #include <cerrno>
 #include <cstring>
+#include <fcntl.h>
 #include <sys/time.h>
+#include <unistd.h>
 
 
 #define ERRMSGSIZ 1024
 
+// Alignment of writes, required by O_DIRECT and a good fit for most filesystems anyway.
+#define SER_WRITE_ALIGNMENT 4096
+// Size of each coalesced write
+#define SER_STAGING_SIZE    (8 * 1024 * 1024)
+// Frames reaching the disk later than this after capture are counted as late
+#define SER_LATE_FRAME_MS   1000
+
 namespace INDI
 {
 
@@ -54,13 +64,14 @@ SER_Recorder::SER_Recorder()
     else
         serh.LittleEndian = SER_BIG_ENDIAN;
     isRecordingActive = false;
-    f                 = nullptr;
 
     jpegBuffer = static_cast<uint8_t*>(malloc(1));
 }
 
 SER_Recorder::~SER_Recorder()
 {
+    close();
+    free(staging);
     free(jpegBuffer);
 }
 
@@ -71,49 +82,37 @@ bool SER_Recorder::is_little_endian()
     return black_magic == 0x01;
 }
 
-void SER_Recorder::write_int_le(uint32_t *i)
+// Serialize the header with all integers in little endian, regardless of host byte order.
+void SER_Recorder::pack_header(const ser_header *s, uint8_t *out)
 {
-    if (is_little_endian())
-        fwrite((const void *)(i), sizeof(uint32_t), 1, f);
-    else
+    auto put32 = [&out](uint32_t value)
     {
-        unsigned char *c = (unsigned char *)i;
-        fwrite((const void *)(c + 3), sizeof(char), 1, f);
-        fwrite((const void *)(c + 2), sizeof(char), 1, f);
-        fwrite((const void *)(c + 1), sizeof(char), 1, f);
-        fwrite((const void *)(c), sizeof(char), 1, f);
-    }
-}
-
-void SER_Recorder::write_long_int_le(uint64_t *i)
-{
-    if (is_little_endian())
+        for (int i = 0; i < 4; i++)
+            *out++ = static_cast<uint8_t>(value >> (8 * i));
+    };
+    auto put64 = [&out](uint64_t value)
     {
-        fwrite((const void *)((uint32_t *)i), sizeof(int), 1, f);
-        fwrite((const void *)((uint32_t *)(i) + 1), sizeof(int), 1, f);
-    }
-    else
-    {
-        write_int_le((uint32_t *)(i) + 1);
-        write_int_le((uint32_t *)(i));
-    }
-}
-
-void SER_Recorder::write_header(ser_header *s)
-{
-    fwrite((const void *)(s->FileID), sizeof(char), 14, f);
-    write_int_le(&(s->LuID));
-    write_int_le(&(s->ColorID));
-    write_int_le(&(s->LittleEndian));
-    write_int_le(&(s->ImageWidth));
-    write_int_le(&(s->ImageHeight));
-    write_int_le(&(s->PixelDepth));
-    write_int_le(&(s->FrameCount));
-    fwrite((const void *)(s->Observer), sizeof(char), 40, f);
-    fwrite((const void *)(s->Instrume), sizeof(char), 40, f);
-    fwrite((const void *)(s->Telescope), sizeof(char), 40, f);
-    write_long_int_le(&(s->DateTime));
-    write_long_int_le(&(s->DateTime_UTC));
+        for (int i = 0; i < 8; i++)
+            *out++ = static_cast<uint8_t>(value >> (8 * i));
+    };
+
+    memcpy(out, s->FileID, 14);
+    out += 14;
+    put32(s->LuID);
+    put32(s->ColorID);
+    put32(s->LittleEndian);
+    put32(s->ImageWidth);
+    put32(s->ImageHeight);
+    put32(s->PixelDepth);
+    put32(s->FrameCount);
+    memcpy(out, s->Observer, 40);
+    out += 40;
+    memcpy(out, s->Instrume, 40);
+    out += 40;
+    memcpy(out, s->Telescope, 40);
+    out += 40;
+    put64(s->DateTime);
+    put64(s->DateTime_UTC);
 }
 
 bool SER_Recorder::setPixelFormat(INDI_PIXEL_FORMAT pixelFormat, uint8_t pixelDepth)
@@ -175,103 +174,313 @@ bool SER_Recorder::open(const char *filename, char *errmsg)
 {
     if (isRecordingActive)
         return false;
-    serh.FrameCount = 0;
-    if ((f = fopen(filename, "w")) == nullptr)
+
+    serh.FrameCount   = 0;
+    serh.DateTime     = getLocalTimeStamp();
+    serh.DateTime_UTC = getUTCTimeStamp();
+    frame_size        = serh.ImageWidth * serh.ImageHeight * (serh.PixelDepth <= 8 ? 1 : 2) * number_of_planes;
+
+    if (staging == nullptr && posix_memalign(reinterpret_cast<void **>(&staging), SER_WRITE_ALIGNMENT, SER_STAGING_SIZE) != 0)
+    {
+        staging = nullptr;
+        snprintf(errmsg, ERRMSGSIZ, "recorder failed to allocate write buffer\n");
+        return false;
+    }
+    stagingSize = SER_STAGING_SIZE;
+
+    baseFilename = filename;
+    segmentIndex = 0;
+    if (openSegment() == false)
     {
         snprintf(errmsg, ERRMSGSIZ, "recorder open error %d, %s\n", errno, strerror(errno));
         return false;
     }
 
-    serh.DateTime     = getLocalTimeStamp();
-    serh.DateTime_UTC = getUTCTimeStamp();
-    write_header(&serh);
-    frame_size        = serh.ImageWidth * serh.ImageHeight * (serh.PixelDepth <= 8 ? 1 : 2) * number_of_planes;
-    isRecordingActive = true;
+    // Slots get their memory the first time they are filled, so a ring that never fills up stays small.
+    size_t slots = std::max<uint64_t>(2, bufferSize / std::max<uint32_t>(frame_size, 1));
+    ring.resize(slots);
+    ringHead  = 0;
+    ringCount = 0;
 
-    frameStamps.clear();
+    framesWritten = 0;
+    framesDropped = 0;
+    framesLate    = 0;
+    writerError   = false;
+    writerExit    = false;
+
+    isRecordingActive = true;
+    writerThread = std::thread(&SER_Recorder::writerLoop, this);
 
     return true;
 }
 
 bool SER_Recorder::close()
 {
-    if (f)
     {
-        // Write all timestamps
-        for (auto value : frameStamps)
-            write_long_int_le(&value);
-
-        frameStamps.clear();
+        std::lock_guard<std::mutex> lock(ringMutex);
+        isRecordingActive = false;
+        writerExit        = true;
+    }
 
-        fseek(f, 0L, SEEK_SET);
-        write_header(&serh);
-        fclose(f);
-        f = nullptr;
+    // The writer drains all queued frames before exiting.
+    if (writerThread.joinable())
+    {
+        ringCondition.notify_one();
+        writerThread.join();
     }
 
-    isRecordingActive = false;
-    return true;
+    if (fd >= 0)
+        finishSegment();
+
+    // Release the ring memory until the next recording.
+    std::vector<FrameSlot>().swap(ring);
+
+    return !writerError;
 }
 
 bool SER_Recorder::writeFrame(const uint8_t *frame, uint32_t nbytes)
 {
-    if (!isRecordingActive)
+    if (writerError)
         return false;
 
-#if 0
-    if (serh.ColorID == SER_MONO)
     {
-        if (isStreamingActive == false &&
-                (offsetX > 0 || offsetY > 0 || serh.ImageWidth != rawWidth || serh.ImageHeight != rawHeight))
+        std::lock_guard<std::mutex> lock(ringMutex);
+        if (!isRecordingActive)
+            return false;
+
+        if (ringCount == ring.size())
+        {
+            // The disk can not keep up, drop the frame instead of blocking the capture thread.
+            framesDropped++;
+            return true;
+        }
+
+        // The writer only touches queued slots, so filling the free slot just holds the lock for a memcpy.
+        FrameSlot &slot = ring[(ringHead + ringCount) % ring.size()];
+        if (slot.data.size() < nbytes)
+            slot.data.resize(nbytes);
+        memcpy(slot.data.data(), frame, nbytes);
+        slot.size      = nbytes;
+        slot.timestamp = getUTCTimeStamp();
+        slot.queued    = std::chrono::steady_clock::now();
+        ringCount++;
+    }
+    ringCondition.notify_one();
+
+    return true;
+}
+
+SER_Recorder::Statistics SER_Recorder::getStatistics()
+{
+    Statistics stats;
+    stats.written = framesWritten;
+    stats.dropped = framesDropped;
+    stats.late    = framesLate;
+    return stats;
+}
+
+void SER_Recorder::writerLoop()
+{
+    std::unique_lock<std::mutex> lock(ringMutex);
+
+    while (true)
+    {
+        ringCondition.wait(lock, [this]()
+        {
+            return ringCount > 0 || writerExit;
+        });
+
+        if (ringCount == 0)
+            break;
+
+        FrameSlot &slot = ring[ringHead];
+        lock.unlock();
+
+        const uint8_t *data = slot.data.data();
+        size_t size         = slot.size;
+        bool rc             = !writerError;
+        uint32_t width = segmentHeader.ImageWidth, height = segmentHeader.ImageHeight, colorID = segmentHeader.ColorID;
+
+        // Not technically pixel format, but let's use this for now.
+        if (rc && m_PixelFormat == INDI_JPG)
         {
-            int offset = ((rawWidth * offsetY) + offsetX);
+            int w = 0, h = 0, naxis = 1;
+            size_t memsize = 0;
+            if (decode_jpeg_rgb(slot.data.data(), slot.size, &jpegBuffer, &memsize, &naxis, &w, &h) < 0)
+                rc = false;
+            else
+            {
+                width   = w;
+                height  = h;
+                colorID = (naxis == 3) ? SER_RGB : SER_MONO;
+                data    = jpegBuffer;
+                size    = memsize;
+            }
+        }
 
-            uint8_t *srcBuffer  = frame + offset;
-            uint8_t *destBuffer = frame;
-            int imageWidth      = serh.ImageWidth;
-            int imageHeight     = serh.ImageHeight;
+        // Start a new segment if this frame would make the current one exceed its maximum size.
+        if (rc && maxSegmentSize > 0 && segmentHeader.FrameCount > 0 &&
+                segmentBytes + size + (segmentHeader.FrameCount + 1) * sizeof(uint64_t) > maxSegmentSize)
+            rc = finishSegment() && openSegment();
 
-            for (int i = 0; i < imageHeight; i++)
-                memcpy(destBuffer + i * imageWidth, srcBuffer + rawWidth * i, imageWidth);
+        if (rc)
+            rc = appendData(data, size);
+
+        if (rc)
+        {
+            segmentHeader.ImageWidth  = width;
+            segmentHeader.ImageHeight = height;
+            segmentHeader.ColorID     = colorID;
+            segmentHeader.FrameCount += 1;
+            frameStamps.push_back(slot.timestamp);
+            stagedFrames.push_back(slot.queued);
+            framesWritten++;
         }
+
+        if (rc == false)
+            writerError = true;
+
+        lock.lock();
+        ringHead = (ringHead + 1) % ring.size();
+        ringCount--;
     }
-    else
+}
+
+bool SER_Recorder::openSegment()
+{
+    std::string filename = baseFilename;
+    if (segmentIndex > 0)
     {
-        if (isStreamingActive == false &&
-                (offsetX > 0 || offsetY > 0 || serh.ImageWidth != rawWidth || serh.ImageHeight != rawHeight))
-        {
-            int offset = ((rawWidth * offsetY) + offsetX);
+        char suffix[16];
+        snprintf(suffix, sizeof(suffix), "_%03d", segmentIndex);
+        size_t dot = filename.rfind(getExtension());
+        if (dot != std::string::npos && dot + strlen(getExtension()) == filename.size())
+            filename.insert(dot, suffix);
+        else
+            filename += suffix;
+    }
+
+    int flags = O_WRONLY | O_CREAT | O_TRUNC;
+    fdDirect  = false;
+#ifdef O_DIRECT
+    if (directIO)
+    {
+        fd = ::open(filename.c_str(), flags | O_DIRECT, 0644);
+        // Not all filesystems support direct I/O, silently use buffered writes there.
+        fdDirect = (fd >= 0);
+    }
+#endif
+    if (fd < 0)
+        fd = ::open(filename.c_str(), flags, 0644);
+    if (fd < 0)
+        return false;
+
+    segmentHeader = serh;
+    segmentHeader.FrameCount = 0;
+    segmentBytes  = 0;
+    frameStamps.clear();
+    frameStamps.reserve(std::max<size_t>(ring.size(), 1024));
+
+    // The header goes in front of the first frame. It is rewritten with the final frame count when the segment is done.
+    stagingUsed = 0;
+    stagedFrames.clear();
+    uint8_t header[SER_HEADER_SIZE];
+    pack_header(&segmentHeader, header);
+    return appendData(header, SER_HEADER_SIZE);
+}
 
-            uint8_t *srcBuffer  = frame + offset * 3;
-            uint8_t *destBuffer = frame;
-            int imageWidth      = serh.ImageWidth;
-            int imageHeight     = serh.ImageHeight;
+bool SER_Recorder::finishSegment()
+{
+    bool rc = flushStaging(true);
 
-            // RGB
-            for (int i = 0; i < imageHeight; i++)
-                memcpy(destBuffer + i * imageWidth * 3, srcBuffer + rawWidth * 3 * i, imageWidth * 3);
+    if (rc && !frameStamps.empty())
+    {
+        // Trailer with one timestamp per frame
+        std::vector<uint8_t> trailer(frameStamps.size() * sizeof(uint64_t));
+        uint8_t *out = trailer.data();
+        for (uint64_t value : frameStamps)
+        {
+            for (int i = 0; i < 8; i++)
+                *out++ = static_cast<uint8_t>(value >> (8 * i));
         }
-   }
+        rc = (write(fd, trailer.data(), trailer.size()) == static_cast<ssize_t>(trailer.size()));
+    }
+
+    if (rc)
+    {
+        uint8_t header[SER_HEADER_SIZE];
+        pack_header(&segmentHeader, header);
+        rc = (pwrite(fd, header, SER_HEADER_SIZE, 0) == SER_HEADER_SIZE);
+    }
+
+    if (::close(fd) != 0)
+        rc = false;
+    fd = -1;
+
+    frameStamps.clear();
+    segmentIndex++;
+
+    return rc;
+}
+
+bool SER_Recorder::appendData(const uint8_t *data, size_t size)
+{
+    segmentBytes += size;
+
+    while (size > 0)
+    {
+        size_t chunk = std::min(size, stagingSize - stagingUsed);
+        memcpy(staging + stagingUsed, data, chunk);
+        stagingUsed += chunk;
+        data += chunk;
+        size -= chunk;
+
+        if (stagingUsed == stagingSize && flushStaging(false) == false)
+            return false;
+    }
+
+    return true;
+}
+
+bool SER_Recorder::flushStaging(bool final)
+{
+    // Direct I/O only accepts aligned sizes. The tail of a segment, its trailer and the final header
+    // are written after switching direct I/O off.
+    if (final && fdDirect)
+    {
+#ifdef O_DIRECT
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_DIRECT);
 #endif
+        fdDirect = false;
+    }
 
-    frameStamps.push_back(getUTCTimeStamp());
+    if (stagingUsed == 0)
+        return true;
 
-    // Not technically pixel format, but let's use this for now.
-    if (m_PixelFormat == INDI_JPG)
+    size_t offset = 0;
+    while (offset < stagingUsed)
     {
-        int w=0,h=0,naxis=1;
-        size_t memsize=0;
-        if (decode_jpeg_rgb(const_cast<uint8_t *>(frame), nbytes, &jpegBuffer, &memsize, &naxis, &w, &h) < 0)
+        ssize_t n = write(fd, staging + offset, stagingUsed - offset);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
             return false;
+        }
+        offset += n;
+    }
+
+    stagingUsed = 0;
 
-        serh.ImageWidth = w;
-        serh.ImageHeight = h;
-        serh.ColorID = (naxis == 3) ? SER_RGB : SER_MONO;
-        fwrite(jpegBuffer, memsize, 1, f);
+    // The frames completed in staging are on disk now
+    auto now = std::chrono::steady_clock::now();
+    for (const auto &queued : stagedFrames)
+    {
+        if (std::chrono::duration_cast<std::chrono::milliseconds>(now - queued).count() > SER_LATE_FRAME_MS)
+            framesLate++;
     }
-    else
-        fwrite(frame, nbytes, 1, f);
-    serh.FrameCount += 1;
+    stagedFrames.clear();
+
     return true;
 }
 
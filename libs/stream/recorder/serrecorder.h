@@ -23,7 +23,13 @@
 
 #include "recorderinterface.h"
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
 #include <stdio.h>
 
 typedef struct ser_header
@@ -66,6 +72,10 @@ namespace INDI
 
 /**
  * @brief The SER_Recorder class implements recording of video streams in SER format.
+ *
+ * writeFrame() only copies the frame into a preallocated ring of frame slots. A dedicated writer thread drains the ring,
+ * coalesces frames into large aligned writes (optionally with O_DIRECT), and splits the recording into several files
+ * when a maximum segment size is set. When the ring is full, frames are dropped rather than stalling the capture thread.
  */
 class SER_Recorder : public RecorderInterface
 {
@@ -81,23 +91,76 @@ class SER_Recorder : public RecorderInterface
     virtual bool writeFrame(const uint8_t *frame, uint32_t nbytes);
     virtual void setStreamEnabled(bool enable) { isStreamingActive = enable; }
 
+    virtual void setBufferSize(uint64_t bytes) { bufferSize = bytes; }
+    virtual void setMaxSegmentSize(uint64_t bytes) { maxSegmentSize = bytes; }
+    virtual void setDirectIO(bool enable) { directIO = enable; }
+    virtual Statistics getStatistics();
+
     // Public constants
     static const uint64_t C_SEPASECONDS_PER_SECOND = 10000000;
 
   protected:
+    // Size of the SER header on disk
+    static const uint32_t SER_HEADER_SIZE = 178;
+
+    struct FrameSlot
+    {
+        std::vector<uint8_t> data;
+        uint32_t size { 0 };
+        uint64_t timestamp { 0 };
+        std::chrono::steady_clock::time_point queued;
+    };
+
     uint64_t utcTo64BitTS();
     bool is_little_endian();
-    void write_int_le(uint32_t *i);
-    void write_long_int_le(uint64_t *i);
-    void write_header(ser_header *s);
+    void pack_header(const ser_header *s, uint8_t *out);
+
+    // Writer thread
+    void writerLoop();
+    bool openSegment();
+    bool finishSegment();
+    bool appendData(const uint8_t *data, size_t size);
+    bool flushStaging(bool final);
+
     ser_header serh;
     bool isRecordingActive = false, isStreamingActive = false;
-    FILE *f;
     uint32_t frame_size;
     uint32_t number_of_planes;
     uint16_t rawWidth = 0, rawHeight = 0;
+
+    // Options
+    uint64_t bufferSize { 32 * 1024 * 1024 };
+    uint64_t maxSegmentSize { 0 };
+    bool directIO { false };
+
+    // Ring of frames waiting for the writer thread. Slots [ringHead, ringHead + ringCount) are queued.
+    std::vector<FrameSlot> ring;
+    size_t ringHead { 0 };
+    size_t ringCount { 0 };
+    std::mutex ringMutex;
+    std::condition_variable ringCondition;
+    std::thread writerThread;
+    bool writerExit { false };
+    std::atomic<bool> writerError { false };
+
+    // Current segment, only touched by the writer thread once recording started.
+    std::string baseFilename;
+    int segmentIndex { 0 };
+    int fd { -1 };
+    bool fdDirect { false };
+    uint64_t segmentBytes { 0 };
+    ser_header segmentHeader;
     std::vector<uint64_t> frameStamps;
 
+    // Aligned buffer coalescing frames into large writes
+    uint8_t *staging { nullptr };
+    size_t stagingSize { 0 };
+    size_t stagingUsed { 0 };
+    // Queue times of the frames whose last bytes are in staging
+    std::vector<std::chrono::steady_clock::time_point> stagedFrames;
+
+    std::atomic<uint64_t> framesWritten { 0 }, framesDropped { 0 }, framesLate { 0 };
+
   private:
     // From pipp_timestamp.h
     // Copyright (C) 2015 Chris Garry
@@ -108,6 +108,9 @@ bool StreamManager::initProperties()
     IUFillNumber(&FpsN[FPS_INSTANT], "EST_FPS", "Instant.", "%3.2f", 0.0, 999.0, 0.0, 30);
     IUFillNumber(&FpsN[FPS_AVERAGE], "AVG_FPS", "Average (1 sec.)", "%3.2f", 0.0, 999.0, 0.0, 30);
     IUFillNumberVector(&FpsNP, FpsN, NARRAY(FpsN), getDeviceName(), "FPS", "FPS", STREAM_TAB, IP_RO, 60, IPS_IDLE);
+    // The instantaneous rate jitters from frame to frame, clients get it once a second at most
+    currentDevice->setPublishPolicy(&FpsNP, 1000);
+    currentDevice->setPublishDeadband(&FpsNP, FpsN[FPS_INSTANT].name, 1);
 
     /* Record Frames */
     /* File */
@@ -123,6 +126,24 @@ bool StreamManager::initProperties()
     IUFillNumberVector(&RecordOptionsNP, RecordOptionsN, NARRAY(RecordOptionsN), getDeviceName(), "RECORD_OPTIONS",
                        "Record Options", STREAM_TAB, IP_RW, 60, IPS_IDLE);
 
+    /* Record Buffering */
+    IUFillNumber(&RecordBufferN[RECORD_BUFFER_SIZE], "RECORD_BUFFER_SIZE", "Buffer (MB)", "%.f", 16, 65536, 16, 32);
+    IUFillNumber(&RecordBufferN[RECORD_SEGMENT_SIZE], "RECORD_SEGMENT_SIZE", "Segment (MB)", "%.f", 0, 1048576, 1024, 0);
+    IUFillNumberVector(&RecordBufferNP, RecordBufferN, NARRAY(RecordBufferN), getDeviceName(), "RECORD_BUFFER",
+                       "Record Buffer", STREAM_TAB, IP_RW, 60, IPS_IDLE);
+
+    IUFillSwitch(&RecordDirectIOS[0], "INDI_ENABLED", "Enabled", ISS_OFF);
+    IUFillSwitch(&RecordDirectIOS[1], "INDI_DISABLED", "Disabled", ISS_ON);
+    IUFillSwitchVector(&RecordDirectIOSP, RecordDirectIOS, NARRAY(RecordDirectIOS), getDeviceName(), "RECORD_DIRECT_IO",
+                       "Direct I/O", STREAM_TAB, IP_RW, ISR_1OFMANY, 0, IPS_IDLE);
+
+    /* Record Statistics */
+    IUFillNumber(&RecordStatsN[RECORD_STATS_WRITTEN], "RECORD_STATS_WRITTEN", "Written", "%.f", 0, 1e12, 0, 0);
+    IUFillNumber(&RecordStatsN[RECORD_STATS_DROPPED], "RECORD_STATS_DROPPED", "Dropped", "%.f", 0, 1e12, 0, 0);
+    IUFillNumber(&RecordStatsN[RECORD_STATS_LATE], "RECORD_STATS_LATE", "Late", "%.f", 0, 1e12, 0, 0);
+    IUFillNumberVector(&RecordStatsNP, RecordStatsN, NARRAY(RecordStatsN), getDeviceName(), "RECORD_STATS",
+                       "Record Frames", STREAM_TAB, IP_RO, 60, IPS_IDLE);
+
     /* Record Switch */
     IUFillSwitch(&RecordStreamS[0], "RECORD_ON", "Record On", ISS_OFF);
     IUFillSwitch(&RecordStreamS[1], "RECORD_DURATION_ON", "Record (Duration)", ISS_OFF);
@@ -150,6 +171,17 @@ bool StreamManager::initProperties()
     else
         IUFillSwitchVector(&EncoderSP, EncoderS, NARRAY(EncoderS), getDeviceName(), "CCD_STREAM_ENCODER", "Encoder", STREAM_TAB, IP_RW, ISR_1OFMANY, 0, IPS_IDLE);
 
+    // JPEG Encoding
+    IUFillNumber(&JPEGQualityN[0], "JPEG_QUALITY", "Quality", "%.f", 1, 100, 5, 70);
+    IUFillNumberVector(&JPEGQualityNP, JPEGQualityN, NARRAY(JPEGQualityN), getDeviceName(), "STREAM_JPEG_QUALITY",
+                       "JPEG Quality", STREAM_TAB, IP_RW, 60, IPS_IDLE);
+
+    IUFillSwitch(&JPEGSubsamplingS[EncoderInterface::SUBSAMPLING_444], "JPEG_SUBSAMPLING_444", "4:4:4", ISS_OFF);
+    IUFillSwitch(&JPEGSubsamplingS[EncoderInterface::SUBSAMPLING_422], "JPEG_SUBSAMPLING_422", "4:2:2", ISS_OFF);
+    IUFillSwitch(&JPEGSubsamplingS[EncoderInterface::SUBSAMPLING_420], "JPEG_SUBSAMPLING_420", "4:2:0", ISS_ON);
+    IUFillSwitchVector(&JPEGSubsamplingSP, JPEGSubsamplingS, NARRAY(JPEGSubsamplingS), getDeviceName(),
+                       "STREAM_JPEG_SUBSAMPLING", "JPEG Chroma", STREAM_TAB, IP_RW, ISR_1OFMANY, 0, IPS_IDLE);
+
     // Recorder Selector
     IUFillSwitch(&RecorderS[RECORDER_RAW], "SER", "SER", ISS_ON);
     IUFillSwitch(&RecorderS[RECORDER_OGV], "OGV", "OGV", ISS_OFF);
@@ -179,8 +211,13 @@ void StreamManager::ISGetProperties(const char * dev)
         currentDevice->defineSwitch(&RecordStreamSP);
         currentDevice->defineText(&RecordFileTP);
         currentDevice->defineNumber(&RecordOptionsNP);
+        currentDevice->defineNumber(&RecordBufferNP);
+        currentDevice->defineSwitch(&RecordDirectIOSP);
+        currentDevice->defineNumber(&RecordStatsNP);
         currentDevice->defineNumber(&StreamFrameNP);
         currentDevice->defineSwitch(&EncoderSP);
+        currentDevice->defineNumber(&JPEGQualityNP);
+        currentDevice->defineSwitch(&JPEGSubsamplingSP);
         currentDevice->defineSwitch(&RecorderSP);
     }
 }
@@ -206,8 +243,13 @@ bool StreamManager::updateProperties()
         currentDevice->defineSwitch(&RecordStreamSP);
         currentDevice->defineText(&RecordFileTP);
         currentDevice->defineNumber(&RecordOptionsNP);
+        currentDevice->defineNumber(&RecordBufferNP);
+        currentDevice->defineSwitch(&RecordDirectIOSP);
+        currentDevice->defineNumber(&RecordStatsNP);
         currentDevice->defineNumber(&StreamFrameNP);
         currentDevice->defineSwitch(&EncoderSP);
+        currentDevice->defineNumber(&JPEGQualityNP);
+        currentDevice->defineSwitch(&JPEGSubsamplingSP);
         currentDevice->defineSwitch(&RecorderSP);
     }
     else
@@ -219,8 +261,13 @@ bool StreamManager::updateProperties()
         currentDevice->deleteProperty(RecordFileTP.name);
         currentDevice->deleteProperty(RecordStreamSP.name);
         currentDevice->deleteProperty(RecordOptionsNP.name);
+        currentDevice->deleteProperty(RecordBufferNP.name);
+        currentDevice->deleteProperty(RecordDirectIOSP.name);
+        currentDevice->deleteProperty(RecordStatsNP.name);
         currentDevice->deleteProperty(StreamFrameNP.name);
         currentDevice->deleteProperty(EncoderSP.name);
+        currentDevice->deleteProperty(JPEGQualityNP.name);
+        currentDevice->deleteProperty(JPEGSubsamplingSP.name);
         currentDevice->deleteProperty(RecorderSP.name);
     }
 
@@ -233,10 +280,19 @@ bool StreamManager::updateProperties()
  * Therefore nbytes is expected to be SubW/BinX * SubH/BinY * Bytes_Per_Pixels * Number_Color_Components
  * Binned frame must be sent from the camera driver for this to work consistentaly for all drivers.*/
 void StreamManager::newFrame(const uint8_t * buffer, uint32_t nbytes)
+{
+    newFrame(buffer, nbytes, nullptr);
+}
+
+void StreamManager::newFrame(const uint8_t * buffer, uint32_t nbytes, std::function<void()> release)
 {
     m_FrameCounterPerSecond += 1;
     if (StreamExposureN[STREAM_DIVISOR].value > 1 && (m_FrameCounterPerSecond % static_cast<int>(StreamExposureN[STREAM_DIVISOR].value)) == 0)
+    {
+        if (release)
+            release();
         return;
+    }
 
     double ms1, ms2, deltams;
     // Measure FPS
@@ -259,13 +315,14 @@ void StreamManager::newFrame(const uint8_t * buffer, uint32_t nbytes)
         m_FrameCounterPerSecond = 0;
     }
 
-    // Only send FPS when there is a substancial update
-    if (fabs(newFPS - FpsN[0].value) > 1 || m_FrameCounterPerSecond == 0)
+    FpsN[0].value = newFPS;
+    currentDevice->publishNumber(&FpsNP);
+    std::thread([this, buffer, nbytes, deltams, release]()
     {
-        FpsN[0].value = newFPS;
-        IDSetNumber(&FpsNP, nullptr);
-    }
-    std::thread(&StreamManager::asyncStream, this, buffer, nbytes, deltams).detach();
+        asyncStream(buffer, nbytes, deltams);
+        if (release)
+            release();
+    }).detach();
 }
 
 void StreamManager::asyncStream(const uint8_t *buffer, uint32_t nbytes, double deltams)
@@ -475,6 +532,8 @@ bool StreamManager::recordStream(const uint8_t * buffer, uint32_t nbytes, double
     m_RecordingFrameDuration += deltams;
     m_RecordingFrameTotal += 1;
 
+    updateRecordStats();
+
     if ((RecordStreamSP.sp[1].s == ISS_ON) && (m_RecordingFrameDuration >= (RecordOptionsNP.np[0].value * 1000.0)))
     {
         LOGF_INFO("Ending record after %g millisecs", m_RecordingFrameDuration);
@@ -498,6 +557,23 @@ bool StreamManager::recordStream(const uint8_t * buffer, uint32_t nbytes, double
     return true;
 }
 
+void StreamManager::updateRecordStats(bool force)
+{
+    // Publish at most once per second while recording
+    struct timeval now;
+    gettimeofday(&now, nullptr);
+    if (!force && (now.tv_sec - m_RecordStatsTime.tv_sec) * 1000000 + (now.tv_usec - m_RecordStatsTime.tv_usec) < 1000000)
+        return;
+    m_RecordStatsTime = now;
+
+    RecorderInterface::Statistics stats = recorder->getStatistics();
+    RecordStatsN[RECORD_STATS_WRITTEN].value = stats.written;
+    RecordStatsN[RECORD_STATS_DROPPED].value = stats.dropped;
+    RecordStatsN[RECORD_STATS_LATE].value    = stats.late;
+    RecordStatsNP.s = (stats.dropped > 0) ? IPS_ALERT : (stats.late > 0 ? IPS_BUSY : IPS_OK);
+    IDSetNumber(&RecordStatsNP, nullptr);
+}
+
 int StreamManager::mkpath(std::string s, mode_t mode)
 {
     size_t pre = 0, pos;
@@ -630,6 +706,9 @@ bool StreamManager::startRecording()
                   strerror(errno));
         return false;
     }
+    recorder->setBufferSize(static_cast<uint64_t>(RecordBufferN[RECORD_BUFFER_SIZE].value) * 1024 * 1024);
+    recorder->setMaxSegmentSize(static_cast<uint64_t>(RecordBufferN[RECORD_SEGMENT_SIZE].value) * 1024 * 1024);
+    recorder->setDirectIO(RecordDirectIOS[0].s == ISS_ON);
     if (!recorder->open(filename.c_str(), errmsg))
     {
         RecordStreamSP.s = IPS_ALERT;
@@ -705,13 +784,18 @@ bool StreamManager::stopRecording(bool force)
     }
 
     m_isRecording = false;
-    recorder->close();
+    if (recorder->close() == false)
+        LOG_ERROR("Failed to write all recorded frames to disk.");
+
+    updateRecordStats(true);
 
     if (force)
         return false;
 
-    LOGF_INFO("Record Duration(millisec): %g -- Frame count: %d", m_RecordingFrameDuration,
-              m_RecordingFrameTotal);
+    RecorderInterface::Statistics stats = recorder->getStatistics();
+    LOGF_INFO("Record Duration(millisec): %g -- Frame count: %d -- Written: %llu Dropped: %llu Late: %llu",
+              m_RecordingFrameDuration, m_RecordingFrameTotal, static_cast<unsigned long long>(stats.written),
+              static_cast<unsigned long long>(stats.dropped), static_cast<unsigned long long>(stats.late));
     return true;
 }
 
@@ -793,6 +877,21 @@ bool StreamManager::ISNewSwitch(const char * dev, const char * name, ISState * s
         return true;
     }
 
+    // Record Direct I/O
+    if (!strcmp(name, RecordDirectIOSP.name))
+    {
+        if (m_isRecording)
+        {
+            LOG_WARN("Recording device is busy");
+            return false;
+        }
+
+        IUUpdateSwitch(&RecordDirectIOSP, states, names, n);
+        RecordDirectIOSP.s = IPS_OK;
+        IDSetSwitch(&RecordDirectIOSP, nullptr);
+        return true;
+    }
+
     // Encoder Selection
     if (!strcmp(name, EncoderSP.name))
     {
@@ -817,6 +916,18 @@ bool StreamManager::ISNewSwitch(const char * dev, const char * name, ISState * s
         IDSetSwitch(&EncoderSP, nullptr);
     }
 
+    // JPEG Chroma Subsampling
+    if (!strcmp(name, JPEGSubsamplingSP.name))
+    {
+        IUUpdateSwitch(&JPEGSubsamplingSP, states, names, n);
+        auto subsampling = static_cast<EncoderInterface::ChromaSubsampling>(IUFindOnSwitchIndex(&JPEGSubsamplingSP));
+        for (EncoderInterface * oneEncoder : encoderManager->getEncoderList())
+            oneEncoder->setChromaSubsampling(subsampling);
+        JPEGSubsamplingSP.s = IPS_OK;
+        IDSetSwitch(&JPEGSubsamplingSP, nullptr);
+        return true;
+    }
+
     // Recorder Selection
     if (!strcmp(name, RecorderSP.name))
     {
@@ -895,6 +1006,32 @@ bool StreamManager::ISNewNumber(const char * dev, const char * name, double valu
         return true;
     }
 
+    /* Record Buffering */
+    if (!strcmp(RecordBufferNP.name, name))
+    {
+        if (m_isRecording)
+        {
+            LOG_WARN("Recording device is busy");
+            return false;
+        }
+
+        IUUpdateNumber(&RecordBufferNP, values, names, n);
+        RecordBufferNP.s = IPS_OK;
+        IDSetNumber(&RecordBufferNP, nullptr);
+        return true;
+    }
+
+    /* JPEG Quality */
+    if (!strcmp(JPEGQualityNP.name, name))
+    {
+        IUUpdateNumber(&JPEGQualityNP, values, names, n);
+        for (EncoderInterface * oneEncoder : encoderManager->getEncoderList())
+            oneEncoder->setQuality(static_cast<uint8_t>(JPEGQualityN[0].value));
+        JPEGQualityNP.s = IPS_OK;
+        IDSetNumber(&JPEGQualityNP, nullptr);
+        return true;
+    }
+
     /* Stream Frame */
     if (!strcmp(StreamFrameNP.name, name))
     {
@@ -1047,8 +1184,12 @@ bool StreamManager::setStream(bool enable)
 bool StreamManager::saveConfigItems(FILE * fp)
 {
     IUSaveConfigSwitch(fp, &EncoderSP);
+    IUSaveConfigNumber(fp, &JPEGQualityNP);
+    IUSaveConfigSwitch(fp, &JPEGSubsamplingSP);
     IUSaveConfigText(fp, &RecordFileTP);
     IUSaveConfigNumber(fp, &RecordOptionsNP);
+    IUSaveConfigNumber(fp, &RecordBufferNP);
+    IUSaveConfigSwitch(fp, &RecordDirectIOSP);
     IUSaveConfigSwitch(fp, &RecorderSP);
     return true;
 }
@@ -28,6 +28,7 @@
 
 #include <string>
 #include <map>
+#include <functional>
 #include <sys/time.h>
 
 #include <stdint.h>
@@ -60,6 +61,7 @@
    1. RAW Encoder: Frame is sent as is (lossless). If compression is enabled, the frame is compressed with zlib. Uncompressed format is ".stream"
    and compressed format is ".stream.z"
    2. MJPEG Encoder: Frame is encoded to a JPEG image before being transmitted. Format is ".stream_jpg"
+   The JPEG quality and chroma subsampling are set via the STREAM_JPEG_QUALITY and STREAM_JPEG_SUBSAMPLING properties.
 
    \section Recorders
 
@@ -74,6 +76,9 @@
    Currently, two recorders are supported:
 
    1. SER recorder: Saves video streams along with timestamps in <a href=http://www.grischa-hahn.homepage.t-online.de/astro/ser/">SER format</a>.
+   Frames are handed to a background writer thread through a ring buffer whose size is set by RECORD_BUFFER. Recordings can be split
+   into several files no larger than the RECORD_BUFFER segment size, and written with direct I/O via RECORD_DIRECT_IO. Frames written,
+   dropped because the buffer was full, and written late are reported in RECORD_STATS.
    2. OGV recorder: Saves video streams in libtheora OGV files. INDI must be compiled with the optional OGG Theora support for this functionality to be
    available. Frame rate is estimated from the average FPS.
 
@@ -122,6 +127,12 @@ class StreamManager
              */
         void newFrame(const uint8_t *buffer, uint32_t nbytes);
 
+        /**
+         * @brief newFrame Same as above for a buffer the driver lends by reference, e.g. a dequeued capture buffer.
+         * @param release called once the streamer no longer uses the buffer, possibly from another thread.
+         */
+        void newFrame(const uint8_t *buffer, uint32_t nbytes, std::function<void()> release);
+
         /**
          * @brief asyncStream Upload the stream asynchronously in a separate thread. ccdBufferLock mutex shall be locked until the record/upload
          * operation is complete.
@@ -248,6 +259,21 @@ class StreamManager
         INumber RecordOptionsN[2];
         INumberVectorProperty RecordOptionsNP;
 
+        /* Record Buffering */
+        INumber RecordBufferN[2];
+        INumberVectorProperty RecordBufferNP;
+        enum { RECORD_BUFFER_SIZE, RECORD_SEGMENT_SIZE };
+
+        ISwitch RecordDirectIOS[2];
+        ISwitchVectorProperty RecordDirectIOSP;
+
+        /* Record Statistics */
+        INumber RecordStatsN[3];
+        INumberVectorProperty RecordStatsNP;
+        enum { RECORD_STATS_WRITTEN, RECORD_STATS_DROPPED, RECORD_STATS_LATE };
+        void updateRecordStats(bool force = false);
+        struct timeval m_RecordStatsTime {0, 0};
+
         // Stream Frame
         INumberVectorProperty StreamFrameNP;
         INumber StreamFrameN[4];
@@ -261,6 +287,12 @@ class StreamManager
         ISwitchVectorProperty EncoderSP;
         enum { ENCODER_RAW, ENCODER_MJPEG };
 
+        // JPEG Encoding
+        INumber JPEGQualityN[1];
+        INumberVectorProperty JPEGQualityNP;
+        ISwitch JPEGSubsamplingS[3];
+        ISwitchVectorProperty JPEGSubsamplingSP;
+
         // Recorder Selector. Static but should be implmeneted as a dynamic plugin interface
         ISwitch RecorderS[2];
         ISwitchVectorProperty RecorderSP;
@@ -45,6 +45,7 @@
 #include <ctime>
 #include <cmath>
 #include <sys/time.h>
+#include <chrono>
 
 #ifdef __linux__
 #include <asm/types.h> /* for videodev2.h */
@@ -149,6 +150,10 @@ V4L2_Base::V4L2_Base()
     buffers   = nullptr;
     n_buffers = 0;
 
+    requested_buffers = V4L2_DEFAULT_BUFFER_COUNT;
+    current_index     = -1;
+    held_buffers      = 0;
+
     callback = nullptr;
 
     cancrop      = true;
@@ -646,20 +651,29 @@ int V4L2_Base::read_frame(char * errmsg)
 
             //DEBUGFDEVICE(deviceName, INDI::Logger::DBG_DEBUG,"lxstate is %d, dropFrame %c\n", lxstate, (dropFrame?'Y':'N'));
 
-            /* Requeue buffer */
-            if (-1 == XIOCTL(fd, VIDIOC_QBUF, &buf))
-                return errno_exit("ReadFrame IO_METHOD_MMAP: VIDIOC_QBUF", errmsg);
-
-            if (lxstate == LX_ACTIVE)
             {
-                /* Call provided callback function if any */
-                //if (callback && !dorecord)
-                if (callback)
-                    (*callback)(uptr);
-            }
+                /* The callback may clobber the shared descriptor, keep our own copy for the requeue */
+                struct v4l2_buffer qbuf = buf;
+
+                if (lxstate == LX_ACTIVE)
+                {
+                    /* Call provided callback function if any. The buffer is still dequeued here, so the decoder
+                     * output and the callback may reference it without copying. */
+                    //if (callback && !dorecord)
+                    current_index = qbuf.index;
+                    if (callback)
+                        (*callback)(uptr);
+                    current_index = -1;
+                }
+
+                if (lxstate == LX_TRIGGERED)
+                    lxstate = LX_ACTIVE;
 
-            if (lxstate == LX_TRIGGERED)
-                lxstate = LX_ACTIVE;
+                /* Requeue buffer, unless a consumer holds it */
+                std::lock_guard<std::mutex> guard(bufferLock);
+                if (!buffers[qbuf.index].held && -1 == XIOCTL(fd, VIDIOC_QBUF, &qbuf))
+                    return errno_exit("ReadFrame IO_METHOD_MMAP: VIDIOC_QBUF", errmsg);
+            }
 
             break;
 
@@ -751,10 +765,17 @@ int V4L2_Base::start_capturing(char * errmsg)
             break;
 
         case IO_METHOD_MMAP:
+        {
+            /* Buffers still held by consumers are enqueued by releaseFrame() */
+            std::lock_guard<std::mutex> guard(bufferLock);
+
             for (i = 0; i < n_buffers; ++i)
             {
                 struct v4l2_buffer buf;
 
+                if (buffers[i].held)
+                    continue;
+
                 CLEAR(buf);
 
                 buf.type   = V4L2_BUF_TYPE_VIDEO_CAPTURE;
@@ -774,6 +795,7 @@ int V4L2_Base::start_capturing(char * errmsg)
             streamactive     = true;
 
             break;
+        }
 
         case IO_METHOD_USERPTR:
             for (i = 0; i < n_buffers; ++i)
@@ -811,6 +833,110 @@ void V4L2_Base::newFrame(int /*fd*/, void * p)
     ((V4L2_Base *)(p))->read_frame(errmsg);
 }
 
+unsigned char * V4L2_Base::getFrameBuffer(unsigned int index)
+{
+    if (io != IO_METHOD_MMAP || index >= n_buffers)
+        return nullptr;
+
+    return (unsigned char *)buffers[index].start;
+}
+
+int V4L2_Base::holdFrame(const unsigned char * data, size_t size)
+{
+    std::lock_guard<std::mutex> guard(bufferLock);
+
+    if (io != IO_METHOD_MMAP || current_index < 0)
+        return -1;
+
+    /* Decoders may have produced the frame in their own memory, which is not ours to hold */
+    const unsigned char * start = static_cast<const unsigned char *>(buffers[current_index].start);
+    if (data < start || size > buffers[current_index].length ||
+            static_cast<size_t>(data - start) > buffers[current_index].length - size)
+        return -1;
+
+    /* Keep at least two buffers queued so capture goes on */
+    if (!buffers[current_index].held && held_buffers + 2 >= n_buffers)
+        return -1;
+
+    if (!buffers[current_index].held)
+    {
+        buffers[current_index].held = true;
+        held_buffers++;
+    }
+
+    return current_index;
+}
+
+int V4L2_Base::releaseFrame(unsigned int index, char * errmsg)
+{
+    std::lock_guard<std::mutex> guard(bufferLock);
+
+    if (io != IO_METHOD_MMAP || index >= n_buffers || !buffers[index].held)
+    {
+        snprintf(errmsg, ERRMSGSIZ, "Buffer #%u is not held\n", index);
+        return -1;
+    }
+
+    buffers[index].held = false;
+    held_buffers--;
+    bufferReleased.notify_all();
+
+    /* When not streaming, start_capturing() enqueues the buffer */
+    if (!streamactive)
+        return 0;
+
+    struct v4l2_buffer qbuf;
+
+    CLEAR(qbuf);
+
+    qbuf.type   = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    qbuf.memory = V4L2_MEMORY_MMAP;
+    qbuf.index  = index;
+
+    /* Not errno_exit(), this may run from a consumer thread */
+    if (-1 == XIOCTL(fd, VIDIOC_QBUF, &qbuf))
+    {
+        snprintf(errmsg, ERRMSGSIZ, "VIDIOC_QBUF error %d, %s\n", errno, strerror(errno));
+        return -1;
+    }
+
+    return 0;
+}
+
+int V4L2_Base::exportFrame(unsigned int index, char * errmsg)
+{
+    if (io != IO_METHOD_MMAP || index >= n_buffers)
+    {
+        snprintf(errmsg, ERRMSGSIZ, "Cannot export buffer #%u\n", index);
+        return -1;
+    }
+
+    if (buffers[index].dmabuf >= 0)
+        return buffers[index].dmabuf;
+
+#ifdef VIDIOC_EXPBUF
+    struct v4l2_exportbuffer expbuf;
+
+    CLEAR(expbuf);
+
+    expbuf.type  = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    expbuf.index = index;
+    expbuf.flags = O_RDONLY | O_CLOEXEC;
+
+    if (-1 == XIOCTL(fd, VIDIOC_EXPBUF, &expbuf))
+    {
+        snprintf(errmsg, ERRMSGSIZ, "VIDIOC_EXPBUF error %d, %s\n", errno, strerror(errno));
+        return -1;
+    }
+
+    buffers[index].dmabuf = expbuf.fd;
+    return expbuf.fd;
+#else
+    snprintf(errmsg, ERRMSGSIZ, "DMABUF export is not supported by this system\n");
+    return -1;
+#endif
+}
+
 int V4L2_Base::uninit_device(char * errmsg)
 {
     switch (io)
@@ -820,10 +946,22 @@ int V4L2_Base::uninit_device(char * errmsg)
             break;
 
         case IO_METHOD_MMAP:
+        {
+            /* Consumers still reading frames in place must return them before the buffers are unmapped */
+            std::unique_lock<std::mutex> guard(bufferLock);
+            while (!bufferReleased.wait_for(guard, std::chrono::seconds(2), [this]() { return held_buffers == 0; }))
+                DEBUGFDEVICE(deviceName, INDI::Logger::DBG_WARNING, "%s: waiting for %u frame buffers still held",
+                             __FUNCTION__, held_buffers);
+
             for (unsigned int i = 0; i < n_buffers; ++i)
+            {
+                if (buffers[i].dmabuf >= 0)
+                    close(buffers[i].dmabuf);
                 if (-1 == munmap(buffers[i].start, buffers[i].length))
                     return errno_exit("munmap", errmsg);
+            }
             break;
+        }
 
         case IO_METHOD_USERPTR:
             for (unsigned int i = 0; i < n_buffers; ++i)
@@ -831,7 +969,10 @@ int V4L2_Base::uninit_device(char * errmsg)
             break;
     }
 
+    std::lock_guard<std::mutex> guard(bufferLock);
     free(buffers);
+    buffers   = nullptr;
+    n_buffers = 0;
 
     return 0;
 }
@@ -862,7 +1003,7 @@ int V4L2_Base::init_mmap(char * errmsg)
 
     CLEAR(req);
 
-    req.count = 4;
+    req.count = requested_buffers;
     //req.count               = 1;
     req.type   = V4L2_BUF_TYPE_VIDEO_CAPTURE;
     req.memory = V4L2_MEMORY_MMAP;
@@ -916,8 +1057,14 @@ int V4L2_Base::init_mmap(char * errmsg)
 
         if (MAP_FAILED == buffers[n_buffers].start)
             return errno_exit("mmap", errmsg);
+
+        buffers[n_buffers].dmabuf = -1;
+        buffers[n_buffers].held   = false;
     }
 
+    DEBUGFDEVICE(deviceName, INDI::Logger::DBG_DEBUG, "%s: %u buffers mapped (%u requested)", __FUNCTION__,
+                 n_buffers, requested_buffers);
+
     return 0;
 }
 
@@ -1917,6 +2064,11 @@ void V4L2_Base::setColorProcessing(bool quantization, bool colorconvert, bool li
     bpp = decoder->getBpp();
 }
 
+void V4L2_Base::setEdgeAwareDemosaic(bool edgeAware)
+{
+    decoder->setEdgeAwareDemosaic(edgeAware);
+}
+
 unsigned char * V4L2_Base::getY()
 {
     return decoder->getY();
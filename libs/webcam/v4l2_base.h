@@ -36,11 +36,17 @@
 
 #include <stdio.h>
 #include <cstdlib>
+#include <mutex>
+#include <condition_variable>
 
 #include <linux/videodev2.h>
 
 #define VIDEO_COMPRESSION_LEVEL 4
 
+/* Number of MMAP buffers requested from the device. Frames held by consumers stay dequeued, so the queue must be
+   deep enough to keep capturing while a few frames are being streamed or recorded. */
+#define V4L2_DEFAULT_BUFFER_COUNT 8
+
 class V4L2_Driver;
 
 enum
@@ -65,6 +71,8 @@ class V4L2_Base
     {
         void *start;
         size_t length;
+        int dmabuf; // exported DMABUF descriptor, -1 if not exported
+        bool held;  // dequeued and referenced by a consumer
     };
 
     /* Connection */
@@ -103,6 +111,25 @@ class V4L2_Base
     int stop_capturing(char *errmsg);
     static void newFrame(int fd, void *p);
 
+    /* Zero-copy frame access (MMAP only).
+     * While the frame callback runs, the dequeued buffer is still owned by the application and the decoder may
+     * reference it instead of copying it. The buffer is re-enqueued once the callback returns, unless a consumer
+     * holds it with holdFrame(), in which case it is re-enqueued by releaseFrame(). */
+    void setBufferCount(unsigned int count) { requested_buffers = count; }
+    unsigned int getBufferCount() { return n_buffers; }
+    /* Index of the buffer being delivered to the frame callback, -1 outside the callback */
+    int getFrameIndex() { return current_index; }
+    unsigned char *getFrameBuffer(unsigned int index);
+    /* Keep the buffer being delivered dequeued after the callback returns, for a consumer referencing the size
+       bytes at data. Returns its index, or -1 if not possible, e.g. when data lies outside the buffer because the
+       frame was decoded elsewhere, or when too few buffers would remain queued */
+    int holdFrame(const unsigned char *data, size_t size);
+    /* Give back a buffer obtained with holdFrame(). Thread-safe. */
+    int releaseFrame(unsigned int index, char *errmsg);
+    /* Export a buffer as a DMABUF file descriptor with VIDIOC_EXPBUF. The descriptor is owned by V4L2_Base and
+       closed when the buffers are released. Returns -1 if the device does not support exporting. */
+    int exportFrame(unsigned int index, char *errmsg);
+
     //void setDropFrameCount(unsigned int count) { dropFrameCount = count;}
     void enumerate_ctrl();
     void enumerate_menu();
@@ -131,6 +158,8 @@ class V4L2_Base
 
     void setColorProcessing(bool quantization, bool colorconvert, bool linearization);
 
+    void setEdgeAwareDemosaic(bool edgeAware);
+
     void setlxstate(short s)
     {
         IDLog("setlexstate to %d\n", s);
@@ -196,6 +225,11 @@ class V4L2_Base
     int fd;
     struct buffer *buffers;
     unsigned int n_buffers;
+    unsigned int requested_buffers;
+    int current_index;
+    unsigned int held_buffers;
+    std::mutex bufferLock;
+    std::condition_variable bufferReleased;
     bool reallocate_buffers;
     //int		dropFrame;
     //bool      dropFrameEnabled;
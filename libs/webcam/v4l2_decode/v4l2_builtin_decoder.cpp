@@ -72,6 +72,7 @@ V4L2_Builtin_Decoder::V4L2_Builtin_Decoder()
     useSoftCrop    = false;
     doCrop         = false;
     doQuantization = false;
+    doEdgeAwareDemosaic = false;
     YBuf           = nullptr;
     UBuf           = nullptr;
     VBuf           = nullptr;
@@ -79,6 +80,8 @@ V4L2_Builtin_Decoder::V4L2_Builtin_Decoder()
     yuyvBuffer     = nullptr;
     colorBuffer    = nullptr;
     rgb24_buffer   = nullptr;
+    yuyvFrame      = nullptr;
+    rgbFrame       = nullptr;
     linearBuffer   = nullptr;
     //cropbuf = nullptr;
     for (i = 0; i < 32; i++)
@@ -125,6 +128,12 @@ void V4L2_Builtin_Decoder::decode(unsigned char *frame, struct v4l2_buffer *buf)
     //LOG_INFO("Calling builtin decoder decode");
 //IDLog("Decoding buffer at %lx, len %d, bytesused %d, bytesperline %d, sequence %d, flag %x, field %x, use soft crop %c, do crop %c\n", frame, buf->length, buf->bytesused, fmt.fmt.pix.bytesperline, buf->sequence, buf->flags, buf->field, (useSoftCrop?'y':'n'), (doCrop?'y':'n'));
 
+    // Uncropped packed frames are referenced in place, see the zero-copy note in V4L2_Decoder::decode
+    if (yuvBuffer)
+        YBuf = yuvBuffer;
+    yuyvFrame = yuyvBuffer;
+    rgbFrame  = rgb24_buffer;
+
     switch (fmt.fmt.pix.pixelformat)
     {
         case V4L2_PIX_FMT_GREY:
@@ -142,7 +151,7 @@ void V4L2_Builtin_Decoder::decode(unsigned char *frame, struct v4l2_buffer *buf)
             }
             else
             {
-                memcpy(YBuf, frame, bufwidth * bufheight);
+                YBuf = frame;
             }
             break;
 
@@ -161,7 +170,7 @@ void V4L2_Builtin_Decoder::decode(unsigned char *frame, struct v4l2_buffer *buf)
             }
             else
             {
-                memcpy(yuyvBuffer, frame, 2 * bufwidth * bufheight);
+                yuyvFrame = frame;
             }
             break;
 
@@ -314,7 +323,7 @@ void V4L2_Builtin_Decoder::decode(unsigned char *frame, struct v4l2_buffer *buf)
             }
             else
             {
-                memcpy(yuyvBuffer, frame, 2 * bufwidth * bufheight);
+                yuyvFrame = frame;
             }
             break;
 
@@ -388,6 +397,11 @@ void V4L2_Builtin_Decoder::decode(unsigned char *frame, struct v4l2_buffer *buf)
             {
                 src = frame;
             }
+            if (src == frame && fmt.fmt.pix.bytesperline == 3 * bufwidth)
+            {
+                rgbFrame = frame;
+                break;
+            }
             for (unsigned int i = 0; i < bufheight; i++)
             {
                 memcpy(dest, src, 3 * bufwidth);
@@ -453,14 +467,26 @@ void V4L2_Builtin_Decoder::decode(unsigned char *frame, struct v4l2_buffer *buf)
         break;
 
         case V4L2_PIX_FMT_SBGGR8:
-            bayer2rgb24(rgb24_buffer, frame, fmt.fmt.pix.width, fmt.fmt.pix.height);
+            if (doEdgeAwareDemosaic)
+                ccvt_bayer8_rgb24(fmt.fmt.pix.width, fmt.fmt.pix.height, frame, rgb24_buffer, CCVT_BAYER_BGGR,
+                                  CCVT_DEMOSAIC_EDGE_AWARE);
+            else
+                bayer2rgb24(rgb24_buffer, frame, fmt.fmt.pix.width, fmt.fmt.pix.height);
             break;
 
         case V4L2_PIX_FMT_SRGGB8:
-            bayer_rggb_2rgb24(rgb24_buffer, frame, fmt.fmt.pix.width, fmt.fmt.pix.height);
+            if (doEdgeAwareDemosaic)
+                ccvt_bayer8_rgb24(fmt.fmt.pix.width, fmt.fmt.pix.height, frame, rgb24_buffer, CCVT_BAYER_RGGB,
+                                  CCVT_DEMOSAIC_EDGE_AWARE);
+            else
+                bayer_rggb_2rgb24(rgb24_buffer, frame, fmt.fmt.pix.width, fmt.fmt.pix.height);
             break;
 	case V4L2_PIX_FMT_SGRBG8:
-		bayer_grbg_to_rgb24(rgb24_buffer, frame, fmt.fmt.pix.width, fmt.fmt.pix.height);
+		if (doEdgeAwareDemosaic)
+			ccvt_bayer8_rgb24(fmt.fmt.pix.width, fmt.fmt.pix.height, frame, rgb24_buffer, CCVT_BAYER_GRBG,
+			                  CCVT_DEMOSAIC_EDGE_AWARE);
+		else
+			bayer_grbg_to_rgb24(rgb24_buffer, frame, fmt.fmt.pix.width, fmt.fmt.pix.height);
 		break;
         case V4L2_PIX_FMT_SBGGR16:
             bayer16_2_rgb24((unsigned short *)rgb24_buffer, (unsigned short *)frame, fmt.fmt.pix.width,
@@ -549,6 +575,10 @@ void V4L2_Builtin_Decoder::setLinearization(bool dolinearization)
     else
         bpp = 8;
 }
+void V4L2_Builtin_Decoder::setEdgeAwareDemosaic(bool doedgeaware)
+{
+    doEdgeAwareDemosaic = doedgeaware;
+}
 void V4L2_Builtin_Decoder::allocBuffers()
 {
     YBuf = nullptr;
@@ -620,6 +650,8 @@ void V4L2_Builtin_Decoder::allocBuffers()
             VBuf      = UBuf + ((bufwidth * bufheight) / 4);
             break;
     }
+    yuyvFrame = yuyvBuffer;
+    rgbFrame  = rgb24_buffer;
     IDLog("Decoder allocBuffers cropping %s\n", (doCrop ? "true" : "false"));
 }
 
@@ -654,14 +686,14 @@ void V4L2_Builtin_Decoder::makeY()
         case V4L2_PIX_FMT_SBGGR8:
         case V4L2_PIX_FMT_SRGGB8:
 	case V4L2_PIX_FMT_SGRBG8:
-            RGB2YUV(bufwidth, bufheight, rgb24_buffer, YBuf, UBuf, VBuf, 0);
+            RGB2YUV(bufwidth, bufheight, rgbFrame, YBuf, UBuf, VBuf, 0);
             break;
         case V4L2_PIX_FMT_YUYV:
         case V4L2_PIX_FMT_UYVY:
         case V4L2_PIX_FMT_VYUY:
         case V4L2_PIX_FMT_YVYU:
             // todo handcopy only Ybuf using an int, byfwidth should be even
-            ccvt_yuyv_420p(bufwidth, bufheight, yuyvBuffer, YBuf, UBuf, VBuf);
+            ccvt_yuyv_420p(bufwidth, bufheight, yuyvFrame, YBuf, UBuf, VBuf);
             break;
     }
 }
@@ -669,7 +701,7 @@ void V4L2_Builtin_Decoder::makeY()
 unsigned char *V4L2_Builtin_Decoder::getY()
 {
     if (fmt.fmt.pix.pixelformat == V4L2_PIX_FMT_Y16)
-        return yuyvBuffer;
+        return yuyvFrame;
     makeY();
     if (doQuantization && getQuantization(&fmt) == QUANTIZATION_LIM_RANGE)
         rangeY8(YBuf, (bufwidth * bufheight));
@@ -807,6 +839,9 @@ unsigned char *V4L2_Builtin_Decoder::getRGBBuffer()
         case V4L2_PIX_FMT_YVU420:
         case V4L2_PIX_FMT_NV12:
         case V4L2_PIX_FMT_NV21:
+            // A referenced GREY frame has no chroma planes next to it
+            if (YBuf != yuvBuffer)
+                memcpy(yuvBuffer, YBuf, bufwidth * bufheight);
             ccvt_420p_rgb24(bufwidth, bufheight, (void *)yuvBuffer, (void *)rgb24_buffer);
             break;
         case V4L2_PIX_FMT_YUYV:
@@ -816,7 +851,7 @@ unsigned char *V4L2_Builtin_Decoder::getRGBBuffer()
             //if (!colorBuffer) colorBuffer = new unsigned char[(bufwidth * bufheight) * 4];
             //ccvt_yuyv_bgr32(bufwidth, bufheight, yuyvBuffer, rgb24_buffer);
             //ccvt_bgr32_rgb24(bufwidth, bufheight, colorBuffer, (void*)rgb24_buffer);
-            ccvt_yuyv_rgb24(bufwidth, bufheight, yuyvBuffer, (void *)rgb24_buffer);
+            ccvt_yuyv_rgb24(bufwidth, bufheight, yuyvFrame, (void *)rgb24_buffer);
             break;
         case V4L2_PIX_FMT_RGB24:
         case V4L2_PIX_FMT_RGB555:
@@ -825,7 +860,7 @@ unsigned char *V4L2_Builtin_Decoder::getRGBBuffer()
         case V4L2_PIX_FMT_SRGGB8:
 	case V4L2_PIX_FMT_SGRBG8:
         case V4L2_PIX_FMT_SBGGR16:
-            break;
+            return rgbFrame ? rgbFrame : rgb24_buffer;
         default:
             ccvt_420p_rgb24(bufwidth, bufheight, (void *)yuvBuffer, (void *)rgb24_buffer);
             break;
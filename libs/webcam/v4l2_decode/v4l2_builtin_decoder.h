@@ -56,6 +56,7 @@ class V4L2_Builtin_Decoder : public V4L2_Decoder
     virtual int getBpp();
     virtual void setQuantization(bool);
     virtual void setLinearization(bool);
+    virtual void setEdgeAwareDemosaic(bool);
 
   protected:
     void init_supported_formats();
@@ -71,6 +72,7 @@ class V4L2_Builtin_Decoder : public V4L2_Decoder
     bool doCrop;      // do software cropping when decoding frames
     bool doQuantization;
     bool doLinearization;
+    bool doEdgeAwareDemosaic;
 
     unsigned char *YBuf;
     unsigned char *UBuf;
@@ -79,6 +81,9 @@ class V4L2_Builtin_Decoder : public V4L2_Decoder
     unsigned char *yuyvBuffer;
     unsigned char *colorBuffer;
     unsigned char *rgb24_buffer;
+    // Packed YUYV/Y16 and RGB24 images of the last frame: either the buffers above or the frame itself
+    unsigned char *yuyvFrame;
+    unsigned char *rgbFrame;
     float *linearBuffer;
     //unsigned char *cropbuf;
     unsigned int bufwidth;
@@ -36,6 +36,10 @@ const char *V4L2_Decoder::getName()
     return name;
 }
 
+void V4L2_Decoder::setEdgeAwareDemosaic(bool)
+{
+}
+
 V4L2_Decode::V4L2_Decode()
 {
     decoder_list.push_back(new V4L2_Builtin_Decoder());
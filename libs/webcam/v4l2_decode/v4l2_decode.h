@@ -45,6 +45,8 @@ class V4L2_Decoder
     virtual void setformat(struct v4l2_format f, bool use_ext_pix_format) = 0;
     virtual bool issupportedformat(unsigned int format)                   = 0;
     virtual const std::vector<unsigned int> &getsupportedformats()        = 0;
+    /* The frame stays dequeued, and valid, until the frame callback returns or the consumer releases it:
+       decoders may reference it instead of copying it */
     virtual void decode(unsigned char *frame, struct v4l2_buffer *buf)    = 0;
     virtual unsigned char *getY()                                         = 0;
     virtual unsigned char *getU()                                         = 0;
@@ -55,6 +57,8 @@ class V4L2_Decoder
     virtual int getBpp()                  = 0;
     virtual void setQuantization(bool)    = 0;
     virtual void setLinearization(bool)   = 0;
+    /* Interpolate green along edges when converting Bayer frames to RGB, decoders without the method ignore it */
+    virtual void setEdgeAwareDemosaic(bool);
 
   protected:
     const char *name;
@@ -0,0 +1,120 @@
+/*******************************************************************************
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+ .
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+ .
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+// Dome slaving benchmark.
+//
+//   bench_dome [evaluations]
+//
+// Times Dome::GetTargetAz() for a mount that moves on every call, so each evaluation solves the mount position,
+// and for a mount that stays put as between two snooped updates, where the cached solution is reused. The
+// horizontal conversion through libnova that the slaving code used before is timed alone for comparison.
+// initProperties() prints its snoop requests on stdout first.
+
+#include "indidome.h"
+
+#include <libnova/julian_day.h>
+#include <libnova/transform.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+namespace
+{
+
+class BenchDome : public INDI::Dome
+{
+    public:
+        BenchDome()
+        {
+            initProperties();
+
+            DomeMeasurementsN[DM_DOME_RADIUS].value        = 2.5;
+            DomeMeasurementsN[DM_SHUTTER_WIDTH].value      = 0.9;
+            DomeMeasurementsN[DM_NORTH_DISPLACEMENT].value = 0.1;
+            DomeMeasurementsN[DM_EAST_DISPLACEMENT].value  = -0.2;
+            DomeMeasurementsN[DM_UP_DISPLACEMENT].value    = 0.3;
+            DomeMeasurementsN[DM_OTA_OFFSET].value         = 0.4;
+
+            observer.lat = 41.6;
+            observer.lng = 357.2;
+            HaveLatLong  = true;
+            HaveRaDec    = true;
+        }
+
+        // Evaluations per second, moving the mount by step hours of RA between evaluations
+        double targetAz(long count, double step, double &checksum)
+        {
+            double az, alt, minAz, maxAz;
+
+            mountEquatorialCoords.ra  = 0;
+            mountEquatorialCoords.dec = 35;
+
+            auto start = std::chrono::steady_clock::now();
+            for (long i = 0; i < count; i++)
+            {
+                mountEquatorialCoords.ra = fmod(mountEquatorialCoords.ra + step, 24);
+                if (GetTargetAz(az, alt, minAz, maxAz))
+                    checksum += az;
+            }
+            return count / std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        }
+
+    protected:
+        const char *getDefaultName() override
+        {
+            return "Bench Dome";
+        }
+};
+
+// Evaluations per second of the libnova conversion alone
+double libnovaHorizontal(long count, double &checksum)
+{
+    struct ln_equ_posn equ = { 0, 35 };
+    struct ln_lnlat_posn observer = { 357.2, 41.6 };
+    struct ln_hrz_posn hrz;
+    double JD = ln_get_julian_from_sys();
+
+    auto start = std::chrono::steady_clock::now();
+    for (long i = 0; i < count; i++)
+    {
+        equ.ra = fmod(equ.ra + 0.01 * 15, 360);
+        ln_get_hrz_from_equ(&equ, &observer, JD, &hrz);
+        checksum += hrz.az;
+    }
+    return count / std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    long count      = argc > 1 ? atol(argv[1]) : 1000000;
+    double checksum = 0;
+    BenchDome dome;
+
+    double moving  = dome.targetAz(count, 0.01, checksum);
+    double still   = dome.targetAz(count, 0, checksum);
+    double libnova = libnovaHorizontal(count, checksum);
+
+    printf("%ld evaluations (checksum %g)\n", count, checksum);
+    printf("%-28s %12.0f eval/s\n", "GetTargetAz, mount moving", moving);
+    printf("%-28s %12.0f eval/s\n", "GetTargetAz, mount still", still);
+    printf("%-28s %12.0f eval/s\n", "ln_get_hrz_from_equ", libnova);
+
+    return 0;
+}
@@ -0,0 +1,99 @@
+/*******************************************************************************
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+ .
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+ .
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+// Driver message throughput.
+//
+//   bench_drivermessages [messages] > /dev/null
+//
+// Times IDSetNumber() of a four element vector, as a mount or focuser publishes it, and IDSetSwitch(), from one
+// thread and from four threads at once. Messages go to stdout, which should be /dev/null or a pipe nobody
+// holds up; the results go to stderr.
+
+#include "indidevapi.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+void sendNumbers(long count)
+{
+    INumber numbers[4];
+    INumberVectorProperty vector;
+
+    IUFillNumber(&numbers[0], "RA", "RA (hh:mm:ss)", "%010.6m", 0, 24, 0, 0);
+    IUFillNumber(&numbers[1], "DEC", "DEC (dd:mm:ss)", "%010.6m", -90, 90, 0, 0);
+    IUFillNumber(&numbers[2], "ALT", "Alt", "%g", -90, 90, 0, 0);
+    IUFillNumber(&numbers[3], "AZ", "Az", "%g", 0, 360, 0, 0);
+    IUFillNumberVector(&vector, numbers, 4, "Telescope Simulator", "EQUATORIAL_EOD_COORD", "Eq. Coordinates",
+                       "Main Control", IP_RW, 60, IPS_BUSY);
+
+    for (long i = 0; i < count; i++)
+    {
+        numbers[0].value = 5.5 + i * 1e-6;
+        numbers[1].value = -12.25 - i * 1e-7;
+        numbers[2].value = 45.123456789;
+        numbers[3].value = 180 + i * 1e-5;
+        IDSetNumber(&vector, nullptr);
+    }
+}
+
+void sendSwitches(long count)
+{
+    ISwitch switches[2];
+    ISwitchVectorProperty vector;
+
+    IUFillSwitch(&switches[0], "TRACK_ON", "On", ISS_ON);
+    IUFillSwitch(&switches[1], "TRACK_OFF", "Off", ISS_OFF);
+    IUFillSwitchVector(&vector, switches, 2, "Telescope Simulator", "TELESCOPE_TRACK_STATE", "Tracking",
+                       "Main Control", IP_RW, ISR_1OFMANY, 60, IPS_OK);
+
+    for (long i = 0; i < count; i++)
+        IDSetSwitch(&vector, nullptr);
+}
+
+// Messages per second sending count messages from each of threads threads
+double rate(void (*send)(long), long count, int threads)
+{
+    std::vector<std::thread> senders;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < threads; i++)
+        senders.emplace_back(send, count);
+    for (auto &sender : senders)
+        sender.join();
+
+    return count * threads / std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    long count = argc > 1 ? atol(argv[1]) : 200000;
+
+    fprintf(stderr, "%ld messages per thread\n", count);
+    fprintf(stderr, "%-28s %12.0f msg/s\n", "IDSetNumber, 1 thread", rate(sendNumbers, count, 1));
+    fprintf(stderr, "%-28s %12.0f msg/s\n", "IDSetNumber, 4 threads", rate(sendNumbers, count, 4));
+    fprintf(stderr, "%-28s %12.0f msg/s\n", "IDSetSwitch, 1 thread", rate(sendSwitches, count, 1));
+    fprintf(stderr, "%-28s %12.0f msg/s\n", "IDSetSwitch, 4 threads", rate(sendSwitches, count, 4));
+
+    return 0;
+}
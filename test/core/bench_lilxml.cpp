@@ -0,0 +1,200 @@
+/*******************************************************************************
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+ .
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+ .
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+// Parser benchmark over captured INDI traffic.
+//
+//   bench_lilxml [capture.xml] [repeat]
+//
+// Replays the capture through parseXMLChunk() in the chunk sizes used by indiserver and the clients, and one
+// char at a time through readXMLEle() as the drivers do, and prints the parsed messages as indiserver does.
+// The same then for a synthetic setBLOBVector of a few MB.
+
+#include "lilxml.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifndef INDI_TRAFFIC_CAPTURE
+#define INDI_TRAFFIC_CAPTURE "indi_traffic.xml"
+#endif
+
+namespace
+{
+
+struct Result
+{
+    double seconds;
+    long messages;
+};
+
+Result parseChunks(const std::string &traffic, int repeat, size_t chunk)
+{
+    std::string buffer(traffic);
+    char errmsg[1024];
+    LilXML *lp    = newLilXML();
+    long messages = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < repeat; r++)
+    {
+        for (size_t offset = 0; offset < buffer.size(); offset += chunk)
+        {
+            size_t size    = std::min(chunk, buffer.size() - offset);
+            XMLEle **nodes = parseXMLChunk(lp, &buffer[offset], size, errmsg);
+            for (int i = 0; nodes[i]; i++, messages++)
+                delXMLEle(nodes[i]);
+            free(nodes);
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    delLilXML(lp);
+    return { std::chrono::duration<double>(end - start).count(), messages };
+}
+
+Result parseChars(const std::string &traffic, int repeat)
+{
+    char errmsg[1024];
+    LilXML *lp    = newLilXML();
+    long messages = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < repeat; r++)
+    {
+        for (char c : traffic)
+        {
+            XMLEle *root = readXMLEle(lp, c, errmsg);
+            if (root)
+            {
+                delXMLEle(root);
+                messages++;
+            }
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    delLilXML(lp);
+    return { std::chrono::duration<double>(end - start).count(), messages };
+}
+
+// Prints the messages of traffic the way indiserver queues them, sized then printed, or in one pass
+Result printMessages(const std::string &traffic, int repeat, bool onePass)
+{
+    std::vector<XMLEle *> roots;
+    std::string buffer(traffic);
+    char errmsg[1024];
+    char shortmsg[2048];
+    LilXML *lp     = newLilXML();
+    XMLEle **nodes = parseXMLChunk(lp, &buffer[0], buffer.size(), errmsg);
+
+    for (int i = 0; nodes[i]; i++)
+        roots.push_back(nodes[i]);
+    free(nodes);
+    delLilXML(lp);
+
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < repeat; r++)
+    {
+        for (XMLEle *root : roots)
+        {
+            int len;
+            char *s;
+
+            if (onePass)
+                s = sprmXMLEle(root, 0, shortmsg, sizeof(shortmsg), &len);
+            else
+            {
+                len = sprlXMLEle(root, 0);
+                s   = len < int(sizeof(shortmsg)) ? shortmsg : static_cast<char *>(malloc(len + 1));
+                sprXMLEle(s, root, 0);
+            }
+            if (s != shortmsg)
+                free(s);
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    for (XMLEle *root : roots)
+        delXMLEle(root);
+    return { std::chrono::duration<double>(end - start).count(), long(roots.size()) * repeat };
+}
+
+std::string blobMessage(size_t size)
+{
+    static const char base64[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string message = "<setBLOBVector device='CCD Simulator' name='CCD1' state='Ok' timeout='60'>\n"
+                          "  <oneBLOB name='CCD1' size='" + std::to_string(size * 3 / 4) + "' format='.fits'>\n";
+    uint32_t seed       = 1;
+
+    message.reserve(message.size() + size + size / 72 + 64);
+    for (size_t i = 0; i < size; i++)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        message += base64[seed >> 26];
+        if (i % 72 == 71)
+            message += '\n';
+    }
+    message += "\n  </oneBLOB>\n</setBLOBVector>\n";
+    return message;
+}
+
+void report(const char *what, const std::string &traffic, int repeat, const Result &result)
+{
+    double mb = traffic.size() * double(repeat) / (1024 * 1024);
+    printf("%-28s %9.1f MB/s %12.0f msg/s\n", what, mb / result.seconds, result.messages / result.seconds);
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    const char *capture = argc > 1 ? argv[1] : INDI_TRAFFIC_CAPTURE;
+    int repeat          = argc > 2 ? atoi(argv[2]) : 200;
+
+    std::ifstream in(capture, std::ios::binary);
+    if (!in)
+    {
+        fprintf(stderr, "Cannot read %s\n", capture);
+        return 1;
+    }
+    std::stringstream ss;
+    ss << in.rdbuf();
+    std::string traffic = ss.str();
+
+    printf("%s: %zu bytes x %d\n", capture, traffic.size(), repeat);
+    report("parseXMLChunk 49152", traffic, repeat, parseChunks(traffic, repeat, 49152));
+    report("parseXMLChunk 4096", traffic, repeat, parseChunks(traffic, repeat, 4096));
+    report("parseXMLChunk 256", traffic, repeat, parseChunks(traffic, repeat, 256));
+    report("readXMLEle", traffic, repeat, parseChars(traffic, repeat));
+    report("sprlXMLEle + sprXMLEle", traffic, repeat, printMessages(traffic, repeat, false));
+    report("sprmXMLEle", traffic, repeat, printMessages(traffic, repeat, true));
+
+    std::string blob = blobMessage(8 * 1024 * 1024);
+    int blobRepeat   = std::max(1, repeat / 20);
+    printf("setBLOBVector: %zu bytes x %d\n", blob.size(), blobRepeat);
+    report("parseXMLChunk 49152", blob, blobRepeat, parseChunks(blob, blobRepeat, 49152));
+    report("readXMLEle", blob, blobRepeat, parseChars(blob, blobRepeat));
+    report("sprlXMLEle + sprXMLEle", blob, blobRepeat, printMessages(blob, blobRepeat, false));
+    report("sprmXMLEle", blob, blobRepeat, printMessages(blob, blobRepeat, true));
+
+    return 0;
+}
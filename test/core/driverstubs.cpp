@@ -0,0 +1,56 @@
+/*******************************************************************************
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+ .
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+ .
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+// Linked into tests and benchmarks that use indidriver.c (messages, the event loop) with their own main(). It
+// provides what indidrivermain.c would, so that the driver main() is not pulled from the library, and the driver
+// entry points indidriver.c dispatches to, which are unused.
+
+#include "indidevapi.h"
+#include "indidriver.h"
+
+ROSC *propCache;
+int nPropCache;
+int verbose;
+char *me;
+LilXML *clixml;
+
+extern "C" {
+
+void ISGetProperties(const char *)
+{
+}
+
+void ISNewSwitch(const char *, const char *, ISState *, char **, int)
+{
+}
+
+void ISNewText(const char *, const char *, char **, char **, int)
+{
+}
+
+void ISNewNumber(const char *, const char *, double *, char **, int)
+{
+}
+
+void ISNewBLOB(const char *, const char *, int *, int *, char **, char **, char **, int)
+{
+}
+
+void ISSnoopDevice(XMLEle *)
+{
+}
+
+}
@@ -0,0 +1,91 @@
+/*******************************************************************************
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+ .
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+ .
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+// Helpers for tests of code delivering results on the driver main loop. The tests run the loop with
+// IEDeferLoop() until Outcome::done is set.
+
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <thread>
+
+#include "indidevapi.h"
+
+namespace EventLoopTest
+{
+
+// What a callback got, when and on which thread
+template <typename Result>
+struct Outcome
+{
+    int done { 0 };
+    Result result;
+    std::chrono::steady_clock::time_point at;
+    std::thread::id thread;
+};
+
+// Callback filling outcome
+template <typename Result>
+std::function<void(const Result &)> recorder(Outcome<Result> &outcome)
+{
+    return [&outcome](const Result & result)
+    {
+        outcome.result = result;
+        outcome.at     = std::chrono::steady_clock::now();
+        outcome.thread = std::this_thread::get_id();
+        outcome.done++;
+    };
+}
+
+inline double since(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Main loop timer firing every 20 ms for as long as it exists, to tell whether the loop kept running
+class Ticker
+{
+    public:
+        Ticker()
+        {
+            timer = IEAddTimer(INTERVAL, tick, this);
+        }
+
+        ~Ticker()
+        {
+            IERmTimer(timer);
+        }
+
+        Ticker(const Ticker &) = delete;
+        Ticker &operator=(const Ticker &) = delete;
+
+        int ticks { 0 };
+
+    private:
+        static constexpr int INTERVAL = 20;
+
+        static void tick(void *userpointer)
+        {
+            Ticker *ticker = static_cast<Ticker *>(userpointer);
+            ticker->ticks++;
+            ticker->timer = IEAddTimer(INTERVAL, tick, ticker);
+        }
+
+        int timer { -1 };
+};
+
+}
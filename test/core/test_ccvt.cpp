@@ -0,0 +1,246 @@
+/*******************************************************************************
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+ .
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+ .
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "ccvt.h"
+
+// The golden hashes were taken from the scalar conversions before they were vectorised.
+
+namespace
+{
+
+uint64_t fnv1a(const void *data, size_t size)
+{
+    const uint8_t *bytes = static_cast<const uint8_t *>(data);
+    uint64_t hash        = 1469598103934665603ULL;
+
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+// Gradient with inverted blocks and some noise, so every interpolation direction gets exercised
+void fill(uint8_t *data, size_t size, int width, uint32_t seed)
+{
+    uint32_t state = seed;
+
+    for (size_t i = 0; i < size; i++)
+    {
+        state = state * 1664525u + 1013904223u;
+
+        int x     = i % width;
+        int y     = i / width;
+        int value = (x * 3 + y * 2) & 255;
+        if ((x / 7 + y / 5) % 3 == 0)
+            value = 255 - value;
+        value += static_cast<int>((state >> 24) & 31) - 16;
+
+        data[i] = value < 0 ? 0 : (value > 255 ? 255 : value);
+    }
+}
+
+struct Golden
+{
+    int width;
+    int height;
+    uint64_t bggr, rggb, grbg, bggr16;
+    uint64_t yuyvRGB24, yuyvBGR24, yuyvBGR32;
+    uint64_t yuyv420pY, yuyv420pU, yuyv420pV;
+    uint64_t i420RGB24, i420BGR24, i420RGB32, i420BGR32;
+};
+
+const Golden goldens[] =
+{
+    {
+        64, 48,
+        0x8bf101d08de56e41ULL, 0xa17493ace1c6fe7dULL, 0xb9af8a1ebe2b3f77ULL, 0x9e2e561f488155f4ULL,
+        0x8319835265553780ULL, 0x81be94d1662c503cULL, 0x9ecd1d34e5c07932ULL,
+        0xb0c75cb255fabb15ULL, 0xb6da14d48d68a038ULL, 0xa595da20ab37d311ULL,
+        0x19c61563f8d48dddULL, 0x4dc5a42775717eb9ULL, 0x00f0c9e4e777c9d7ULL, 0xef45f5d41913ed0bULL
+    },
+    {
+        640, 480,
+        0xe8e1231c85cf9c2fULL, 0xe4b046761425d1f7ULL, 0x439d940f6e31811aULL, 0x2ef6b093db345878ULL,
+        0x24fcfbbbaa70fe02ULL, 0xb2e85db1935a3ed2ULL, 0x7d0811525d06fd3eULL,
+        0xd56014193ce4eaf6ULL, 0x1bd50fd812270ae3ULL, 0x8a61acef247d585fULL,
+        0xb8fdf309e7b9b50fULL, 0x290dfb1334297397ULL, 0xadac7a4c3906989bULL, 0x5987fe721c2a676bULL
+    }
+};
+
+class CCVTGolden : public ::testing::TestWithParam<Golden>
+{
+    protected:
+        void SetUp() override
+        {
+            golden = GetParam();
+            pixels = static_cast<size_t>(golden.width) * golden.height;
+
+            // The legacy bayer functions read one row and pixel past the image on its borders
+            padded.resize(pixels + 2 * golden.width + 64);
+            fill(padded.data(), padded.size(), golden.width, 7);
+
+            output.assign(pixels * 4, 0);
+        }
+
+        const uint8_t *bayer() const
+        {
+            return padded.data() + golden.width + 32;
+        }
+
+        uint64_t hash(size_t bytesPerPixel) const
+        {
+            return fnv1a(output.data(), pixels * bytesPerPixel);
+        }
+
+        Golden golden;
+        size_t pixels;
+        std::vector<uint8_t> padded;
+        std::vector<uint8_t> output;
+};
+
+TEST_P(CCVTGolden, Bayer8)
+{
+    uint8_t *src = const_cast<uint8_t *>(bayer());
+
+    bayer2rgb24(output.data(), src, golden.width, golden.height);
+    EXPECT_EQ(golden.bggr, hash(3));
+
+    output.assign(output.size(), 0);
+    bayer_rggb_2rgb24(output.data(), src, golden.width, golden.height);
+    EXPECT_EQ(golden.rggb, hash(3));
+
+    output.assign(output.size(), 0);
+    bayer_grbg_to_rgb24(output.data(), src, golden.width, golden.height);
+    EXPECT_EQ(golden.grbg, hash(3));
+}
+
+TEST_P(CCVTGolden, Bayer16)
+{
+    std::vector<uint16_t> src(padded.size()), dst(pixels * 3, 0);
+
+    for (size_t i = 0; i < src.size(); i++)
+        src[i] = (padded[i] * 257u) ^ (i & 15);
+
+    bayer16_2_rgb24(dst.data(), src.data() + golden.width + 32, golden.width, golden.height);
+    EXPECT_EQ(golden.bggr16, fnv1a(dst.data(), pixels * 6));
+}
+
+TEST_P(CCVTGolden, YUYV)
+{
+    std::vector<uint8_t> yuyv(pixels * 2);
+    fill(yuyv.data(), yuyv.size(), golden.width * 2, 11);
+
+    ccvt_yuyv_rgb24(golden.width, golden.height, yuyv.data(), output.data());
+    EXPECT_EQ(golden.yuyvRGB24, hash(3));
+
+    output.assign(output.size(), 0);
+    ccvt_yuyv_bgr24(golden.width, golden.height, yuyv.data(), output.data());
+    EXPECT_EQ(golden.yuyvBGR24, hash(3));
+
+    output.assign(output.size(), 0);
+    ccvt_yuyv_bgr32(golden.width, golden.height, yuyv.data(), output.data());
+    EXPECT_EQ(golden.yuyvBGR32, hash(4));
+
+    std::vector<uint8_t> y(pixels), u(pixels / 4), v(pixels / 4);
+    ccvt_yuyv_420p(golden.width, golden.height, yuyv.data(), y.data(), u.data(), v.data());
+    EXPECT_EQ(golden.yuyv420pY, fnv1a(y.data(), y.size()));
+    EXPECT_EQ(golden.yuyv420pU, fnv1a(u.data(), u.size()));
+    EXPECT_EQ(golden.yuyv420pV, fnv1a(v.data(), v.size()));
+}
+
+TEST_P(CCVTGolden, YUV420P)
+{
+    std::vector<uint8_t> i420(pixels * 3 / 2);
+    fill(i420.data(), i420.size(), golden.width, 13);
+
+    ccvt_420p_rgb24(golden.width, golden.height, i420.data(), output.data());
+    EXPECT_EQ(golden.i420RGB24, hash(3));
+
+    output.assign(output.size(), 0);
+    ccvt_420p_bgr24(golden.width, golden.height, i420.data(), output.data());
+    EXPECT_EQ(golden.i420BGR24, hash(3));
+
+    output.assign(output.size(), 0);
+    ccvt_420p_rgb32(golden.width, golden.height, i420.data(), output.data());
+    EXPECT_EQ(golden.i420RGB32, hash(4));
+
+    output.assign(output.size(), 0);
+    ccvt_420p_bgr32(golden.width, golden.height, i420.data(), output.data());
+    EXPECT_EQ(golden.i420BGR32, hash(4));
+}
+
+INSTANTIATE_TEST_CASE_P(CORE_CCVT, CCVTGolden, ::testing::ValuesIn(goldens));
+
+TEST(CORE_CCVT, BilinearMatchesLegacyInterior)
+{
+    const int width = 96, height = 64;
+    std::vector<uint8_t> padded(width * height + 2 * width + 64);
+    fill(padded.data(), padded.size(), width, 3);
+    uint8_t *src = padded.data() + width + 32;
+
+    std::vector<uint8_t> legacy(width * height * 3), generic(width * height * 3);
+    bayer2rgb24(legacy.data(), src, width, height);
+    ccvt_bayer8_rgb24(width, height, src, generic.data(), CCVT_BAYER_BGGR, CCVT_DEMOSAIC_BILINEAR);
+
+    for (int y = 1; y < height - 1; y++)
+        ASSERT_EQ(0, memcmp(legacy.data() + (y * width + 1) * 3, generic.data() + (y * width + 1) * 3,
+                            (width - 2) * 3)) << "row " << y;
+}
+
+TEST(CORE_CCVT, EdgeAwareKeepsFlatImage)
+{
+    // Odd sizes take the border code path on the last row and column too
+    const int width = 37, height = 23;
+    const ccvt_bayer_pattern patterns[] = { CCVT_BAYER_BGGR, CCVT_BAYER_RGGB, CCVT_BAYER_GRBG, CCVT_BAYER_GBRG };
+    std::vector<uint8_t> src(width * height, 100), dst(width * height * 3);
+
+    for (ccvt_bayer_pattern pattern : patterns)
+    {
+        dst.assign(dst.size(), 0);
+        ccvt_bayer8_rgb24(width, height, src.data(), dst.data(), pattern, CCVT_DEMOSAIC_EDGE_AWARE);
+        for (size_t i = 0; i < dst.size(); i++)
+            ASSERT_EQ(100, dst[i]) << "pattern " << pattern << " byte " << i;
+    }
+}
+
+TEST(CORE_CCVT, EdgeAwareFollowsEdges)
+{
+    // Vertical edge: left half dark, right half bright. Green at red and blue sites must not blur across it.
+    const int width = 32, height = 16;
+    std::vector<uint8_t> src(width * height), bilinear(width * height * 3), edge(width * height * 3);
+
+    for (int y = 0; y < height; y++)
+        for (int x = 0; x < width; x++)
+            src[y * width + x] = x < width / 2 ? 20 : 220;
+
+    ccvt_bayer8_rgb24(width, height, src.data(), bilinear.data(), CCVT_BAYER_RGGB, CCVT_DEMOSAIC_BILINEAR);
+    ccvt_bayer8_rgb24(width, height, src.data(), edge.data(), CCVT_BAYER_RGGB, CCVT_DEMOSAIC_EDGE_AWARE);
+
+    // Column width / 2 is the first bright one, row 2 is an RG row so even columns are red sites
+    int red = (2 * width + width / 2) * 3;
+    EXPECT_EQ(220, edge[red + 1]);
+    EXPECT_LT(bilinear[red + 1], 220);
+}
+
+}
@@ -0,0 +1,174 @@
+/*******************************************************************************
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+ .
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+ .
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+// Numbers in driver messages must read exactly like printf("%.<prec>g") in the C locale. Timeouts are sent with 6
+// significant digits and values with 20.
+
+#include <gtest/gtest.h>
+
+#include <cfloat>
+#include <clocale>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "indidevapi.h"
+
+namespace
+{
+
+std::string printfG(double value, int prec)
+{
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%.*g", prec, value);
+    return buf;
+}
+
+// Send values with IDSetNumber(), each once as the timeout and once as a number, and return what went out as
+// pairs of (timeout, value).
+std::vector<std::pair<std::string, std::string>> sendNumbers(const std::vector<double> &values)
+{
+    char path[] = "/tmp/test_drivernumberXXXXXX";
+    int fd      = mkstemp(path);
+    unlink(path);
+
+    fflush(stdout);
+    int saved = dup(1);
+    dup2(fd, 1);
+
+    INumber number;
+    INumberVectorProperty vector;
+    IUFillNumber(&number, "N", "N", "%g", 0, 0, 0, 0);
+    IUFillNumberVector(&vector, &number, 1, "Device", "VECTOR", "Vector", "Main", IP_RO, 0, IPS_OK);
+    for (double value : values)
+    {
+        vector.timeout = value;
+        number.value   = value;
+        IDSetNumber(&vector, nullptr);
+    }
+
+    dup2(saved, 1);
+    close(saved);
+
+    std::string output;
+    char buf[65536];
+    ssize_t n;
+    lseek(fd, 0, SEEK_SET);
+    while ((n = read(fd, buf, sizeof(buf))) > 0)
+        output.append(buf, n);
+    close(fd);
+
+    std::vector<std::pair<std::string, std::string>> sent;
+    size_t at = 0;
+    while ((at = output.find("timeout='", at)) != std::string::npos)
+    {
+        at += strlen("timeout='");
+        std::string timeout = output.substr(at, output.find('\'', at) - at);
+
+        at = output.find("<oneNumber name='N'>\n      ", at) + strlen("<oneNumber name='N'>\n      ");
+        sent.emplace_back(timeout, output.substr(at, output.find('\n', at) - at));
+    }
+    return sent;
+}
+
+void expectLikePrintf(const std::vector<double> &values)
+{
+    auto sent = sendNumbers(values);
+    ASSERT_EQ(sent.size(), values.size());
+
+    for (size_t i = 0; i < values.size(); i++)
+    {
+        EXPECT_EQ(sent[i].first, printfG(values[i], 6)) << "timeout " << printfG(values[i], 20);
+        EXPECT_EQ(sent[i].second, printfG(values[i], 20)) << "value " << printfG(values[i], 20);
+    }
+}
+
+}
+
+TEST(CORE_DRIVERNUMBER, Test_EdgeValues)
+{
+    const double inf = std::numeric_limits<double>::infinity();
+
+    expectLikePrintf(
+    {
+        0.0, -0.0, 1.0, -1.0, 10.0, 0.1, -0.1, 1e-4, 9.99999e-5, 1e-5, 123456, 1234567, -1234567,
+        1e20, 1e21, 1e22, 1e-20, 1e308, -1e308, 1e-308, -1e-308, DBL_MAX, -DBL_MAX, DBL_MIN,
+        std::numeric_limits<double>::denorm_min(), std::ldexp(1.0, 63), std::ldexp(1.0, 64), std::ldexp(1.0, -1014),
+        4503599627370496.5,
+        inf, -inf, std::nan("")
+    });
+}
+
+TEST(CORE_DRIVERNUMBER, Test_RoundingBoundaries)
+{
+    // Ties and near ties at the sixth digit, which printf() rounds to even on the exact binary value
+    expectLikePrintf(
+    {
+        0.5, 1.5, 2.5, 1234565, 1234575, 123456.5, 123457.5, 999999.5, 9999995, 0.1234565, 0.0000012345675,
+        2.5e-5, 9.999995, 9.9999949999, 99999.95, 999999.4999, 0.999999500000001, std::nextafter(0.9999995, 1.0),
+        std::nextafter(0.9999995, 0.0), 5e-324, 0.30000000000000004, 2.0 / 3.0, -2.0 / 3.0, 1e23, 8.5e-5
+    });
+}
+
+TEST(CORE_DRIVERNUMBER, Test_RandomValues)
+{
+    std::mt19937_64 generator(32);
+    std::uniform_real_distribution<double> mantissa(-10, 10);
+    std::uniform_int_distribution<int> exponent(-40, 40);
+
+    std::vector<double> values;
+    for (int i = 0; i < 20000; i++)
+        values.push_back(mantissa(generator) * std::pow(10.0, exponent(generator)));
+
+    // Any bit pattern, whatever the magnitude
+    for (int i = 0; i < 20000; i++)
+    {
+        uint64_t bits = generator();
+        double value;
+        memcpy(&value, &bits, sizeof(value));
+        values.push_back(value);
+    }
+
+    expectLikePrintf(values);
+}
+
+TEST(CORE_DRIVERNUMBER, Test_DecimalPointInOtherLocales)
+{
+    const char *locales[] = { "de_DE.UTF-8", "fr_FR.UTF-8", "de_DE", "C.UTF-8" };
+    const char *set       = nullptr;
+    for (const char *name : locales)
+    {
+        if ((set = setlocale(LC_NUMERIC, name)) != nullptr)
+            break;
+    }
+    if (set == nullptr)
+        return;
+
+    auto sent = sendNumbers({ 1.5, 1e300 * 1e10, 0.25, 1e-310 });
+    setlocale(LC_NUMERIC, "C");
+
+    ASSERT_EQ(sent.size(), 4u);
+    EXPECT_EQ(sent[0].second, "1.5");
+    EXPECT_EQ(sent[1].second, "inf");
+    EXPECT_EQ(sent[2].second, "0.25");
+    EXPECT_EQ(sent[3].second, printfG(1e-310, 20));
+}
@@ -0,0 +1,248 @@
+/*******************************************************************************
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+ .
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+ .
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "eventlooptest.h"
+#include "indihttpfetcher.h"
+
+using INDI::HTTPFetcher;
+
+namespace
+{
+
+// Stand-in for a weather service on 127.0.0.1, one thread per connection, keep-alive.
+//   /data     200 with a small JSON document
+//   /missing  404
+//   /slow     answers after two seconds
+class StandInServer
+{
+    public:
+        StandInServer()
+        {
+            struct sockaddr_in addr {};
+            socklen_t len = sizeof(addr);
+            int on        = 1;
+
+            listenFD = socket(AF_INET, SOCK_STREAM, 0);
+            setsockopt(listenFD, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+            addr.sin_family      = AF_INET;
+            addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            bind(listenFD, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr));
+            listen(listenFD, 8);
+            getsockname(listenFD, reinterpret_cast<struct sockaddr *>(&addr), &len);
+            port = ntohs(addr.sin_port);
+
+            acceptor = std::thread(&StandInServer::acceptConnections, this);
+        }
+
+        ~StandInServer()
+        {
+            stop = true;
+            acceptor.join();
+            for (auto &connection : connections)
+                connection.join();
+            close(listenFD);
+        }
+
+        std::string url(const char *path) const
+        {
+            return "http://127.0.0.1:" + std::to_string(port) + path;
+        }
+
+        static const char *document()
+        {
+            return "{\"main\":{\"temp\":12.5,\"humidity\":60}}";
+        }
+
+        std::atomic<int> accepted { 0 };
+
+    private:
+        bool readable(int fd)
+        {
+            struct pollfd pfd = { fd, POLLIN, 0 };
+            return poll(&pfd, 1, 50) > 0;
+        }
+
+        void acceptConnections()
+        {
+            while (!stop)
+            {
+                if (!readable(listenFD))
+                    continue;
+
+                int fd = accept(listenFD, nullptr, nullptr);
+                if (fd < 0)
+                    continue;
+
+                accepted++;
+                connections.emplace_back(&StandInServer::serve, this, fd);
+            }
+        }
+
+        void serve(int fd)
+        {
+            std::string request;
+            char buf[1024];
+
+            while (!stop)
+            {
+                if (!readable(fd))
+                    continue;
+
+                ssize_t n = read(fd, buf, sizeof(buf));
+                if (n <= 0)
+                    break;
+                request.append(buf, n);
+
+                size_t end = request.find("\r\n\r\n");
+                if (end == std::string::npos)
+                    continue;
+
+                std::string line = request.substr(0, request.find("\r\n"));
+                request.erase(0, end + 4);
+
+                std::string status = "200 OK", body = document();
+                if (line.find(" /missing ") != std::string::npos)
+                {
+                    status = "404 Not Found";
+                    body   = "{\"error\":\"not found\"}";
+                }
+                else if (line.find(" /slow ") != std::string::npos)
+                {
+                    for (int i = 0; i < 40 && !stop; i++)
+                        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+                }
+
+                std::string response = "HTTP/1.1 " + status + "\r\nContent-Type: application/json\r\nContent-Length: " +
+                                       std::to_string(body.size()) + "\r\n\r\n" + body;
+                if (write(fd, response.data(), response.size()) < 0)
+                    break;
+            }
+
+            close(fd);
+        }
+
+        int listenFD { -1 };
+        int port { 0 };
+        std::atomic<bool> stop { false };
+        std::thread acceptor;
+        std::vector<std::thread> connections;
+};
+
+typedef EventLoopTest::Outcome<HTTPFetcher::Result> Outcome;
+
+int fetch(const std::string &url, Outcome &outcome, long timeout = HTTPFetcher::DEFAULT_TIMEOUT)
+{
+    return HTTPFetcher::instance().fetch(url, EventLoopTest::recorder(outcome), timeout);
+}
+
+}
+
+TEST(CORE_HTTPFETCHER, Test_ResultOnMainLoop)
+{
+    StandInServer server;
+    Outcome outcome;
+
+    fetch(server.url("/data"), outcome);
+    // Nothing is delivered outside of the main loop
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    EXPECT_EQ(0, outcome.done);
+
+    ASSERT_EQ(0, IEDeferLoop(5000, &outcome.done));
+    EXPECT_TRUE(outcome.result.ok);
+    EXPECT_EQ(200, outcome.result.status);
+    EXPECT_EQ(StandInServer::document(), outcome.result.body);
+    EXPECT_EQ(std::this_thread::get_id(), outcome.thread);
+
+    // HTTP errors are for the caller to judge
+    Outcome missing;
+    fetch(server.url("/missing"), missing);
+    ASSERT_EQ(0, IEDeferLoop(5000, &missing.done));
+    EXPECT_TRUE(missing.result.ok);
+    EXPECT_EQ(404, missing.result.status);
+}
+
+TEST(CORE_HTTPFETCHER, Test_ConnectionReuse)
+{
+    StandInServer server;
+
+    for (int i = 0; i < 5; i++)
+    {
+        Outcome outcome;
+        fetch(server.url("/data"), outcome);
+        ASSERT_EQ(0, IEDeferLoop(5000, &outcome.done));
+        EXPECT_TRUE(outcome.result.ok);
+    }
+
+    HTTPFetcher::Result result = HTTPFetcher::instance().fetchNow(server.url("/data"));
+    EXPECT_TRUE(result.ok);
+    EXPECT_EQ(StandInServer::document(), result.body);
+
+    EXPECT_EQ(1, server.accepted.load());
+}
+
+TEST(CORE_HTTPFETCHER, Test_TimeoutKeepsLoopRunning)
+{
+    StandInServer server;
+    Outcome outcome;
+    EventLoopTest::Ticker ticker;
+
+    auto start = std::chrono::steady_clock::now();
+    fetch(server.url("/slow"), outcome, 300);
+
+    ASSERT_EQ(0, IEDeferLoop(5000, &outcome.done));
+    EXPECT_FALSE(outcome.result.ok);
+    EXPECT_NE("", outcome.result.error);
+    EXPECT_LT(EventLoopTest::since(start), 1.5);
+    // Timers kept firing while the service did not answer
+    EXPECT_GE(ticker.ticks, 5);
+}
+
+TEST(CORE_HTTPFETCHER, Test_Cancel)
+{
+    StandInServer server;
+    Outcome cancelled, waiting, other;
+
+    // While running, and once finished but not delivered yet
+    int id = fetch(server.url("/slow"), cancelled, 500);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    HTTPFetcher::instance().cancel(id);
+
+    id = fetch(server.url("/data"), waiting);
+    fetch(server.url("/data"), other);
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    HTTPFetcher::instance().cancel(id);
+
+    ASSERT_EQ(0, IEDeferLoop(5000, &other.done));
+    int never = 0;
+    IEDeferLoop(800, &never);
+
+    EXPECT_EQ(0, cancelled.done);
+    EXPECT_EQ(0, waiting.done);
+    EXPECT_EQ(1, other.done);
+}
@@ -0,0 +1,724 @@
+/*******************************************************************************
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+ .
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+ .
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace
+{
+
+// Scratch directory for driver scripts and payloads, removed with everything in it
+class Scratch
+{
+    public:
+        Scratch()
+        {
+            char dir[] = "/tmp/test_indiserverXXXXXX";
+            if (mkdtemp(dir) != nullptr)
+                directory = dir;
+        }
+
+        ~Scratch()
+        {
+            for (const std::string &name : files)
+                unlink(name.c_str());
+            rmdir(directory.c_str());
+        }
+
+        // Write a file, executable if a script, return its path
+        std::string write(const std::string &name, const std::string &content, bool executable = false)
+        {
+            std::string path = directory + "/" + name;
+            FILE *fp         = fopen(path.c_str(), "w");
+            if (fp == nullptr)
+                return path;
+            fwrite(content.data(), 1, content.size(), fp);
+            fclose(fp);
+            chmod(path.c_str(), executable ? 0700 : 0600);
+            files.push_back(path);
+            return path;
+        }
+
+        // Driver defining one text property of device on each getProperties
+        std::string textDriver(const std::string &device)
+        {
+            return write(device + ".sh",
+                         "#!/bin/sh\n"
+                         "while read -r line; do\n"
+                         "    case \"$line\" in *getProperties*)\n"
+                         "        echo \"<defTextVector device='" + device + "' name='INFO' label='Info' group='Main' "
+                         "state='Idle' perm='ro' timeout='0'><defText name='NAME' label='Name'>" + device +
+                         "</defText></defTextVector>\";;\n"
+                         "    esac\n"
+                         "done\n", true);
+        }
+
+        // Driver defining device and, once the file go exists, writing each of chunks with a pause in between so
+        // the server reads them apart
+        std::string chunkedDriver(const std::string &device, const std::vector<std::string> &chunks)
+        {
+            char name[32];
+            for (size_t i = 0; i < chunks.size(); i++)
+            {
+                snprintf(name, sizeof(name), "chunk%04zu", i);
+                write(name, chunks[i]);
+            }
+
+            return write(device + ".sh",
+                         "#!/bin/sh\n"
+                         "echo \"<defBLOBVector device='" + device + "' name='IMAGE' label='Image' group='Main' "
+                         "state='Idle' perm='ro' timeout='0'><defBLOB name='IMAGE' label='Image'/></defBLOBVector>\"\n"
+                         "while [ ! -e " + directory + "/go ]; do sleep 0.05; done\n"
+                         "for chunk in " + directory + "/chunk*; do cat \"$chunk\"; sleep 0.02; done\n"
+                         "cat > /dev/null\n", true);
+        }
+
+        std::string directory;
+
+    private:
+        std::vector<std::string> files;
+};
+
+// indiserver running drivers, started from a fifo, reading its -vv log. Port 0 picks a free port, kept across
+// stop() and start(). The Unix-domain socket is in a directory of its own unless given.
+class Server
+{
+    public:
+        explicit Server(const std::vector<std::string> &drivers = {}, int port = 0, const std::string &socketPath = "")
+            : port(port), socketPath(socketPath), drivers(drivers)
+        {
+            char dir[] = "/tmp/test_indiserverXXXXXX";
+            if (mkdtemp(dir) == nullptr)
+                return;
+            directory = dir;
+            fifo      = directory + "/fifo";
+            mkfifo(fifo.c_str(), 0600);
+            if (this->socketPath.empty())
+                this->socketPath = directory + "/indi.sock";
+
+            if (this->port == 0)
+                this->port = freePort();
+            start();
+        }
+
+        ~Server()
+        {
+            stop();
+            unlink(fifo.c_str());
+            if (socketPath == directory + "/indi.sock")
+                unlink(socketPath.c_str());
+            rmdir(directory.c_str());
+        }
+
+        void start()
+        {
+            std::string portArg = std::to_string(port);
+            std::vector<const char *> args = { "indiserver", "-vv", "-p", portArg.c_str(), "-f", fifo.c_str(),
+                                               "-u", socketPath.c_str()
+                                             };
+            for (const std::string &driver : drivers)
+                args.push_back(driver.c_str());
+            args.push_back(nullptr);
+
+            int err[2];
+            if (pipe(err) < 0)
+                return;
+
+            pid = fork();
+            if (pid == 0)
+            {
+                dup2(err[1], 2);
+                close(err[0]);
+                close(err[1]);
+                execv(INDISERVER_PATH, const_cast<char *const *>(args.data()));
+                _exit(127);
+            }
+            close(err[1]);
+            log = err[0];
+            pending.clear();
+        }
+
+        // Kill the server, as if it crashed
+        void stop()
+        {
+            if (pid > 0)
+            {
+                kill(pid, SIGKILL);
+                waitpid(pid, nullptr, 0);
+                pid = -1;
+            }
+            if (log >= 0)
+            {
+                close(log);
+                log = -1;
+            }
+        }
+
+        int connectClient() const
+        {
+            // The server may still be starting
+            for (int attempt = 0; attempt < 50; attempt++)
+            {
+                struct sockaddr_in addr {};
+                addr.sin_family      = AF_INET;
+                addr.sin_port        = htons(port);
+                addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+                int fd = socket(AF_INET, SOCK_STREAM, 0);
+                if (connect(fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) == 0)
+                    return fd;
+                close(fd);
+                usleep(100000);
+            }
+            return -1;
+        }
+
+        // Client on the Unix-domain socket, -1 if none listens there
+        int connectLocalClient() const
+        {
+            struct sockaddr_un addr {};
+            addr.sun_family = AF_UNIX;
+            strncpy(addr.sun_path, socketPath.c_str(), sizeof(addr.sun_path) - 1);
+
+            int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+            if (connect(fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) == 0)
+                return fd;
+            close(fd);
+            return -1;
+        }
+
+        // Send a driver start or stop command
+        bool command(const std::string &line)
+        {
+            // The server may not read the fifo yet
+            int fd = -1;
+            for (int attempt = 0; attempt < 50 && fd < 0; attempt++)
+            {
+                if ((fd = open(fifo.c_str(), O_WRONLY | O_NONBLOCK)) < 0)
+                    usleep(100000);
+            }
+            if (fd < 0)
+                return false;
+            bool sent = ::write(fd, (line + "\n").data(), line.size() + 1) == static_cast<ssize_t>(line.size() + 1);
+            close(fd);
+            return sent;
+        }
+
+        // Wait for the next line of the log containing text, return it or "" on timeout
+        std::string waitFor(const std::string &text, int timeout = 5000)
+        {
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
+
+            for (;;)
+            {
+                size_t nl;
+                while ((nl = pending.find('\n')) != std::string::npos)
+                {
+                    std::string line = pending.substr(0, nl);
+                    pending.erase(0, nl + 1);
+                    if (line.find(text) != std::string::npos)
+                        return line;
+                }
+
+                int left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline -
+                           std::chrono::steady_clock::now()).count();
+                struct pollfd pfd = { log, POLLIN, 0 };
+                if (left <= 0 || poll(&pfd, 1, left) <= 0)
+                    return "";
+
+                char buf[4096];
+                ssize_t n = read(log, buf, sizeof(buf));
+                if (n <= 0)
+                    return "";
+                pending.append(buf, n);
+            }
+        }
+
+        // Routes in use reported after the next client shut down, -1 if none
+        int routesAfterShutdown()
+        {
+            std::string line = waitFor(" routes in use");
+            if (line.empty())
+                return -1;
+
+            size_t end   = line.rfind(" routes in use");
+            size_t start = line.rfind(' ', end - 1);
+            return atoi(line.c_str() + start + 1);
+        }
+
+        // Number of lines of the log containing text until it is quiet for timeout ms
+        int count(const std::string &text, int timeout = 500)
+        {
+            int n = 0;
+            while (!waitFor(text, timeout).empty())
+                n++;
+            return n;
+        }
+
+        int port { 0 };
+        std::string socketPath;
+
+    private:
+        static int freePort()
+        {
+            struct sockaddr_in addr {};
+            socklen_t len = sizeof(addr);
+
+            int fd = socket(AF_INET, SOCK_STREAM, 0);
+            addr.sin_family      = AF_INET;
+            addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            bind(fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr));
+            getsockname(fd, reinterpret_cast<struct sockaddr *>(&addr), &len);
+            close(fd);
+            return ntohs(addr.sin_port);
+        }
+
+        std::vector<std::string> drivers;
+        std::string directory, fifo, pending;
+        pid_t pid { -1 };
+        int log { -1 };
+};
+
+bool sendAll(int fd, const std::string &text)
+{
+    return send(fd, text.data(), text.size(), MSG_NOSIGNAL) == static_cast<ssize_t>(text.size());
+}
+
+// getProperties for properties of devices nobody serves, each gets a route
+std::string subscriptions(int first, int count)
+{
+    std::string xml;
+    char buf[128];
+
+    for (int i = first; i < first + count; i++)
+    {
+        snprintf(buf, sizeof(buf), "<getProperties version='1.7' device='Device %d' name='PROP_%d'/>\n", i % 7, i);
+        xml += buf;
+    }
+    return xml;
+}
+
+// Everything fd receives until it is quiet for timeout ms, and the descriptors passed along
+std::string receive(int fd, std::vector<int> &fds, int timeout = 1000)
+{
+    std::string received;
+    char buf[65536];
+    char cbuf[CMSG_SPACE(4 * sizeof(int))];
+    struct pollfd pfd = { fd, POLLIN, 0 };
+
+    while (poll(&pfd, 1, timeout) > 0)
+    {
+        struct iovec iov = { buf, sizeof(buf) };
+        struct msghdr msg {};
+        msg.msg_iov        = &iov;
+        msg.msg_iovlen     = 1;
+        msg.msg_control    = cbuf;
+        msg.msg_controllen = sizeof(cbuf);
+
+        ssize_t n = recvmsg(fd, &msg, 0);
+        if (n <= 0)
+            break;
+        received.append(buf, n);
+
+        for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg))
+        {
+            size_t count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+            for (size_t i = 0; i < count; i++)
+            {
+                int passed;
+                memcpy(&passed, CMSG_DATA(cmsg) + i * sizeof(int), sizeof(int));
+                fds.push_back(passed);
+            }
+        }
+    }
+    return received;
+}
+
+std::string receive(int fd, int timeout = 1000)
+{
+    std::vector<int> fds;
+    std::string received = receive(fd, fds, timeout);
+    for (int passed : fds)
+        close(passed);
+    return received;
+}
+
+// Raw BLOB messages of device with payloads, each followed by a message "after <i>", cut in the header, around
+// the payload, in each end tag inside it and in the message after it
+std::vector<std::string> rawBlobChunks(const std::string &device, const std::vector<std::string> &payloads)
+{
+    const std::string end = "</setBLOBVector>";
+    std::string stream;
+    std::vector<size_t> cuts;
+
+    for (size_t i = 0; i < payloads.size(); i++)
+    {
+        size_t start = stream.size();
+        stream += "<setBLOBVector device='" + device + "' name='IMAGE' state='Ok'>\n  <oneBLOB name='IMAGE' size='" +
+                  std::to_string(payloads[i].size()) + "' enclen='" + std::to_string(payloads[i].size()) +
+                  "' format='.fits' encoding='raw'/>\n" + end;
+        size_t payload = stream.size();
+        stream += payloads[i] + "\n<message device='" + device + "' message='after " + std::to_string(i) + "'/>\n";
+
+        size_t last = payload + payloads[i].size();
+        for (size_t cut : { start + 5, payload - 3, payload + 1, last - 7, last + 20 })
+            cuts.push_back(cut);
+        for (size_t at = payloads[i].find(end); at != std::string::npos; at = payloads[i].find(end, at + 1))
+            cuts.push_back(payload + at + 6);
+    }
+    std::sort(cuts.begin(), cuts.end());
+
+    std::vector<std::string> chunks;
+    size_t from = 0;
+    for (size_t cut : cuts)
+    {
+        chunks.push_back(stream.substr(from, cut - from));
+        from = cut;
+    }
+    chunks.push_back(stream.substr(from));
+    return chunks;
+}
+
+// Occurrences of text in received
+int occurrences(const std::string &received, const std::string &text)
+{
+    int n = 0;
+    for (size_t at = received.find(text); at != std::string::npos; at = received.find(text, at + text.size()))
+        n++;
+    return n;
+}
+
+std::string decode64(const std::string &text)
+{
+    static const std::string alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string decoded;
+    unsigned int bits = 0;
+    int nbits         = 0;
+
+    for (char c : text)
+    {
+        size_t value = alphabet.find(c);
+        if (value == std::string::npos)
+            continue;
+        bits = (bits << 6) | value;
+        nbits += 6;
+        if (nbits >= 8)
+        {
+            nbits -= 8;
+            decoded += static_cast<char>((bits >> nbits) & 0xff);
+        }
+    }
+    return decoded;
+}
+
+// Value of attribute name in the element starting at start
+std::string attribute(const std::string &received, size_t start, const std::string &name)
+{
+    size_t at = received.find(" " + name + "=\"", start);
+    if (at == std::string::npos)
+        return "";
+    at += name.size() + 3;
+    return received.substr(at, received.find('"', at) - at);
+}
+
+// BLOB payloads in received, raw or in base64, and the text around them
+struct Blobs
+{
+    std::vector<std::string> payloads, encodings;
+    std::string text;
+};
+
+Blobs parseBlobs(const std::string &received)
+{
+    const std::string end = "</setBLOBVector>";
+    Blobs blobs;
+    size_t at = 0, start;
+
+    while ((start = received.find("<setBLOBVector", at)) != std::string::npos)
+    {
+        blobs.text += received.substr(at, start - at);
+        size_t blob = received.find("<oneBLOB", start);
+        size_t stop = received.find(end, start);
+        if (blob == std::string::npos || stop == std::string::npos)
+            break;
+        stop += end.size();
+
+        std::string encoding = attribute(received, blob, "encoding");
+        size_t enclen        = atol(attribute(received, blob, "enclen").c_str());
+        blobs.encodings.push_back(encoding);
+        if (encoding == "raw")
+        {
+            // The payload follows the message
+            blobs.payloads.push_back(received.substr(stop, enclen));
+            at = stop + enclen;
+        }
+        else
+        {
+            size_t content = received.find('>', blob) + 1;
+            size_t length  = received.find("</oneBLOB>", content) - content;
+            blobs.payloads.push_back(decode64(received.substr(content, length)));
+            at = stop;
+        }
+    }
+    blobs.text += received.substr(at);
+    return blobs;
+}
+
+}
+
+TEST(CORE_INDISERVER, Test_RoutesFreedOnDisconnect)
+{
+    Server server;
+
+    // Initial size, reported when a client without subscriptions leaves
+    int fd = server.connectClient();
+    ASSERT_GE(fd, 0);
+    close(fd);
+    int initial = server.routesAfterShutdown();
+    ASSERT_GE(initial, 0);
+
+    // Routes stay while one of their clients is connected
+    int keeper = server.connectClient();
+    ASSERT_GE(keeper, 0);
+    ASSERT_TRUE(sendAll(keeper, subscriptions(0, 50)));
+    ASSERT_FALSE(server.waitFor("name='PROP_49'").empty());
+
+    for (int round = 0; round < 20; round++)
+    {
+        fd = server.connectClient();
+        ASSERT_GE(fd, 0);
+        // The first round shares some routes with the keeper
+        ASSERT_TRUE(sendAll(fd, subscriptions(25 + round * 100, 100)));
+        close(fd);
+        EXPECT_EQ(initial + 50, server.routesAfterShutdown());
+    }
+
+    close(keeper);
+    EXPECT_EQ(initial, server.routesAfterShutdown());
+}
+
+TEST(CORE_INDISERVER, Test_ChainedServerLink)
+{
+    Scratch scratch;
+    Server chained({ scratch.textDriver("LinkA"), scratch.textDriver("LinkB") });
+    ASSERT_FALSE(chained.waitFor("listening to port").empty());
+
+    // Both remote devices share one connection, made once the chained server is up
+    std::string at = "@localhost:" + std::to_string(chained.port);
+    Server server({ "LinkA" + at, "LinkB" + at });
+    ASSERT_FALSE(server.waitFor("connected socket").empty());
+    EXPECT_EQ(1, chained.count("new arrival"));
+
+    int fd = server.connectClient();
+    ASSERT_GE(fd, 0);
+    ASSERT_TRUE(sendAll(fd, "<getProperties version='1.7'/>\n"));
+    std::string received = receive(fd);
+    EXPECT_EQ(1, occurrences(received, "<defTextVector device=\"LinkA\""));
+    EXPECT_EQ(1, occurrences(received, "<defTextVector device=\"LinkB\""));
+
+    // Clients hear the devices are gone when the link drops
+    chained.stop();
+    ASSERT_FALSE(server.waitFor("reconnecting in 1 s").empty());
+    received = receive(fd);
+    EXPECT_EQ(1, occurrences(received, "<delProperty device=\"LinkA\""));
+    EXPECT_EQ(1, occurrences(received, "<delProperty device=\"LinkB\""));
+
+    // And see them again once it is back
+    chained.start();
+    ASSERT_FALSE(chained.waitFor("listening to port").empty());
+    ASSERT_FALSE(server.waitFor("connected socket", 10000).empty());
+    EXPECT_EQ(1, chained.count("new arrival"));
+    received = receive(fd);
+    EXPECT_EQ(1, occurrences(received, "<defTextVector device=\"LinkA\""));
+    EXPECT_EQ(1, occurrences(received, "<defTextVector device=\"LinkB\""));
+
+    close(fd);
+}
+
+TEST(CORE_INDISERVER, Test_RawBlobFraming)
+{
+    // Payloads looking like the end of their message, split across reads anywhere
+    const std::string end = "</setBLOBVector>";
+    std::vector<std::string> payloads = { end, "", std::string(70001, '\0') + end };
+    for (int i = 0; i < 1000; i++)
+        for (int c = 0; c < 256; c++)
+            payloads[1] += static_cast<char>(c);
+    payloads[1].insert(1234, end + "\n<message device='Raw' message='inside'/>\n");
+
+    Scratch scratch;
+    Server server({ scratch.chunkedDriver("Raw", rawBlobChunks("Raw", payloads)) });
+
+    // One client takes BLOBs raw, the other in base64
+    int raw    = server.connectClient();
+    int base64 = server.connectClient();
+    ASSERT_GE(raw, 0);
+    ASSERT_GE(base64, 0);
+    ASSERT_TRUE(sendAll(raw, "<getProperties version='1.7' device='Raw'/>\n"
+                        "<enableBLOB device='Raw' encoding='raw'>Also</enableBLOB>\n"));
+    ASSERT_TRUE(sendAll(base64, "<getProperties version='1.7' device='Raw'/>\n"
+                        "<enableBLOB device='Raw'>Also</enableBLOB>\n"));
+    ASSERT_FALSE(server.waitFor("read <enableBLOB").empty());
+    ASSERT_FALSE(server.waitFor("read <enableBLOB").empty());
+    scratch.write("go", "");
+
+    for (int fd : { raw, base64 })
+    {
+        Blobs blobs = parseBlobs(receive(fd));
+
+        SCOPED_TRACE(fd == raw ? "raw client" : "base64 client");
+        ASSERT_EQ(payloads.size(), blobs.payloads.size());
+        for (size_t i = 0; i < payloads.size(); i++)
+        {
+            EXPECT_EQ(fd == raw ? "raw" : "", blobs.encodings[i]);
+            EXPECT_TRUE(payloads[i] == blobs.payloads[i]) << "payload " << i;
+        }
+
+        // Messages after each BLOB parsed as such, nothing out of the payloads
+        EXPECT_EQ(std::string::npos, blobs.text.find("inside"));
+        size_t after0 = blobs.text.find("message=\"after 0\"");
+        size_t after1 = blobs.text.find("message=\"after 1\"");
+        size_t after2 = blobs.text.find("message=\"after 2\"");
+        EXPECT_NE(std::string::npos, after0);
+        EXPECT_LT(after0, after1);
+        EXPECT_LT(after1, after2);
+        EXPECT_NE(std::string::npos, after2);
+    }
+
+    close(raw);
+    close(base64);
+}
+
+TEST(CORE_INDISERVER, Test_SharedMemoryBlobs)
+{
+    std::vector<std::string> payloads = { std::string(100000, '\0'), "</setBLOBVector>" };
+    for (size_t i = 0; i < payloads[0].size(); i++)
+        payloads[0][i] = static_cast<char>(i * 7);
+
+    Scratch scratch;
+    Server server({ scratch.chunkedDriver("Shm", rawBlobChunks("Shm", payloads)) });
+    ASSERT_FALSE(server.waitFor("listening to " + server.socketPath).empty());
+
+    int fd = server.connectLocalClient();
+    ASSERT_GE(fd, 0);
+    ASSERT_TRUE(sendAll(fd, "<getProperties version='1.7' device='Shm'/>\n"
+                        "<enableBLOB device='Shm' encoding='shm'>Also</enableBLOB>\n"));
+    ASSERT_FALSE(server.waitFor("read <enableBLOB").empty());
+    scratch.write("go", "");
+
+    std::vector<int> fds;
+    std::string received = receive(fd, fds);
+    close(fd);
+
+    // One segment per message, the payload at the offset given
+    size_t at = 0;
+    for (size_t i = 0; i < payloads.size(); i++)
+    {
+        SCOPED_TRACE("payload " + std::to_string(i));
+        at = received.find("<oneBLOB", at);
+        ASSERT_NE(std::string::npos, at);
+        ASSERT_EQ("shm", attribute(received, at, "encoding"));
+        ASSERT_LT(i, fds.size());
+        size_t offset = atol(attribute(received, at, "offset").c_str());
+        size_t enclen = atol(attribute(received, at, "enclen").c_str());
+        EXPECT_EQ(payloads[i].size(), enclen);
+
+        struct stat st;
+        ASSERT_EQ(0, fstat(fds[i], &st));
+        ASSERT_LE(offset + enclen, static_cast<size_t>(st.st_size));
+        void *segment = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fds[i], 0);
+        ASSERT_NE(MAP_FAILED, segment);
+        EXPECT_TRUE(payloads[i] == std::string(static_cast<const char *>(segment) + offset, enclen));
+        munmap(segment, st.st_size);
+
+        // Nobody may change what the other clients read
+        segment = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fds[i], 0);
+        EXPECT_EQ(MAP_FAILED, segment);
+        if (segment != MAP_FAILED)
+            munmap(segment, st.st_size);
+        at++;
+    }
+    EXPECT_EQ(payloads.size(), fds.size());
+    for (int passed : fds)
+        close(passed);
+
+    EXPECT_NE(std::string::npos, received.find("message=\"after 0\""));
+    EXPECT_NE(std::string::npos, received.find("message=\"after 1\""));
+}
+
+TEST(CORE_INDISERVER, Test_UnixSocketPath)
+{
+    Scratch scratch;
+
+    // Anything but a socket stays as it is
+    std::string path = scratch.write("file", "keep");
+    {
+        Server server({}, 0, path);
+        EXPECT_FALSE(server.waitFor("is not a socket").empty());
+    }
+    struct stat st;
+    ASSERT_EQ(0, lstat(path.c_str(), &st));
+    EXPECT_TRUE(S_ISREG(st.st_mode));
+
+    // A socket in use too
+    path = scratch.directory + "/indi.sock";
+    Server first({}, 0, path);
+    ASSERT_FALSE(first.waitFor("listening to " + path).empty());
+    {
+        Server second({}, 0, path);
+        EXPECT_FALSE(second.waitFor("is in use").empty());
+    }
+    int fd = first.connectLocalClient();
+    EXPECT_GE(fd, 0);
+    close(fd);
+
+    // A server leaves the socket of the one that replaced its own
+    unlink(path.c_str());
+    Server third({}, 0, path);
+    ASSERT_FALSE(third.waitFor("listening to " + path).empty());
+    ASSERT_TRUE(first.command("start Bad@"));
+    ASSERT_FALSE(first.waitFor("good bye").empty());
+    fd = third.connectLocalClient();
+    EXPECT_GE(fd, 0);
+    close(fd);
+
+    // A stale socket is replaced, and removed on the way out
+    third.stop();
+    ASSERT_EQ(0, lstat(path.c_str(), &st));
+    Server fourth({}, 0, path);
+    ASSERT_FALSE(fourth.waitFor("listening to " + path).empty());
+    ASSERT_TRUE(fourth.command("start Bad@"));
+    ASSERT_FALSE(fourth.waitFor("good bye").empty());
+    EXPECT_NE(0, lstat(path.c_str(), &st));
+}
@@ -0,0 +1,285 @@
+/*******************************************************************************
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+ .
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+ .
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "lilxml.h"
+
+#ifndef INDI_TRAFFIC_CAPTURE
+#define INDI_TRAFFIC_CAPTURE "indi_traffic.xml"
+#endif
+
+namespace
+{
+
+std::string print(XMLEle *ep)
+{
+    std::string s(sprlXMLEle(ep, 0), '\0');
+    sprXMLEle(&s[0], ep, 0);
+    return s;
+}
+
+// Parses text in chunks of the given size, returns the printed messages
+std::vector<std::string> parseChunks(const std::string &text, size_t chunk, std::string &error)
+{
+    std::vector<std::string> messages;
+    std::string buffer(text);
+    char errmsg[1024];
+    LilXML *lp = newLilXML();
+
+    error.clear();
+    for (size_t offset = 0; offset < buffer.size(); offset += chunk)
+    {
+        size_t size    = std::min(chunk, buffer.size() - offset);
+        XMLEle **nodes = parseXMLChunk(lp, &buffer[offset], size, errmsg);
+        for (int i = 0; nodes[i]; i++)
+        {
+            messages.push_back(print(nodes[i]));
+            delXMLEle(nodes[i]);
+        }
+        free(nodes);
+        if (errmsg[0])
+            error = errmsg;
+    }
+
+    delLilXML(lp);
+    return messages;
+}
+
+std::vector<std::string> parseChars(const std::string &text, std::string &error)
+{
+    std::vector<std::string> messages;
+    char errmsg[1024];
+    LilXML *lp = newLilXML();
+
+    error.clear();
+    for (char c : text)
+    {
+        XMLEle *root = readXMLEle(lp, c, errmsg);
+        if (root)
+        {
+            messages.push_back(print(root));
+            delXMLEle(root);
+        }
+        else if (errmsg[0])
+            error = errmsg;
+    }
+
+    delLilXML(lp);
+    return messages;
+}
+
+XMLEle *parseOne(const std::string &text)
+{
+    std::string buffer(text);
+    char errmsg[1024];
+    LilXML *lp     = newLilXML();
+    XMLEle **nodes = parseXMLChunk(lp, &buffer[0], buffer.size(), errmsg);
+    XMLEle *root   = nodes[0];
+
+    for (int i = 1; nodes[i]; i++)
+        delXMLEle(nodes[i]);
+    free(nodes);
+    delLilXML(lp);
+    return root;
+}
+
+}
+
+TEST(CORE_LILXML, Test_ChunkSizesAgree)
+{
+    std::ifstream in(INDI_TRAFFIC_CAPTURE, std::ios::binary);
+    ASSERT_TRUE(in.good());
+    std::stringstream ss;
+    ss << in.rdbuf();
+    std::string traffic = ss.str();
+
+    std::string error;
+    std::vector<std::string> expected = parseChars(traffic, error);
+    ASSERT_EQ("", error);
+    ASSERT_GT(expected.size(), 10u);
+
+    for (size_t chunk : { size_t(1), size_t(7), size_t(256), size_t(4096), traffic.size() })
+    {
+        EXPECT_EQ(expected, parseChunks(traffic, chunk, error)) << "chunk " << chunk;
+        EXPECT_EQ("", error);
+    }
+}
+
+TEST(CORE_LILXML, Test_Content)
+{
+    XMLEle *root = parseOne("<?xml version='1.0'?>\n<!-- comment -->\n"
+                            "<defText device=\"A &amp; B\" name='x'>before<oneText name='t'>&lt;1&gt;</oneText>after</defText>");
+    ASSERT_NE(nullptr, root);
+
+    EXPECT_STREQ("defText", tagXMLEle(root));
+    EXPECT_STREQ("A & B", findXMLAttValu(root, "device"));
+    EXPECT_STREQ("x", findXMLAttValu(root, "name"));
+    EXPECT_STREQ("beforeafter", pcdataXMLEle(root));
+    EXPECT_EQ(1, nXMLEle(root));
+
+    XMLEle *child = findXMLEle(root, "oneText");
+    ASSERT_NE(nullptr, child);
+    // &lt; stays encoded in pcdata
+    EXPECT_STREQ("&lt;1>", pcdataXMLEle(child));
+    EXPECT_EQ(6, pcdatalenXMLEle(child));
+    EXPECT_EQ(root, parentXMLEle(child));
+
+    delXMLEle(root);
+}
+
+TEST(CORE_LILXML, Test_ErrorResync)
+{
+    std::string error;
+    std::vector<std::string> messages = parseChunks("<a x='1'>\n</b>\n<c y='2'/>\n", 4096, error);
+
+    EXPECT_NE("", error);
+    ASSERT_EQ(1u, messages.size());
+    EXPECT_EQ("<c y=\"2\"/>\n", messages[0]);
+
+    // An error leaves the parser ready for the next message
+    messages = parseChars("<a><b></a>\n<c/>\n", error);
+    EXPECT_NE("", error);
+    ASSERT_EQ(1u, messages.size());
+    EXPECT_EQ("<c/>\n", messages[0]);
+}
+
+TEST(CORE_LILXML, Test_EditParsedTree)
+{
+    XMLEle *root = parseOne("<newNumberVector device='CCD' name='EXP'><oneNumber name='V'>1</oneNumber></newNumberVector>");
+    ASSERT_NE(nullptr, root);
+
+    // Parsed elements, attributes and strings must survive being grown, replaced and removed
+    editXMLAtt(findXMLAtt(root, "device"), "A much longer device name than the parsed one");
+    addXMLAtt(root, "timestamp", "2020-01-01T00:00:00");
+    rmXMLAtt(root, "name");
+    editXMLEle(findXMLEle(root, "oneNumber"), "2.5");
+    for (int i = 0; i < 20; i++)
+        addXMLAtt(addXMLEle(root, "oneNumber"), "name", "N");
+
+    EXPECT_STREQ("A much longer device name than the parsed one", findXMLAttValu(root, "device"));
+    EXPECT_STREQ("", findXMLAttValu(root, "name"));
+    EXPECT_EQ(2, nXMLAtt(root));
+    EXPECT_EQ(21, nXMLEle(root));
+    EXPECT_STREQ("2.5", pcdataXMLEle(findXMLEle(root, "oneNumber")));
+
+    // Removing a child of a parsed tree, then the tree
+    XMLEle *child = nextXMLEle(root, 1);
+    delXMLEle(child);
+    EXPECT_EQ(20, nXMLEle(root));
+    EXPECT_STREQ("N", findXMLAttValu(nextXMLEle(root, 1), "name"));
+
+    delXMLEle(root);
+}
+
+TEST(CORE_LILXML, Test_PrintEntities)
+{
+    XMLEle *root = parseOne("<defText device='A &amp; B' label=\"it's\" name='x &gt; y'><oneText name='t'>a &amp; b</oneText></defText>");
+    ASSERT_NE(nullptr, root);
+
+    // Values are escaped again when printed, whether they came from an entity or not
+    const std::string expected = "<defText device=\"A &amp; B\" label=\"it&apos;s\" name=\"x &gt; y\">\n"
+                                 "    <oneText name=\"t\">\n"
+                                 "a &amp; b\n"
+                                 "    </oneText>\n"
+                                 "</defText>\n";
+    EXPECT_EQ(expected, print(root));
+
+    editXMLAtt(findXMLAtt(root, "label"), "plain");
+    addXMLAtt(root, "format", "\"<q>\"");
+    EXPECT_NE(std::string::npos, print(root).find(" label=\"plain\" "));
+    EXPECT_NE(std::string::npos, print(root).find(" format=\"&quot;&lt;q&gt;&quot;\">"));
+
+    delXMLEle(root);
+}
+
+TEST(CORE_LILXML, Test_PrintToBuffer)
+{
+    XMLEle *small = parseOne("<newSwitchVector device='CCD &amp; Co' name='CONNECTION'><oneSwitch name='CONNECT'>On</oneSwitch></newSwitchVector>");
+    XMLEle *large = parseOne("<setBLOBVector device='CCD' name='CCD1'><oneBLOB name='CCD1' format='.fits'>" +
+                             std::string(100000, 'A') + "</oneBLOB></setBLOBVector>");
+    ASSERT_NE(nullptr, small);
+    ASSERT_NE(nullptr, large);
+
+    char buf[256];
+    int len;
+
+    // Fits in the caller's buffer
+    char *s = sprmXMLEle(small, 0, buf, sizeof(buf), &len);
+    EXPECT_EQ(buf, s);
+    EXPECT_EQ(print(small), std::string(s, len));
+    EXPECT_EQ('\0', s[len]);
+
+    // Outgrows it, or there is none
+    s = sprmXMLEle(large, 0, buf, sizeof(buf), &len);
+    ASSERT_NE(buf, s);
+    EXPECT_EQ(print(large), std::string(s, len));
+    EXPECT_EQ('\0', s[len]);
+    free(s);
+
+    s = sprmXMLEle(small, 0, nullptr, 0, &len);
+    EXPECT_EQ(print(small), std::string(s, len));
+    free(s);
+
+    delXMLEle(small);
+    delXMLEle(large);
+}
+
+TEST(CORE_LILXML, Test_StopAfterElement)
+{
+    // Raw bytes follow the element, they must not reach the parser
+    std::string payload("<\0>\n&\xff", 6);
+    std::string text = "<?xml version='1.0'?>\n<setBLOBVector device='CCD' name='CCD1'>\n"
+                       "  <oneBLOB name='CCD1' size='6' format='.fits' enclen='6' encoding='raw'/>\n"
+                       "</setBLOBVector>" + payload + "<message device='CCD' message='done'/>\n";
+    char errmsg[1024];
+    LilXML *lp = newLilXML();
+    int used;
+
+    // Split anywhere in the header, the element still ends where it ends
+    XMLEle *root = parseXMLEle(lp, &text[0], 30, &used, errmsg);
+    EXPECT_EQ(nullptr, root);
+    EXPECT_EQ(30, used);
+    EXPECT_STREQ("", errmsg);
+
+    root = parseXMLEle(lp, &text[30], text.size() - 30, &used, errmsg);
+    ASSERT_NE(nullptr, root);
+    EXPECT_STREQ("setBLOBVector", tagXMLEle(root));
+    EXPECT_EQ(text.find(payload), 30 + static_cast<size_t>(used));
+    EXPECT_STREQ("raw", findXMLAttValu(nextXMLEle(root, 1), "encoding"));
+    delXMLEle(root);
+
+    size_t next = text.find(payload) + payload.size();
+    root        = parseXMLEle(lp, &text[next], text.size() - next, &used, errmsg);
+    ASSERT_NE(nullptr, root);
+    EXPECT_STREQ("message", tagXMLEle(root));
+    delXMLEle(root);
+
+    // Trailing white space is all that is left
+    EXPECT_EQ(nullptr, parseXMLEle(lp, &text[next + used], text.size() - next - used, &used, errmsg));
+    EXPECT_STREQ("", errmsg);
+    EXPECT_EQ(nullptr, parseXMLEle(lp, &text[0], 0, &used, errmsg));
+    EXPECT_EQ(0, used);
+
+    delLilXML(lp);
+}
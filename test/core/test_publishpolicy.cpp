@@ -0,0 +1,206 @@
+/*******************************************************************************
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+ .
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+ .
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+// Number properties with a publish policy, published from worker threads while the main loop runs, as
+// StreamManager does with the frame rate.
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include "defaultdevice.h"
+#include "eventlooptest.h"
+#include "indidriver.h"
+
+namespace
+{
+
+constexpr int PROPERTIES = 4;
+
+class PublishingDevice : public INDI::DefaultDevice
+{
+    public:
+        PublishingDevice()
+        {
+            setDeviceName("Publisher");
+        }
+
+        bool initProperties() override
+        {
+            INDI::DefaultDevice::initProperties();
+
+            for (int i = 0; i < PROPERTIES; i++)
+            {
+                names[i] = "VALUE_" + std::to_string(i);
+                IUFillNumber(&numbers[i], "VALUE", "Value", "%g", 0, 1e9, 0, 0);
+                IUFillNumberVector(&vectors[i], &numbers[i], 1, getDeviceName(), names[i].c_str(), "Value",
+                                   MAIN_CONTROL_TAB, IP_RO, 0, IPS_OK);
+                setPublishPolicy(&vectors[i], 50, 0, 0, 200);
+            }
+
+            return true;
+        }
+
+        // Updates from a worker thread, one property each
+        void update(int i, double value)
+        {
+            numbers[i].value = value;
+            publishNumber(&vectors[i]);
+        }
+
+        std::string names[PROPERTIES];
+
+    protected:
+        const char *getDefaultName() override
+        {
+            return "Publisher";
+        }
+
+    private:
+        INumber numbers[PROPERTIES];
+        INumberVectorProperty vectors[PROPERTIES];
+};
+
+// Driver output on a temporary file while alive
+class CapturedOutput
+{
+    public:
+        CapturedOutput()
+        {
+            char path[] = "/tmp/test_publishpolicyXXXXXX";
+            fd          = mkstemp(path);
+            unlink(path);
+
+            fflush(stdout);
+            saved = dup(1);
+            dup2(fd, 1);
+        }
+
+        ~CapturedOutput()
+        {
+            restore();
+            close(fd);
+        }
+
+        std::string text()
+        {
+            restore();
+
+            std::string output;
+            char buf[65536];
+            ssize_t n;
+            lseek(fd, 0, SEEK_SET);
+            while ((n = read(fd, buf, sizeof(buf))) > 0)
+                output.append(buf, n);
+            return output;
+        }
+
+    private:
+        void restore()
+        {
+            if (saved < 0)
+                return;
+            fflush(stdout);
+            dup2(saved, 1);
+            close(saved);
+            saved = -1;
+        }
+
+        int fd { -1 };
+        int saved { -1 };
+};
+
+// Values sent for each property, in order
+std::map<std::string, std::vector<double>> sentValues(const std::string &output)
+{
+    std::map<std::string, std::vector<double>> sent;
+    const std::string start = "<setNumberVector\n  device='Publisher'\n  name='";
+    size_t at = 0;
+
+    while ((at = output.find(start, at)) != std::string::npos)
+    {
+        at += start.size();
+        std::string name = output.substr(at, output.find('\'', at) - at);
+
+        at = output.find("<oneNumber name='VALUE'>", at);
+        at = output.find('\n', at) + 1;
+        sent[name].push_back(atof(output.c_str() + at));
+    }
+
+    return sent;
+}
+
+}
+
+TEST(CORE_PUBLISHPOLICY, Test_PublishFromThreads)
+{
+    // The executable name, which the stubs leave unset
+    me = const_cast<char *>("test_publishpolicy");
+
+    CapturedOutput output;
+    PublishingDevice device;
+    device.initProperties();
+
+    std::atomic<int> running { PROPERTIES };
+    std::vector<std::thread> workers;
+    int done = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < PROPERTIES; i++)
+    {
+        workers.emplace_back([&device, &running, i]()
+        {
+            for (int value = 1; value <= 20000; value++)
+            {
+                device.update(i, value);
+                if (value % 100 == 0)
+                    std::this_thread::sleep_for(std::chrono::microseconds(500));
+            }
+            running--;
+        });
+    }
+
+    // The main loop flushes meanwhile, and sends the final values once the workers went idle
+    while (running > 0 || EventLoopTest::since(start) < 0.1)
+        IEDeferLoop(20, &done);
+    double elapsed = EventLoopTest::since(start);
+    for (auto &worker : workers)
+        worker.join();
+    IEDeferLoop(600, &done);
+
+    auto sent = sentValues(output.text());
+    for (int i = 0; i < PROPERTIES; i++)
+    {
+        const std::vector<double> &values = sent[device.names[i]];
+
+        SCOPED_TRACE(device.names[i]);
+        ASSERT_FALSE(values.empty());
+        EXPECT_EQ(20000, values.back());
+        // At most one update every 50 ms, and the idle flush
+        EXPECT_LE(values.size(), elapsed / 0.05 + 3);
+        EXPECT_TRUE(std::is_sorted(values.begin(), values.end()));
+    }
+}
@@ -0,0 +1,308 @@
+/*******************************************************************************
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+ .
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+ .
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "eventlooptest.h"
+#include "indiscriptrunner.h"
+
+using INDI::ScriptRunner;
+
+namespace
+{
+
+typedef EventLoopTest::Outcome<ScriptRunner::Result> Outcome;
+using EventLoopTest::since;
+
+int run(const std::string &script, Outcome &outcome, int timeout = ScriptRunner::DEFAULT_TIMEOUT, bool urgent = false)
+{
+    return ScriptRunner::instance().run({ "sh", "-c", script }, EventLoopTest::recorder(outcome), timeout, urgent);
+}
+
+// Process pid is gone, or only waits to be reaped by someone else than the driver
+bool gone(pid_t pid)
+{
+    if (kill(pid, 0) < 0)
+        return true;
+
+    FILE *fp = fopen(("/proc/" + std::to_string(pid) + "/stat").c_str(), "r");
+    if (fp == nullptr)
+        return true;
+
+    char state = '?';
+    int scanned = fscanf(fp, "%*d (%*[^)]) %c", &state);
+    fclose(fp);
+    return scanned == 1 && state == 'Z';
+}
+
+// Children of the driver that exited and were not reaped
+bool unreaped()
+{
+    siginfo_t info {};
+    return waitid(P_ALL, 0, &info, WEXITED | WNOHANG | WNOWAIT) == 0 && info.si_pid != 0;
+}
+
+// Run the main loop for ms milliseconds
+void spin(int ms)
+{
+    int never = 0;
+    IEDeferLoop(ms, &never);
+}
+
+}
+
+TEST(CORE_SCRIPTRUNNER, Test_Output)
+{
+    Outcome outcome;
+
+    run("echo 1 0 180.5; echo warning >&2; exit 3", outcome);
+    EXPECT_EQ(0, outcome.done);
+
+    ASSERT_EQ(0, IEDeferLoop(5000, &outcome.done));
+    EXPECT_FALSE(outcome.result.ok);
+    EXPECT_EQ(3, outcome.result.status);
+    EXPECT_FALSE(outcome.result.timedOut);
+    EXPECT_EQ("1 0 180.5\n", outcome.result.output);
+    EXPECT_EQ("warning\n", outcome.result.errors);
+
+    // Scripts do not get the driver's stdin
+    Outcome input;
+    run("read line; echo \"[$line]\"", input);
+    ASSERT_EQ(0, IEDeferLoop(5000, &input.done));
+    EXPECT_EQ("[]\n", input.result.output);
+
+    ScriptRunner::Result result = ScriptRunner::instance().runNow({ "sh", "-c", "echo connected" });
+    EXPECT_TRUE(result.ok);
+    EXPECT_EQ(0, result.status);
+    EXPECT_EQ("connected\n", result.output);
+}
+
+TEST(CORE_SCRIPTRUNNER, Test_MissingProgram)
+{
+    Outcome outcome;
+
+    int id = ScriptRunner::instance().run({ "/nonexistent/park.py" }, EventLoopTest::recorder(outcome));
+
+    // Reported from the main loop, not from run()
+    EXPECT_EQ(0, outcome.done);
+    EXPECT_TRUE(ScriptRunner::instance().isActive(id));
+
+    ASSERT_EQ(0, IEDeferLoop(5000, &outcome.done));
+    EXPECT_FALSE(outcome.result.ok);
+    EXPECT_EQ(-1, outcome.result.status);
+    EXPECT_NE("", outcome.result.error);
+    EXPECT_FALSE(ScriptRunner::instance().isActive(id));
+}
+
+TEST(CORE_SCRIPTRUNNER, Test_TimeoutKeepsLoopRunning)
+{
+    Outcome outcome;
+    EventLoopTest::Ticker ticker;
+
+    auto start = std::chrono::steady_clock::now();
+    // The child shell is in the script's process group and goes too
+    run("sh -c 'sleep 10'; echo late", outcome, 300);
+
+    ASSERT_EQ(0, IEDeferLoop(5000, &outcome.done));
+    EXPECT_LT(since(start), 1.5);
+    EXPECT_FALSE(outcome.result.ok);
+    EXPECT_TRUE(outcome.result.timedOut);
+    EXPECT_EQ("", outcome.result.output);
+    EXPECT_GE(ticker.ticks, 5);
+
+    // Ignoring SIGTERM does not help
+    Outcome stubborn;
+    start = std::chrono::steady_clock::now();
+    run("trap '' TERM; while :; do sleep 0.1; done", stubborn, 200);
+    ASSERT_EQ(0, IEDeferLoop(5000, &stubborn.done));
+    EXPECT_TRUE(stubborn.result.timedOut);
+    EXPECT_LT(since(start), 3.5);
+}
+
+TEST(CORE_SCRIPTRUNNER, Test_MaxRunning)
+{
+    ScriptRunner &runner = ScriptRunner::instance();
+    std::vector<Outcome> outcomes(4);
+    Outcome urgent;
+
+    runner.setMaxRunning(2);
+
+    auto start = std::chrono::steady_clock::now();
+    for (Outcome &outcome : outcomes)
+        run("sleep 0.3", outcome);
+    run("true", urgent, ScriptRunner::DEFAULT_TIMEOUT, true);
+
+    ASSERT_EQ(0, IEDeferLoop(5000, &urgent.done));
+    EXPECT_LT(since(start), 0.25);
+
+    for (Outcome &outcome : outcomes)
+    {
+        ASSERT_EQ(0, IEDeferLoop(5000, &outcome.done));
+        EXPECT_TRUE(outcome.result.ok);
+    }
+
+    // Two at a time, in order
+    EXPECT_LT(outcomes[1].at - start, std::chrono::milliseconds(550));
+    EXPECT_GE(outcomes[2].at - start, std::chrono::milliseconds(550));
+    EXPECT_GE(outcomes[3].at - start, std::chrono::milliseconds(550));
+
+    runner.setMaxRunning(4);
+}
+
+TEST(CORE_SCRIPTRUNNER, Test_Cancel)
+{
+    ScriptRunner &runner = ScriptRunner::instance();
+    Outcome running, waiting, other;
+
+    runner.setMaxRunning(1);
+    int runningID = run("sleep 5", running);
+    int waitingID = run("echo waiting", waiting);
+    runner.setMaxRunning(4);
+
+    runner.cancel(waitingID);
+    runner.cancel(runningID);
+    EXPECT_FALSE(runner.isActive(runningID));
+    EXPECT_FALSE(runner.isActive(waitingID));
+
+    run("echo other", other);
+    ASSERT_EQ(0, IEDeferLoop(5000, &other.done));
+    spin(300);
+
+    EXPECT_EQ(0, running.done);
+    EXPECT_EQ(0, waiting.done);
+    EXPECT_EQ("other\n", other.result.output);
+}
+
+TEST(CORE_SCRIPTRUNNER, Test_KillsProcessGroup)
+{
+    // Whatever the script started in the background goes with it, on timeout
+    Outcome timedOut;
+    run("sleep 30 & echo $!; wait", timedOut, 300);
+    ASSERT_EQ(0, IEDeferLoop(5000, &timedOut.done));
+    EXPECT_TRUE(timedOut.result.timedOut);
+
+    pid_t background = atoi(timedOut.result.output.c_str());
+    ASSERT_GT(background, 0);
+    spin(100);
+    EXPECT_TRUE(gone(background));
+
+    // and on cancel, which drops the output, so the script leaves the pid in a file
+    char path[] = "/tmp/test_scriptrunnerXXXXXX";
+    int fd      = mkstemp(path);
+    ASSERT_GE(fd, 0);
+    close(fd);
+
+    Outcome cancelled;
+    int id = run(std::string("sleep 30 & echo $! > ") + path + "; wait", cancelled);
+
+    background = 0;
+    for (int i = 0; i < 100 && background <= 0; i++)
+    {
+        spin(50);
+        FILE *fp = fopen(path, "r");
+        if (fp == nullptr || fscanf(fp, "%d", &background) != 1)
+            background = 0;
+        if (fp != nullptr)
+            fclose(fp);
+    }
+    unlink(path);
+    ASSERT_GT(background, 0);
+    EXPECT_FALSE(gone(background));
+
+    ScriptRunner::instance().cancel(id);
+    spin(100);
+    EXPECT_TRUE(gone(background));
+    EXPECT_EQ(0, cancelled.done);
+}
+
+TEST(CORE_SCRIPTRUNNER, Test_ReapsScripts)
+{
+    ScriptRunner &runner = ScriptRunner::instance();
+    std::vector<Outcome> outcomes(6);
+    std::vector<int> ids;
+
+    // Finished, failed, timed out, cancelled while running, and through runNow()
+    run("true", outcomes[0]);
+    run("exit 7", outcomes[1]);
+    run("kill -9 $$", outcomes[2]);
+    run("sleep 10", outcomes[3], 100);
+    ids.push_back(run("sleep 10", outcomes[4]));
+    ids.push_back(run("trap '' TERM; sleep 10", outcomes[5]));
+    EXPECT_TRUE(runner.runNow({ "sh", "-c", "exit 0" }).ok);
+
+    spin(100);
+    for (int id : ids)
+        runner.cancel(id);
+
+    for (int i = 0; i < 4; i++)
+        ASSERT_EQ(0, IEDeferLoop(5000, &outcomes[i].done));
+    EXPECT_TRUE(outcomes[0].result.ok);
+    EXPECT_EQ(7, outcomes[1].result.status);
+    EXPECT_EQ(-1, outcomes[2].result.status);
+    EXPECT_NE(std::string::npos, outcomes[2].result.error.find("signal 9"));
+    EXPECT_TRUE(outcomes[3].result.timedOut);
+
+    // Cancelled scripts are reaped by the main loop too, without a callback
+    for (int i = 0; i < 20 && unreaped(); i++)
+        spin(50);
+    spin(100);
+    EXPECT_FALSE(unreaped());
+    EXPECT_EQ(0, outcomes[4].done);
+    EXPECT_EQ(0, outcomes[5].done);
+}
+
+TEST(CORE_SCRIPTRUNNER, Test_CapturesOutput)
+{
+    // More than a pipe holds, on both streams at once, without the script blocking
+    Outcome large;
+    run("i=0; while [ $i -lt 2000 ]; do echo \"line $i of the standard output, padded to be long enough\"; "
+        "echo \"line $i of the standard error\" >&2; i=$((i + 1)); done", large);
+    ASSERT_EQ(0, IEDeferLoop(10000, &large.done));
+    EXPECT_TRUE(large.result.ok);
+    EXPECT_EQ(0u, large.result.output.find("line 0 of the standard output"));
+    EXPECT_NE(std::string::npos, large.result.output.find("line 1999 of the standard output"));
+    EXPECT_NE(std::string::npos, large.result.errors.find("line 1999 of the standard error"));
+    EXPECT_GT(large.result.output.size(), 65536u);
+
+    // Written just before exiting
+    Outcome last;
+    run("printf 'no newline'; exit 0", last);
+    ASSERT_EQ(0, IEDeferLoop(5000, &last.done));
+    EXPECT_EQ("no newline", last.result.output);
+
+    // Binary output is kept as is, and capped at 1 MiB per stream
+    Outcome binary;
+    run("printf 'a\\000b'; head -c 3000000 /dev/zero", binary);
+    ASSERT_EQ(0, IEDeferLoop(10000, &binary.done));
+    EXPECT_TRUE(binary.result.ok);
+    ASSERT_EQ(1024u * 1024u, binary.result.output.size());
+    EXPECT_EQ(std::string("a\0b", 3), binary.result.output.substr(0, 3));
+
+    // The same through runNow()
+    ScriptRunner::Result result = ScriptRunner::instance().runNow({ "sh", "-c", "head -c 3000000 /dev/zero; echo done >&2" });
+    EXPECT_TRUE(result.ok);
+    EXPECT_EQ(1024u * 1024u, result.output.size());
+    EXPECT_EQ("done\n", result.errors);
+}
@@ -0,0 +1,210 @@
+/*******************************************************************************
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+ .
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+ .
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "starcatalog.h"
+
+namespace
+{
+
+typedef StarCatalog::Star Star;
+
+// Catalog file in a scratch directory, removed with the fixture
+class StarCatalogTest : public ::testing::Test
+{
+    protected:
+        void SetUp() override
+        {
+            char dir[] = "/tmp/test_starcatalogXXXXXX";
+            ASSERT_NE(mkdtemp(dir), nullptr);
+            directory = dir;
+            path      = directory + "/stars.cat";
+        }
+
+        void TearDown() override
+        {
+            catalog.unload();
+            unlink(path.c_str());
+            rmdir(directory.c_str());
+        }
+
+        std::vector<Star> query(double ra, double dec, double radius, double maxMag, size_t limit = 1000000)
+        {
+            std::vector<Star> found;
+            catalog.query(ra, dec, radius, maxMag, limit, [&found](const Star & star)
+            {
+                found.push_back(star);
+            });
+            std::sort(found.begin(), found.end(), byPosition);
+            return found;
+        }
+
+        static bool byPosition(const Star &a, const Star &b)
+        {
+            return a.ra != b.ra ? a.ra < b.ra : a.dec < b.dec;
+        }
+
+        // Stars within radius arcminutes of the center and not fainter than maxMag, by brute force
+        static std::vector<Star> inField(const std::vector<Star> &stars, double ra, double dec, double radius,
+                                         double maxMag)
+        {
+            std::vector<Star> found;
+            for (const Star &star : stars)
+            {
+                double cosSeparation = std::sin(dec * M_PI / 180) * std::sin(star.dec * M_PI / 180) +
+                                       std::cos(dec * M_PI / 180) * std::cos(star.dec * M_PI / 180) *
+                                       std::cos((star.ra - ra) * M_PI / 180);
+                if (star.mag <= maxMag && cosSeparation >= std::cos(radius / 60 * M_PI / 180))
+                    found.push_back(star);
+            }
+            std::sort(found.begin(), found.end(), byPosition);
+            return found;
+        }
+
+        std::string directory, path;
+        StarCatalog catalog;
+};
+
+}
+
+TEST_F(StarCatalogTest, Test_FieldAcrossRAWrap)
+{
+    std::vector<Star> stars =
+    {
+        { 359.95f, 10.0f, 8.0f },  // just west of 0h
+        { 0.05f, 10.0f, 9.0f },    // just east of 0h
+        { 0.02f, 10.02f, 14.0f },  // too faint
+        { 1.0f, 10.0f, 8.0f },     // outside the field
+        { 180.0f, 10.0f, 5.0f },   // other side of the sky
+    };
+    ASSERT_TRUE(StarCatalog::write(path, stars, 180));
+    ASSERT_TRUE(catalog.load(path));
+    EXPECT_EQ(catalog.size(), stars.size());
+
+    std::vector<Star> found = query(0, 10, 30, 12);
+    ASSERT_EQ(found.size(), 2u);
+    EXPECT_FLOAT_EQ(found[0].ra, 0.05f);
+    EXPECT_FLOAT_EQ(found[1].ra, 359.95f);
+}
+
+TEST_F(StarCatalogTest, Test_FieldAroundPole)
+{
+    // Around the pole every right ascension is in the field
+    std::vector<Star> stars;
+    for (int ra = 0; ra < 360; ra += 30)
+        stars.push_back({ static_cast<float>(ra), 89.8f, 6.0f });
+    stars.push_back({ 45.0f, 88.0f, 6.0f });
+    ASSERT_TRUE(StarCatalog::write(path, stars, 180));
+    ASSERT_TRUE(catalog.load(path));
+
+    EXPECT_EQ(query(123, 89.9, 30, 10).size(), 12u);
+    EXPECT_EQ(query(0, 90, 150, 10).size(), 13u);
+}
+
+TEST_F(StarCatalogTest, Test_MatchesBruteForce)
+{
+    std::vector<Star> stars = StarCatalog::synthesize(200000, 12, 7);
+    ASSERT_TRUE(StarCatalog::write(path, stars));
+    ASSERT_TRUE(catalog.load(path));
+
+    // write() normalises right ascension, compare against what it stored
+    for (Star &star : stars)
+    {
+        star.ra = std::fmod(star.ra, 360.0f);
+        if (star.ra < 0)
+            star.ra += 360.0f;
+    }
+
+    const double fields[][4] =
+    {
+        { 83.8, -5.4, 60, 12 },
+        { 0.1, 0.0, 90, 11 },
+        { 359.9, 45.0, 120, 12 },
+        { 200.0, -89.5, 60, 12 },
+        { 10.0, 70.0, 30, 9 },
+    };
+    for (const auto &field : fields)
+    {
+        std::vector<Star> expected = inField(stars, field[0], field[1], field[2], field[3]);
+        std::vector<Star> found    = query(field[0], field[1], field[2], field[3]);
+
+        SCOPED_TRACE("field at " + std::to_string(field[0]) + " " + std::to_string(field[1]));
+        ASSERT_EQ(found.size(), expected.size());
+        for (size_t i = 0; i < found.size(); i++)
+        {
+            EXPECT_EQ(found[i].ra, expected[i].ra);
+            EXPECT_EQ(found[i].dec, expected[i].dec);
+        }
+    }
+}
+
+TEST_F(StarCatalogTest, Test_Limit)
+{
+    ASSERT_TRUE(StarCatalog::write(path, StarCatalog::synthesize(50000, 12, 3)));
+    ASSERT_TRUE(catalog.load(path));
+
+    EXPECT_EQ(catalog.query(0, 0, 600, 12, 10, [](const Star &) {}), 10u);
+}
+
+TEST_F(StarCatalogTest, Test_RejectsBadFiles)
+{
+    ASSERT_TRUE(StarCatalog::write(path, StarCatalog::synthesize(1000, 12, 1), 90));
+
+    std::vector<char> bytes;
+    FILE *fp = fopen(path.c_str(), "rb");
+    ASSERT_NE(fp, nullptr);
+    for (int c; (c = fgetc(fp)) != EOF;)
+        bytes.push_back(static_cast<char>(c));
+    fclose(fp);
+
+    auto rewrite = [this](const std::vector<char> &content)
+    {
+        FILE *out = fopen(path.c_str(), "wb");
+        fwrite(content.data(), 1, content.size(), out);
+        fclose(out);
+    };
+
+    // Truncated
+    rewrite(std::vector<char>(bytes.begin(), bytes.end() - 5));
+    EXPECT_FALSE(catalog.load(path));
+    EXPECT_FALSE(catalog.isLoaded());
+
+    // Wrong magic
+    std::vector<char> bad = bytes;
+    bad[0] = 'X';
+    rewrite(bad);
+    EXPECT_FALSE(catalog.load(path));
+
+    // Zone offsets going backwards, the first offset follows the 24 byte header
+    bad = bytes;
+    bad[24 + 4 * 10] = 0x7f;
+    rewrite(bad);
+    EXPECT_FALSE(catalog.load(path));
+
+    rewrite(bytes);
+    EXPECT_TRUE(catalog.load(path));
+    EXPECT_FALSE(catalog.load(directory + "/missing.cat"));
+}
@@ -0,0 +1,358 @@
+/*******************************************************************************
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+ .
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+ .
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "indiusbtransfer.h"
+
+using INDI::USBBuffer;
+using INDI::USBTransferRing;
+using INDI::USBTransport;
+
+namespace
+{
+
+// In-process device: packets queued by the test complete the submitted transfers in order.
+class FakeDevice : public USBTransport
+{
+    public:
+        int submit(Transfer *transfer) override
+        {
+            std::lock_guard<std::mutex> guard(lock);
+
+            if (unplugged)
+                return LIBUSB_ERROR_NO_DEVICE;
+
+            pending.push_back(transfer);
+            submitted++;
+            maxInFlight = std::max(maxInFlight.load(), static_cast<int>(pending.size()));
+            changed.notify_all();
+            return 0;
+        }
+
+        int cancel(Transfer *transfer) override
+        {
+            std::lock_guard<std::mutex> guard(lock);
+
+            auto it = std::find(pending.begin(), pending.end(), transfer);
+            if (it == pending.end())
+                return LIBUSB_ERROR_NOT_FOUND;
+
+            pending.erase(it);
+            finish(transfer, LIBUSB_TRANSFER_CANCELLED);
+            return 0;
+        }
+
+        void handleEvents(int timeout) override
+        {
+            std::vector<Transfer *> completed;
+
+            {
+                std::unique_lock<std::mutex> guard(lock);
+
+                changed.wait_for(guard, std::chrono::milliseconds(timeout), [this]()
+                {
+                    return !done.empty() || (!packets.empty() && !pending.empty());
+                });
+
+                while (!packets.empty() && !pending.empty())
+                {
+                    Transfer *transfer = pending.front();
+                    std::string packet = packets.front();
+
+                    pending.pop_front();
+                    packets.pop_front();
+
+                    transfer->actual = std::min(static_cast<int>(packet.size()), transfer->length);
+                    memcpy(transfer->data, packet.data(), transfer->actual);
+                    finish(transfer, LIBUSB_TRANSFER_COMPLETED);
+                }
+
+                completed.swap(done);
+            }
+
+            for (Transfer *transfer : completed)
+                transfer->completed(transfer);
+        }
+
+        void send(const std::string &packet)
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            packets.push_back(packet);
+            changed.notify_all();
+        }
+
+        // Submitted transfers end as with libusb when the device is unplugged
+        void unplug()
+        {
+            std::lock_guard<std::mutex> guard(lock);
+
+            unplugged = true;
+            while (!pending.empty())
+            {
+                finish(pending.front(), LIBUSB_TRANSFER_NO_DEVICE);
+                pending.pop_front();
+            }
+        }
+
+        // Submitted transfers end without data
+        void timeOut()
+        {
+            std::lock_guard<std::mutex> guard(lock);
+
+            while (!pending.empty())
+            {
+                finish(pending.front(), LIBUSB_TRANSFER_TIMED_OUT);
+                pending.pop_front();
+            }
+        }
+
+        int inFlight()
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            return static_cast<int>(pending.size());
+        }
+
+        int queued()
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            return static_cast<int>(packets.size());
+        }
+
+        std::mutex lock;
+        std::atomic<int> submitted { 0 };
+        std::atomic<int> maxInFlight { 0 };
+
+    private:
+        // Called with lock held
+        void finish(Transfer *transfer, libusb_transfer_status status)
+        {
+            if (status != LIBUSB_TRANSFER_COMPLETED)
+                transfer->actual = 0;
+            transfer->status = status;
+            done.push_back(transfer);
+            changed.notify_all();
+        }
+
+        std::condition_variable changed;
+        std::deque<Transfer *> pending;
+        std::deque<std::string> packets;
+        std::vector<Transfer *> done;
+        bool unplugged { false };
+};
+
+// Collects what the ring hands over
+struct Consumer
+{
+    std::mutex lock;
+    std::condition_variable changed;
+    std::vector<std::string> received;
+    std::vector<libusb_transfer_status> statuses;
+    std::vector<USBBuffer> held;
+    std::set<const unsigned char *> addresses;
+    std::thread::id thread;
+    bool hold { false };
+
+    USBTransferRing::Callback callback()
+    {
+        return [this](USBBuffer buffer)
+        {
+            std::lock_guard<std::mutex> guard(lock);
+
+            received.emplace_back(reinterpret_cast<const char *>(buffer.data()), buffer.size());
+            statuses.push_back(buffer.status());
+            addresses.insert(buffer.data());
+            thread = std::this_thread::get_id();
+            if (hold)
+                held.push_back(std::move(buffer));
+            changed.notify_all();
+        };
+    }
+
+    bool waitFor(size_t count)
+    {
+        std::unique_lock<std::mutex> guard(lock);
+        return changed.wait_for(guard, std::chrono::seconds(5), [&]()
+        {
+            return received.size() >= count;
+        });
+    }
+};
+
+bool eventually(const std::function<bool()> &condition)
+{
+    for (int i = 0; i < 500; i++)
+    {
+        if (condition())
+            return true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return false;
+}
+
+}
+
+TEST(CORE_USBTRANSFER, Test_Streaming)
+{
+    FakeDevice device;
+    Consumer consumer;
+    USBTransferRing ring(device, 0x82, 64, 4);
+
+    ASSERT_TRUE(ring.start(consumer.callback()));
+    EXPECT_TRUE(ring.isRunning());
+    EXPECT_TRUE(eventually([&]()
+    {
+        return device.inFlight() == 4;
+    }));
+
+    for (int i = 0; i < 100; i++)
+        device.send("frame " + std::to_string(i));
+
+    ASSERT_TRUE(consumer.waitFor(100));
+    ring.stop();
+
+    for (int i = 0; i < 100; i++)
+    {
+        EXPECT_EQ("frame " + std::to_string(i), consumer.received[i]);
+        EXPECT_EQ(LIBUSB_TRANSFER_COMPLETED, consumer.statuses[i]);
+    }
+
+    EXPECT_EQ(4, device.maxInFlight.load());
+    EXPECT_NE(std::this_thread::get_id(), consumer.thread);
+    // The same four buffers all along
+    EXPECT_EQ(4u, consumer.addresses.size());
+    EXPECT_EQ(0, device.inFlight());
+}
+
+TEST(CORE_USBTRANSFER, Test_HeldBuffers)
+{
+    FakeDevice device;
+    Consumer consumer;
+    USBTransferRing ring(device, 0x82, 64, 2);
+
+    consumer.hold = true;
+    ASSERT_TRUE(ring.start(consumer.callback()));
+
+    for (int i = 0; i < 4; i++)
+        device.send("frame " + std::to_string(i));
+
+    // Both buffers held by the consumer, nothing more is read
+    ASSERT_TRUE(consumer.waitFor(2));
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    EXPECT_EQ(0, device.inFlight());
+    EXPECT_EQ(2, device.queued());
+
+    USBBuffer first;
+    {
+        std::lock_guard<std::mutex> guard(consumer.lock);
+        EXPECT_EQ(2u, consumer.received.size());
+        ASSERT_EQ(2u, consumer.held.size());
+        EXPECT_EQ(0, memcmp("frame 0", consumer.held[0].data(), 7));
+        first = std::move(consumer.held[0]);
+        consumer.held.erase(consumer.held.begin());
+        consumer.hold = false;
+    }
+
+    // Processing elsewhere, then back to the ring
+    std::thread([&first]()
+    {
+        first.release();
+    }).join();
+    EXPECT_FALSE(first);
+
+    ASSERT_TRUE(consumer.waitFor(4));
+    EXPECT_EQ("frame 3", consumer.received[3]);
+
+    ring.stop();
+
+    // Still readable after the ring stopped, and released after it is gone
+    std::lock_guard<std::mutex> guard(consumer.lock);
+    EXPECT_EQ(0, memcmp("frame 1", consumer.held[0].data(), 7));
+}
+
+TEST(CORE_USBTRANSFER, Test_StopCancelsInFlight)
+{
+    FakeDevice device;
+    Consumer consumer;
+    USBTransferRing ring(device, 0x82, 64, 4);
+
+    ASSERT_TRUE(ring.start(consumer.callback()));
+    ASSERT_TRUE(eventually([&]()
+    {
+        return device.inFlight() == 4;
+    }));
+
+    auto start = std::chrono::steady_clock::now();
+    ring.stop();
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(1));
+    EXPECT_FALSE(ring.isRunning());
+    EXPECT_EQ(0, device.inFlight());
+
+    // Nothing is read or handed over once stopped
+    device.send("late");
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    EXPECT_EQ(0u, consumer.received.size());
+
+    // And it starts again
+    ASSERT_TRUE(ring.start(consumer.callback()));
+    ASSERT_TRUE(consumer.waitFor(1));
+    EXPECT_EQ("late", consumer.received[0]);
+}
+
+TEST(CORE_USBTRANSFER, Test_TimeoutsAndUnplug)
+{
+    FakeDevice device;
+    Consumer consumer;
+    USBTransferRing ring(device, 0x82, 64, 3, 100);
+
+    ASSERT_TRUE(ring.start(consumer.callback()));
+    ASSERT_TRUE(eventually([&]()
+    {
+        return device.inFlight() == 3;
+    }));
+
+    // Timeouts without data are not reported, the transfers go on
+    device.timeOut();
+    ASSERT_TRUE(eventually([&]()
+    {
+        return device.submitted == 6 && device.inFlight() == 3;
+    }));
+    EXPECT_EQ(0u, consumer.received.size());
+
+    device.unplug();
+    ASSERT_TRUE(consumer.waitFor(3));
+    EXPECT_EQ(LIBUSB_TRANSFER_NO_DEVICE, consumer.statuses[0]);
+    EXPECT_EQ(0u, consumer.received[0].size());
+    EXPECT_FALSE(ring.isRunning());
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    EXPECT_EQ(6, device.submitted.load());
+
+    FakeDevice gone;
+    gone.unplug();
+    USBTransferRing other(gone, 0x82, 64);
+    EXPECT_FALSE(other.start(consumer.callback()));
+}
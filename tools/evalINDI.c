@@ -28,6 +28,7 @@
 #include <netinet/in.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/un.h>
 
 extern int compileExpr(char *expr, char *errmsg);
 extern int evalExpr(double *vp, char *errmsg);
@@ -40,6 +41,7 @@ extern int setOperand(char *name, double valu);
 static void usage();
 static void compileINDI(char *expr);
 static FILE *openINDIServer();
+static int openUnixSocket(const char *path);
 static void getProps(FILE *fp);
 static void initProps(FILE *fp);
 static int pstatestr(char *state);
@@ -184,7 +186,7 @@ int main(int ac, char *av[])
     {
         fp = openINDIServer();
         if (verbose)
-            fprintf(stderr, "Connected to %s on port %d\n", host, port);
+            fprintf(stderr, host[0] == '/' ? "Connected to %s\n" : "Connected to %s on port %d\n", host, port);
     }
 
     /* build a parser context for cracking XML responses */
@@ -214,7 +216,7 @@ static void usage()
 
     fprintf(stderr, "   -e   : print each updated expression value\n");
     fprintf(stderr, "   -f   : print final expression value\n");
-    fprintf(stderr, "   -h h : alternate host, default is %s\n", host_def);
+    fprintf(stderr, "   -h h : alternate host, or local server socket path, default is %s\n", host_def);
     fprintf(stderr, "   -i   : read expression from stdin\n");
     fprintf(stderr, "   -o   : print operands as they change\n");
     fprintf(stderr, "   -p p : alternate port, default is %d\n", INDIPORT);
@@ -273,6 +275,38 @@ static void compileINDI(char *expr)
         free(exp);
 }
 
+/* connect to the Unix-domain socket of a local server at path.
+ * return socket or exit if trouble.
+ */
+static int openUnixSocket(const char *path)
+{
+    struct sockaddr_un serv_addr;
+    int sockfd;
+
+    if (strlen(path) >= sizeof(serv_addr.sun_path))
+    {
+        fprintf(stderr, "Socket path too long: %s\n", path);
+        exit(2);
+    }
+
+    (void)memset((char *)&serv_addr, 0, sizeof(serv_addr));
+    serv_addr.sun_family = AF_UNIX;
+    strcpy(serv_addr.sun_path, path);
+    if ((sockfd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0)
+    {
+        perror("socket");
+        exit(2);
+    }
+
+    if (connect(sockfd, (struct sockaddr *)&serv_addr, sizeof(serv_addr)) < 0)
+    {
+        perror("connect");
+        exit(2);
+    }
+
+    return (sockfd);
+}
+
 /* open a connection to the given host and port or die.
  * return FILE pointer to socket.
  */
@@ -282,6 +316,10 @@ static FILE *openINDIServer()
     struct hostent *hp;
     int sockfd;
 
+    /* an absolute path names the Unix-domain socket of a local server */
+    if (host[0] == '/')
+        return (fdopen(openUnixSocket(host), "r+"));
+
     /* lookup host address */
     hp = gethostbyname(host);
     if (!hp)
@@ -23,6 +23,7 @@
 #include <netinet/in.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/un.h>
 
 /* table of INDI definition elements, plus setBLOB.
  * we also look for set* if -m
@@ -67,6 +68,7 @@ static void usage(void);
 static void crackDPE(char *spec);
 static void addSearchDef(char *dev, char *prop, char *ele);
 static void openINDIServer(void);
+static int openUnixSocket(const char *path);
 static void getprops(void);
 static void listenINDI(void);
 static int finished(void);
@@ -201,7 +203,7 @@ int main(int ac, char *av[])
     {
         openINDIServer();
         if (verbose)
-            fprintf(stderr, "Connected to %s on port %d\n", host, port);
+            fprintf(stderr, host[0] == '/' ? "Connected to %s\n" : "Connected to %s on port %d\n", host, port);
     }
 
     /* build a parser context for cracking XML responses */
@@ -233,7 +235,7 @@ static void usage()
     fprintf(stderr, "Options:\n");
     fprintf(stderr, "  -1    : print just value if expecting exactly one response\n");
     fprintf(stderr, "  -d f  : use file descriptor f already open to server\n");
-    fprintf(stderr, "  -h h  : alternate host, default is %s\n", host_def);
+    fprintf(stderr, "  -h h  : alternate host, or local server socket path, default is %s\n", host_def);
     fprintf(stderr, "  -m    : keep monitoring for more updates\n");
     fprintf(stderr, "  -p p  : alternate port, default is %d\n", INDIPORT);
     fprintf(stderr, "  -t t  : max time to wait, default is %d secs\n", TIMEOUT);
@@ -277,6 +279,38 @@ static void addSearchDef(char *dev, char *prop, char *ele)
     nsrchs++;
 }
 
+/* connect to the Unix-domain socket of a local server at path.
+ * return socket or exit if trouble.
+ */
+static int openUnixSocket(const char *path)
+{
+    struct sockaddr_un serv_addr;
+    int sockfd;
+
+    if (strlen(path) >= sizeof(serv_addr.sun_path))
+    {
+        fprintf(stderr, "Socket path too long: %s\n", path);
+        exit(2);
+    }
+
+    (void)memset((char *)&serv_addr, 0, sizeof(serv_addr));
+    serv_addr.sun_family = AF_UNIX;
+    strcpy(serv_addr.sun_path, path);
+    if ((sockfd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0)
+    {
+        perror("socket");
+        exit(2);
+    }
+
+    if (connect(sockfd, (struct sockaddr *)&serv_addr, sizeof(serv_addr)) < 0)
+    {
+        perror("connect");
+        exit(2);
+    }
+
+    return (sockfd);
+}
+
 /* open a connection to the given host and port.
  * set svrwfp and svrrfp or die.
  */
@@ -286,6 +320,15 @@ static void openINDIServer(void)
     struct hostent *hp;
     int sockfd;
 
+    /* an absolute path names the Unix-domain socket of a local server */
+    if (host[0] == '/')
+    {
+        sockfd = openUnixSocket(host);
+        svrwfp = fdopen(sockfd, "w");
+        svrrfp = fdopen(sockfd, "r");
+        return;
+    }
+
     /* lookup host address */
     hp = gethostbyname(host);
     if (!hp)
@@ -19,6 +19,7 @@
 #include <netinet/in.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/un.h>
 
 /* table of INDI definition elements we can set
  * N.B. do not change defs[] order, they are indexed via -x/-n/-s args
@@ -70,6 +71,7 @@ static int nsets;
 static void usage(void);
 static int crackSpec(int *acp, char **avp[]);
 static void openINDIServer(FILE **rfpp, FILE **wfpp);
+static int openUnixSocket(const char *path);
 static void listenINDI(FILE *rfp, FILE *wfp);
 static int finished(void);
 static void onAlarm(int dummy);
@@ -196,7 +198,7 @@ int main(int ac, char *av[])
     {
         openINDIServer(&rfp, &wfp);
         if (verbose)
-            fprintf(stderr, "Connected to %s on port %d\n", host, port);
+            fprintf(stderr, host[0] == '/' ? "Connected to %s\n" : "Connected to %s on port %d\n", host, port);
     }
 
     /* build a parser context for cracking XML responses */
@@ -229,7 +231,7 @@ static void usage()
     fprintf(stderr, "Usage: %s [options] {[type] spec} ...\n", me);
     fprintf(stderr, "Options:\n");
     fprintf(stderr, "  -d f  : use file descriptor f already open to server\n");
-    fprintf(stderr, "  -h h  : alternate host, default is %s\n", host_def);
+    fprintf(stderr, "  -h h  : alternate host, or local server socket path, default is %s\n", host_def);
     fprintf(stderr, "  -p p  : alternate port, default is %d\n", INDIPORT);
     fprintf(stderr, "  -t t  : max time to wait, default is %d secs\n", TIMEOUT);
     fprintf(stderr, "  -v    : verbose (more are cumulative)\n");
@@ -315,6 +317,38 @@ static int crackSpec(int *acp, char **avp[])
     return (dp ? 1 : 0);
 }
 
+/* connect to the Unix-domain socket of a local server at path.
+ * return socket or exit if trouble.
+ */
+static int openUnixSocket(const char *path)
+{
+    struct sockaddr_un serv_addr;
+    int sockfd;
+
+    if (strlen(path) >= sizeof(serv_addr.sun_path))
+    {
+        fprintf(stderr, "Socket path too long: %s\n", path);
+        exit(2);
+    }
+
+    (void)memset((char *)&serv_addr, 0, sizeof(serv_addr));
+    serv_addr.sun_family = AF_UNIX;
+    strcpy(serv_addr.sun_path, path);
+    if ((sockfd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0)
+    {
+        perror("socket");
+        exit(2);
+    }
+
+    if (connect(sockfd, (struct sockaddr *)&serv_addr, sizeof(serv_addr)) < 0)
+    {
+        perror("connect");
+        exit(2);
+    }
+
+    return (sockfd);
+}
+
 /* open a read and write connection to host and port or die.
  * exit if trouble.
  */
@@ -324,6 +358,15 @@ static void openINDIServer(FILE **rfpp, FILE **wfpp)
     struct hostent *hp;
     int sockfd;
 
+    /* an absolute path names the Unix-domain socket of a local server */
+    if (host[0] == '/')
+    {
+        sockfd = openUnixSocket(host);
+        *rfpp  = fdopen(sockfd, "r");
+        *wfpp  = fdopen(sockfd, "w");
+        return;
+    }
+
     /* lookup host address */
     hp = gethostbyname(host);
     if (!hp)